@@ -0,0 +1,413 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#include <CryptoNoteConfig.h>
+#include <CryptoNoteCore/Account.h>
+#include <CryptoNoteCore/CryptoNoteBasic.h>
+#include <CryptoNoteCore/CryptoNoteTools.h>
+#include <CryptoNoteCore/Currency.h>
+#include <CryptoNoteCore/TransactionExtra.h>
+#include <Logging/LoggerManager.h>
+#include <NodeRpcProxy/NodeRpcProxy.h>
+#include <WalletLegacy/WalletLegacy.h>
+#include <crypto/hash.h>
+
+#include "FusionPlanner.h"
+#include "TransactionSizeEstimator.h"
+
+using namespace WalletGui;
+
+namespace {
+
+// The wallet scans every output as it would on a real chain, which takes far longer than the measured calls
+const size_t DEFAULT_OUTPUT_COUNTS[] = {10000, 100000, 1000000};
+const char* const DISTRIBUTIONS[] = {"uniform", "dust", "payouts"};
+const size_t DEFAULT_MIXIN = 3;
+const uint64_t SEED = 20160530;
+const size_t OUTPUTS_PER_TRANSACTION = 10;
+// WalletLegacy::createFusionTransaction sizes its inputs for this many outputs
+const size_t MAX_FUSION_OUTPUT_COUNT = 4;
+
+uint64_t pow10(unsigned _power) {
+  uint64_t value = 1;
+  while (_power-- > 0) {
+    value *= 10;
+  }
+
+  return value;
+}
+
+// The wallet only ever holds decomposed amounts, a single significant digit each
+std::vector<uint64_t> makeAmounts(const std::string& _distribution, size_t _count, uint64_t _dustThreshold) {
+  std::mt19937_64 random(SEED);
+  std::uniform_int_distribution<uint64_t> digit(1, 9);
+  const TransactionSizeEstimator estimator(_dustThreshold);
+  std::vector<uint64_t> amounts;
+  amounts.reserve(_count);
+  if (_distribution == "payouts") {
+    // Pool payouts of similar size, every one split into its digits
+    std::normal_distribution<double> payout(5.0 * CryptoNote::parameters::COIN, 1.0 * CryptoNote::parameters::COIN);
+    while (amounts.size() < _count) {
+      for (uint64_t amount : estimator.decompose(static_cast<uint64_t>(std::max(payout(random), 1.0)))) {
+        amounts.push_back(amount);
+      }
+    }
+
+    amounts.resize(_count);
+    return amounts;
+  }
+
+  // Dust-heavy wallets have most outputs a few orders of magnitude above the dust threshold
+  const unsigned lowest = static_cast<unsigned>(std::log10(std::max<uint64_t>(_dustThreshold, 1)));
+  std::uniform_int_distribution<unsigned> uniformPower(lowest, lowest + 8);
+  std::geometric_distribution<unsigned> dustPower(0.5);
+  for (size_t i = 0; i < _count; ++i) {
+    const unsigned power = _distribution == "dust" ? lowest + std::min(dustPower(random), 8u) : uniformPower(random);
+    amounts.push_back(digit(random) * pow10(power));
+  }
+
+  return amounts;
+}
+
+double measureMilliseconds(const std::function<void()>& _function) {
+  auto start = std::chrono::steady_clock::now();
+  _function();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A chain of blocks whose base transactions pay the wallet a few outputs each, served to a real
+// WalletLegacy. NodeRpcProxy is never initialized, only the requests the wallet makes while it
+// synchronizes and sends are answered, all of them synchronously.
+class SyntheticNode : public CryptoNote::NodeRpcProxy {
+public:
+  SyntheticNode(const CryptoNote::Currency& _currency, Logging::LoggerManager& _logManager, const CryptoNote::AccountPublicAddress& _address,
+    const std::vector<uint64_t>& _amounts) : CryptoNote::NodeRpcProxy("127.0.0.1", 0, "/", false, _logManager) {
+    addBlock(_currency.genesisBlockHash(), _currency.genesisBlock());
+    uint32_t globalIndex = 0;
+    for (size_t begin = 0; begin < _amounts.size(); begin += OUTPUTS_PER_TRANSACTION) {
+      const size_t end = std::min(begin + OUTPUTS_PER_TRANSACTION, _amounts.size());
+      CryptoNote::Block block = makeBlock(_address, std::vector<uint64_t>(_amounts.begin() + begin, _amounts.begin() + end));
+      std::vector<uint32_t> indexes;
+      for (size_t i = begin; i < end; ++i) {
+        indexes.push_back(globalIndex++);
+      }
+
+      m_globalIndexes[hashKey(CryptoNote::getObjectHash(block.baseTransaction))] = indexes;
+      addBlock(makeBlockHash(m_blocks.size()), block);
+    }
+
+    // Empty blocks on top, so the last outputs are unlocked as well
+    for (size_t i = 0; i < _currency.transactionSpendableAge(); ++i) {
+      addBlock(makeBlockHash(m_blocks.size()), makeBlock(_address, {}));
+    }
+  }
+
+  uint32_t getLastLocalBlockHeight() const override {
+    return static_cast<uint32_t>(m_blocks.size() - 1);
+  }
+
+  uint32_t getLastKnownBlockHeight() const override {
+    return static_cast<uint32_t>(m_blocks.size() - 1);
+  }
+
+  uint32_t getLocalBlockCount() const override {
+    return static_cast<uint32_t>(m_blocks.size());
+  }
+
+  uint32_t getKnownBlockCount() const override {
+    return static_cast<uint32_t>(m_blocks.size());
+  }
+
+  void queryBlocks(std::vector<Crypto::Hash>&& _knownBlockIds, uint64_t _timestamp, std::vector<CryptoNote::BlockShortEntry>& _newBlocks,
+    uint32_t& _startHeight, const Callback& _callback) override {
+    _startHeight = 0;
+    for (const Crypto::Hash& knownBlockId : _knownBlockIds) {
+      auto height = m_heights.find(hashKey(knownBlockId));
+      if (height != m_heights.end()) {
+        _startHeight = height->second;
+        break;
+      }
+    }
+
+    const size_t end = std::min<size_t>(_startHeight + QUERY_BLOCKS_COUNT, m_blocks.size());
+    _newBlocks.assign(m_blocks.begin() + _startHeight, m_blocks.begin() + end);
+    _callback(std::error_code());
+  }
+
+  void getTransactionOutsGlobalIndices(const Crypto::Hash& _transactionHash, std::vector<uint32_t>& _outsGlobalIndices,
+    const Callback& _callback) override {
+    auto indexes = m_globalIndexes.find(hashKey(_transactionHash));
+    if (indexes == m_globalIndexes.end()) {
+      _callback(std::make_error_code(std::errc::invalid_argument));
+      return;
+    }
+
+    _outsGlobalIndices = indexes->second;
+    _callback(std::error_code());
+  }
+
+  void getPoolSymmetricDifference(std::vector<Crypto::Hash>&& _knownPoolTxIds, Crypto::Hash _knownBlockId, bool& _isBcActual,
+    std::vector<std::unique_ptr<CryptoNote::ITransactionReader>>& _newTxs, std::vector<Crypto::Hash>& _deletedTxIds,
+    const Callback& _callback) override {
+    _isBcActual = _knownBlockId == m_blocks.back().blockHash;
+    _newTxs.clear();
+    _deletedTxIds = std::move(_knownPoolTxIds);
+    _callback(std::error_code());
+  }
+
+  // Sends stop at the node, only the wallet side of a send is measured
+  void getRandomOutsByAmounts(std::vector<uint64_t>&& _amounts, uint16_t _outsCount,
+    std::vector<CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& _result, const Callback& _callback) override {
+    _callback(std::make_error_code(std::errc::operation_canceled));
+  }
+
+  void relayTransaction(const CryptoNote::Transaction& _transaction, const Callback& _callback) override {
+    _callback(std::make_error_code(std::errc::operation_canceled));
+  }
+
+private:
+  static const size_t QUERY_BLOCKS_COUNT = 1000;
+
+  std::vector<CryptoNote::BlockShortEntry> m_blocks;
+  std::unordered_map<std::string, uint32_t> m_heights;
+  std::unordered_map<std::string, std::vector<uint32_t>> m_globalIndexes;
+
+  static std::string hashKey(const Crypto::Hash& _hash) {
+    return std::string(reinterpret_cast<const char*>(&_hash), sizeof(_hash));
+  }
+
+  static Crypto::Hash makeBlockHash(uint64_t _height) {
+    return Crypto::cn_fast_hash(&_height, sizeof(_height));
+  }
+
+  // Outputs are derived for the address as a sender would, the wallet has to recognize them while it scans
+  CryptoNote::Block makeBlock(const CryptoNote::AccountPublicAddress& _address, const std::vector<uint64_t>& _amounts) const {
+    CryptoNote::Block block;
+    block.timestamp = static_cast<uint64_t>(std::time(nullptr));
+    block.previousBlockHash = m_blocks.back().blockHash;
+    CryptoNote::Transaction& transaction = block.baseTransaction;
+    transaction.version = CryptoNote::CURRENT_TRANSACTION_VERSION;
+    transaction.unlockTime = 0;
+    transaction.inputs.push_back(CryptoNote::BaseInput {static_cast<uint32_t>(m_blocks.size())});
+    const CryptoNote::KeyPair transactionKeys = CryptoNote::generateKeyPair();
+    Crypto::KeyDerivation derivation;
+    Crypto::generate_key_derivation(_address.viewPublicKey, transactionKeys.secretKey, derivation);
+    for (size_t i = 0; i < _amounts.size(); ++i) {
+      CryptoNote::KeyOutput output;
+      Crypto::derive_public_key(derivation, i, _address.spendPublicKey, output.key);
+      transaction.outputs.push_back(CryptoNote::TransactionOutput {_amounts[i], output});
+    }
+
+    CryptoNote::addTransactionPublicKeyToExtra(transaction.extra, transactionKeys.publicKey);
+    return block;
+  }
+
+  void addBlock(const Crypto::Hash& _hash, const CryptoNote::Block& _block) {
+    CryptoNote::BlockShortEntry entry;
+    entry.blockHash = _hash;
+    entry.hasBlock = true;
+    entry.block = _block;
+    m_heights[hashKey(_hash)] = static_cast<uint32_t>(m_blocks.size());
+    m_blocks.push_back(std::move(entry));
+  }
+};
+
+class SynchronizationWaiter : public CryptoNote::IWalletLegacyObserver {
+public:
+  SynchronizationWaiter() : m_isCompleted(false) {
+  }
+
+  void synchronizationCompleted(std::error_code _result) override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isCompleted = true;
+    m_result = _result;
+    m_completed.notify_all();
+  }
+
+  std::error_code wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_completed.wait(lock, [this] { return m_isCompleted; });
+    return m_result;
+  }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_completed;
+  bool m_isCompleted;
+  std::error_code m_result;
+};
+
+std::vector<size_t> parseCounts(const char* _list) {
+  std::vector<size_t> counts;
+  std::stringstream stream(_list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    counts.push_back(std::strtoull(item.c_str(), nullptr, 10));
+  }
+
+  return counts;
+}
+
+void usage(const char* _name) {
+  std::cerr << "usage: " << _name << " [--outputs N[,N...]] [--distribution uniform|dust|payouts] [--mixin N] [--threshold AMOUNT] [--json FILE]"
+    << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  std::vector<size_t> outputCounts(std::begin(DEFAULT_OUTPUT_COUNTS), std::end(DEFAULT_OUTPUT_COUNTS));
+  std::vector<std::string> distributions(std::begin(DISTRIBUTIONS), std::end(DISTRIBUTIONS));
+  size_t mixin = DEFAULT_MIXIN;
+  uint64_t threshold = CryptoNote::parameters::COIN;
+  std::string jsonFile;
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 1;
+    }
+
+    if (std::strcmp(argv[i], "--outputs") == 0) {
+      outputCounts = parseCounts(argv[++i]);
+    } else if (std::strcmp(argv[i], "--distribution") == 0) {
+      distributions = {argv[++i]};
+      if (std::find(std::begin(DISTRIBUTIONS), std::end(DISTRIBUTIONS), distributions.front()) == std::end(DISTRIBUTIONS)) {
+        usage(argv[0]);
+        return 1;
+      }
+    } else if (std::strcmp(argv[i], "--mixin") == 0) {
+      mixin = std::strtoull(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--threshold") == 0) {
+      threshold = std::strtoull(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--json") == 0) {
+      jsonFile = argv[++i];
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  Logging::LoggerManager logManager;
+  const CryptoNote::Currency currency = CryptoNote::CurrencyBuilder(logManager).currency();
+  const size_t maxFusionInputCount = currency.getApproximateMaximumInputCount(currency.fusionTxMaxSize(), MAX_FUSION_OUTPUT_COUNT, mixin);
+  const FusionPlanParameters parameters {threshold, currency.defaultDustThreshold(), mixin, currency.fusionTxMaxSize(),
+    currency.fusionTxMinInputCount(), currency.fusionTxMinInOutCountRatio(), 0, 0};
+  const FusionPlanner planner(parameters);
+
+  std::cout << std::setw(10) << "dist" << std::setw(10) << "outputs" << std::setw(12) << "sync ms" << std::setw(14) << "estimate ms"
+    << std::setw(14) << "select ms" << std::setw(12) << "send ms" << std::setw(14) << "plan ms" << std::setw(8) << "txs" << std::setw(12) << "final"
+    << std::endl;
+
+  std::stringstream json;
+  json << "{\n  \"mixin\": " << mixin << ",\n  \"threshold\": " << threshold << ",\n  \"results\": [";
+  bool first = true;
+  for (const std::string& distribution : distributions) {
+    for (size_t outputCount : outputCounts) {
+      const std::vector<uint64_t> amounts = makeAmounts(distribution, outputCount, parameters.dustThreshold);
+      uint64_t total = 0;
+      for (uint64_t amount : amounts) {
+        total += amount;
+      }
+
+      CryptoNote::AccountBase account;
+      account.generate();
+      SyntheticNode node(currency, logManager, account.getAccountKeys().address, amounts);
+      CryptoNote::WalletLegacy wallet(currency, node, logManager);
+      SynchronizationWaiter waiter;
+      wallet.addObserver(&waiter);
+      std::error_code syncResult;
+      const double syncMs = measureMilliseconds([&] {
+        wallet.initWithKeys(account.getAccountKeys(), "", 0);
+        syncResult = waiter.wait();
+      });
+
+      if (syncResult || wallet.getUnlockedOutputsCount() != outputCount) {
+        std::cerr << "wallet synchronization failed: " << syncResult.message() << ", " << wallet.getUnlockedOutputsCount() << " of " << outputCount
+          << " outputs unlocked" << std::endl;
+        wallet.removeObserver(&waiter);
+        wallet.shutdown();
+        return 1;
+      }
+
+      size_t estimate = 0;
+      std::list<CryptoNote::TransactionOutputInformation> fusionInputs;
+      FusionPlan plan;
+      const double estimateMs = measureMilliseconds([&] { estimate = wallet.estimateFusion(threshold); });
+      const double selectMs = measureMilliseconds([&] {
+        fusionInputs = wallet.selectFusionTransfersToSend(threshold, currency.fusionTxMinInputCount(), maxFusionInputCount);
+      });
+
+      // Half of the balance, what a large send has to gather. Input selection and, without mixin, signing happen
+      // before sendTransaction returns, the node refuses the random outputs or the relay that would follow.
+      CryptoNote::WalletLegacyTransfer transfer;
+      transfer.address = wallet.getAddress();
+      transfer.amount = static_cast<int64_t>(total / 2);
+      const double sendMs = measureMilliseconds([&] {
+        try {
+          wallet.sendTransaction(transfer, currency.minimumFee(), "", mixin, 0);
+        } catch (std::system_error& error) {
+          std::cerr << "send failed: " << error.what() << std::endl;
+        }
+      });
+
+      // The consolidation the optimization manager plans over the same outputs
+      const double planMs = measureMilliseconds([&] {
+        std::vector<CryptoNote::TransactionOutputInformation> outputs = wallet.getUnlockedOutputs();
+        std::vector<uint64_t> outputAmounts;
+        outputAmounts.reserve(outputs.size());
+        for (const CryptoNote::TransactionOutputInformation& output : outputs) {
+          outputAmounts.push_back(output.amount);
+        }
+
+        plan = planner.plan(outputAmounts);
+      });
+
+      wallet.removeObserver(&waiter);
+      wallet.shutdown();
+
+      std::cout << std::setw(10) << distribution << std::setw(10) << outputCount << std::fixed << std::setprecision(2)
+        << std::setw(12) << syncMs << std::setw(14) << estimateMs << std::setw(14) << selectMs << std::setw(12) << sendMs
+        << std::setw(14) << planMs << std::setw(8) << plan.transactions.size() << std::setw(12) << plan.finalOutputCount << std::endl;
+
+      json << (first ? "" : ",") << "\n    {\"distribution\": \"" << distribution << "\", \"outputs\": " << outputCount
+        << ", \"syncMs\": " << syncMs << ", \"fusionReady\": " << estimate << ", \"estimateMs\": " << estimateMs
+        << ", \"selectMs\": " << selectMs << ", \"selectedInputs\": " << fusionInputs.size() << ", \"sendMs\": " << sendMs
+        << ", \"planMs\": " << planMs << ", \"planTransactions\": " << plan.transactions.size() << ", \"planRounds\": " << plan.roundCount
+        << ", \"finalOutputs\": " << plan.finalOutputCount << "}";
+      first = false;
+    }
+  }
+
+  json << "\n  ]\n}\n";
+  if (!jsonFile.empty()) {
+    std::ofstream file(jsonFile);
+    if (!file) {
+      std::cerr << "cannot write " << jsonFile << std::endl;
+      return 1;
+    }
+
+    file << json.str();
+  }
+
+  return 0;
+}
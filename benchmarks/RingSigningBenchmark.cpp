@@ -0,0 +1,118 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include <crypto/hash.h>
+
+#include "RingSigner.h"
+
+using namespace WalletGui;
+
+namespace {
+
+const size_t INPUT_COUNTS[] = {1, 8, 32, 128, 256};
+const size_t MIXINS[] = {0, 3, 7, 12};
+
+std::vector<RingSigningInput> makeInputs(size_t _inputCount, size_t _mixin) {
+  std::vector<RingSigningInput> inputs(_inputCount);
+  for (size_t i = 0; i < _inputCount; ++i) {
+    RingSigningInput& input = inputs[i];
+    input.ring.resize(_mixin + 1);
+    input.realIndex = i % input.ring.size();
+    for (size_t j = 0; j < input.ring.size(); ++j) {
+      Crypto::SecretKey secretKey;
+      Crypto::generate_keys(input.ring[j], secretKey);
+      if (j == input.realIndex) {
+        input.ephemeralSecretKey = secretKey;
+      }
+    }
+  }
+
+  return inputs;
+}
+
+double signMilliseconds(const RingSigner& _signer, const Crypto::Hash& _prefixHash, const std::vector<RingSigningInput>& _inputs,
+  std::vector<Crypto::KeyImage>& _keyImages, std::vector<std::vector<Crypto::Signature>>& _signatures) {
+  auto start = std::chrono::steady_clock::now();
+  _keyImages = _signer.generateKeyImages(_inputs);
+  _signatures = _signer.sign(_prefixHash, _inputs, _keyImages);
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Signatures are randomized, so they are checked against the ring instead of compared
+bool checkSignatures(const Crypto::Hash& _prefixHash, const std::vector<RingSigningInput>& _inputs,
+  const std::vector<Crypto::KeyImage>& _keyImages, const std::vector<std::vector<Crypto::Signature>>& _signatures) {
+  if (_signatures.size() != _inputs.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < _inputs.size(); ++i) {
+    std::vector<const Crypto::PublicKey*> keys;
+    for (const Crypto::PublicKey& key : _inputs[i].ring) {
+      keys.push_back(&key);
+    }
+
+    if (_signatures[i].size() != keys.size() ||
+        !Crypto::check_ring_signature(_prefixHash, _keyImages[i], keys.data(), keys.size(), _signatures[i].data())) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  size_t threads = 0;
+  if (argc > 1) {
+    threads = std::strtoul(argv[1], nullptr, 10);
+  }
+
+  const RingSigner serialSigner(1);
+  const RingSigner parallelSigner(threads);
+  Crypto::Hash prefixHash;
+  const char prefix[] = "ring signing benchmark";
+  Crypto::cn_fast_hash(prefix, sizeof(prefix), prefixHash);
+
+  std::cout << "threads: " << parallelSigner.getThreadCount() << std::endl;
+  std::cout << std::setw(8) << "inputs" << std::setw(8) << "mixin" << std::setw(14) << "serial ms" << std::setw(14) << "parallel ms"
+    << std::setw(14) << "inputs/s" << std::setw(10) << "speedup" << std::endl;
+
+  int result = 0;
+  for (size_t mixin : MIXINS) {
+    for (size_t inputCount : INPUT_COUNTS) {
+      std::vector<RingSigningInput> inputs = makeInputs(inputCount, mixin);
+      std::vector<Crypto::KeyImage> serialKeyImages;
+      std::vector<Crypto::KeyImage> parallelKeyImages;
+      std::vector<std::vector<Crypto::Signature>> serialSignatures;
+      std::vector<std::vector<Crypto::Signature>> parallelSignatures;
+      const double serialMs = signMilliseconds(serialSigner, prefixHash, inputs, serialKeyImages, serialSignatures);
+      const double parallelMs = signMilliseconds(parallelSigner, prefixHash, inputs, parallelKeyImages, parallelSignatures);
+
+      // Both paths must produce the same key images in the same order
+      if (std::memcmp(serialKeyImages.data(), parallelKeyImages.data(), serialKeyImages.size() * sizeof(Crypto::KeyImage)) != 0) {
+        std::cerr << "key images differ for " << inputCount << " inputs, mixin " << mixin << std::endl;
+        result = 1;
+      }
+
+      if (!checkSignatures(prefixHash, inputs, parallelKeyImages, parallelSignatures)) {
+        std::cerr << "invalid parallel signature for " << inputCount << " inputs, mixin " << mixin << std::endl;
+        result = 1;
+      }
+
+      std::cout << std::setw(8) << inputCount << std::setw(8) << mixin << std::fixed << std::setprecision(2)
+        << std::setw(14) << serialMs << std::setw(14) << parallelMs
+        << std::setw(14) << (parallelMs > 0 ? inputCount * 1000.0 / parallelMs : 0.0)
+        << std::setw(10) << (parallelMs > 0 ? serialMs / parallelMs : 0.0) << std::endl;
+    }
+  }
+
+  return result;
+}
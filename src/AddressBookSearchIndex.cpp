@@ -0,0 +1,326 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+
+#include <QRegularExpression>
+#include <QSet>
+
+#include "AddressBookSearchIndex.h"
+
+namespace WalletGui {
+
+namespace {
+
+const int PREFIX_LENGTH = 2;
+const int TOLERANT_LENGTH = 5;
+
+const int SCORE_LABEL_EXACT = 100;
+const int SCORE_LABEL_PREFIX = 80;
+const int SCORE_LABEL_WORD = 60;
+const int SCORE_KEY_PREFIX = 50;
+const int SCORE_LABEL_SUBSTRING = 40;
+const int SCORE_KEY_SUBSTRING = 30;
+const int SCORE_TOLERANT = 10;
+
+quint64 trigram(const QChar* _chars) {
+  return (static_cast<quint64>(_chars[0].unicode()) << 32) | (static_cast<quint64>(_chars[1].unicode()) << 16) | _chars[2].unicode();
+}
+
+bool containsTrigram(const QString& _text, quint64 _key) {
+  for (int i = 0; i + 2 < _text.size(); ++i) {
+    if (trigram(_text.constData() + i) == _key) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+}
+
+AddressBookSearchIndex::AddressBookSearchIndex() {
+}
+
+AddressBookSearchIndex::~AddressBookSearchIndex() {
+}
+
+void AddressBookSearchIndex::clear() {
+  m_rows.clear();
+  m_prefixIndex.clear();
+  m_trigramIndex.clear();
+  m_matches.clear();
+}
+
+int AddressBookSearchIndex::size() const {
+  return m_rows.size();
+}
+
+void AddressBookSearchIndex::append(const QString& _label, const QString& _address, const QString& _paymentId) {
+  m_rows.append(Row {_label.toLower(), _address.toLower(), _paymentId.toLower()});
+  const int row = m_rows.size() - 1;
+  indexRow(row);
+  const int score = scoreRow(row);
+  if (score >= 0) {
+    m_matches.insert(row, score);
+  }
+}
+
+void AddressBookSearchIndex::update(int _row, const QString& _label, const QString& _address, const QString& _paymentId) {
+  if (_row < 0 || _row >= m_rows.size()) {
+    return;
+  }
+
+  unindexRow(_row);
+  m_rows[_row] = Row {_label.toLower(), _address.toLower(), _paymentId.toLower()};
+  indexRow(_row);
+  const int score = scoreRow(_row);
+  if (score >= 0) {
+    m_matches.insert(_row, score);
+  } else {
+    m_matches.remove(_row);
+  }
+}
+
+void AddressBookSearchIndex::removeLast() {
+  if (m_rows.isEmpty()) {
+    return;
+  }
+
+  const int row = m_rows.size() - 1;
+  unindexRow(row);
+  m_matches.remove(row);
+  m_rows.removeLast();
+}
+
+void AddressBookSearchIndex::setQuery(const QString& _query) {
+  const QStringList tokens = _query.toLower().split(QRegularExpression("\\s+"), QString::SkipEmptyParts);
+  if (tokens.isEmpty()) {
+    m_tokens.clear();
+    m_matches.clear();
+    return;
+  }
+
+  // Every match of the extended query is a match of the previous one
+  QVector<int> candidates;
+  if (canRefine(tokens)) {
+    candidates.reserve(m_matches.size());
+    for (auto it = m_matches.constBegin(); it != m_matches.constEnd(); ++it) {
+      candidates.append(it.key());
+    }
+  } else {
+    bool first = true;
+    for (const QString& token : tokens) {
+      QVector<int> tokenCandidates = getCandidates(token);
+      if (first || tokenCandidates.size() < candidates.size()) {
+        candidates.swap(tokenCandidates);
+        first = false;
+      }
+    }
+  }
+
+  m_tokens = tokens;
+  m_matches.clear();
+  for (int row : candidates) {
+    const int score = scoreRow(row);
+    if (score >= 0) {
+      m_matches.insert(row, score);
+    }
+  }
+}
+
+bool AddressBookSearchIndex::isQueryEmpty() const {
+  return m_tokens.isEmpty();
+}
+
+bool AddressBookSearchIndex::matches(int _row) const {
+  return m_tokens.isEmpty() || m_matches.contains(_row);
+}
+
+int AddressBookSearchIndex::getScore(int _row) const {
+  return m_matches.value(_row, -1);
+}
+
+AddressBookSearchIndex::Mode AddressBookSearchIndex::getMode(const QString& _token) {
+  if (_token.size() <= PREFIX_LENGTH) {
+    return Mode::PREFIX;
+  }
+
+  return _token.size() < TOLERANT_LENGTH ? Mode::SUBSTRING : Mode::TOLERANT;
+}
+
+QStringList AddressBookSearchIndex::getWords(const Row& _row) {
+  static const QRegularExpression separator("[^\\w]+", QRegularExpression::UseUnicodePropertiesOption);
+  QStringList words = _row.label.split(separator, QString::SkipEmptyParts);
+  if (!_row.address.isEmpty()) {
+    words.append(_row.address);
+  }
+
+  if (!_row.paymentId.isEmpty()) {
+    words.append(_row.paymentId);
+  }
+
+  return words;
+}
+
+QVector<quint64> AddressBookSearchIndex::getTrigrams(const QString& _text) {
+  QVector<quint64> trigrams;
+  for (int i = 0; i + 2 < _text.size(); ++i) {
+    trigrams.append(trigram(_text.constData() + i));
+  }
+
+  return trigrams;
+}
+
+QVector<quint64> AddressBookSearchIndex::getTrigrams(const Row& _row) {
+  QVector<quint64> trigrams = getTrigrams(_row.label) + getTrigrams(_row.address) + getTrigrams(_row.paymentId);
+  std::sort(trigrams.begin(), trigrams.end());
+  trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+  return trigrams;
+}
+
+QStringList AddressBookSearchIndex::getPrefixes(const Row& _row) {
+  QSet<QString> prefixes;
+  for (const QString& word : getWords(_row)) {
+    for (int length = 1; length <= PREFIX_LENGTH && length <= word.size(); ++length) {
+      prefixes.insert(word.left(length));
+    }
+  }
+
+  return prefixes.toList();
+}
+
+void AddressBookSearchIndex::indexRow(int _row) {
+  const Row& row = m_rows.at(_row);
+  for (const QString& prefix : getPrefixes(row)) {
+    m_prefixIndex[prefix].append(_row);
+  }
+
+  for (quint64 key : getTrigrams(row)) {
+    m_trigramIndex[key].append(_row);
+  }
+}
+
+void AddressBookSearchIndex::unindexRow(int _row) {
+  const Row& row = m_rows.at(_row);
+  for (const QString& prefix : getPrefixes(row)) {
+    auto it = m_prefixIndex.find(prefix);
+    if (it != m_prefixIndex.end() && it->removeOne(_row) && it->isEmpty()) {
+      m_prefixIndex.erase(it);
+    }
+  }
+
+  for (quint64 key : getTrigrams(row)) {
+    auto it = m_trigramIndex.find(key);
+    if (it != m_trigramIndex.end() && it->removeOne(_row) && it->isEmpty()) {
+      m_trigramIndex.erase(it);
+    }
+  }
+}
+
+// A superset of the rows matching the token, taken from the indexes
+QVector<int> AddressBookSearchIndex::getCandidates(const QString& _token) const {
+  const Mode mode = getMode(_token);
+  if (mode == Mode::PREFIX) {
+    return m_prefixIndex.value(_token);
+  }
+
+  QVector<QVector<int>> postings;
+  for (quint64 key : getTrigrams(_token)) {
+    postings.append(m_trigramIndex.value(key));
+  }
+
+  std::sort(postings.begin(), postings.end(), [](const QVector<int>& _left, const QVector<int>& _right) {
+    return _left.size() < _right.size();
+  });
+
+  if (mode == Mode::SUBSTRING) {
+    return postings.front();
+  }
+
+  // A row missing one trigram of the token still has at least one of any two of them
+  QVector<int> candidates = postings.at(0) + postings.at(1);
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+  return candidates;
+}
+
+int AddressBookSearchIndex::scoreToken(const Row& _row, const QString& _token) const {
+  if (_row.label == _token) {
+    return SCORE_LABEL_EXACT;
+  }
+
+  if (_row.label.startsWith(_token)) {
+    return SCORE_LABEL_PREFIX;
+  }
+
+  const QStringList words = getWords(_row);
+  for (int i = 0; i < words.size(); ++i) {
+    if (words[i].startsWith(_token)) {
+      return words[i] == _row.address || words[i] == _row.paymentId ? SCORE_KEY_PREFIX : SCORE_LABEL_WORD;
+    }
+  }
+
+  const Mode mode = getMode(_token);
+  if (mode == Mode::PREFIX) {
+    return -1;
+  }
+
+  if (_row.label.contains(_token)) {
+    return SCORE_LABEL_SUBSTRING;
+  }
+
+  if (_row.address.contains(_token) || _row.paymentId.contains(_token)) {
+    return SCORE_KEY_SUBSTRING;
+  }
+
+  if (mode == Mode::SUBSTRING) {
+    return -1;
+  }
+
+  int missing = 0;
+  for (quint64 key : getTrigrams(_token)) {
+    if (!containsTrigram(_row.label, key) && !containsTrigram(_row.address, key) && !containsTrigram(_row.paymentId, key) &&
+        ++missing > 1) {
+      return -1;
+    }
+  }
+
+  return SCORE_TOLERANT;
+}
+
+int AddressBookSearchIndex::scoreRow(int _row) const {
+  if (m_tokens.isEmpty()) {
+    return -1;
+  }
+
+  int score = 0;
+  for (const QString& token : m_tokens) {
+    const int tokenScore = scoreToken(m_rows.at(_row), token);
+    if (tokenScore < 0) {
+      return -1;
+    }
+
+    score += tokenScore;
+  }
+
+  return score;
+}
+
+// Refining is exact as long as every word only grew and kept its kind of match
+bool AddressBookSearchIndex::canRefine(const QStringList& _tokens) const {
+  if (m_tokens.isEmpty() || _tokens.size() < m_tokens.size()) {
+    return false;
+  }
+
+  for (int i = 0; i < m_tokens.size(); ++i) {
+    if (!_tokens[i].startsWith(m_tokens[i]) || getMode(_tokens[i]) != getMode(m_tokens[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace WalletGui {
+
+// Search over the contacts of the address book by row. Every whitespace separated word of the query
+// has to match, in any order and case insensitively: words of one or two letters against the start of
+// a label word, an address or a payment ID through a prefix index, longer ones as a substring through
+// a trigram index. From five letters on a match may miss one trigram of the word, which tolerates a typo.
+// Matches are ranked, exact and leading matches of the label first.
+//
+// A query that only extends the previous one is answered by refining the previous matches.
+class AddressBookSearchIndex {
+public:
+  AddressBookSearchIndex();
+  ~AddressBookSearchIndex();
+
+  void clear();
+  int size() const;
+  // Rows are kept in step with the model, new ones are appended and only the last ones can be removed
+  void append(const QString& _label, const QString& _address, const QString& _paymentId);
+  void update(int _row, const QString& _label, const QString& _address, const QString& _paymentId);
+  void removeLast();
+
+  void setQuery(const QString& _query);
+  bool isQueryEmpty() const;
+  bool matches(int _row) const;
+  // Higher is better, -1 for rows that don't match
+  int getScore(int _row) const;
+
+private:
+  struct Row {
+    QString label;
+    QString address;
+    QString paymentId;
+  };
+
+  enum class Mode { PREFIX, SUBSTRING, TOLERANT };
+
+  QVector<Row> m_rows;
+  QHash<QString, QVector<int>> m_prefixIndex;
+  QHash<quint64, QVector<int>> m_trigramIndex;
+  QStringList m_tokens;
+  QHash<int, int> m_matches;
+
+  static Mode getMode(const QString& _token);
+  static QStringList getWords(const Row& _row);
+  static QVector<quint64> getTrigrams(const QString& _text);
+  static QVector<quint64> getTrigrams(const Row& _row);
+  static QStringList getPrefixes(const Row& _row);
+
+  void indexRow(int _row);
+  void unindexRow(int _row);
+  QVector<int> getCandidates(const QString& _token) const;
+  int scoreToken(const Row& _row, const QString& _token) const;
+  int scoreRow(int _row) const;
+  bool canRefine(const QStringList& _tokens) const;
+};
+
+}
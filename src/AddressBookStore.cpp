@@ -0,0 +1,308 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QDataStream>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include "AddressBookStore.h"
+
+namespace WalletGui {
+
+namespace {
+
+const quint32 JOURNAL_MAGIC = 0x4b414242;
+const quint32 JOURNAL_VERSION = 1;
+const quint8 RECORD_ADD = 1;
+const quint8 RECORD_REMOVE = 2;
+const int MIN_COMPACT_RECORDS = 1024;
+
+QString paymentKey(const QString& _address, const QString& _paymentId) {
+  return _address + QLatin1Char('\n') + _paymentId;
+}
+
+QByteArray journalHeader() {
+  QByteArray header;
+  QDataStream out(&header, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_5_0);
+  out << JOURNAL_MAGIC << JOURNAL_VERSION;
+  return header;
+}
+
+QByteArray addRecord(const AddressBookEntry& _entry) {
+  QByteArray record;
+  QDataStream out(&record, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_5_0);
+  out << RECORD_ADD << _entry.id << _entry.label << _entry.address << _entry.paymentId;
+  return record;
+}
+
+QByteArray removeRecord(quint64 _id) {
+  QByteArray record;
+  QDataStream out(&record, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_5_0);
+  out << RECORD_REMOVE << _id;
+  return record;
+}
+
+}
+
+AddressBookStore::AddressBookStore() : m_nextId(0), m_deadRecords(0) {
+}
+
+AddressBookStore::~AddressBookStore() {
+  close();
+}
+
+bool AddressBookStore::open(const QString& _fileName) {
+  close();
+  m_fileName = _fileName;
+  bool rewrite = false;
+  QFile file(m_fileName);
+  if (file.open(QIODevice::ReadOnly)) {
+    QByteArray data = file.readAll();
+    file.close();
+    if (data.trimmed().startsWith('[')) {
+      if (!importJson(data)) {
+        return false;
+      }
+
+      // The conversion replaces the file, keep the original in case it goes wrong
+      const QString backupFile = m_fileName + ".bak";
+      QFile::remove(backupFile);
+      if (!QFile::copy(m_fileName, backupFile)) {
+        return false;
+      }
+
+      rewrite = true;
+    } else if (!data.isEmpty()) {
+      if (!data.startsWith(journalHeader())) {
+        // Not ours, leave the file as it is
+        return false;
+      }
+
+      // A record cut short by a crash is dropped with everything after it
+      rewrite = !replayJournal(data);
+    }
+  }
+
+  if (rewrite) {
+    // Appending to anything but a whole journal would lose the new records
+    return compact() && openJournal();
+  }
+
+  if (m_deadRecords > qMax(MIN_COMPACT_RECORDS, size())) {
+    compact();
+  }
+
+  return openJournal();
+}
+
+void AddressBookStore::close() {
+  m_journal.close();
+  m_fileName.clear();
+  m_entries.clear();
+  m_rows.clear();
+  m_labelIndex.clear();
+  m_addressIndex.clear();
+  m_paymentIndex.clear();
+  m_nextId = 0;
+  m_deadRecords = 0;
+}
+
+bool AddressBookStore::isOpen() const {
+  return m_journal.isOpen();
+}
+
+int AddressBookStore::size() const {
+  return m_entries.size();
+}
+
+const AddressBookEntry& AddressBookStore::at(int _row) const {
+  return m_entries.at(_row);
+}
+
+int AddressBookStore::findByLabel(const QString& _label) const {
+  return m_labelIndex.value(_label, -1);
+}
+
+int AddressBookStore::findByAddress(const QString& _address, const QString& _paymentId) const {
+  if (_paymentId.isEmpty()) {
+    return m_addressIndex.value(_address, -1);
+  }
+
+  return m_paymentIndex.value(paymentKey(_address, _paymentId), -1);
+}
+
+QStringList AddressBookStore::getPaymentIds(const QString& _address) const {
+  QStringList paymentIds;
+  for (auto it = m_addressIndex.constFind(_address); it != m_addressIndex.constEnd() && it.key() == _address; ++it) {
+    const QString& paymentId = m_entries.at(it.value()).paymentId;
+    if (!paymentId.isEmpty() && !paymentIds.contains(paymentId)) {
+      paymentIds.append(paymentId);
+    }
+  }
+
+  return paymentIds;
+}
+
+int AddressBookStore::append(const QString& _label, const QString& _address, const QString& _paymentId) {
+  if (!isOpen()) {
+    return -1;
+  }
+
+  const AddressBookEntry entry {m_nextId, _label, _address, _paymentId};
+  insertEntry(entry);
+  writeRecord(addRecord(entry));
+  return m_entries.size() - 1;
+}
+
+void AddressBookStore::remove(int _row) {
+  if (!isOpen() || _row < 0 || _row >= m_entries.size()) {
+    return;
+  }
+
+  writeRecord(removeRecord(m_entries.at(_row).id));
+  removeEntry(_row);
+  // Both the add and the remove record of the contact are dead now
+  m_deadRecords += 2;
+  if (m_deadRecords > qMax(MIN_COMPACT_RECORDS, size())) {
+    // A failed compaction leaves the journal as it was
+    compact();
+    openJournal();
+  }
+}
+
+void AddressBookStore::insertEntry(const AddressBookEntry& _entry) {
+  if (m_rows.contains(_entry.id)) {
+    return;
+  }
+
+  m_entries.append(_entry);
+  indexEntry(m_entries.size() - 1);
+  m_nextId = qMax(m_nextId, _entry.id + 1);
+}
+
+void AddressBookStore::removeEntry(int _row) {
+  const int lastRow = m_entries.size() - 1;
+  unindexEntry(_row);
+  if (_row != lastRow) {
+    unindexEntry(lastRow);
+    m_entries[_row] = m_entries.at(lastRow);
+    indexEntry(_row);
+  }
+
+  m_entries.removeLast();
+}
+
+void AddressBookStore::indexEntry(int _row) {
+  const AddressBookEntry& entry = m_entries.at(_row);
+  m_rows.insert(entry.id, _row);
+  m_labelIndex.insert(entry.label, _row);
+  m_addressIndex.insert(entry.address, _row);
+  m_paymentIndex.insert(paymentKey(entry.address, entry.paymentId), _row);
+}
+
+void AddressBookStore::unindexEntry(int _row) {
+  const AddressBookEntry& entry = m_entries.at(_row);
+  m_rows.remove(entry.id);
+  m_labelIndex.remove(entry.label, _row);
+  m_addressIndex.remove(entry.address, _row);
+  m_paymentIndex.remove(paymentKey(entry.address, entry.paymentId), _row);
+}
+
+bool AddressBookStore::importJson(const QByteArray& _data) {
+  QJsonDocument doc = QJsonDocument::fromJson(_data);
+  if (!doc.isArray()) {
+    return false;
+  }
+
+  for (const QJsonValue& value : doc.array()) {
+    const QJsonObject contact = value.toObject();
+    insertEntry(AddressBookEntry {m_nextId, contact.value("label").toString(), contact.value("address").toString(),
+      contact.value("paymentid").toString()});
+  }
+
+  return true;
+}
+
+bool AddressBookStore::replayJournal(const QByteArray& _data) {
+  QDataStream in(_data);
+  in.setVersion(QDataStream::Qt_5_0);
+  quint32 magic;
+  quint32 version;
+  in >> magic >> version;
+  while (!in.atEnd()) {
+    quint8 type;
+    quint64 id;
+    in >> type >> id;
+    if (type == RECORD_ADD) {
+      AddressBookEntry entry {id, QString(), QString(), QString()};
+      in >> entry.label >> entry.address >> entry.paymentId;
+      if (in.status() != QDataStream::Ok) {
+        return false;
+      }
+
+      insertEntry(entry);
+    } else if (type == RECORD_REMOVE && in.status() == QDataStream::Ok) {
+      auto row = m_rows.constFind(id);
+      if (row != m_rows.constEnd()) {
+        removeEntry(row.value());
+      }
+
+      m_deadRecords += 2;
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool AddressBookStore::openJournal() {
+  m_journal.setFileName(m_fileName);
+  if (!m_journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+    return false;
+  }
+
+  if (m_journal.size() == 0) {
+    writeRecord(journalHeader());
+  }
+
+  return true;
+}
+
+void AddressBookStore::writeRecord(const QByteArray& _record) {
+  if (!m_journal.isOpen()) {
+    return;
+  }
+
+  m_journal.write(_record);
+  m_journal.flush();
+}
+
+bool AddressBookStore::compact() {
+  // The journal has to be closed before it can be replaced on Windows
+  m_journal.close();
+  QSaveFile file(m_fileName);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+
+  file.write(journalHeader());
+  for (const AddressBookEntry& entry : m_entries) {
+    file.write(addRecord(entry));
+  }
+
+  if (!file.commit()) {
+    return false;
+  }
+
+  m_deadRecords = 0;
+  return true;
+}
+
+}
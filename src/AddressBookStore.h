@@ -0,0 +1,74 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QFile>
+#include <QHash>
+#include <QMultiHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace WalletGui {
+
+struct AddressBookEntry {
+  quint64 id;
+  QString label;
+  QString address;
+  QString paymentId;
+};
+
+// Contacts kept in memory with hash indexes by label, address and address with payment ID.
+// On disk the address book is a journal of added and removed contacts, so a change costs one
+// appended record. The journal is rewritten with only the live contacts once removed ones
+// outnumber them, and an address book in the old JSON format is converted on open, after copying it
+// to a ".bak" file next to it.
+class AddressBookStore {
+public:
+  AddressBookStore();
+  ~AddressBookStore();
+
+  // On failure the contacts read so far stay readable, but nothing can be changed
+  bool open(const QString& _fileName);
+  void close();
+  bool isOpen() const;
+
+  int size() const;
+  const AddressBookEntry& at(int _row) const;
+
+  // Rows are -1 when nothing matches
+  int findByLabel(const QString& _label) const;
+  // Any contact with the address if _paymentId is empty, otherwise the one with exactly this payment ID
+  int findByAddress(const QString& _address, const QString& _paymentId = QString()) const;
+  QStringList getPaymentIds(const QString& _address) const;
+
+  // Returns the row of the new contact, always the last one, or -1 when the store isn't open
+  int append(const QString& _label, const QString& _address, const QString& _paymentId);
+  // The last contact takes the place of the removed one
+  void remove(int _row);
+
+private:
+  QString m_fileName;
+  QFile m_journal;
+  QVector<AddressBookEntry> m_entries;
+  QHash<quint64, int> m_rows;
+  QMultiHash<QString, int> m_labelIndex;
+  QMultiHash<QString, int> m_addressIndex;
+  QMultiHash<QString, int> m_paymentIndex;
+  quint64 m_nextId;
+  int m_deadRecords;
+
+  void insertEntry(const AddressBookEntry& _entry);
+  void removeEntry(int _row);
+  void indexEntry(int _row);
+  void unindexEntry(int _row);
+  bool importJson(const QByteArray& _data);
+  bool replayJournal(const QByteArray& _data);
+  bool openJournal();
+  void writeRecord(const QByteArray& _record);
+  bool compact();
+};
+
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QFile>
+#include <QSaveFile>
+
+#include <crypto/random.h>
+
+#include "AuthCookie.h"
+
+namespace WalletGui {
+
+AuthCookie::AuthCookie() {
+}
+
+AuthCookie::~AuthCookie() {
+}
+
+bool AuthCookie::create(const QString& _fileName) {
+  remove();
+  QByteArray secret(32, 0);
+  Random::randomBytes(secret.size(), reinterpret_cast<uint8_t*>(secret.data()));
+  QSaveFile cookie(_fileName);
+  if (!cookie.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+
+  cookie.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+  cookie.write(secret.toHex());
+  if (!cookie.commit()) {
+    return false;
+  }
+
+  m_fileName = _fileName;
+  m_token = secret.toHex();
+  return true;
+}
+
+void AuthCookie::remove() {
+  if (!m_fileName.isEmpty()) {
+    QFile::remove(m_fileName);
+  }
+
+  m_fileName.clear();
+  m_token.clear();
+}
+
+bool AuthCookie::isValid(const QByteArray& _token) const {
+  if (m_token.isEmpty() || _token.size() != m_token.size()) {
+    return false;
+  }
+
+  char difference = 0;
+  for (int i = 0; i < _token.size(); ++i) {
+    difference |= _token[i] ^ m_token[i];
+  }
+
+  return difference == 0;
+}
+
+}
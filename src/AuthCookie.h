@@ -0,0 +1,30 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+namespace WalletGui {
+
+// A random token in an owner-only file, so local clients prove they run as the wallet's user by
+// reading it. Every create() writes a new token, remove() deletes the file and forgets the token.
+class AuthCookie {
+public:
+  AuthCookie();
+  ~AuthCookie();
+
+  bool create(const QString& _fileName);
+  void remove();
+
+  // Compared in constant time, nothing matches while there is no token
+  bool isValid(const QByteArray& _token) const;
+
+private:
+  QString m_fileName;
+  QByteArray m_token;
+};
+
+}
@@ -29,7 +29,11 @@ CommandLineParser::CommandLineParser(QObject* _parent) : QObject(_parent), m_par
   m_dataDirOption("data-dir", tr("Specify data directory"), tr("directory"), QString::fromLocal8Bit(Tools::getDefaultDataDirectory().c_str())),
   m_rollBackOption("rollback", tr("Rollback to height"), tr("height"), QString::number(std::numeric_limits<uint32_t>::max())),
   m_minimized("minimized", tr("Run application in minimized mode")),
-  m_levelDb("level-db", tr("Use LevelDB instead of RocksDB"))
+  m_levelDb("level-db", tr("Use LevelDB instead of RocksDB")),
+  m_profileStartupOption("profile-startup", tr("Write the timings of the startup stages to a trace file in the data directory")),
+  m_headlessOption("headless", tr("Run the node and the last opened wallet without the user interface, logging to the console")),
+  m_passwordFileOption("password-file", tr("Read the password of the wallet from the file in headless mode"), tr("file")),
+  m_walletRpcPortOption("wallet-rpc-port", tr("Serve the JSON-RPC wallet API on the port of the loopback interface"), tr("port"), "0")
 {
   m_parser.setApplicationDescription(tr("Karbowanec wallet"));
   m_parser.addHelpOption();
@@ -48,6 +52,10 @@ CommandLineParser::CommandLineParser(QObject* _parent) : QObject(_parent), m_par
   m_parser.addOption(m_rollBackOption);
   m_parser.addOption(m_minimized);
   m_parser.addOption(m_levelDb);
+  m_parser.addOption(m_profileStartupOption);
+  m_parser.addOption(m_headlessOption);
+  m_parser.addOption(m_passwordFileOption);
+  m_parser.addOption(m_walletRpcPortOption);
 }
 
 CommandLineParser::~CommandLineParser() {
@@ -90,6 +98,14 @@ bool CommandLineParser::hasLevelDBOption() const {
   return m_parser.isSet(m_levelDb);
 }
 
+bool CommandLineParser::hasProfileStartupOption() const {
+  return m_parser.isSet(m_profileStartupOption);
+}
+
+bool CommandLineParser::hasHeadlessOption() const {
+  return m_parser.isSet(m_headlessOption);
+}
+
 QString CommandLineParser::getErrorText() const {
   return m_parser.errorText();
 }
@@ -134,4 +150,22 @@ quint32 CommandLineParser::rollBack() const {
   return m_parser.value(m_rollBackOption).toULong();
 }
 
+QString CommandLineParser::getPasswordFile() const {
+  return m_parser.value(m_passwordFileOption);
+}
+
+quint16 CommandLineParser::getWalletRpcPort() const {
+  return m_parser.value(m_walletRpcPortOption).toUShort();
+}
+
+bool CommandLineParser::isHeadlessRequested(int _argc, char* _argv[]) {
+  for (int i = 1; i < _argc; ++i) {
+    if (qstrcmp(_argv[i], "--headless") == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 }
@@ -26,6 +26,8 @@ public:
   bool hasAllowLocalIpOption() const;
   bool hasHideMyPortOption() const;
   bool hasLevelDBOption() const;
+  bool hasProfileStartupOption() const;
+  bool hasHeadlessOption() const;
   QString getErrorText() const;
   QString getHelpText() const;
   QString getP2pBindIp() const;
@@ -37,6 +39,11 @@ public:
   QStringList getSeedNodes() const;
   QString getDataDir() const;
   quint32 rollBack() const;
+  QString getPasswordFile() const;
+  quint16 getWalletRpcPort() const;
+
+  // Checked before the application object is created, the parser needs one
+  static bool isHeadlessRequested(int _argc, char* _argv[]);
 
 private:
   QCommandLineParser m_parser;
@@ -56,6 +63,10 @@ private:
   QCommandLineOption m_rollBackOption;
   QCommandLineOption m_minimized;
   QCommandLineOption m_levelDb;
+  QCommandLineOption m_profileStartupOption;
+  QCommandLineOption m_headlessOption;
+  QCommandLineOption m_passwordFileOption;
+  QCommandLineOption m_walletRpcPortOption;
 };
 
 }
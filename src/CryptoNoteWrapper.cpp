@@ -38,8 +38,11 @@
 #include "Logging/LoggerManager.h"
 #include "System/Dispatcher.h"
 #include "IDataBase.h"
+#include "ITransaction.h"
 #include "CurrencyAdapter.h"
+#include "DecoyCache.h"
 #include "Settings.h"
+#include "StartupProfiler.h"
 
 #include <QDebug>
 
@@ -85,6 +88,45 @@ std::string extractPaymentId(const std::string& extra) {
   return res;
 }
 
+// Asks the node for the pool difference against the transactions we already know,
+// reduces new transactions to fee and size and hands the result over to the callback
+void requestPoolChanges(CryptoNote::INode& node, std::vector<Crypto::Hash>&& knownPoolTxIds, const PoolChangesCallback& callback) {
+  struct PoolChangesRequest {
+    bool isBcActual = false;
+    std::vector<std::unique_ptr<CryptoNote::ITransactionReader>> newTxs;
+    std::vector<Crypto::Hash> deletedTxIds;
+  };
+
+  auto request = std::make_shared<PoolChangesRequest>();
+  Crypto::Hash knownBlockId = node.getLastLocalBlockHeaderInfo().hash;
+  node.getPoolSymmetricDifference(std::move(knownPoolTxIds), knownBlockId, request->isBcActual, request->newTxs, request->deletedTxIds,
+    [request, callback](std::error_code ec) {
+      std::vector<PoolTransactionInfo> addedTxs;
+      if (!ec) {
+        addedTxs.reserve(request->newTxs.size());
+        for (const auto& tx : request->newTxs) {
+          uint64_t inputs = tx->getInputTotalAmount();
+          uint64_t outputs = tx->getOutputTotalAmount();
+          addedTxs.push_back({tx->getTransactionHash(), inputs > outputs ? inputs - outputs : 0, tx->getTransactionData().size()});
+        }
+      }
+
+      callback(ec, std::move(addedTxs), std::move(request->deletedTxIds));
+    });
+}
+
+// Starts an asynchronous node request and waits for its callback
+template <typename Request>
+std::error_code waitForNode(Request request) {
+  auto completed = std::make_shared<std::promise<std::error_code>>();
+  std::future<std::error_code> completedFuture = completed->get_future();
+  request([completed](std::error_code ec) {
+    completed->set_value(ec);
+  });
+
+  return completedFuture.get();
+}
+
 inline std::string interpret_rpc_response(bool ok, const std::string& status) {
   std::string err;
   if (ok) {
@@ -232,6 +274,27 @@ public:
     return connections;
   }
 
+  void getPoolChanges(std::vector<Crypto::Hash>&& knownPoolTxIds, const PoolChangesCallback& callback) override {
+    requestPoolChanges(m_node, std::move(knownPoolTxIds), callback);
+  }
+
+  void prefetchRandomOuts(const std::map<uint64_t, uint64_t>& outsCounts) override {
+    m_node.prefetchRandomOuts(outsCounts);
+  }
+
+  std::error_code getRandomOuts(std::vector<uint64_t>&& amounts, uint16_t outsCount,
+    std::vector<CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result) override {
+    return waitForNode([&](const CryptoNote::INode::Callback& callback) {
+      m_node.getRandomOutsByAmounts(std::move(amounts), outsCount, result, callback);
+    });
+  }
+
+  std::error_code relayTransaction(const CryptoNote::Transaction& transaction) override {
+    return waitForNode([&](const CryptoNote::INode::Callback& callback) {
+      m_node.relayTransaction(transaction, callback);
+    });
+  }
+
   CryptoNote::IWalletLegacy* createWallet() override {
     return new CryptoNote::WalletLegacy(m_currency, m_node, m_logManager);
   }
@@ -239,7 +302,7 @@ public:
 private:
   INodeCallback& m_callback;
   const CryptoNote::Currency& m_currency;
-  CryptoNote::NodeRpcProxy m_node;
+  DecoyCachingNode<CryptoNote::NodeRpcProxy> m_node;
   System::Dispatcher m_dispatcher;
 
   void peerCountUpdated(size_t count) {
@@ -284,6 +347,7 @@ public:
     m_node(m_core, m_protocolHandler, m_dispatcher)
   {
     CryptoNote::MinerConfig emptyMiner;
+    StartupSpan span("core load");
     m_core.load(emptyMiner);
     m_protocolHandler.set_p2p_endpoint(&m_nodeServer);
   }
@@ -294,9 +358,11 @@ public:
   void init(const std::function<void(std::error_code)>& callback) override {
     try {
       if(Settings::instance().getRollBack() != std::numeric_limits<uint32_t>::max()) {
+        StartupSpan span("rollback");
         m_core.rewind(Settings::instance().getRollBack());
       }
 
+      StartupSpan span("p2p init");
       if (!m_nodeServer.init(m_netNodeConfig)) {
         callback(make_error_code(CryptoNote::error::NOT_INITIALIZED));
         return;
@@ -426,6 +492,27 @@ public:
     return connections;
   }
 
+  void getPoolChanges(std::vector<Crypto::Hash>&& knownPoolTxIds, const PoolChangesCallback& callback) override {
+    requestPoolChanges(m_node, std::move(knownPoolTxIds), callback);
+  }
+
+  void prefetchRandomOuts(const std::map<uint64_t, uint64_t>& outsCounts) override {
+    m_node.prefetchRandomOuts(outsCounts);
+  }
+
+  std::error_code getRandomOuts(std::vector<uint64_t>&& amounts, uint16_t outsCount,
+    std::vector<CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result) override {
+    return waitForNode([&](const CryptoNote::INode::Callback& callback) {
+      m_node.getRandomOutsByAmounts(std::move(amounts), outsCount, result, callback);
+    });
+  }
+
+  std::error_code relayTransaction(const CryptoNote::Transaction& transaction) override {
+    return waitForNode([&](const CryptoNote::INode::Callback& callback) {
+      m_node.relayTransaction(transaction, callback);
+    });
+  }
+
   CryptoNote::IWalletLegacy* createWallet() override {
     return new CryptoNote::WalletLegacy(m_currency, m_node, m_logManager);
   }
@@ -441,7 +528,7 @@ private:
   CryptoNote::Core m_core;
   CryptoNote::CryptoNoteProtocolHandler m_protocolHandler;
   CryptoNote::NodeServer m_nodeServer;
-  CryptoNote::InProcessNode m_node;
+  DecoyCachingNode<CryptoNote::InProcessNode> m_node;
   std::future<bool> m_nodeServerFuture;
 
   void peerCountUpdated(size_t count) {
@@ -495,7 +582,12 @@ Node* createInprocessNode(const CryptoNote::Currency& currency, Logging::LoggerM
   }
 
   try {
-    database->init();
+    {
+      StartupSpan span("database init");
+      database->init();
+    }
+
+    StartupSpan span("database scheme check");
     if (!CryptoNote::DatabaseBlockchainCache::checkDBSchemeVersion(*database, logManager))
     {
       database->shutdown();
@@ -514,11 +606,19 @@ Node* createInprocessNode(const CryptoNote::Currency& currency, Logging::LoggerM
   }
 
   CryptoNote::Checkpoints checkpoints(logManager);
-  for (const CryptoNote::CheckpointData& checkpoint : CryptoNote::CHECKPOINTS) {
-    checkpoints.addCheckpoint(checkpoint.index, checkpoint.blockId);
+  {
+    StartupSpan span("checkpoints");
+    for (const CryptoNote::CheckpointData& checkpoint : CryptoNote::CHECKPOINTS) {
+      checkpoints.addCheckpoint(checkpoint.index, checkpoint.blockId);
+    }
+  }
+
+  {
+    StartupSpan span("DNS checkpoints");
+    checkpoints.loadCheckpointsFromDns();
   }
-  checkpoints.loadCheckpointsFromDns();
 
+  StartupSpan span("in-process node");
   return new InprocessNode(currency, logManager, checkpoints, netNodeConfig, *database, callback);
 }
 
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <functional>
+#include <map>
 #include <memory>
 #include <string>
 #include <system_error>
@@ -27,6 +28,14 @@ namespace Logging {
 
 namespace WalletGui {
 
+struct PoolTransactionInfo {
+  Crypto::Hash hash;
+  uint64_t fee;
+  uint64_t size;
+};
+
+typedef std::function<void(std::error_code, std::vector<PoolTransactionInfo>&&, std::vector<Crypto::Hash>&&)> PoolChangesCallback;
+
 class Node {
 public:
   virtual ~Node() = 0;
@@ -56,6 +65,12 @@ public:
   virtual CryptoNote::BlockHeaderInfo getLastLocalBlockHeaderInfo() = 0;
 
   virtual std::vector<CryptoNote::p2pConnection> getConnections() = 0;
+  virtual void getPoolChanges(std::vector<Crypto::Hash>&& knownPoolTxIds, const PoolChangesCallback& callback) = 0;
+  virtual void prefetchRandomOuts(const std::map<uint64_t, uint64_t>& outsCounts) = 0;
+  // Blocking, for callers that build transactions themselves. Random outputs come from the decoy cache when it holds enough.
+  virtual std::error_code getRandomOuts(std::vector<uint64_t>&& amounts, uint16_t outsCount,
+    std::vector<CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result) = 0;
+  virtual std::error_code relayTransaction(const CryptoNote::Transaction& transaction) = 0;
 
   virtual CryptoNote::IWalletLegacy* createWallet() = 0;
 };
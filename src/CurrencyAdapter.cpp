@@ -46,6 +46,12 @@ quint64 CurrencyAdapter::getMinimumFee() const {
   return m_currency.minimumFee();
 }
 
+// Block space left for transactions once the miner transaction is reserved
+quint64 CurrencyAdapter::getMaxTransactionSize(quint8 _blockMajorVersion) const {
+  const size_t fullRewardZone = m_currency.blockGrantedFullRewardZoneByBlockVersion(_blockMajorVersion);
+  return fullRewardZone > m_currency.minerTxBlobReservedSize() ? fullRewardZone - m_currency.minerTxBlobReservedSize() : fullRewardZone;
+}
+
 quint64 CurrencyAdapter::getAddressPrefix() const {
   return m_currency.publicAddressBase58Prefix();
 }
@@ -21,6 +21,7 @@ public:
   QString getCurrencyName() const;
   QString getCurrencyTicker() const;
   quint64 getMinimumFee() const;
+  quint64 getMaxTransactionSize(quint8 _blockMajorVersion) const;
   quint64 getAddressPrefix() const;
   quintptr getNumberOfDecimalPlaces() const;
   QString formatAmount(quint64 _amount) const;
@@ -0,0 +1,146 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+#include <set>
+
+#include "DecoyCache.h"
+
+namespace WalletGui {
+
+namespace {
+
+// Outputs created after the fetch should get a chance to become decoys, so entries don't live long
+const std::chrono::minutes DECOY_ENTRY_LIFETIME(10);
+// A request without an answer by then is taken as lost, the amount is requested again
+const std::chrono::minutes DECOY_REQUEST_TIMEOUT(1);
+
+}
+
+DecoyCache::DecoyCache() {
+}
+
+void DecoyCache::dropExpired(std::deque<Entry>& _entries, std::chrono::steady_clock::time_point _now) {
+  while (!_entries.empty() && _now - _entries.front().fetched > DECOY_ENTRY_LIFETIME) {
+    _entries.pop_front();
+  }
+}
+
+bool DecoyCache::take(const std::vector<uint64_t>& _amounts, uint64_t _outsCount, std::vector<RandomOutsForAmount>& _result) {
+  if (_amounts.empty() || _outsCount == 0) {
+    return false;
+  }
+
+  std::map<uint64_t, uint64_t> needed;
+  for (uint64_t amount : _amounts) {
+    needed[amount] += _outsCount;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto now = std::chrono::steady_clock::now();
+  for (const auto& need : needed) {
+    auto it = m_outs.find(need.first);
+    if (it == m_outs.end()) {
+      return false;
+    }
+
+    dropExpired(it->second, now);
+    if (it->second.size() < need.second) {
+      return false;
+    }
+  }
+
+  _result.clear();
+  _result.reserve(_amounts.size());
+  for (uint64_t amount : _amounts) {
+    std::deque<Entry>& entries = m_outs[amount];
+    RandomOutsForAmount outs;
+    outs.amount = amount;
+    for (uint64_t i = 0; i < _outsCount; ++i) {
+      outs.outs.push_back(entries.front().out);
+      entries.pop_front();
+    }
+
+    _result.push_back(std::move(outs));
+  }
+
+  return true;
+}
+
+std::map<uint64_t, uint64_t> DecoyCache::setTargets(const std::map<uint64_t, uint64_t>& _targets) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_targets = _targets;
+  for (auto it = m_outs.begin(); it != m_outs.end();) {
+    if (m_targets.count(it->first) == 0) {
+      it = m_outs.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  for (auto it = m_requested.begin(); it != m_requested.end();) {
+    if (m_targets.count(it->first) == 0 || now - it->second.sent > DECOY_REQUEST_TIMEOUT) {
+      it = m_requested.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  std::map<uint64_t, uint64_t> deficits;
+  for (const auto& target : m_targets) {
+    std::deque<Entry>& entries = m_outs[target.first];
+    dropExpired(entries, now);
+    auto requested = m_requested.find(target.first);
+    const uint64_t available = entries.size() + (requested != m_requested.end() ? requested->second.count : 0);
+    if (available < target.second) {
+      deficits[target.first] = target.second - available;
+      if (requested != m_requested.end()) {
+        requested->second.count += target.second - available;
+        requested->second.sent = now;
+      } else {
+        m_requested[target.first] = Request {target.second - available, now};
+      }
+    }
+  }
+
+  return deficits;
+}
+
+void DecoyCache::store(uint64_t _amount, const std::vector<RandomOutsForAmount>& _outs) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_requested.erase(_amount);
+  if (m_targets.count(_amount) == 0) {
+    return;
+  }
+
+  // A ring must not contain the same output twice, so entries already in the cache are skipped
+  std::deque<Entry>& entries = m_outs[_amount];
+  std::set<uint64_t> known;
+  for (const Entry& entry : entries) {
+    known.insert(entry.out.global_amount_index);
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  for (const RandomOutsForAmount& outs : _outs) {
+    if (outs.amount != _amount) {
+      continue;
+    }
+
+    for (const RandomOutEntry& out : outs.outs) {
+      if (known.insert(out.global_amount_index).second) {
+        entries.push_back(Entry {out, now});
+      }
+    }
+  }
+}
+
+void DecoyCache::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_outs.clear();
+  m_targets.clear();
+  m_requested.clear();
+}
+
+}
@@ -0,0 +1,104 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <INode.h>
+#include <Rpc/CoreRpcServerCommandsDefinitions.h>
+
+namespace WalletGui {
+
+typedef CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount RandomOutsForAmount;
+typedef CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry RandomOutEntry;
+
+// Random outputs fetched ahead of time, per amount. Every entry is handed out once,
+// so two transactions never share decoys taken from the cache.
+class DecoyCache {
+public:
+  DecoyCache();
+
+  // Fills _result in the order of _amounts if every amount has enough entries, otherwise leaves the cache untouched
+  bool take(const std::vector<uint64_t>& _amounts, uint64_t _outsCount, std::vector<RandomOutsForAmount>& _result);
+
+  // Amounts not listed in _targets are dropped, the rest reports how many entries each one is missing.
+  // The reported entries count as requested until store() is called for the amount, or until the
+  // request times out for a node that never answers.
+  std::map<uint64_t, uint64_t> setTargets(const std::map<uint64_t, uint64_t>& _targets);
+  void store(uint64_t _amount, const std::vector<RandomOutsForAmount>& _outs);
+  void clear();
+
+private:
+  struct Entry {
+    RandomOutEntry out;
+    std::chrono::steady_clock::time_point fetched;
+  };
+
+  struct Request {
+    uint64_t count;
+    std::chrono::steady_clock::time_point sent;
+  };
+
+  std::mutex m_mutex;
+  std::map<uint64_t, std::deque<Entry>> m_outs;
+  std::map<uint64_t, uint64_t> m_targets;
+  std::map<uint64_t, Request> m_requested;
+
+  void dropExpired(std::deque<Entry>& _entries, std::chrono::steady_clock::time_point _now);
+};
+
+// Node wrapper that answers wallet requests for random outputs from a DecoyCache
+// and falls back to the node itself when the cache can't cover a request.
+template <typename NodeType>
+class DecoyCachingNode : public NodeType {
+public:
+  template <typename... Args>
+  DecoyCachingNode(Args&&... _args) : NodeType(std::forward<Args>(_args)...), m_cache(std::make_shared<DecoyCache>()) {
+  }
+
+  void getRandomOutsByAmounts(std::vector<uint64_t>&& _amounts, uint16_t _outsCount, std::vector<RandomOutsForAmount>& _result,
+    const CryptoNote::INode::Callback& _callback) override {
+    if (m_cache->take(_amounts, _outsCount, _result)) {
+      _callback(std::error_code());
+      return;
+    }
+
+    NodeType::getRandomOutsByAmounts(std::move(_amounts), _outsCount, _result, _callback);
+  }
+
+  // Requests whatever the cache is missing to hold _targets entries per amount
+  void prefetchRandomOuts(const std::map<uint64_t, uint64_t>& _targets) {
+    std::map<uint64_t, uint64_t> deficits = m_cache->setTargets(_targets);
+    for (const auto& deficit : deficits) {
+      // One request per amount, so a failed one only releases its own reservation
+      auto result = std::make_shared<std::vector<RandomOutsForAmount>>();
+      std::shared_ptr<DecoyCache> cache = m_cache;
+      NodeType::getRandomOutsByAmounts(std::vector<uint64_t> {deficit.first}, static_cast<uint16_t>(std::min<uint64_t>(deficit.second, 0xffff)),
+        *result, [cache, result, deficit](std::error_code _error) {
+          if (_error) {
+            result->clear();
+          }
+
+          cache->store(deficit.first, *result);
+        });
+    }
+  }
+
+  void clearRandomOuts() {
+    m_cache->clear();
+  }
+
+private:
+  // Shared with pending requests, their callbacks may outlive the node
+  std::shared_ptr<DecoyCache> m_cache;
+};
+
+}
@@ -0,0 +1,116 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "DecoyPrefetcher.h"
+#include "NodeAdapter.h"
+#include "WalletAdapter.h"
+
+namespace WalletGui {
+
+namespace {
+
+const int DECOY_REFRESH_INTERVAL = 5 * 60 * 1000;
+const int DECOY_REFRESH_THROTTLE = 30 * 1000;
+const quint64 DEFAULT_MIXIN = 7;
+const size_t MAX_PREFETCHED_AMOUNTS = 16;
+const quint64 MAX_INPUTS_PER_AMOUNT = 3;
+
+}
+
+DecoyPrefetcher& DecoyPrefetcher::instance() {
+  static DecoyPrefetcher inst;
+  return inst;
+}
+
+DecoyPrefetcher::DecoyPrefetcher() : QObject(), m_mixin(DEFAULT_MIXIN), m_started(false) {
+  m_refreshTimer.setInterval(DECOY_REFRESH_INTERVAL);
+  connect(&m_refreshTimer, &QTimer::timeout, this, &DecoyPrefetcher::refresh);
+  m_throttleTimer.setSingleShot(true);
+  m_throttleTimer.setInterval(DECOY_REFRESH_THROTTLE);
+  connect(&m_throttleTimer, &QTimer::timeout, this, &DecoyPrefetcher::refresh);
+}
+
+DecoyPrefetcher::~DecoyPrefetcher() {
+}
+
+void DecoyPrefetcher::start() {
+  connect(&WalletAdapter::instance(), &WalletAdapter::walletActualBalanceUpdatedSignal, this, &DecoyPrefetcher::scheduleRefresh,
+    static_cast<Qt::ConnectionType>(Qt::QueuedConnection | Qt::UniqueConnection));
+  connect(&WalletAdapter::instance(), &WalletAdapter::walletSynchronizationCompletedSignal, this, &DecoyPrefetcher::scheduleRefresh,
+    static_cast<Qt::ConnectionType>(Qt::QueuedConnection | Qt::UniqueConnection));
+  connect(&WalletAdapter::instance(), &WalletAdapter::walletCloseCompletedSignal, this, &DecoyPrefetcher::walletClosed, Qt::UniqueConnection);
+  m_started = true;
+  m_refreshTimer.start();
+  refresh();
+}
+
+void DecoyPrefetcher::stop() {
+  disconnect(&WalletAdapter::instance(), nullptr, this, nullptr);
+  m_started = false;
+  m_refreshTimer.stop();
+  m_throttleTimer.stop();
+}
+
+void DecoyPrefetcher::setMixin(quint64 _mixin) {
+  if (m_mixin == _mixin) {
+    return;
+  }
+
+  m_mixin = _mixin;
+  refresh();
+}
+
+void DecoyPrefetcher::scheduleRefresh() {
+  if (m_started && !m_throttleTimer.isActive()) {
+    m_throttleTimer.start();
+  }
+}
+
+void DecoyPrefetcher::refresh() {
+  m_throttleTimer.stop();
+  if (!m_started || !WalletAdapter::instance().isOpen()) {
+    return;
+  }
+
+  std::map<uint64_t, uint64_t> targets;
+  if (m_mixin > 0) {
+    // The denominations the wallet holds most of are the ones a send most likely spends
+    std::map<uint64_t, quint64> histogram;
+    for (const CryptoNote::TransactionOutputInformation& output : WalletAdapter::instance().getUnlockedOutputs()) {
+      ++histogram[output.amount];
+    }
+
+    std::vector<std::pair<uint64_t, quint64>> amounts(histogram.begin(), histogram.end());
+    std::sort(amounts.begin(), amounts.end(), [](const std::pair<uint64_t, quint64>& _left, const std::pair<uint64_t, quint64>& _right) {
+      return _left.second > _right.second;
+    });
+
+    if (amounts.size() > MAX_PREFETCHED_AMOUNTS) {
+      amounts.resize(MAX_PREFETCHED_AMOUNTS);
+    }
+
+    // The wallet asks for one output more than the mixin to be able to skip its own
+    for (const auto& amount : amounts) {
+      targets[amount.first] = (m_mixin + 1) * std::min(amount.second, MAX_INPUTS_PER_AMOUNT);
+    }
+  }
+
+  try {
+    NodeAdapter::instance().prefetchRandomOuts(targets);
+  } catch (std::system_error&) {
+  }
+}
+
+void DecoyPrefetcher::walletClosed() {
+  try {
+    NodeAdapter::instance().prefetchRandomOuts(std::map<uint64_t, uint64_t>());
+  } catch (std::system_error&) {
+  }
+}
+
+}
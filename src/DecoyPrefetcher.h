@@ -0,0 +1,40 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+
+namespace WalletGui {
+
+// Keeps the node's decoy cache filled for the denominations the wallet is likely to spend,
+// so a send can start signing without waiting for random outputs.
+class DecoyPrefetcher : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(DecoyPrefetcher)
+
+public:
+  static DecoyPrefetcher& instance();
+
+  void start();
+  void stop();
+  void setMixin(quint64 _mixin);
+
+private:
+  QTimer m_refreshTimer;
+  // Balance updates come with every block while syncing, they only schedule a refresh
+  QTimer m_throttleTimer;
+  quint64 m_mixin;
+  bool m_started;
+
+  DecoyPrefetcher();
+  ~DecoyPrefetcher();
+
+  void refresh();
+  void scheduleRefresh();
+  void walletClosed();
+};
+
+}
@@ -0,0 +1,179 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+#include <map>
+
+#include "FusionPlanner.h"
+#include "TransactionSizeEstimator.h"
+
+namespace WalletGui {
+
+namespace {
+
+uint64_t powerOfTen(uint64_t _amount) {
+  uint64_t power = 1;
+  while (_amount >= 10) {
+    _amount /= 10;
+    power *= 10;
+  }
+
+  return power;
+}
+
+// The network only accepts fusion inputs of a single significant digit
+bool isPrettyAmount(uint64_t _amount) {
+  while (_amount != 0 && _amount % 10 == 0) {
+    _amount /= 10;
+  }
+
+  return _amount != 0 && _amount < 10;
+}
+
+}
+
+FusionPlanner::FusionPlanner(const FusionPlanParameters& _parameters) : m_parameters(_parameters) {
+  m_parameters.minInputCount = std::max<size_t>(m_parameters.minInputCount, 1);
+}
+
+size_t FusionPlanner::estimate(const std::vector<uint64_t>& _amounts) const {
+  std::map<uint64_t, size_t> denominations;
+  for (uint64_t amount : _amounts) {
+    if (isFusible(amount)) {
+      ++denominations[powerOfTen(amount)];
+    }
+  }
+
+  size_t count = 0;
+  for (const auto& denomination : denominations) {
+    if (denomination.second >= m_parameters.minInputCount) {
+      count += denomination.second;
+    }
+  }
+
+  return count;
+}
+
+FusionPlan FusionPlanner::plan(const std::vector<uint64_t>& _amounts) const {
+  FusionPlan plan {{}, 0, _amounts.size(), _amounts.size(), 0};
+  const TransactionSizeEstimator estimator(m_parameters.dustThreshold);
+  std::vector<uint64_t> amounts = _amounts;
+  while (plan.finalOutputCount > m_parameters.targetOutputCount) {
+    std::vector<FusionTransactionPlan> round;
+    size_t outputCount = amounts.size();
+    planRound(amounts, plan.roundCount, outputCount, round);
+    if (round.empty()) {
+      break;
+    }
+
+    // Spent outputs are replaced by the ones the fusions create, those feed the next round
+    std::vector<bool> spent(amounts.size(), false);
+    for (const FusionTransactionPlan& transaction : round) {
+      for (size_t input : transaction.inputs) {
+        spent[input] = true;
+      }
+    }
+
+    std::vector<uint64_t> nextAmounts;
+    nextAmounts.reserve(outputCount);
+    for (size_t i = 0; i < amounts.size(); ++i) {
+      if (!spent[i]) {
+        nextAmounts.push_back(amounts[i]);
+      }
+    }
+
+    for (FusionTransactionPlan& transaction : round) {
+      const std::vector<uint64_t> outputs = estimator.decompose(transaction.amount - m_parameters.fee);
+      nextAmounts.insert(nextAmounts.end(), outputs.begin(), outputs.end());
+      plan.totalFee += m_parameters.fee;
+      if (plan.roundCount != 0) {
+        transaction.inputs.clear();
+      }
+    }
+
+    plan.transactions.insert(plan.transactions.end(), round.begin(), round.end());
+    amounts.swap(nextAmounts);
+    plan.finalOutputCount = amounts.size();
+    ++plan.roundCount;
+  }
+
+  return plan;
+}
+
+bool FusionPlanner::isFusible(uint64_t _amount) const {
+  return _amount < m_parameters.threshold && _amount >= m_parameters.dustThreshold && isPrettyAmount(_amount);
+}
+
+void FusionPlanner::planRound(const std::vector<uint64_t>& _amounts, size_t _round, size_t& _outputCount,
+  std::vector<FusionTransactionPlan>& _transactions) const {
+  std::map<uint64_t, std::vector<size_t>> denominations;
+  for (size_t i = 0; i < _amounts.size(); ++i) {
+    if (isFusible(_amounts[i])) {
+      denominations[powerOfTen(_amounts[i])].push_back(i);
+    }
+  }
+
+  std::vector<size_t> leftovers;
+  FusionTransactionPlan transaction;
+  for (auto& denomination : denominations) {
+    std::vector<size_t>& candidates = denomination.second;
+    while (_outputCount > m_parameters.targetOutputCount && takeTransaction(_amounts, candidates, transaction)) {
+      transaction.round = _round;
+      _outputCount = _outputCount - transaction.inputCount + transaction.outputCount;
+      _transactions.push_back(transaction);
+    }
+
+    leftovers.insert(leftovers.end(), candidates.begin(), candidates.end());
+  }
+
+  // What no denomination could fill on its own is fused across denominations
+  while (_outputCount > m_parameters.targetOutputCount && takeTransaction(_amounts, leftovers, transaction)) {
+    transaction.round = _round;
+    _outputCount = _outputCount - transaction.inputCount + transaction.outputCount;
+    _transactions.push_back(transaction);
+  }
+}
+
+// Takes as many candidates from the back as fit the size limit with the outputs their sum splits into
+bool FusionPlanner::takeTransaction(const std::vector<uint64_t>& _amounts, std::vector<size_t>& _candidates,
+  FusionTransactionPlan& _transaction) const {
+  if (_candidates.size() < m_parameters.minInputCount) {
+    return false;
+  }
+
+  const TransactionSizeEstimator estimator(m_parameters.dustThreshold);
+  size_t inputCount = 0;
+  while (inputCount < _candidates.size() &&
+      TransactionSizeEstimator::estimateMaxSize(inputCount + 1, 1, m_parameters.mixin, 0) <= m_parameters.maxTransactionSize) {
+    ++inputCount;
+  }
+
+  uint64_t amount = 0;
+  for (size_t i = _candidates.size() - inputCount; i < _candidates.size(); ++i) {
+    amount += _amounts[_candidates[i]];
+  }
+
+  for (; inputCount >= m_parameters.minInputCount; --inputCount) {
+    if (amount > m_parameters.fee) {
+      const size_t outputCount = estimator.decomposedOutputCount(amount - m_parameters.fee);
+      const uint64_t maxSize = TransactionSizeEstimator::estimateMaxSize(inputCount, outputCount, m_parameters.mixin, 0);
+      if (maxSize <= m_parameters.maxTransactionSize && outputCount < inputCount && inputCount >= m_parameters.minInOutCountRatio * outputCount) {
+        _transaction.inputs.assign(_candidates.end() - inputCount, _candidates.end());
+        _transaction.inputCount = inputCount;
+        _transaction.outputCount = outputCount;
+        _transaction.amount = amount;
+        _transaction.maxSize = maxSize;
+        _candidates.resize(_candidates.size() - inputCount);
+        return true;
+      }
+    }
+
+    // The candidate dropped is the first one of the window
+    amount -= _amounts[_candidates[_candidates.size() - inputCount]];
+  }
+
+  return false;
+}
+
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace WalletGui {
+
+struct FusionPlanParameters {
+  // Outputs at or above the threshold, or below the dust threshold, are never fused
+  uint64_t threshold;
+  uint64_t dustThreshold;
+  size_t mixin;
+  size_t maxTransactionSize;
+  size_t minInputCount;
+  size_t minInOutCountRatio;
+  // Planning stops once the wallet is projected to hold no more outputs than this
+  size_t targetOutputCount;
+  uint64_t fee;
+};
+
+struct FusionTransactionPlan {
+  // Transactions of the same round spend disjoint outputs and can be sent back to back,
+  // a later round spends outputs created by the earlier ones
+  size_t round;
+  // Indexes into the planned amounts, only known for the first round
+  std::vector<size_t> inputs;
+  size_t inputCount;
+  size_t outputCount;
+  uint64_t amount;
+  uint64_t maxSize;
+};
+
+struct FusionPlan {
+  std::vector<FusionTransactionPlan> transactions;
+  size_t roundCount;
+  size_t initialOutputCount;
+  size_t finalOutputCount;
+  uint64_t totalFee;
+};
+
+// Computes the whole schedule of fusion transactions that consolidates a wallet, without touching it.
+// Outputs are packed by denomination, every transaction is kept within the fusion size limit by its
+// largest possible size, and the outputs of each round are fed into the next one.
+class FusionPlanner {
+public:
+  explicit FusionPlanner(const FusionPlanParameters& _parameters);
+
+  // Outputs in denominations with enough of them for a fusion, the count the wallet's estimateFusion reports
+  size_t estimate(const std::vector<uint64_t>& _amounts) const;
+  FusionPlan plan(const std::vector<uint64_t>& _amounts) const;
+
+private:
+  FusionPlanParameters m_parameters;
+
+  bool isFusible(uint64_t _amount) const;
+  void planRound(const std::vector<uint64_t>& _amounts, size_t _round, size_t& _outputCount, std::vector<FusionTransactionPlan>& _transactions) const;
+  bool takeTransaction(const std::vector<uint64_t>& _amounts, std::vector<size_t>& _candidates, FusionTransactionPlan& _transaction) const;
+};
+
+}
@@ -0,0 +1,157 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+
+#include <CryptoNoteConfig.h>
+#include <CryptoNoteCore/CryptoNoteBasic.h>
+#include <CryptoNoteCore/CryptoNoteFormatUtils.h>
+#include <CryptoNoteCore/CryptoNoteTools.h>
+#include <CryptoNoteCore/Currency.h>
+#include <CryptoNoteCore/TransactionExtra.h>
+
+#include "FusionTransactionBuilder.h"
+
+namespace WalletGui {
+
+namespace {
+
+// The real output and _mixin decoys sorted by global index, decoys equal to the real output are skipped as the core does
+bool makeRing(const CryptoNote::TransactionOutputInformation& _input, const RandomOutsForAmount& _decoys, uint64_t _mixin,
+  std::vector<uint32_t>& _indexes, RingSigningInput& _ring) {
+  std::vector<RandomOutEntry> members;
+  members.reserve(_mixin + 1);
+  for (const RandomOutEntry& decoy : _decoys.outs) {
+    if (members.size() == _mixin) {
+      break;
+    }
+
+    if (decoy.global_amount_index != _input.globalOutputIndex) {
+      members.push_back(decoy);
+    }
+  }
+
+  if (members.size() < _mixin) {
+    return false;
+  }
+
+  RandomOutEntry real;
+  real.global_amount_index = _input.globalOutputIndex;
+  real.out_key = _input.outputKey;
+  members.push_back(real);
+  std::sort(members.begin(), members.end(), [](const RandomOutEntry& _left, const RandomOutEntry& _right) {
+    return _left.global_amount_index < _right.global_amount_index;
+  });
+
+  _indexes.clear();
+  _ring.ring.clear();
+  for (const RandomOutEntry& member : members) {
+    if (member.global_amount_index == _input.globalOutputIndex) {
+      _ring.realIndex = _ring.ring.size();
+    }
+
+    _indexes.push_back(static_cast<uint32_t>(member.global_amount_index));
+    _ring.ring.push_back(member.out_key);
+  }
+
+  return true;
+}
+
+}
+
+FusionTransactionBuilder::FusionTransactionBuilder(const CryptoNote::Currency& _currency, const CryptoNote::AccountKeys& _keys, size_t _threads) :
+  m_currency(_currency), m_keys(_keys), m_signer(_threads) {
+}
+
+bool FusionTransactionBuilder::build(const std::vector<CryptoNote::TransactionOutputInformation>& _inputs, const std::vector<RandomOutsForAmount>& _decoys,
+  uint64_t _mixin, uint64_t _fee, const std::string& _extra, CryptoNote::Transaction& _transaction, std::string& _error) const {
+  if (_decoys.size() != _inputs.size()) {
+    _error = "Random outputs don't match the inputs";
+    return false;
+  }
+
+  _transaction = CryptoNote::Transaction();
+  _transaction.version = CryptoNote::CURRENT_TRANSACTION_VERSION;
+  _transaction.unlockTime = 0;
+
+  uint64_t inputAmount = 0;
+  std::vector<RingSigningInput> rings(_inputs.size());
+  for (size_t i = 0; i < _inputs.size(); ++i) {
+    const CryptoNote::TransactionOutputInformation& input = _inputs[i];
+    if (input.type != CryptoNote::TransactionTypes::OutputType::Key || _decoys[i].amount != input.amount) {
+      _error = "Input can't be fused";
+      return false;
+    }
+
+    CryptoNote::KeyInput keyInput;
+    keyInput.amount = input.amount;
+    if (!makeRing(input, _decoys[i], _mixin, keyInput.outputIndexes, rings[i])) {
+      _error = "Not enough random outputs for the mixin";
+      return false;
+    }
+
+    Crypto::KeyDerivation derivation;
+    if (!Crypto::generate_key_derivation(input.transactionPublicKey, m_keys.viewSecretKey, derivation)) {
+      _error = "Input can't be fused";
+      return false;
+    }
+
+    Crypto::derive_secret_key(derivation, input.outputInTransaction, m_keys.spendSecretKey, rings[i].ephemeralSecretKey);
+    keyInput.outputIndexes = CryptoNote::absolute_output_offsets_to_relative(keyInput.outputIndexes);
+    _transaction.inputs.push_back(keyInput);
+    inputAmount += input.amount;
+  }
+
+  if (inputAmount <= _fee) {
+    _error = "Inputs don't cover the fee";
+    return false;
+  }
+
+  // Outputs are the decomposition of the amount, which is what the currency accepts as a fusion
+  std::vector<uint64_t> amounts;
+  CryptoNote::decompose_amount_into_digits(inputAmount - _fee, m_currency.defaultDustThreshold(),
+    [&amounts](uint64_t _amount) { amounts.push_back(_amount); }, [&amounts](uint64_t _amount) { amounts.push_back(_amount); });
+  std::sort(amounts.begin(), amounts.end());
+
+  const CryptoNote::KeyPair transactionKeys = CryptoNote::generateKeyPair();
+  Crypto::KeyDerivation derivation;
+  if (!Crypto::generate_key_derivation(m_keys.address.viewPublicKey, transactionKeys.secretKey, derivation)) {
+    _error = "Failed to derive output keys";
+    return false;
+  }
+
+  for (size_t i = 0; i < amounts.size(); ++i) {
+    CryptoNote::KeyOutput keyOutput;
+    if (!Crypto::derive_public_key(derivation, i, m_keys.address.spendPublicKey, keyOutput.key)) {
+      _error = "Failed to derive output keys";
+      return false;
+    }
+
+    CryptoNote::TransactionOutput output;
+    output.amount = amounts[i];
+    output.target = keyOutput;
+    _transaction.outputs.push_back(output);
+  }
+
+  CryptoNote::addTransactionPublicKeyToExtra(_transaction.extra, transactionKeys.publicKey);
+  _transaction.extra.insert(_transaction.extra.end(), _extra.begin(), _extra.end());
+
+  // Key images are part of the prefix, so they are computed before its hash and the signatures after it
+  const std::vector<Crypto::KeyImage> keyImages = m_signer.generateKeyImages(rings);
+  for (size_t i = 0; i < keyImages.size(); ++i) {
+    boost::get<CryptoNote::KeyInput>(_transaction.inputs[i]).keyImage = keyImages[i];
+  }
+
+  const Crypto::Hash prefixHash = CryptoNote::getObjectHash(static_cast<const CryptoNote::TransactionPrefix&>(_transaction));
+  _transaction.signatures = m_signer.sign(prefixHash, rings, keyImages);
+
+  if (CryptoNote::getObjectBinarySize(_transaction) > m_currency.fusionTxMaxSize() || !m_currency.isFusionTransaction(_transaction)) {
+    _error = "Transaction isn't a valid fusion";
+    return false;
+  }
+
+  return true;
+}
+
+}
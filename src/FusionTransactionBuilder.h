@@ -0,0 +1,46 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <CryptoNote.h>
+#include <IWalletLegacy.h>
+
+#include "DecoyCache.h"
+#include "RingSigner.h"
+
+namespace CryptoNote {
+class Currency;
+}
+
+namespace WalletGui {
+
+// Fusion transactions built and signed by the wallet instead of the wallet core. The core signs
+// the inputs of a transaction one after another on its own thread, here key images and ring
+// signatures go through RingSigner and so over the global thread pool, which is what makes a
+// fusion of a few hundred inputs with a large mixin affordable.
+//
+// A fusion only pays to our own address, so the wallet core picks the transaction up from the
+// pool as any other transaction that spends our outputs.
+class FusionTransactionBuilder {
+public:
+  // 0 threads means one per hardware thread
+  FusionTransactionBuilder(const CryptoNote::Currency& _currency, const CryptoNote::AccountKeys& _keys, size_t _threads = 0);
+
+  // _decoys holds the random outputs for every input in input order, as the node returns them for
+  // the input amounts. Rings are the input and _mixin decoys sorted by global index.
+  bool build(const std::vector<CryptoNote::TransactionOutputInformation>& _inputs, const std::vector<RandomOutsForAmount>& _decoys,
+    uint64_t _mixin, uint64_t _fee, const std::string& _extra, CryptoNote::Transaction& _transaction, std::string& _error) const;
+
+private:
+  const CryptoNote::Currency& m_currency;
+  CryptoNote::AccountKeys m_keys;
+  RingSigner m_signer;
+};
+
+}
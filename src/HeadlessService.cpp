@@ -0,0 +1,107 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QFile>
+#include <QRegExp>
+
+#include <Wallet/WalletErrors.h>
+
+#include "HeadlessService.h"
+#include "LoggerAdapter.h"
+#include "OptimizationManager.h"
+#include "Settings.h"
+#include "WalletAdapter.h"
+
+namespace WalletGui {
+
+namespace {
+
+const int SAVE_INTERVAL = 10 * 60 * 1000;
+
+}
+
+HeadlessService::HeadlessService(QObject* _parent) : QObject(_parent),
+  m_logger(LoggerAdapter::instance().getLoggerManager(), "headless"), m_optimizationManager(nullptr), m_saveTimer() {
+  m_saveTimer.setInterval(SAVE_INTERVAL);
+  connect(&m_saveTimer, &QTimer::timeout, this, &HeadlessService::saveWallet);
+  connect(&WalletAdapter::instance(), &WalletAdapter::walletInitCompletedSignal, this, &HeadlessService::walletInitCompleted,
+    Qt::QueuedConnection);
+  connect(&WalletAdapter::instance(), &WalletAdapter::walletSaveCompletedSignal, this, &HeadlessService::walletSaveCompleted,
+    Qt::QueuedConnection);
+  connect(&WalletAdapter::instance(), &WalletAdapter::walletTransactionCreatedSignal, this,
+    &HeadlessService::walletTransactionCreated, Qt::QueuedConnection);
+  connect(&WalletAdapter::instance(), &WalletAdapter::openWalletWithPasswordSignal, this,
+    &HeadlessService::walletPasswordRequired, Qt::QueuedConnection);
+}
+
+HeadlessService::~HeadlessService() {
+}
+
+bool HeadlessService::start(const QString& _passwordFile) {
+  const QString walletFile = Settings::instance().getWalletFile();
+  if (walletFile.isEmpty() || !QFile::exists(walletFile)) {
+    m_logger(Logging::ERROR) << "No wallet to open, open or create one with the user interface first";
+    return false;
+  }
+
+  QString password;
+  if (!_passwordFile.isEmpty()) {
+    QFile file(_passwordFile);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+      m_logger(Logging::ERROR) << "Failed to read the password file " << _passwordFile.toStdString();
+      return false;
+    }
+
+    password = QString::fromUtf8(file.readLine()).remove(QRegExp("[\\r\\n]+$"));
+  }
+
+  // Created here, like in the main window, it follows the wallet on its own
+  m_optimizationManager = new OptimizationManager(this);
+  m_logger(Logging::INFO) << "Opening wallet " << walletFile.toStdString();
+  WalletAdapter::instance().open(password);
+  return true;
+}
+
+void HeadlessService::stop() {
+  m_saveTimer.stop();
+  if (WalletAdapter::instance().isOpen()) {
+    m_logger(Logging::INFO) << "Closing wallet";
+    WalletAdapter::instance().close();
+  }
+}
+
+void HeadlessService::walletInitCompleted(int _error, const QString& _errorText) {
+  if (_error == 0) {
+    m_logger(Logging::INFO) << "Wallet opened, address " << WalletAdapter::instance().getAddress().toStdString();
+    m_saveTimer.start();
+  } else if (_error != CryptoNote::error::WRONG_PASSWORD) {
+    // A wrong password is reported with its own signal
+    m_logger(Logging::ERROR) << "Failed to open the wallet: " << _errorText.toStdString();
+    Q_EMIT failedSignal();
+  }
+}
+
+void HeadlessService::walletSaveCompleted(int _error, const QString& _errorText) {
+  if (_error != 0) {
+    m_logger(Logging::ERROR) << "Failed to save the wallet: " << _errorText.toStdString();
+  }
+}
+
+void HeadlessService::walletTransactionCreated(CryptoNote::TransactionId _transactionId) {
+  m_logger(Logging::INFO) << "Transaction " << _transactionId << " created";
+}
+
+void HeadlessService::walletPasswordRequired(bool _isWrongPassword) {
+  m_logger(Logging::ERROR) << (_isWrongPassword ? "Wrong wallet password" :
+    "The wallet is encrypted, pass its password with --password-file");
+  Q_EMIT failedSignal();
+}
+
+void HeadlessService::saveWallet() {
+  if (WalletAdapter::instance().isOpen()) {
+    WalletAdapter::instance().save(true, true);
+  }
+}
+
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+
+#include <IWalletLegacy.h>
+
+#include "Logging/LoggerRef.h"
+
+namespace WalletGui {
+
+class OptimizationManager;
+
+// Keeps the last opened wallet open and synchronized without any widget, for servers without a
+// display. The node is initialized by the caller. The wallet is saved periodically and on stop,
+// optimization runs as configured in the settings, and the events are logged.
+class HeadlessService : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(HeadlessService)
+
+public:
+  HeadlessService(QObject* _parent);
+  ~HeadlessService();
+
+  bool start(const QString& _passwordFile);
+  void stop();
+
+private:
+  Logging::LoggerRef m_logger;
+  OptimizationManager* m_optimizationManager;
+  QTimer m_saveTimer;
+
+  void walletInitCompleted(int _error, const QString& _errorText);
+  void walletSaveCompleted(int _error, const QString& _errorText);
+  void walletTransactionCreated(CryptoNote::TransactionId _transactionId);
+  void walletPasswordRequired(bool _isWrongPassword);
+  void saveWallet();
+
+Q_SIGNALS:
+  void failedSignal();
+};
+
+}
@@ -22,10 +22,17 @@ void LoggerAdapter::init() {
   fileLogger.insert("type", "file");
   fileLogger.insert("filename", Settings::instance().getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".log").toStdString());
   fileLogger.insert("level", static_cast<int64_t>(Logging::INFO));
+  if (Settings::instance().isHeadless()) {
+    Common::JsonValue& consoleLogger = cfgLoggers.pushBack(Common::JsonValue::OBJECT);
+    consoleLogger.insert("type", "console");
+    consoleLogger.insert("level", static_cast<int64_t>(Logging::INFO));
+  }
+
   m_logManager.configure(loggerConfiguration);
+  m_logManager.addLogger(m_startupLogSink);
 }
 
-LoggerAdapter::LoggerAdapter() : m_logManager() {
+LoggerAdapter::LoggerAdapter() : m_startupLogSink(), m_logManager() {
 }
 
 LoggerAdapter::~LoggerAdapter() {
@@ -35,4 +42,8 @@ Logging::LoggerManager& LoggerAdapter::getLoggerManager() {
   return m_logManager;
 }
 
+StartupLogSink& LoggerAdapter::getStartupLogSink() {
+  return m_startupLogSink;
+}
+
 }
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "Logging/LoggerManager.h"
+#include "StartupLogSink.h"
 
 namespace WalletGui {
 
@@ -14,8 +15,11 @@ public:
   static LoggerAdapter& instance();
   void init();
   Logging::LoggerManager& getLoggerManager();
+  StartupLogSink& getStartupLogSink();
 
 private:
+  // Declared first, the manager refers to it until destroyed
+  StartupLogSink m_startupLogSink;
   Logging::LoggerManager m_logManager;
 
   LoggerAdapter();
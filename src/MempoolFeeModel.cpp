@@ -0,0 +1,166 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+
+#include <QMutexLocker>
+
+#include "CurrencyAdapter.h"
+#include "MempoolFeeModel.h"
+#include "NodeAdapter.h"
+
+namespace WalletGui {
+
+namespace {
+
+const int POOL_REFRESH_INTERVAL = 30000;
+const int FEE_RATE_BUCKETS_COUNT = 128;
+
+}
+
+MempoolFeeModel& MempoolFeeModel::instance() {
+  static MempoolFeeModel inst;
+  return inst;
+}
+
+MempoolFeeModel::MempoolFeeModel() : QObject(), m_buckets(FEE_RATE_BUCKETS_COUNT, Bucket {0, 0}), m_poolBytes(0), m_blockCapacity(0),
+  m_hasData(false), m_requestInProgress(false), m_pendingFailed(false) {
+  // Bucket i holds fee rates in [m_bucketBounds[i], m_bucketBounds[i + 1]), each bound is 25% above the previous one
+  m_bucketBounds.reserve(FEE_RATE_BUCKETS_COUNT);
+  m_bucketBounds.push_back(0);
+  m_bucketBounds.push_back(1);
+  while (m_bucketBounds.size() < FEE_RATE_BUCKETS_COUNT) {
+    quint64 last = m_bucketBounds.back();
+    m_bucketBounds.push_back(std::max(last + 1, last + last / 4));
+  }
+
+  m_refreshTimer.setInterval(POOL_REFRESH_INTERVAL);
+  connect(&m_refreshTimer, &QTimer::timeout, this, &MempoolFeeModel::refresh);
+  connect(this, &MempoolFeeModel::poolChangesReceivedSignal, this, &MempoolFeeModel::applyPoolChanges, Qt::QueuedConnection);
+}
+
+MempoolFeeModel::~MempoolFeeModel() {
+}
+
+bool MempoolFeeModel::hasData() const {
+  return m_hasData;
+}
+
+quint64 MempoolFeeModel::getPoolTransactionsCount() const {
+  return m_pool.size();
+}
+
+quint64 MempoolFeeModel::getPoolBytes() const {
+  return m_poolBytes;
+}
+
+quint64 MempoolFeeModel::estimateFeePerByte(quint32 _targetBlocks) const {
+  if (!m_hasData || m_blockCapacity == 0) {
+    return 0;
+  }
+
+  // Walk from the best paying bucket down until the transactions ahead of us fill the target blocks
+  const quint64 capacity = static_cast<quint64>(std::max<quint32>(_targetBlocks, 1)) * m_blockCapacity;
+  quint64 bytesAhead = 0;
+  for (int i = FEE_RATE_BUCKETS_COUNT - 1; i >= 0; --i) {
+    bytesAhead += m_buckets[i].bytes;
+    if (bytesAhead > capacity) {
+      return i + 1 < FEE_RATE_BUCKETS_COUNT ? m_bucketBounds[i + 1] : m_bucketBounds[i] + m_bucketBounds[i] / 4;
+    }
+  }
+
+  return 0;
+}
+
+quint64 MempoolFeeModel::estimateFee(quint32 _targetBlocks, quint64 _transactionSize) const {
+  return estimateFeePerByte(_targetBlocks) * _transactionSize;
+}
+
+int MempoolFeeModel::getBucketIndex(quint64 _fee, quint64 _size) const {
+  const quint64 feePerByte = _size > 0 ? _fee / _size : 0;
+  return static_cast<int>(std::upper_bound(m_bucketBounds.begin(), m_bucketBounds.end(), feePerByte) - m_bucketBounds.begin()) - 1;
+}
+
+void MempoolFeeModel::start() {
+  connect(&NodeAdapter::instance(), &NodeAdapter::localBlockchainUpdatedSignal, this, &MempoolFeeModel::refresh, Qt::UniqueConnection);
+  m_refreshTimer.start();
+  refresh();
+}
+
+void MempoolFeeModel::stop() {
+  disconnect(&NodeAdapter::instance(), &NodeAdapter::localBlockchainUpdatedSignal, this, &MempoolFeeModel::refresh);
+  m_refreshTimer.stop();
+}
+
+void MempoolFeeModel::refresh() {
+  if (m_requestInProgress) {
+    return;
+  }
+
+  std::vector<Crypto::Hash> knownPoolTxIds;
+  knownPoolTxIds.reserve(m_pool.size());
+  for (const auto& entry : m_pool) {
+    knownPoolTxIds.push_back(entry.first);
+  }
+
+  m_requestInProgress = true;
+  try {
+    NodeAdapter::instance().getPoolChanges(std::move(knownPoolTxIds),
+      [this](std::error_code _error, std::vector<PoolTransactionInfo>&& _addedTxs, std::vector<Crypto::Hash>&& _deletedTxIds) {
+        QMutexLocker locker(&m_pendingMutex);
+        m_pendingFailed = static_cast<bool>(_error);
+        m_pendingAdded = std::move(_addedTxs);
+        m_pendingDeleted = std::move(_deletedTxIds);
+        Q_EMIT poolChangesReceivedSignal();
+      });
+  } catch (std::system_error&) {
+    m_requestInProgress = false;
+  }
+}
+
+void MempoolFeeModel::applyPoolChanges() {
+  std::vector<PoolTransactionInfo> addedTxs;
+  std::vector<Crypto::Hash> deletedTxIds;
+  {
+    QMutexLocker locker(&m_pendingMutex);
+    m_requestInProgress = false;
+    if (m_pendingFailed) {
+      return;
+    }
+
+    addedTxs.swap(m_pendingAdded);
+    deletedTxIds.swap(m_pendingDeleted);
+  }
+
+  for (const Crypto::Hash& txId : deletedTxIds) {
+    auto it = m_pool.find(txId);
+    if (it == m_pool.end()) {
+      continue;
+    }
+
+    Bucket& bucket = m_buckets[it->second.bucket];
+    --bucket.count;
+    bucket.bytes -= it->second.size;
+    m_poolBytes -= it->second.size;
+    m_pool.erase(it);
+  }
+
+  for (const PoolTransactionInfo& tx : addedTxs) {
+    if (m_pool.count(tx.hash) != 0) {
+      continue;
+    }
+
+    const int bucketIndex = getBucketIndex(tx.fee, tx.size);
+    m_pool.emplace(tx.hash, PoolEntry {tx.size, bucketIndex});
+    ++m_buckets[bucketIndex].count;
+    m_buckets[bucketIndex].bytes += tx.size;
+    m_poolBytes += tx.size;
+  }
+
+  m_blockCapacity = CurrencyAdapter::instance().getMaxTransactionSize(NodeAdapter::instance().getCurrentBlockMajorVersion());
+  m_hasData = true;
+  Q_EMIT feeEstimatesUpdatedSignal();
+}
+
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include <QMutex>
+#include <QObject>
+#include <QTimer>
+
+#include "CryptoNoteWrapper.h"
+
+namespace WalletGui {
+
+// Fee-per-byte histogram of the transaction pool. It is kept in sync with the node
+// by pool differences, so only transactions that came or went are transferred.
+class MempoolFeeModel : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(MempoolFeeModel)
+
+public:
+  static MempoolFeeModel& instance();
+
+  void start();
+  void stop();
+
+  bool hasData() const;
+  quint64 getPoolTransactionsCount() const;
+  quint64 getPoolBytes() const;
+
+  // Lowest fee per byte that keeps a transaction within the first _targetBlocks blocks, 0 if the pool fits in them anyway
+  quint64 estimateFeePerByte(quint32 _targetBlocks) const;
+  quint64 estimateFee(quint32 _targetBlocks, quint64 _transactionSize) const;
+
+private:
+  struct PoolEntry {
+    quint64 size;
+    int bucket;
+  };
+
+  struct Bucket {
+    quint64 count;
+    quint64 bytes;
+  };
+
+  std::unordered_map<Crypto::Hash, PoolEntry> m_pool;
+  std::vector<quint64> m_bucketBounds;
+  std::vector<Bucket> m_buckets;
+  quint64 m_poolBytes;
+  quint64 m_blockCapacity;
+  bool m_hasData;
+  bool m_requestInProgress;
+  QTimer m_refreshTimer;
+
+  QMutex m_pendingMutex;
+  bool m_pendingFailed;
+  std::vector<PoolTransactionInfo> m_pendingAdded;
+  std::vector<Crypto::Hash> m_pendingDeleted;
+
+  MempoolFeeModel();
+  ~MempoolFeeModel();
+
+  int getBucketIndex(quint64 _fee, quint64 _size) const;
+  void refresh();
+  void applyPoolChanges();
+
+Q_SIGNALS:
+  void poolChangesReceivedSignal();
+  void feeEstimatesUpdatedSignal();
+};
+
+}
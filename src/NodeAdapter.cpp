@@ -3,6 +3,8 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <limits>
+
 #include <QCoreApplication>
 #include <QDateTime>
 #include <QDir>
@@ -11,17 +13,23 @@
 
 #include <P2p/NetNodeConfig.h>
 #include <Wallet/WalletErrors.h>
+#include <Logging/LoggerRef.h>
 
 #include "CurrencyAdapter.h"
 #include "LoggerAdapter.h"
 #include "NodeAdapter.h"
+#include "PeerScoreStore.h"
 #include "Settings.h"
+#include "StartupProfiler.h"
 #include <boost/program_options/variables_map.hpp>
 
 namespace WalletGui {
 
 namespace {
 
+// Kept connected as priority nodes, so half of the default outgoing connections are left for new peers
+const int SCORED_PEERS_COUNT = 4;
+
 std::vector<std::string> convertStringListToVector(const QStringList& list) {
   std::vector<std::string> result;
   Q_FOREACH (const QString& item, list) {
@@ -85,7 +93,8 @@ NodeAdapter& NodeAdapter::instance() {
   return inst;
 }
 
-NodeAdapter::NodeAdapter() : QObject(), m_node(nullptr), m_nodeInitializerThread(), m_nodeInitializer(new InProcessNodeInitializer) {
+NodeAdapter::NodeAdapter() : QObject(), m_node(nullptr), m_nodeInitializerThread(), m_nodeInitializer(new InProcessNodeInitializer),
+  m_startupHeight(0), m_timeToFirstBlock(-1) {
   m_nodeInitializer->moveToThread(&m_nodeInitializerThread);
 
   qRegisterMetaType<CryptoNote::NetNodeConfig>("CryptoNote::NetNodeConfig");
@@ -93,6 +102,7 @@ NodeAdapter::NodeAdapter() : QObject(), m_node(nullptr), m_nodeInitializerThread
   connect(m_nodeInitializer, &InProcessNodeInitializer::nodeInitCompletedSignal, this, &NodeAdapter::nodeInitCompletedSignal, Qt::QueuedConnection);
   connect(this, &NodeAdapter::initNodeSignal, m_nodeInitializer, &InProcessNodeInitializer::start, Qt::QueuedConnection);
   connect(this, &NodeAdapter::deinitNodeSignal, m_nodeInitializer, &InProcessNodeInitializer::stop, Qt::QueuedConnection);
+  connect(this, &NodeAdapter::localBlockchainUpdatedSignal, this, &NodeAdapter::firstBlockReceived, Qt::QueuedConnection);
 }
 
 NodeAdapter::~NodeAdapter() {
@@ -300,6 +310,27 @@ std::vector<CryptoNote::p2pConnection> NodeAdapter::getConnections() {
   return m_node->getConnections();
 }
 
+void NodeAdapter::getPoolChanges(std::vector<Crypto::Hash>&& _knownPoolTxIds, const PoolChangesCallback& _callback) {
+  Q_CHECK_PTR(m_node);
+  m_node->getPoolChanges(std::move(_knownPoolTxIds), _callback);
+}
+
+void NodeAdapter::prefetchRandomOuts(const std::map<uint64_t, uint64_t>& _outsCounts) {
+  Q_CHECK_PTR(m_node);
+  m_node->prefetchRandomOuts(_outsCounts);
+}
+
+std::error_code NodeAdapter::getRandomOuts(std::vector<uint64_t>&& _amounts, uint16_t _outsCount,
+  std::vector<CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& _result) {
+  Q_CHECK_PTR(m_node);
+  return m_node->getRandomOuts(std::move(_amounts), _outsCount, _result);
+}
+
+std::error_code NodeAdapter::relayTransaction(const CryptoNote::Transaction& _transaction) {
+  Q_CHECK_PTR(m_node);
+  return m_node->relayTransaction(_transaction);
+}
+
 void NodeAdapter::peerCountUpdated(Node& _node, size_t _count) {
   Q_UNUSED(_node);
   Q_EMIT peerCountUpdatedSignal(_count);
@@ -321,6 +352,10 @@ void NodeAdapter::connectionStatusUpdated(bool _connected) {
 
 bool NodeAdapter::initInProcessNode() {
   Q_ASSERT(m_node == nullptr);
+  PeerScoreStore::instance().load();
+  // Blocks reported while the node initializes don't count, the start height isn't known yet
+  m_startupHeight = std::numeric_limits<quint64>::max();
+  m_startupTimer.start();
   m_nodeInitializerThread.start();
   CryptoNote::NetNodeConfig netNodeConfig = makeNetNodeConfig();
   Q_EMIT initNodeSignal(&m_node, &CurrencyAdapter::instance().getCurrency(), this, &LoggerAdapter::instance().getLoggerManager(), netNodeConfig);
@@ -331,6 +366,8 @@ bool NodeAdapter::initInProcessNode() {
     return false;
   }
 
+  m_startupHeight = getLastLocalBlockHeight();
+  PeerScoreStore::instance().start();
   Q_EMIT localBlockchainUpdatedSignal(getLastLocalBlockHeight());
   Q_EMIT lastKnownBlockHeightUpdatedSignal(getLastKnownBlockHeight());
   return true;
@@ -339,6 +376,7 @@ bool NodeAdapter::initInProcessNode() {
 void NodeAdapter::deinit() {
   if (m_node != nullptr) {
     if (m_nodeInitializerThread.isRunning()) {
+      PeerScoreStore::instance().stop();
       m_nodeInitializer->stop(&m_node);
       QEventLoop waitLoop;
       connect(m_nodeInitializer, &InProcessNodeInitializer::nodeDeinitCompletedSignal, &waitLoop, &QEventLoop::quit, Qt::QueuedConnection);
@@ -370,7 +408,18 @@ CryptoNote::NetNodeConfig NodeAdapter::makeNetNodeConfig() const {
     options.insert(std::make_pair("add-peer", boost::program_options::variable_value(peerList, false)));
   }
 
-  std::vector<std::string> priorityNodeList = convertStringListToVector(Settings::instance().getPriorityNodes());
+  // Best scored peers of previous runs are dialed as priority nodes, which the node connects to before
+  // it picks anything from its peer list. Exclusive nodes leave no room for them.
+  QStringList priorityNodes = Settings::instance().getPriorityNodes();
+  if (Settings::instance().getExclusiveNodes().isEmpty()) {
+    Q_FOREACH (const QString& peer, PeerScoreStore::instance().getTopPeers(SCORED_PEERS_COUNT)) {
+      if (!priorityNodes.contains(peer)) {
+        priorityNodes.append(peer);
+      }
+    }
+  }
+
+  std::vector<std::string> priorityNodeList = convertStringListToVector(priorityNodes);
   if (!priorityNodeList.empty()) {
     options.insert(std::make_pair("add-priority-node", boost::program_options::variable_value(priorityNodeList, false)));
   }
@@ -404,6 +453,18 @@ bool NodeAdapter::isOffline() {
   return getConnectionsCount() == 0;
 }
 
+void NodeAdapter::firstBlockReceived(quint64 _height) {
+  if (m_timeToFirstBlock >= 0 || !m_startupTimer.isValid() || _height <= m_startupHeight) {
+    return;
+  }
+
+  m_timeToFirstBlock = m_startupTimer.elapsed();
+  const qint64 startupTimerUs = m_startupTimer.nsecsElapsed() / 1000;
+  StartupProfiler::instance().addSpan("time to first block", StartupProfiler::instance().elapsedUs() - startupTimerUs, startupTimerUs);
+  Logging::LoggerRef(LoggerAdapter::instance().getLoggerManager(), "NodeAdapter")(Logging::INFO) <<
+    "First block received " << m_timeToFirstBlock << " ms after node start";
+}
+
 }
 
 #include "NodeAdapter.moc"
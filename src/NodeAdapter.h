@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <QElapsedTimer>
 #include <QObject>
 #include <QThread>
 
@@ -58,6 +59,11 @@ public:
   uint8_t getCurrentBlockMajorVersion();
   quint64 getAlreadyGeneratedCoins();
   std::vector<CryptoNote::p2pConnection> getConnections();
+  void getPoolChanges(std::vector<Crypto::Hash>&& _knownPoolTxIds, const PoolChangesCallback& _callback);
+  void prefetchRandomOuts(const std::map<uint64_t, uint64_t>& _outsCounts);
+  std::error_code getRandomOuts(std::vector<uint64_t>&& _amounts, uint16_t _outsCount,
+    std::vector<CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& _result);
+  std::error_code relayTransaction(const CryptoNote::Transaction& _transaction);
   CryptoNote::BlockHeaderInfo getLastLocalBlockHeaderInfo();
   void peerCountUpdated(Node& _node, size_t _count) Q_DECL_OVERRIDE;
   void localBlockchainUpdated(Node& _node, uint64_t _height) Q_DECL_OVERRIDE;
@@ -69,12 +75,16 @@ private:
   Node* m_node;
   QThread m_nodeInitializerThread;
   InProcessNodeInitializer* m_nodeInitializer;
+  QElapsedTimer m_startupTimer;
+  quint64 m_startupHeight;
+  qint64 m_timeToFirstBlock;
 
   NodeAdapter();
   ~NodeAdapter();
 
   bool initInProcessNode();
   CryptoNote::NetNodeConfig makeNetNodeConfig() const;
+  void firstBlockReceived(quint64 _height);
 
 Q_SIGNALS:
   void localBlockchainUpdatedSignal(quint64 _height);
@@ -16,10 +16,12 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with Karbovanets.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <atomic>
+
 #include <QTime>
-#include <QTimerEvent>
 
 #include "OptimizationManager.h"
+#include "FusionPlanner.h"
 #include "WalletAdapter.h"
 #include "gui/WalletEvents.h"
 #include "NodeAdapter.h"
@@ -29,36 +31,142 @@ namespace WalletGui {
 
 namespace {
 
-const int CHECK_TIMER_INTERVAL = 1000;
+const int MSECS_IN_DAY = 24 * 60 * 60 * 1000;
 
 }
 
-OptimizationManager::OptimizationManager(QObject* _parent) : QObject(_parent),
-  m_checkTimerId(-1), m_optimizationTimerId(-1), m_currentOptimizationInterval(0), m_isSynchronized(false) {
+// Scans the outputs off the GUI thread, the wallet adapter is safe to read and send from here
+class FusionWorker : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(FusionWorker)
+
+public:
+  FusionWorker(QObject* _parent = nullptr) : QObject(_parent), lastPreviewId(0) {
+  }
+
+  ~FusionWorker() {
+  }
+
+  std::atomic<quint64> lastPreviewId;
+
+  void plan(quint64 _threshold, quint64 _mixin, quint64 _targetOutputCount) {
+    Q_EMIT planFinishedSignal(sendFusion(_threshold, _mixin, _targetOutputCount));
+  }
+
+  void preview(quint64 _previewId, quint64 _threshold, quint64 _mixin, quint64 _targetOutputCount) {
+    if (_previewId != lastPreviewId || !WalletAdapter::instance().isOpen()) {
+      return;
+    }
+
+    FusionPlan plan {{}, 0, 0, 0, 0};
+    const quint64 estimate = WalletAdapter::instance().estimateFusion(_threshold);
+    if (estimate > 0) {
+      plan = FusionPlanner(OptimizationManager::getFusionPlanParameters(_threshold, _mixin, _targetOutputCount)).plan(getAmounts(
+        WalletAdapter::instance().getSpendableOutputs()));
+    }
+
+    Q_EMIT previewFinishedSignal(_previewId, estimate, plan);
+  }
+
+Q_SIGNALS:
+  void planFinishedSignal(bool _sent);
+  void previewFinishedSignal(quint64 _previewId, quint64 _estimate, const FusionPlan& _plan);
+
+private:
+  static std::vector<uint64_t> getAmounts(const std::vector<CryptoNote::TransactionOutputInformation>& _outputs) {
+    std::vector<uint64_t> amounts;
+    amounts.reserve(_outputs.size());
+    for (const CryptoNote::TransactionOutputInformation& output : _outputs) {
+      amounts.push_back(output.amount);
+    }
+
+    return amounts;
+  }
+
+  // Sends every fusion of the plan's first round back to back, their inputs are disjoint
+  bool sendFusion(quint64 _threshold, quint64 _mixin, quint64 _targetOutputCount) {
+    if (!WalletAdapter::instance().isOpen()) {
+      return false;
+    }
+
+    // Counting is cheaper than planning, and usually tells there is nothing to optimize
+    if (WalletAdapter::instance().estimateFusion(_threshold) < CurrencyAdapter::instance().getCurrency().fusionTxMinInputCount()) {
+      return false;
+    }
+
+    std::vector<CryptoNote::TransactionOutputInformation> outputs = WalletAdapter::instance().getSpendableOutputs();
+    const FusionPlan plan = FusionPlanner(OptimizationManager::getFusionPlanParameters(_threshold, _mixin, _targetOutputCount)).plan(
+      getAmounts(outputs));
+    bool sent = false;
+    for (const FusionTransactionPlan& transaction : plan.transactions) {
+      if (transaction.round != 0) {
+        break;
+      }
+
+      std::list<CryptoNote::TransactionOutputInformation> fusionInputs;
+      for (size_t input : transaction.inputs) {
+        fusionInputs.push_back(outputs[input]);
+      }
+
+      WalletAdapter::instance().sendFusionTransaction(fusionInputs, 0, "", _mixin);
+      sent = true;
+    }
+
+    return sent;
+  }
+};
+
+OptimizationManager::OptimizationManager(QObject* _parent) : QObject(_parent), m_scheduleTimer(), m_optimizationTimer(), m_workerThread(),
+  m_worker(new FusionWorker), m_isActive(false), m_isSynchronized(false), m_isPlanning(false), m_isPlanStale(true), m_lastPreviewId(0) {
+    qRegisterMetaType<FusionPlan>("FusionPlan");
+    m_scheduleTimer.setSingleShot(true);
+    m_scheduleTimer.setTimerType(Qt::PreciseTimer);
+    m_optimizationTimer.setSingleShot(true);
+    m_worker->moveToThread(&m_workerThread);
+    connect(this, &OptimizationManager::planFusionSignal, m_worker, &FusionWorker::plan, Qt::QueuedConnection);
+    connect(m_worker, &FusionWorker::planFinishedSignal, this, &OptimizationManager::planFinished, Qt::QueuedConnection);
+    connect(this, &OptimizationManager::previewFusionSignal, m_worker, &FusionWorker::preview, Qt::QueuedConnection);
+    connect(m_worker, &FusionWorker::previewFinishedSignal, this, &OptimizationManager::fusionPreviewReadySignal, Qt::QueuedConnection);
+    connect(&m_workerThread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(&m_scheduleTimer, &QTimer::timeout, this, &OptimizationManager::checkOptimization);
+    connect(&m_optimizationTimer, &QTimer::timeout, this, &OptimizationManager::optimize);
+    connect(&Settings::instance(), &Settings::optimizationSettingsChangedSignal, this, &OptimizationManager::settingsChanged);
     connect(&WalletAdapter::instance(), &WalletAdapter::walletInitCompletedSignal, this, &OptimizationManager::walletOpened);
     connect(&WalletAdapter::instance(), &WalletAdapter::walletCloseCompletedSignal, this, &OptimizationManager::walletClosed);
     connect(&WalletAdapter::instance(), &WalletAdapter::walletSynchronizationProgressUpdatedSignal, this, &OptimizationManager::synchronizationProgressUpdated, Qt::QueuedConnection);
     connect(&WalletAdapter::instance(), &WalletAdapter::walletSynchronizationCompletedSignal, this, &OptimizationManager::synchronizationCompleted, Qt::QueuedConnection);
+    connect(&WalletAdapter::instance(), &WalletAdapter::walletActualBalanceUpdatedSignal, this, &OptimizationManager::outputsChanged, Qt::QueuedConnection);
+    connect(&WalletAdapter::instance(), &WalletAdapter::walletPendingBalanceUpdatedSignal, this, &OptimizationManager::outputsChanged, Qt::QueuedConnection);
+    m_workerThread.start();
 }
 
 OptimizationManager::~OptimizationManager() {
+  m_workerThread.quit();
+  m_workerThread.wait();
+}
+
+FusionPlanParameters OptimizationManager::getFusionPlanParameters(quint64 _threshold, quint64 _mixin, quint64 _targetOutputCount) {
+  const CryptoNote::Currency& currency = CurrencyAdapter::instance().getCurrency();
+  return FusionPlanParameters {_threshold, currency.defaultDustThreshold(), _mixin, currency.fusionTxMaxSize(), currency.fusionTxMinInputCount(),
+    currency.fusionTxMinInOutCountRatio(), _targetOutputCount, 0};
+}
+
+quint64 OptimizationManager::previewFusion(quint64 _threshold, quint64 _mixin, quint64 _targetOutputCount) {
+  m_worker->lastPreviewId = ++m_lastPreviewId;
+  Q_EMIT previewFusionSignal(m_lastPreviewId, _threshold, _mixin, _targetOutputCount);
+  return m_lastPreviewId;
 }
 
 void OptimizationManager::walletOpened() {
-  m_checkTimerId = startTimer(CHECK_TIMER_INTERVAL);
+  m_isPlanStale = true;
+  checkOptimization();
 }
 
 void OptimizationManager::walletClosed() {
+  m_isActive = false;
   m_isSynchronized = false;
-  if (m_checkTimerId != -1) {
-    killTimer(m_checkTimerId);
-    m_checkTimerId = -1;
-  }
-
-  if (m_optimizationTimerId != -1) {
-    killTimer(m_optimizationTimerId);
-    m_optimizationTimerId = -1;
-  }
+  m_scheduleTimer.stop();
+  m_optimizationTimer.stop();
 }
 
 void OptimizationManager::synchronizationProgressUpdated() {
@@ -67,85 +175,87 @@ void OptimizationManager::synchronizationProgressUpdated() {
 
 void OptimizationManager::synchronizationCompleted() {
   m_isSynchronized = true;
+  optimize();
 }
 
-void OptimizationManager::timerEvent(QTimerEvent* _event) {
-  if (_event->timerId() == m_checkTimerId) {
-    checkOptimization();
-  } else if (_event->timerId() == m_optimizationTimerId) {
-    optimize();
-  }
+void OptimizationManager::settingsChanged() {
+  m_isPlanStale = true;
+  checkOptimization();
+  optimize();
+}
 
-  QObject::timerEvent(_event);
+void OptimizationManager::outputsChanged() {
+  m_isPlanStale = true;
+  optimize();
 }
 
+// Called on wallet and settings changes and at window boundaries only, the timer is armed for the next boundary
 void OptimizationManager::checkOptimization() {
-  if (Settings::instance().isOptimizationEnabled() && WalletAdapter::instance().isOpen()) {
-    bool customTimeEnabled = Settings::instance().isOptimizationTimeSetManually();
-    QTime startTime = Settings::instance().getOptimizationStartTime();
-    QTime stopTime = Settings::instance().getOptimizationStopTime();
-    QTime currentTime = QTime::currentTime();
-    if (!customTimeEnabled || startTime == stopTime) {
-      ensureStarted();
-    } else if (stopTime > startTime) {
-      if (currentTime >= startTime && currentTime < stopTime) {
-        ensureStarted();
-      } else {
-        ensureStopped();
-      }
-    } else {
-      if ((currentTime >= startTime && currentTime < QTime(0, 0)) || (currentTime >= QTime(0, 0) && currentTime < stopTime)) {
-        ensureStarted();
-      } else {
-        ensureStopped();
-      }
-    }
-  } else {
-    ensureStopped();
+  m_scheduleTimer.stop();
+  int msecsToChange = -1;
+  bool isActive = Settings::instance().isOptimizationEnabled() && !Settings::instance().isTrackingMode() &&
+    WalletAdapter::instance().isOpen() && isInSchedule(msecsToChange);
+  if (msecsToChange >= 0) {
+    m_scheduleTimer.start(msecsToChange);
   }
-}
 
-void OptimizationManager::optimize() {
-  if (!Settings::instance().isTrackingMode() && WalletAdapter::instance().isOpen() && m_isSynchronized) {
-    size_t fusionReadyCount = WalletAdapter::instance().estimateFusion(CurrencyAdapter::instance().getMinimumFee());
-    const size_t MAX_FUSION_OUTPUT_COUNT = 4;
-    const quint64 mixin = Settings::instance().getOptimizationMixin();
-    size_t estimatedFusionInputsCount = CurrencyAdapter::instance().getCurrency().getApproximateMaximumInputCount(CurrencyAdapter::instance().getCurrency().fusionTxMaxSize(), MAX_FUSION_OUTPUT_COUNT, mixin);
-    if (estimatedFusionInputsCount < CurrencyAdapter::instance().getCurrency().fusionTxMinInputCount()) {
-      // Mixin is too big
-      return;
-    }
-    std::list<CryptoNote::TransactionOutputInformation> fusionInputs = WalletAdapter::instance().getFusionTransfersToSend(Settings::instance().getOptimizationThreshold(), CurrencyAdapter::instance().getCurrency().fusionTxMinInputCount(), estimatedFusionInputsCount);
-    if (fusionInputs.size() < CurrencyAdapter::instance().getCurrency().fusionTxMinInputCount()) {
-      //nothing to optimize
-      return;
-    }
-    quint64 amount = 0;
-    WalletAdapter::instance().sendFusionTransaction(fusionInputs, 0, "", mixin);
+  m_optimizationTimer.setInterval(static_cast<int>(Settings::instance().getOptimizationInterval()));
+  if (!isActive) {
+    m_isActive = false;
+    m_optimizationTimer.stop();
+    return;
+  }
+
+  if (!m_isActive) {
+    m_isActive = true;
+    optimize();
   }
 }
 
-void OptimizationManager::ensureStarted() {
-  if (m_optimizationTimerId != -1) {
-    if (m_currentOptimizationInterval == Settings::instance().getOptimizationInterval()) {
-      return;
-    }
+bool OptimizationManager::isInSchedule(int& _msecsToChange) const {
+  _msecsToChange = -1;
+  QTime startTime = Settings::instance().getOptimizationStartTime();
+  QTime stopTime = Settings::instance().getOptimizationStopTime();
+  if (!Settings::instance().isOptimizationTimeSetManually() || startTime == stopTime) {
+    return true;
   }
 
-  m_currentOptimizationInterval = Settings::instance().getOptimizationInterval();
-  m_optimizationTimerId = startTimer(m_currentOptimizationInterval);
+  QTime currentTime = QTime::currentTime();
+  bool inSchedule = stopTime > startTime ? (currentTime >= startTime && currentTime < stopTime) : (currentTime >= startTime || currentTime < stopTime);
+  _msecsToChange = currentTime.msecsTo(inSchedule ? stopTime : startTime);
+  if (_msecsToChange <= 0) {
+    _msecsToChange += MSECS_IN_DAY;
+  }
 
-  optimize();
+  return inSchedule;
+}
+
+// A fusion is followed by a pause of the optimization interval, otherwise planning waits for the outputs to change
+void OptimizationManager::optimize() {
+  if (!m_isActive || !m_isSynchronized || m_isPlanning || !m_isPlanStale || m_optimizationTimer.isActive()) {
+    return;
+  }
+
+  m_isPlanning = true;
+  m_isPlanStale = false;
+  Q_EMIT planFusionSignal(Settings::instance().getOptimizationThreshold(), Settings::instance().getOptimizationMixin(),
+    Settings::instance().getOptimizationTargetOutputCount());
 }
 
-void OptimizationManager::ensureStopped() {
-  if (m_optimizationTimerId == -1) {
+void OptimizationManager::planFinished(bool _sent) {
+  m_isPlanning = false;
+  if (!m_isActive) {
     return;
   }
 
-  killTimer(m_optimizationTimerId);
-  m_currentOptimizationInterval = 0;
-  m_optimizationTimerId = -1;
+  if (_sent) {
+    m_isPlanStale = true;
+    m_optimizationTimer.start();
+  }
+
+  optimize();
 }
 
 }
+
+#include "OptimizationManager.moc"
@@ -19,13 +19,20 @@
 #pragma once
 
 #include <QObject>
+#include <QThread>
+#include <QTimer>
 
 #include "CryptoNoteWrapper.h"
 #include "CurrencyAdapter.h"
+#include "FusionPlanner.h"
 #include "WalletAdapter.h"
 
 namespace WalletGui {
 
+class FusionWorker;
+
+// Optimizes only when something can have changed: the output set, the synchronization state,
+// the settings or the schedule window. Fusion estimation and selection run on a worker thread.
 class OptimizationManager : public QObject {
   Q_OBJECT
   Q_DISABLE_COPY(OptimizationManager)
@@ -35,25 +42,39 @@ public:
   ~OptimizationManager();
 
   void checkOptimization();
+  // Dry run of the whole consolidation on the worker, answered by fusionPreviewReadySignal with the returned id.
+  // A newer request drops the ones still waiting.
+  quint64 previewFusion(quint64 _threshold, quint64 _mixin, quint64 _targetOutputCount);
+
+  // Fusion rules of the currency with the given settings, fusion transactions pay no fee
+  static FusionPlanParameters getFusionPlanParameters(quint64 _threshold, quint64 _mixin, quint64 _targetOutputCount);
 
   Q_SLOT void walletOpened();
   Q_SLOT void walletClosed();
   Q_SLOT void synchronizationProgressUpdated();
   Q_SLOT void synchronizationCompleted();
 
-protected:
-  virtual void timerEvent(QTimerEvent* _event);
-
 private:
-  int m_checkTimerId;
-  int m_optimizationTimerId;
-  quint64 m_currentOptimizationInterval;
+  QTimer m_scheduleTimer;
+  QTimer m_optimizationTimer;
+  QThread m_workerThread;
+  FusionWorker* m_worker;
+  bool m_isActive;
   bool m_isSynchronized;
+  bool m_isPlanning;
+  bool m_isPlanStale;
+  quint64 m_lastPreviewId;
 
   void optimize();
-  void ensureStarted();
-  void ensureStopped();
+  void settingsChanged();
+  void outputsChanged();
+  void planFinished(bool _sent);
+  bool isInSchedule(int& _msecsToChange) const;
 
+Q_SIGNALS:
+  void planFusionSignal(quint64 _threshold, quint64 _mixin, quint64 _targetOutputCount);
+  void previewFusionSignal(quint64 _previewId, quint64 _threshold, quint64 _mixin, quint64 _targetOutputCount);
+  void fusionPreviewReadySignal(quint64 _previewId, quint64 _estimate, const FusionPlan& _plan);
 };
 
 }
@@ -0,0 +1,76 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+
+namespace WalletGui {
+
+namespace Detail {
+
+template <typename Func>
+class RangeRunnable : public QRunnable {
+public:
+  RangeRunnable(const Func& _func, size_t _begin, size_t _end, QSemaphore& _done) : m_func(_func), m_begin(_begin), m_end(_end), m_done(_done) {
+    setAutoDelete(false);
+  }
+
+  void run() override {
+    for (size_t i = m_begin; i < m_end; ++i) {
+      m_func(i);
+    }
+
+    m_done.release();
+  }
+
+private:
+  const Func& m_func;
+  size_t m_begin;
+  size_t m_end;
+  QSemaphore& m_done;
+};
+
+}
+
+// Calls _func for every index below _count in up to _chunks contiguous ranges. The ranges after the first
+// go to the global thread pool, the calling thread takes the first one and then runs the ranges no pool
+// thread has started yet, so a caller that is itself a pool thread never waits on a queue it blocks.
+// _func must not throw.
+template <typename Func>
+void parallelFor(size_t _chunks, size_t _count, const Func& _func) {
+  if (_count == 0) {
+    return;
+  }
+
+  const size_t range = (_count + std::max<size_t>(_chunks, 1) - 1) / std::max<size_t>(_chunks, 1);
+  QThreadPool* pool = QThreadPool::globalInstance();
+  QSemaphore done;
+  std::vector<std::unique_ptr<Detail::RangeRunnable<Func>>> ranges;
+  for (size_t begin = range; begin < _count; begin += range) {
+    ranges.emplace_back(new Detail::RangeRunnable<Func>(_func, begin, std::min(begin + range, _count), done));
+    pool->start(ranges.back().get());
+  }
+
+  for (size_t i = 0; i < std::min(range, _count); ++i) {
+    _func(i);
+  }
+
+  for (const std::unique_ptr<Detail::RangeRunnable<Func>>& pending : ranges) {
+    if (pool->tryTake(pending.get())) {
+      pending->run();
+    }
+  }
+
+  done.acquire(static_cast<int>(ranges.size()));
+}
+
+}
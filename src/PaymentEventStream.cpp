@@ -0,0 +1,227 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QLocalSocket>
+
+#include <Common/StringTools.h>
+
+#include "PaymentEventStream.h"
+#include "NodeAdapter.h"
+#include "Settings.h"
+#include "WalletAdapter.h"
+
+namespace WalletGui {
+
+namespace {
+
+const size_t MAX_HISTORY_SIZE = 10000;
+// A subscriber that does not read is dropped instead of buffering without end, it can resume
+const qint64 MAX_PENDING_BYTES = 4 * 1024 * 1024;
+// The first confirmation and the age at which outputs become spendable
+const quint64 CONFIRMATION_THRESHOLDS[] = {1, 10};
+const quint64 LAST_CONFIRMATION_THRESHOLD = 10;
+
+// The same count as shown in the transaction list
+quint64 getConfirmations(const CryptoNote::WalletLegacyTransaction& _transaction) {
+  if (_transaction.blockHeight == CryptoNote::WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
+    return 0;
+  }
+
+  return NodeAdapter::instance().getLastKnownBlockHeight() + 1 - _transaction.blockHeight + 1;
+}
+
+}
+
+PaymentEventStream::PaymentEventStream(QObject* _parent) : QObject(_parent),
+  m_session(QString::number(QDateTime::currentMSecsSinceEpoch(), 16)), m_seq(0), m_actualBalance(0), m_pendingBalance(0) {
+  connect(&WalletAdapter::instance(), &WalletAdapter::walletInitCompletedSignal, this, &PaymentEventStream::walletInitCompleted,
+    Qt::QueuedConnection);
+  connect(&WalletAdapter::instance(), &WalletAdapter::walletTransactionCreatedSignal, this, &PaymentEventStream::transactionCreated,
+    Qt::QueuedConnection);
+  connect(&WalletAdapter::instance(), &WalletAdapter::walletTransactionUpdatedSignal, this, &PaymentEventStream::transactionUpdated,
+    Qt::QueuedConnection);
+  connect(&WalletAdapter::instance(), &WalletAdapter::walletActualBalanceUpdatedSignal, this, &PaymentEventStream::balanceUpdated,
+    Qt::QueuedConnection);
+  connect(&WalletAdapter::instance(), &WalletAdapter::walletPendingBalanceUpdatedSignal, this, &PaymentEventStream::balanceUpdated,
+    Qt::QueuedConnection);
+  connect(&NodeAdapter::instance(), &NodeAdapter::lastKnownBlockHeightUpdatedSignal, this, &PaymentEventStream::blockHeightUpdated,
+    Qt::QueuedConnection);
+  // Without the cookie nobody can subscribe
+  m_cookie.create(Settings::instance().getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".events.cookie"));
+}
+
+PaymentEventStream::~PaymentEventStream() {
+  m_cookie.remove();
+}
+
+bool PaymentEventStream::subscribe(QLocalSocket* _socket, const QByteArray& _token, quint64 _lastSeq) {
+  if (!m_cookie.isValid(_token)) {
+    return false;
+  }
+
+  if (m_subscribers.contains(_socket)) {
+    return true;
+  }
+
+  const bool isComplete = _lastSeq >= m_seq || (!m_history.empty() && _lastSeq + 1 >= m_history.front().seq);
+  QJsonObject subscribed {{"seq", static_cast<double>(m_seq)}, {"type", "subscribed"}, {"session", m_session}, {"complete", isComplete}};
+  write(_socket, QJsonDocument(subscribed).toJson(QJsonDocument::Compact));
+  for (const Event& event : m_history) {
+    if (event.seq > _lastSeq) {
+      write(_socket, event.frame);
+    }
+  }
+
+  m_subscribers.append(_socket);
+  connect(_socket, &QLocalSocket::disconnected, this, [this, _socket]() {
+    m_subscribers.removeOne(_socket);
+  });
+
+  connect(_socket, &QObject::destroyed, this, [this, _socket]() {
+    m_subscribers.removeOne(_socket);
+  });
+
+  return true;
+}
+
+void PaymentEventStream::publish(const QString& _type, QJsonObject _event) {
+  _event.insert("seq", static_cast<double>(++m_seq));
+  _event.insert("type", _type);
+  const QByteArray frame = QJsonDocument(_event).toJson(QJsonDocument::Compact);
+  m_history.push_back(Event {m_seq, frame});
+  if (m_history.size() > MAX_HISTORY_SIZE) {
+    m_history.pop_front();
+  }
+
+  const QList<QLocalSocket*> subscribers = m_subscribers;
+  for (QLocalSocket* socket : subscribers) {
+    if (socket->bytesToWrite() > MAX_PENDING_BYTES) {
+      m_subscribers.removeOne(socket);
+      socket->abort();
+      continue;
+    }
+
+    write(socket, frame);
+  }
+}
+
+void PaymentEventStream::write(QLocalSocket* _socket, const QByteArray& _frame) {
+  QByteArray block;
+  QDataStream out(&block, QIODevice::WriteOnly);
+  out << _frame;
+  _socket->write(block);
+}
+
+void PaymentEventStream::publishTransaction(const QString& _type, CryptoNote::TransactionId _transactionId) {
+  CryptoNote::WalletLegacyTransaction transaction;
+  if (!WalletAdapter::instance().getTransaction(_transactionId, transaction)) {
+    return;
+  }
+
+  const bool isConfirmed = transaction.blockHeight != CryptoNote::WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT;
+  publish(_type, QJsonObject {
+    {"id", static_cast<double>(_transactionId)},
+    {"hash", QString::fromStdString(Common::podToHex(transaction.hash))},
+    {"blockHeight", isConfirmed ? QJsonValue(static_cast<double>(transaction.blockHeight)) : QJsonValue()},
+    {"confirmations", static_cast<double>(getConfirmations(transaction))},
+    {"timestamp", static_cast<double>(transaction.timestamp)},
+    {"totalAmount", QString::number(transaction.totalAmount)},
+    {"fee", QString::number(transaction.fee)},
+    {"isCoinbase", transaction.isCoinbase},
+    {"paymentId", NodeAdapter::instance().extractPaymentId(transaction.extra)}
+  });
+}
+
+// Reports the thresholds crossed since the last check, once each
+void PaymentEventStream::checkConfirmations(CryptoNote::TransactionId _transactionId, bool _isPublishing) {
+  CryptoNote::WalletLegacyTransaction transaction;
+  if (!WalletAdapter::instance().getTransaction(_transactionId, transaction) ||
+      transaction.state != CryptoNote::WalletLegacyTransactionState::Active) {
+    m_unconfirmedTransactions.remove(_transactionId);
+    return;
+  }
+
+  const quint64 confirmations = getConfirmations(transaction);
+  const quint64 reported = m_unconfirmedTransactions.value(_transactionId, 0);
+  if (_isPublishing) {
+    for (quint64 threshold : CONFIRMATION_THRESHOLDS) {
+      if (reported < threshold && confirmations >= threshold) {
+        publish("confirmations", QJsonObject {
+          {"id", static_cast<double>(_transactionId)},
+          {"hash", QString::fromStdString(Common::podToHex(transaction.hash))},
+          {"threshold", static_cast<double>(threshold)},
+          {"confirmations", static_cast<double>(confirmations)}
+        });
+      }
+    }
+  }
+
+  if (confirmations >= LAST_CONFIRMATION_THRESHOLD) {
+    m_unconfirmedTransactions.remove(_transactionId);
+  } else {
+    // A reorganization can take confirmations back, the thresholds are reported again then
+    m_unconfirmedTransactions.insert(_transactionId, confirmations);
+  }
+}
+
+void PaymentEventStream::walletInitCompleted(int _error) {
+  if (_error != 0) {
+    return;
+  }
+
+  m_unconfirmedTransactions.clear();
+  m_actualBalance = WalletAdapter::instance().getActualBalance();
+  m_pendingBalance = WalletAdapter::instance().getPendingBalance();
+  publish("walletOpened", QJsonObject {
+    {"address", WalletAdapter::instance().getAddress()},
+    {"transactionCount", static_cast<double>(WalletAdapter::instance().getTransactionCount())},
+    {"actual", QString::number(m_actualBalance)},
+    {"pending", QString::number(m_pendingBalance)}
+  });
+
+  // The thresholds already crossed are not reported for the loaded transactions
+  const CryptoNote::TransactionId count = WalletAdapter::instance().getTransactionCount();
+  for (CryptoNote::TransactionId transactionId = 0; transactionId < count; ++transactionId) {
+    checkConfirmations(transactionId, false);
+  }
+}
+
+void PaymentEventStream::transactionCreated(CryptoNote::TransactionId _transactionId) {
+  publishTransaction("transactionCreated", _transactionId);
+  checkConfirmations(_transactionId, true);
+}
+
+void PaymentEventStream::transactionUpdated(CryptoNote::TransactionId _transactionId) {
+  publishTransaction("transactionUpdated", _transactionId);
+  checkConfirmations(_transactionId, true);
+}
+
+void PaymentEventStream::balanceUpdated() {
+  if (!WalletAdapter::instance().isOpen()) {
+    return;
+  }
+
+  const quint64 actualBalance = WalletAdapter::instance().getActualBalance();
+  const quint64 pendingBalance = WalletAdapter::instance().getPendingBalance();
+  if (actualBalance == m_actualBalance && pendingBalance == m_pendingBalance) {
+    return;
+  }
+
+  m_actualBalance = actualBalance;
+  m_pendingBalance = pendingBalance;
+  publish("balance", QJsonObject {{"actual", QString::number(actualBalance)}, {"pending", QString::number(pendingBalance)}});
+}
+
+void PaymentEventStream::blockHeightUpdated() {
+  const QList<CryptoNote::TransactionId> transactionIds = m_unconfirmedTransactions.keys();
+  for (CryptoNote::TransactionId transactionId : transactionIds) {
+    checkConfirmations(transactionId, true);
+  }
+}
+
+}
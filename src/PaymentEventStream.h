@@ -0,0 +1,75 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <deque>
+
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+
+#include <IWalletLegacy.h>
+
+#include "AuthCookie.h"
+
+class QLocalSocket;
+
+namespace WalletGui {
+
+// Pushes wallet events to subscribers of the local socket server, so payment processors do not
+// have to poll. Every event is a JSON object framed by its byte length as a big-endian quint32 (the
+// QDataStream encoding of a QByteArray) and carries a "seq" number increasing by one per event.
+//
+// A subscriber sends the message "subscribe:<token>:<seq>", with the token of the owner-only cookie file
+// "<application>.events.cookie" in the data directory, which is rewritten on every start. A wrong token
+// drops the connection. Otherwise it first gets a "subscribed" event with the session and the
+// current sequence number, then the kept events after <seq>, then the live ones. The session
+// changes with every start of the application, and "complete" is false when events after <seq>
+// were already dropped from the history; the client has to resynchronize in both cases.
+//
+// Events: "transactionCreated", "transactionUpdated", "confirmations" when a transaction reaches
+// one of the confirmation thresholds, "balance" when a balance changes and "walletOpened" when the
+// transaction IDs start over. Amounts are strings of atomic units.
+class PaymentEventStream : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(PaymentEventStream)
+
+public:
+  PaymentEventStream(QObject* _parent);
+  ~PaymentEventStream();
+
+  // False when the token is wrong, the caller drops the client then
+  bool subscribe(QLocalSocket* _socket, const QByteArray& _token, quint64 _lastSeq);
+
+private:
+  struct Event {
+    quint64 seq;
+    QByteArray frame;
+  };
+
+  AuthCookie m_cookie;
+  QString m_session;
+  quint64 m_seq;
+  std::deque<Event> m_history;
+  QList<QLocalSocket*> m_subscribers;
+  // Transactions below the highest threshold, by ID, with the confirmations already reported
+  QHash<CryptoNote::TransactionId, quint64> m_unconfirmedTransactions;
+  quint64 m_actualBalance;
+  quint64 m_pendingBalance;
+
+  void publish(const QString& _type, QJsonObject _event);
+  void write(QLocalSocket* _socket, const QByteArray& _frame);
+  void publishTransaction(const QString& _type, CryptoNote::TransactionId _transactionId);
+  void checkConfirmations(CryptoNote::TransactionId _transactionId, bool _isPublishing);
+
+  void walletInitCompleted(int _error);
+  void transactionCreated(CryptoNote::TransactionId _transactionId);
+  void transactionUpdated(CryptoNote::TransactionId _transactionId);
+  void balanceUpdated();
+  void blockHeightUpdated();
+};
+
+}
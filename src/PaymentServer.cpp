@@ -16,6 +16,7 @@
 #include <QUrl>
 #endif
 #include "PaymentServer.h"
+#include "PaymentEventStream.h"
 #include "Settings.h"
 #include "CurrencyAdapter.h"
 
@@ -24,6 +25,9 @@ using namespace WalletGui;
 
 const int BITCOIN_IPC_CONNECT_TIMEOUT = 1000; // milliseconds
 const QString BITCOIN_IPC_PREFIX("karbowanec:");
+const QString IPC_SUBSCRIBE_PREFIX("subscribe:");
+const quint32 IPC_MAX_MESSAGE_SIZE = 64 * 1024;
+const int IPC_MAX_CONNECTIONS = 64;
 
 static QString ipcServerName()
 {
@@ -40,15 +44,29 @@ static QString ipcServerName()
 static QStringList savedPaymentRequests;
 
 //
-// Sending to the server is done synchronously, at startup.
+// Messages in both directions are framed by their
+// byte length as a big-endian quint32, the QDataStream
+// encoding of a QByteArray, followed by UTF-8 text.
+// A connection may carry any number of them.
+//
+static QByteArray ipcFrame(const QByteArray& payload)
+{
+    QByteArray frame;
+    QDataStream out(&frame, QIODevice::WriteOnly);
+    out << payload;
+    return frame;
+}
+
+//
+// Sending to the server is done synchronously, at startup,
+// all URIs over one connection. This runs in the second
+// instance before it has any user interface.
 // If the server isn't already running, startup continues,
 // and the items in savedPaymentRequest will be handled
 // when uiReady() is called.
 //
 bool PaymentServer::ipcSendCommandLine()
 {
-    bool fResult = false;
-
     const QStringList& args = qApp->arguments();
     for (int i = 1; i < args.size(); i++)
     {
@@ -57,30 +75,30 @@ bool PaymentServer::ipcSendCommandLine()
         savedPaymentRequests.append(args[i]);
     }
 
+    if (savedPaymentRequests.isEmpty())
+        return false;
+
+    QLocalSocket socket;
+    socket.connectToServer(ipcServerName(), QIODevice::WriteOnly);
+    if (!socket.waitForConnected(BITCOIN_IPC_CONNECT_TIMEOUT))
+        return false;
+
+    QByteArray block;
     foreach (const QString& arg, savedPaymentRequests)
+        block += ipcFrame(arg.toUtf8());
+
+    socket.write(block);
+    while (socket.bytesToWrite() > 0)
     {
-        QLocalSocket* socket = new QLocalSocket();
-        socket->connectToServer(ipcServerName(), QIODevice::WriteOnly);
-        if (!socket->waitForConnected(BITCOIN_IPC_CONNECT_TIMEOUT))
+        if (!socket.waitForBytesWritten(BITCOIN_IPC_CONNECT_TIMEOUT))
             return false;
-
-        QByteArray block;
-        QDataStream out(&block, QIODevice::WriteOnly);
-        out.setVersion(QDataStream::Qt_4_0);
-        out << arg;
-        out.device()->seek(0);
-        socket->write(block);
-        socket->flush();
-
-        socket->waitForBytesWritten(BITCOIN_IPC_CONNECT_TIMEOUT);
-        socket->disconnectFromServer();
-        delete socket;
-        fResult = true;
     }
-    return fResult;
+
+    socket.disconnectFromServer();
+    return true;
 }
 
-PaymentServer::PaymentServer(QApplication* parent) : QObject(parent), saveURIs(true)
+PaymentServer::PaymentServer(QCoreApplication* parent) : QObject(parent), saveURIs(true)
 {
     // Install global event filter to catch QFileOpenEvents on the mac (sent when you click bitcoin: links)
     parent->installEventFilter(this);
@@ -91,6 +109,9 @@ PaymentServer::PaymentServer(QApplication* parent) : QObject(parent), saveURIs(t
     QLocalServer::removeServer(name);
 
     uriServer = new QLocalServer(this);
+    // Only the user running the wallet may connect, other users of the machine can't reach the pipe
+    uriServer->setSocketOptions(QLocalServer::UserAccessOption);
+    eventStream = new PaymentEventStream(this);
 
     if (!uriServer->listen(name))
         qDebug() << tr("Cannot start karbowanec: click-to-pay handler");
@@ -127,21 +148,84 @@ void PaymentServer::uiReady()
 
 void PaymentServer::handleURIConnection()
 {
-    QLocalSocket *clientConnection = uriServer->nextPendingConnection();
+    while (QLocalSocket* clientConnection = uriServer->nextPendingConnection())
+    {
+        // Every client costs a buffer, their number is bounded
+        if (ipcBuffers.size() >= IPC_MAX_CONNECTIONS)
+        {
+            clientConnection->abort();
+            clientConnection->deleteLater();
+            continue;
+        }
+
+        ipcBuffers.insert(clientConnection, QByteArray());
+        connect(clientConnection, &QLocalSocket::readyRead, this, [this, clientConnection]() {
+            readIPCMessages(clientConnection);
+        });
+        connect(clientConnection, &QLocalSocket::disconnected, this, [this, clientConnection]() {
+            ipcBuffers.remove(clientConnection);
+            clientConnection->deleteLater();
+        });
+
+        // Data may have arrived with the connection
+        readIPCMessages(clientConnection);
+    }
+}
+
+//
+// Reads what has arrived and handles every complete
+// message, the rest stays buffered until the next
+// readyRead(). Nothing here waits for the client.
+//
+void PaymentServer::readIPCMessages(QLocalSocket* clientConnection)
+{
+    if (!ipcBuffers.contains(clientConnection))
+        return;
+
+    QByteArray buffer = ipcBuffers.value(clientConnection) + clientConnection->readAll();
+    int offset = 0;
+    while (buffer.size() - offset >= (int)sizeof(quint32))
+    {
+        const uchar* header = reinterpret_cast<const uchar*>(buffer.constData() + offset);
+        const quint32 length = (quint32(header[0]) << 24) | (quint32(header[1]) << 16) | (quint32(header[2]) << 8) | quint32(header[3]);
+        if (length > IPC_MAX_MESSAGE_SIZE)
+        {
+            qDebug() << tr("Dropping an IPC client sending a message of %1 bytes").arg(length);
+            clientConnection->abort();
+            return;
+        }
 
-    while (clientConnection->bytesAvailable() < (int)sizeof(quint32))
-        clientConnection->waitForReadyRead();
+        if (buffer.size() - offset - (int)sizeof(quint32) < (int)length)
+            break;
 
-    connect(clientConnection, SIGNAL(disconnected()),
-            clientConnection, SLOT(deleteLater()));
+        const QString message = QString::fromUtf8(buffer.constData() + offset + sizeof(quint32), length);
+        offset += sizeof(quint32) + length;
+        handleIPCMessage(clientConnection, message);
+        // Handling may have dropped the client
+        if (!ipcBuffers.contains(clientConnection))
+            return;
+    }
+
+    ipcBuffers.insert(clientConnection, buffer.mid(offset));
+}
 
-    QDataStream in(clientConnection);
-    in.setVersion(QDataStream::Qt_4_0);
-    if (clientConnection->bytesAvailable() < (int)sizeof(quint16)) {
+void PaymentServer::handleIPCMessage(QLocalSocket* clientConnection, const QString& message)
+{
+    // The connection stays open for the events
+    if (message.startsWith(IPC_SUBSCRIBE_PREFIX))
+    {
+        // "subscribe:<token>:<seq>", see PaymentEventStream
+        const QStringList fields = message.mid(IPC_SUBSCRIBE_PREFIX.size()).split(':');
+        if (fields.size() != 2 || !eventStream->subscribe(clientConnection, fields[0].toLatin1(), fields[1].toULongLong()))
+        {
+            qDebug() << tr("Dropping an IPC client subscribing without the event stream token");
+            clientConnection->abort();
+        }
         return;
     }
-    QString message;
-    in >> message;
+
+    if (!message.startsWith(BITCOIN_IPC_PREFIX, Qt::CaseInsensitive))
+        return;
 
     if (saveURIs)
         savedPaymentRequests.append(message);
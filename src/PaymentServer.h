@@ -28,11 +28,22 @@
 // and, if a server is running in another process,
 // sends them to the server.
 //
+// The same server streams wallet events to local
+// payment processors that subscribe to them, see
+// PaymentEventStream. It runs without a window as
+// well, for the headless wallet.
+//
+#include <QHash>
 #include <QObject>
 #include <QString>
 
-class QApplication;
+class QCoreApplication;
 class QLocalServer;
+class QLocalSocket;
+
+namespace WalletGui {
+class PaymentEventStream;
+}
 
 class PaymentServer : public QObject
 {
@@ -41,6 +52,12 @@ class PaymentServer : public QObject
 private:
     bool saveURIs;
     QLocalServer* uriServer;
+    WalletGui::PaymentEventStream* eventStream;
+    // Bytes of incomplete messages, by client
+    QHash<QLocalSocket*, QByteArray> ipcBuffers;
+
+    void readIPCMessages(QLocalSocket* clientConnection);
+    void handleIPCMessage(QLocalSocket* clientConnection, const QString& message);
 
 public:
     // Returns true if there were URIs on the command line
@@ -48,7 +65,7 @@ public:
     // process.
     static bool ipcSendCommandLine();
 
-    PaymentServer(QApplication* parent);
+    PaymentServer(QCoreApplication* parent);
 
     bool eventFilter(QObject *object, QEvent *event);
 
@@ -0,0 +1,317 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#include "Common/StringTools.h"
+#include "NodeAdapter.h"
+#include "PeerScoreStore.h"
+#include "Settings.h"
+
+Q_DECLARE_METATYPE(std::vector<CryptoNote::p2pConnection>)
+
+namespace WalletGui {
+
+namespace {
+
+const int SAMPLE_INTERVAL = 10000;
+const int SAMPLES_PER_SAVE = 30;
+const int MAX_STORED_PEERS = 256;
+const int STALE_PEER_DAYS = 30;
+const qint64 MIN_HEALTHY_CONNECTION_SECONDS = 30;
+const double MAX_SCORED_LIFETIME_SECONDS = 3600;
+const double EWMA_WEIGHT = 0.3;
+
+double ewma(double _current, double _sample) {
+  return _current <= 0 ? _sample : _current + EWMA_WEIGHT * (_sample - _current);
+}
+
+}
+
+class PeerSampler : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(PeerSampler)
+
+public:
+  PeerSampler(QObject* _parent = nullptr) : QObject(_parent) {
+  }
+
+  ~PeerSampler() {
+  }
+
+  Q_SLOT void sample() {
+    Q_EMIT sampledSignal(NodeAdapter::instance().getConnections(), NodeAdapter::instance().getLastLocalBlockHeight());
+  }
+
+  // Returns once the samples requested before it are taken
+  Q_SLOT void sync() {
+  }
+
+Q_SIGNALS:
+  void sampledSignal(const std::vector<CryptoNote::p2pConnection>& _connections, quint64 _localHeight);
+};
+
+PeerScoreStore& PeerScoreStore::instance() {
+  static PeerScoreStore inst;
+  return inst;
+}
+
+PeerScoreStore::PeerScoreStore() : QObject(), m_lastLocalHeight(0), m_samplesSinceSave(0), m_sampler(new PeerSampler), m_isSampling(false) {
+  qRegisterMetaType<std::vector<CryptoNote::p2pConnection>>();
+  m_sampleTimer.setInterval(SAMPLE_INTERVAL);
+  connect(&m_sampleTimer, &QTimer::timeout, this, &PeerScoreStore::sampleTimeout);
+  m_sampler->moveToThread(&m_samplerThread);
+  connect(this, &PeerScoreStore::sampleSignal, m_sampler, &PeerSampler::sample, Qt::QueuedConnection);
+  connect(m_sampler, &PeerSampler::sampledSignal, this, &PeerScoreStore::sampled, Qt::QueuedConnection);
+  connect(&m_samplerThread, &QThread::finished, m_sampler, &QObject::deleteLater);
+  m_samplerThread.start();
+}
+
+PeerScoreStore::~PeerScoreStore() {
+  m_samplerThread.quit();
+  m_samplerThread.wait();
+}
+
+QString PeerScoreStore::getFileName() const {
+  return Settings::instance().getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".peerscores");
+}
+
+void PeerScoreStore::load() {
+  m_scores.clear();
+  QFile scoresFile(getFileName());
+  if (!scoresFile.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  QJsonArray peers = QJsonDocument::fromJson(scoresFile.readAll()).array();
+  scoresFile.close();
+  for (const QJsonValue& value : peers) {
+    QJsonObject peerObject = value.toObject();
+    PeerScore peer;
+    peer.host = peerObject.value("host").toString();
+    peer.port = static_cast<quint16>(peerObject.value("port").toInt());
+    peer.successes = static_cast<quint32>(peerObject.value("successes").toDouble());
+    peer.failures = static_cast<quint32>(peerObject.value("failures").toDouble());
+    peer.lifetime = peerObject.value("lifetime").toDouble();
+    peer.throughput = peerObject.value("throughput").toDouble();
+    peer.lastSeen = QDateTime::fromTime_t(static_cast<uint>(peerObject.value("lastSeen").toDouble()), Qt::UTC);
+    if (peer.host.isEmpty() || peer.port == 0) {
+      continue;
+    }
+
+    m_scores.insert(QString("%1:%2").arg(peer.host).arg(peer.port), peer);
+  }
+}
+
+void PeerScoreStore::save() {
+  prune();
+  QJsonArray peers;
+  for (const PeerScore& peer : m_scores) {
+    QJsonObject peerObject;
+    peerObject.insert("host", peer.host);
+    peerObject.insert("port", peer.port);
+    peerObject.insert("successes", static_cast<double>(peer.successes));
+    peerObject.insert("failures", static_cast<double>(peer.failures));
+    peerObject.insert("lifetime", peer.lifetime);
+    peerObject.insert("throughput", peer.throughput);
+    peerObject.insert("lastSeen", static_cast<double>(peer.lastSeen.toTime_t()));
+    peers.append(peerObject);
+  }
+
+  QSaveFile scoresFile(getFileName());
+  if (scoresFile.open(QIODevice::WriteOnly)) {
+    scoresFile.write(QJsonDocument(peers).toJson(QJsonDocument::Compact));
+    scoresFile.commit();
+  }
+
+  m_samplesSinceSave = 0;
+}
+
+void PeerScoreStore::start() {
+  m_liveConnections.clear();
+  m_lastSample = QDateTime();
+  m_isSampling = false;
+  m_sampleTimer.start();
+}
+
+void PeerScoreStore::stop() {
+  if (!m_sampleTimer.isActive()) {
+    return;
+  }
+
+  m_sampleTimer.stop();
+  // The node is destroyed right after, a sample in flight must not use it any more. Its result is dropped.
+  QMetaObject::invokeMethod(m_sampler, "sync", Qt::BlockingQueuedConnection);
+  const QDateTime now = QDateTime::currentDateTimeUtc();
+  for (const LiveConnection& live : m_liveConnections) {
+    if (live.handshaked) {
+      connectionClosed(live, now);
+    }
+  }
+
+  m_liveConnections.clear();
+  save();
+}
+
+void PeerScoreStore::sampleTimeout() {
+  // A slow node doesn't pile up requests
+  if (m_isSampling) {
+    return;
+  }
+
+  m_isSampling = true;
+  Q_EMIT sampleSignal();
+}
+
+void PeerScoreStore::sampled(const std::vector<CryptoNote::p2pConnection>& _connections, quint64 _localHeight) {
+  m_isSampling = false;
+  if (!m_sampleTimer.isActive()) {
+    return;
+  }
+
+  sample(_connections, _localHeight);
+  if (++m_samplesSinceSave >= SAMPLES_PER_SAVE) {
+    save();
+  }
+}
+
+void PeerScoreStore::sample(const std::vector<CryptoNote::p2pConnection>& _connections, quint64 _localHeight) {
+  const QDateTime now = QDateTime::currentDateTimeUtc();
+  // Blocks added since the last sample are credited in equal shares to the peers we synced from
+  const qint64 elapsed = m_lastSample.isValid() ? m_lastSample.secsTo(now) : 0;
+  const quint64 receivedBlocks = elapsed > 0 && _localHeight > m_lastLocalHeight ? _localHeight - m_lastLocalHeight : 0;
+  const auto syncingPeers = std::count_if(_connections.begin(), _connections.end(), [](const CryptoNote::p2pConnection& _connection) {
+    return _connection.connection_state == CryptoNote::p2pConnection::state_synchronizing;
+  });
+
+  m_lastSample = now;
+  m_lastLocalHeight = _localHeight;
+
+  QSet<QString> seenConnections;
+  for (const CryptoNote::p2pConnection& connection : _connections) {
+    // Incoming peers connect from ephemeral ports we can't dial back
+    if (connection.is_incoming) {
+      continue;
+    }
+
+    const QString connectionId = QString::fromStdString(boost::lexical_cast<std::string>(connection.connection_id));
+    const QString host = QString::fromStdString(Common::ipAddressToString(connection.remote_ip));
+    const QString key = QString("%1:%2").arg(host).arg(connection.remote_port);
+    seenConnections.insert(connectionId);
+
+    if (!m_scores.contains(key)) {
+      m_scores.insert(key, PeerScore {host, static_cast<quint16>(connection.remote_port), 0, 0, 0, 0, now});
+    }
+
+    PeerScore& peer = m_scores[key];
+    peer.lastSeen = now;
+
+    if (!m_liveConnections.contains(connectionId)) {
+      const QDateTime started = QDateTime::fromTime_t(static_cast<uint>(connection.started), Qt::UTC);
+      m_liveConnections.insert(connectionId, LiveConnection {key, started.isValid() ? started : now, false});
+    }
+
+    LiveConnection& live = m_liveConnections[connectionId];
+    if (connection.connection_state == CryptoNote::p2pConnection::state_befor_handshake) {
+      continue;
+    }
+
+    if (!live.handshaked) {
+      live.handshaked = true;
+      ++peer.successes;
+    }
+
+    if (receivedBlocks > 0 && connection.connection_state == CryptoNote::p2pConnection::state_synchronizing) {
+      peer.throughput = ewma(peer.throughput, static_cast<double>(receivedBlocks) / syncingPeers / elapsed);
+    }
+  }
+
+  // Connections gone before the handshake or shortly after it count against the peer
+  for (auto it = m_liveConnections.begin(); it != m_liveConnections.end();) {
+    if (seenConnections.contains(it.key())) {
+      ++it;
+      continue;
+    }
+
+    if (!it->handshaked || it->started.secsTo(now) < MIN_HEALTHY_CONNECTION_SECONDS) {
+      auto peer = m_scores.find(it->key);
+      if (peer != m_scores.end()) {
+        ++peer->failures;
+      }
+    }
+
+    if (it->handshaked) {
+      connectionClosed(*it, now);
+    }
+
+    it = m_liveConnections.erase(it);
+  }
+}
+
+void PeerScoreStore::connectionClosed(const LiveConnection& _connection, const QDateTime& _now) {
+  auto peer = m_scores.find(_connection.key);
+  if (peer != m_scores.end()) {
+    peer->lifetime = ewma(peer->lifetime, static_cast<double>(std::max<qint64>(1, _connection.started.secsTo(_now))));
+  }
+}
+
+QStringList PeerScoreStore::getTopPeers(int _count) const {
+  QList<PeerScore> peers = m_scores.values();
+  peers.erase(std::remove_if(peers.begin(), peers.end(), [](const PeerScore& _peer) { return _peer.successes == 0; }), peers.end());
+  std::sort(peers.begin(), peers.end(), [](const PeerScore& _left, const PeerScore& _right) {
+    return score(_left) > score(_right);
+  });
+
+  QStringList result;
+  for (int i = 0; i < peers.size() && i < _count; ++i) {
+    result.append(QString("%1:%2").arg(peers[i].host).arg(peers[i].port));
+  }
+
+  return result;
+}
+
+double PeerScoreStore::score(const PeerScore& _peer) {
+  const double attempts = _peer.successes + _peer.failures;
+  const double reliability = attempts > 0 ? _peer.successes / attempts : 0;
+  return reliability * 10 + std::min(_peer.throughput, 100.0) / 10 + std::min(_peer.lifetime, MAX_SCORED_LIFETIME_SECONDS) / 1200;
+}
+
+void PeerScoreStore::prune() {
+  const QDateTime staleBefore = QDateTime::currentDateTimeUtc().addDays(-STALE_PEER_DAYS);
+  for (auto it = m_scores.begin(); it != m_scores.end();) {
+    if (it->lastSeen < staleBefore) {
+      it = m_scores.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  if (m_scores.size() <= MAX_STORED_PEERS) {
+    return;
+  }
+
+  QList<QString> keys = m_scores.keys();
+  std::sort(keys.begin(), keys.end(), [this](const QString& _left, const QString& _right) {
+    return score(m_scores[_left]) > score(m_scores[_right]);
+  });
+
+  for (int i = MAX_STORED_PEERS; i < keys.size(); ++i) {
+    m_scores.remove(keys[i]);
+  }
+}
+
+}
+
+#include "PeerScoreStore.moc"
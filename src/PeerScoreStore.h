@@ -0,0 +1,81 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QDateTime>
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+
+#include "CryptoNoteWrapper.h"
+
+namespace WalletGui {
+
+class PeerSampler;
+
+// Keeps quality scores of outgoing peers of the embedded node across restarts,
+// so the best of them can be dialed first on the next start. Connections are sampled
+// on a thread of their own, asking the node for them blocks until the node answers.
+class PeerScoreStore : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(PeerScoreStore)
+
+public:
+  static PeerScoreStore& instance();
+
+  void load();
+  void save();
+  void start();
+  void stop();
+
+  void sample(const std::vector<CryptoNote::p2pConnection>& _connections, quint64 _localHeight);
+  QStringList getTopPeers(int _count) const;
+
+private:
+  struct PeerScore {
+    QString host;
+    quint16 port;
+    quint32 successes;
+    quint32 failures;
+    // Seconds handshaked connections lasted
+    double lifetime;
+    // Blocks per second added to the local chain while syncing from the peer
+    double throughput;
+    QDateTime lastSeen;
+  };
+
+  struct LiveConnection {
+    QString key;
+    QDateTime started;
+    bool handshaked;
+  };
+
+  QHash<QString, PeerScore> m_scores;
+  QHash<QString, LiveConnection> m_liveConnections;
+  QDateTime m_lastSample;
+  quint64 m_lastLocalHeight;
+  QTimer m_sampleTimer;
+  int m_samplesSinceSave;
+  QThread m_samplerThread;
+  PeerSampler* m_sampler;
+  bool m_isSampling;
+
+  PeerScoreStore();
+  ~PeerScoreStore();
+
+  static double score(const PeerScore& _peer);
+  QString getFileName() const;
+  void prune();
+  void connectionClosed(const LiveConnection& _connection, const QDateTime& _now);
+  void sampleTimeout();
+  void sampled(const std::vector<CryptoNote::p2pConnection>& _connections, quint64 _localHeight);
+
+Q_SIGNALS:
+  void sampleSignal();
+};
+
+}
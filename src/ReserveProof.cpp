@@ -0,0 +1,481 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include <QIODevice>
+
+#include <Common/Base58.h>
+#include <Common/StringTools.h>
+#include <crypto/hash.h>
+
+#include "ParallelFor.h"
+#include "ReserveProof.h"
+
+namespace WalletGui {
+
+namespace {
+
+const char PROOF_HEADER[] = "ReserveProofV1";
+// Outputs per chunk, between two progress reports and cancel checks
+const size_t CHUNK_SIZE = 4096;
+// Below this count handing work to the pool costs more than the work itself
+const size_t MIN_OUTPUTS_PER_THREAD = 64;
+// Base58 encodes blocks of 8 bytes to 11 characters
+const size_t BASE58_BLOCK_SIZE = 8;
+const size_t BASE58_ENCODED_BLOCK_SIZE = 11;
+const size_t READ_BLOCKS = 4096;
+
+struct ProofEntry {
+  Crypto::Hash transactionHash;
+  uint64_t outputInTransaction;
+  Crypto::PublicKey sharedSecret;
+  Crypto::KeyImage keyImage;
+  Crypto::Signature sharedSecretSignature;
+  Crypto::Signature keyImageSignature;
+};
+
+size_t getThreads(size_t _threads) {
+  return _threads != 0 ? _threads : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+// Contiguous ranges over the global thread pool. _func must not throw.
+template <typename Func>
+void forEachOutput(size_t _threads, size_t _count, Func _func) {
+  parallelFor(std::min(_threads, std::max<size_t>(_count / MIN_OUTPUTS_PER_THREAD, 1)), _count, _func);
+}
+
+// The scalar 1, derivations from it only multiply the point by the cofactor
+Crypto::SecretKey getScalarOne() {
+  Crypto::SecretKey one;
+  std::memset(&one, 0, sizeof(one));
+  reinterpret_cast<uint8_t*>(&one)[0] = 1;
+  return one;
+}
+
+// Every output is signed as a ring of its own key
+bool makeSigningInput(const CryptoNote::AccountKeys& _keys, const CryptoNote::TransactionOutputInformation& _output,
+  RingSigningInput& _input) {
+  Crypto::KeyDerivation derivation;
+  if (!Crypto::generate_key_derivation(_output.transactionPublicKey, _keys.viewSecretKey, derivation)) {
+    return false;
+  }
+
+  _input.ring.assign(1, _output.outputKey);
+  _input.realIndex = 0;
+  Crypto::derive_secret_key(derivation, _output.outputInTransaction, _keys.spendSecretKey, _input.ephemeralSecretKey);
+  return true;
+}
+
+// Writes the binary proof as hex in Base58, whole blocks as soon as they are complete
+class ProofWriter {
+public:
+  explicit ProofWriter(QIODevice& _device) : m_device(_device), m_isValid(true) {
+    m_isValid = m_device.write(PROOF_HEADER, sizeof(PROOF_HEADER) - 1) == sizeof(PROOF_HEADER) - 1;
+  }
+
+  template <typename T>
+  void writePod(const T& _value) {
+    write(&_value, sizeof(_value));
+  }
+
+  void writeVarint(uint64_t _value) {
+    uint8_t buffer[10];
+    size_t size = 0;
+    for (; _value >= 0x80; _value >>= 7) {
+      buffer[size++] = static_cast<uint8_t>(_value & 0x7f) | 0x80;
+    }
+
+    buffer[size++] = static_cast<uint8_t>(_value);
+    write(buffer, size);
+  }
+
+  void writeEntry(const ProofEntry& _entry) {
+    writePod(_entry.transactionHash);
+    writeVarint(_entry.outputInTransaction);
+    writePod(_entry.sharedSecret);
+    writePod(_entry.keyImage);
+    writePod(_entry.sharedSecretSignature);
+    writePod(_entry.keyImageSignature);
+  }
+
+  bool finish() {
+    flush(m_hex.size());
+    return m_isValid;
+  }
+
+private:
+  QIODevice& m_device;
+  std::string m_hex;
+  bool m_isValid;
+
+  void write(const void* _data, size_t _size) {
+    m_hex += Common::toHex(_data, _size);
+    if (m_hex.size() >= READ_BLOCKS * BASE58_BLOCK_SIZE) {
+      flush(m_hex.size() - m_hex.size() % BASE58_BLOCK_SIZE);
+    }
+  }
+
+  void flush(size_t _size) {
+    if (_size == 0 || !m_isValid) {
+      return;
+    }
+
+    const std::string text = Tools::Base58::encode(m_hex.substr(0, _size));
+    m_isValid = m_device.write(text.data(), text.size()) == static_cast<qint64>(text.size());
+    m_hex.erase(0, _size);
+  }
+};
+
+// Reads the binary proof back from its text, one piece of the device at a time
+class ProofReader {
+public:
+  explicit ProofReader(QIODevice& _device) : m_device(_device), m_position(0), m_isValid(true) {
+    char header[sizeof(PROOF_HEADER) - 1];
+    m_isValid = m_device.read(header, sizeof(header)) == sizeof(header) && std::memcmp(header, PROOF_HEADER, sizeof(header)) == 0;
+  }
+
+  bool isValid() const {
+    return m_isValid;
+  }
+
+  template <typename T>
+  bool readPod(T& _value) {
+    return read(&_value, sizeof(_value));
+  }
+
+  bool readVarint(uint64_t& _value) {
+    _value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t byte;
+      if (!read(&byte, 1)) {
+        return false;
+      }
+
+      _value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        return true;
+      }
+    }
+
+    return m_isValid = false;
+  }
+
+  bool readEntry(ProofEntry& _entry) {
+    return readPod(_entry.transactionHash) && readVarint(_entry.outputInTransaction) && readPod(_entry.sharedSecret) &&
+      readPod(_entry.keyImage) && readPod(_entry.sharedSecretSignature) && readPod(_entry.keyImageSignature);
+  }
+
+  bool atEnd() {
+    return m_position == m_data.size() && !refill();
+  }
+
+private:
+  QIODevice& m_device;
+  std::string m_text;
+  std::vector<uint8_t> m_data;
+  size_t m_position;
+  bool m_isValid;
+
+  bool read(void* _data, size_t _size) {
+    uint8_t* data = static_cast<uint8_t*>(_data);
+    while (_size > 0) {
+      if (m_position == m_data.size() && !refill()) {
+        return m_isValid = false;
+      }
+
+      const size_t size = std::min(_size, m_data.size() - m_position);
+      std::memcpy(data, m_data.data() + m_position, size);
+      m_position += size;
+      data += size;
+      _size -= size;
+    }
+
+    return true;
+  }
+
+  bool refill() {
+    m_data.clear();
+    m_position = 0;
+    while (m_isValid && m_data.empty()) {
+      const QByteArray piece = m_device.read(READ_BLOCKS * BASE58_ENCODED_BLOCK_SIZE);
+      if (piece.isEmpty() && !m_device.atEnd()) {
+        return m_isValid = false;
+      }
+
+      for (char c : piece) {
+        if (c != '\r' && c != '\n' && c != ' ' && c != '\t') {
+          m_text += c;
+        }
+      }
+
+      // Only the last block of the text may be short
+      const bool isLast = m_device.atEnd();
+      const size_t size = isLast ? m_text.size() : m_text.size() - m_text.size() % BASE58_ENCODED_BLOCK_SIZE;
+      if (size == 0) {
+        if (isLast) {
+          return false;
+        }
+
+        continue;
+      }
+
+      std::string hex;
+      size_t dataSize = 0;
+      if (!Tools::Base58::decode(m_text.substr(0, size), hex) || hex.size() % 2 != 0) {
+        return m_isValid = false;
+      }
+
+      m_data.resize(hex.size() / 2);
+      if (!Common::fromHex(hex, m_data.data(), m_data.size(), dataSize) || dataSize != m_data.size()) {
+        return m_isValid = false;
+      }
+
+      m_text.erase(0, size);
+    }
+
+    return m_isValid;
+  }
+};
+
+}
+
+ReserveProofGenerator::ReserveProofGenerator(const CryptoNote::AccountKeys& _keys, size_t _threads) : m_keys(_keys),
+  m_threads(getThreads(_threads)), m_signer(m_threads) {
+}
+
+std::vector<CryptoNote::TransactionOutputInformation> ReserveProofGenerator::selectOutputs(
+  std::vector<CryptoNote::TransactionOutputInformation> _outputs, uint64_t _reserve) {
+  std::sort(_outputs.begin(), _outputs.end(), [](const CryptoNote::TransactionOutputInformation& _left,
+    const CryptoNote::TransactionOutputInformation& _right) {
+    return _left.amount > _right.amount;
+  });
+
+  uint64_t total = 0;
+  size_t count = 0;
+  while (count < _outputs.size() && total < _reserve) {
+    total += _outputs[count].amount;
+    ++count;
+  }
+
+  _outputs.resize(total >= _reserve ? count : 0);
+  return _outputs;
+}
+
+bool ReserveProofGenerator::generate(const std::vector<CryptoNote::TransactionOutputInformation>& _outputs, const std::string& _message,
+  QIODevice& _device, const ProgressCallback& _progress, const std::atomic<bool>& _cancel) const {
+  const uint64_t total = _outputs.size() * 2;
+  std::vector<Crypto::KeyImage> keyImages(_outputs.size());
+  std::vector<RingSigningInput> inputs;
+  std::atomic<bool> isFailed(false);
+  for (size_t begin = 0; begin < _outputs.size(); begin += CHUNK_SIZE) {
+    if (_cancel) {
+      return false;
+    }
+
+    const size_t end = std::min(begin + CHUNK_SIZE, _outputs.size());
+    inputs.resize(end - begin);
+    forEachOutput(m_threads, end - begin, [&](size_t _index) {
+      if (!makeSigningInput(m_keys, _outputs[begin + _index], inputs[_index])) {
+        isFailed = true;
+      }
+    });
+
+    if (isFailed) {
+      return false;
+    }
+
+    const std::vector<Crypto::KeyImage> chunkKeyImages = m_signer.generateKeyImages(inputs);
+    std::copy(chunkKeyImages.begin(), chunkKeyImages.end(), keyImages.begin() + begin);
+    _progress(end, total);
+  }
+
+  std::string prefixData = _message;
+  prefixData.append(reinterpret_cast<const char*>(&m_keys.address), sizeof(m_keys.address));
+  prefixData.append(reinterpret_cast<const char*>(keyImages.data()), keyImages.size() * sizeof(Crypto::KeyImage));
+  Crypto::Hash prefixHash;
+  Crypto::cn_fast_hash(prefixData.data(), prefixData.size(), prefixHash);
+  std::string().swap(prefixData);
+
+  ProofWriter writer(_device);
+  writer.writeVarint(_outputs.size());
+  std::vector<ProofEntry> entries(std::min(CHUNK_SIZE, _outputs.size()));
+  for (size_t begin = 0; begin < _outputs.size(); begin += CHUNK_SIZE) {
+    if (_cancel) {
+      return false;
+    }
+
+    const size_t end = std::min(begin + CHUNK_SIZE, _outputs.size());
+    inputs.resize(end - begin);
+    forEachOutput(m_threads, end - begin, [&](size_t _index) {
+      const CryptoNote::TransactionOutputInformation& output = _outputs[begin + _index];
+      ProofEntry& entry = entries[_index];
+      entry.transactionHash = output.transactionHash;
+      entry.outputInTransaction = output.outputInTransaction;
+      entry.keyImage = keyImages[begin + _index];
+
+      Crypto::KeyImage sharedSecret = Crypto::scalarmultKey(reinterpret_cast<const Crypto::KeyImage&>(output.transactionPublicKey),
+        reinterpret_cast<const Crypto::KeyImage&>(m_keys.viewSecretKey));
+      entry.sharedSecret = reinterpret_cast<const Crypto::PublicKey&>(sharedSecret);
+      Crypto::generate_tx_proof(prefixHash, m_keys.address.viewPublicKey, output.transactionPublicKey, entry.sharedSecret,
+        m_keys.viewSecretKey, entry.sharedSecretSignature);
+      makeSigningInput(m_keys, output, inputs[_index]);
+    });
+
+    const std::vector<Crypto::KeyImage> chunkKeyImages(keyImages.begin() + begin, keyImages.begin() + end);
+    const std::vector<std::vector<Crypto::Signature>> signatures = m_signer.sign(prefixHash, inputs, chunkKeyImages);
+    for (size_t i = 0; i < end - begin; ++i) {
+      entries[i].keyImageSignature = signatures[i].front();
+      writer.writeEntry(entries[i]);
+    }
+
+    _progress(_outputs.size() + end, total);
+  }
+
+  // The spend key that received the outputs
+  Crypto::Signature signature;
+  Crypto::generate_signature(prefixHash, m_keys.address.spendPublicKey, m_keys.spendSecretKey, signature);
+  writer.writePod(signature);
+  return writer.finish();
+}
+
+ReserveProofVerifier::ReserveProofVerifier(size_t _threads) : m_threads(getThreads(_threads)) {
+}
+
+ReserveProofVerifier::Result ReserveProofVerifier::verify(QIODevice& _device, const CryptoNote::AccountPublicAddress& _address,
+  const std::string& _message, const OutputLookup& _lookup, const SpentCheck& _isSpent,
+  const ReserveProofGenerator::ProgressCallback& _progress, const std::atomic<bool>& _cancel) const {
+  Result result {Status::INVALID, 0, 0, 0, std::string()};
+  const qint64 start = _device.pos();
+
+  // First pass: the key images for the prefix hash
+  ProofReader keyImageReader(_device);
+  uint64_t count = 0;
+  if (!keyImageReader.isValid() || !keyImageReader.readVarint(count)) {
+    result.error = "Not a reserve proof";
+    return result;
+  }
+
+  std::string prefixData = _message;
+  prefixData.append(reinterpret_cast<const char*>(&_address), sizeof(_address));
+  std::vector<Crypto::KeyImage> keyImages;
+  ProofEntry entry;
+  for (uint64_t i = 0; i < count; ++i) {
+    if (i % CHUNK_SIZE == 0) {
+      if (_cancel) {
+        result.status = Status::CANCELLED;
+        return result;
+      }
+
+      _progress(i, count * 2);
+    }
+
+    if (!keyImageReader.readEntry(entry)) {
+      result.error = "The proof is truncated";
+      return result;
+    }
+
+    keyImages.push_back(entry.keyImage);
+  }
+
+  Crypto::Signature signature;
+  if (!keyImageReader.readPod(signature) || !keyImageReader.atEnd()) {
+    result.error = "The proof is malformed";
+    return result;
+  }
+
+  prefixData.append(reinterpret_cast<const char*>(keyImages.data()), keyImages.size() * sizeof(Crypto::KeyImage));
+  Crypto::Hash prefixHash;
+  Crypto::cn_fast_hash(prefixData.data(), prefixData.size(), prefixHash);
+  std::string().swap(prefixData);
+  if (!Crypto::check_signature(prefixHash, _address.spendPublicKey, signature)) {
+    result.error = "The proof is not signed by the address";
+    return result;
+  }
+
+  // An output proven twice would count twice
+  std::sort(keyImages.begin(), keyImages.end(), [](const Crypto::KeyImage& _left, const Crypto::KeyImage& _right) {
+    return std::memcmp(&_left, &_right, sizeof(Crypto::KeyImage)) < 0;
+  });
+
+  if (std::adjacent_find(keyImages.begin(), keyImages.end(), [](const Crypto::KeyImage& _left, const Crypto::KeyImage& _right) {
+        return std::memcmp(&_left, &_right, sizeof(Crypto::KeyImage)) == 0;
+      }) != keyImages.end()) {
+    result.error = "The proof contains an output twice";
+    return result;
+  }
+
+  std::vector<Crypto::KeyImage>().swap(keyImages);
+
+  // Second pass: the signatures, against the outputs as the chain has them
+  if (!_device.seek(start)) {
+    result.error = "The proof cannot be read again";
+    return result;
+  }
+
+  ProofReader reader(_device);
+  reader.readVarint(count);
+  const Crypto::SecretKey one = getScalarOne();
+  std::vector<ProofEntry> entries(std::min<uint64_t>(CHUNK_SIZE, count));
+  std::vector<ReserveProofOutput> outputs(entries.size());
+  std::vector<char> isValid(entries.size());
+  for (uint64_t begin = 0; begin < count; begin += CHUNK_SIZE) {
+    if (_cancel) {
+      result.status = Status::CANCELLED;
+      return result;
+    }
+
+    const size_t size = static_cast<size_t>(std::min<uint64_t>(CHUNK_SIZE, count - begin));
+    for (size_t i = 0; i < size; ++i) {
+      if (!reader.readEntry(entries[i])) {
+        result.error = "The proof changed while it was read";
+        return result;
+      }
+
+      if (!_lookup(entries[i].transactionHash, entries[i].outputInTransaction, outputs[i])) {
+        result.error = "Output " + std::to_string(entries[i].outputInTransaction) + " of transaction " +
+          Common::podToHex(entries[i].transactionHash) + " is unknown";
+        return result;
+      }
+    }
+
+    forEachOutput(m_threads, size, [&](size_t _index) {
+      const ProofEntry& proof = entries[_index];
+      const ReserveProofOutput& output = outputs[_index];
+      const Crypto::PublicKey* keys[] = {&output.outputKey};
+      Crypto::KeyDerivation derivation;
+      Crypto::PublicKey outputKey;
+      isValid[_index] = Crypto::check_tx_proof(prefixHash, _address.viewPublicKey, output.transactionPublicKey, proof.sharedSecret,
+          proof.sharedSecretSignature) &&
+        Crypto::check_ring_signature(prefixHash, proof.keyImage, keys, 1, &proof.keyImageSignature) &&
+        // The output belongs to the address
+        Crypto::generate_key_derivation(proof.sharedSecret, one, derivation) &&
+        Crypto::derive_public_key(derivation, proof.outputInTransaction, _address.spendPublicKey, outputKey) &&
+        outputKey == output.outputKey;
+    });
+
+    for (size_t i = 0; i < size; ++i) {
+      if (!isValid[i]) {
+        result.error = "The proof of output " + std::to_string(entries[i].outputInTransaction) + " of transaction " +
+          Common::podToHex(entries[i].transactionHash) + " is invalid";
+        return result;
+      }
+
+      result.total += outputs[i].amount;
+      if (_isSpent && _isSpent(entries[i].keyImage)) {
+        result.spent += outputs[i].amount;
+      }
+    }
+
+    _progress(count + begin + size, count * 2);
+  }
+
+  result.status = Status::VALID;
+  result.outputCount = count;
+  return result;
+}
+
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <IWalletLegacy.h>
+#include <crypto/crypto.h>
+
+#include "RingSigner.h"
+
+class QIODevice;
+
+namespace WalletGui {
+
+// What the blockchain says about an output a proof refers to
+struct ReserveProofOutput {
+  Crypto::PublicKey transactionPublicKey;
+  Crypto::PublicKey outputKey;
+  uint64_t amount;
+};
+
+// Proofs of reserve in the "ReserveProofV1" format of the wallet core: the header followed by the
+// Base58 of the hex of the binary proof. Base58 encodes blocks of 8 characters independently, so
+// the text is written and read in pieces and a proof over hundreds of thousands of outputs never
+// exists as one string.
+//
+// Every output is proven by a key image signature and a signature of the shared secret, all signed
+// over one prefix hash of the message, the address and all key images. So both sides run in two
+// passes, key images first, and every pass works through chunks of outputs spread over threads.
+// Progress is reported per chunk in units of outputs, two per output, and a set cancel flag stops
+// the work at the next chunk.
+class ReserveProofGenerator {
+public:
+  using ProgressCallback = std::function<void(uint64_t _done, uint64_t _total)>;
+
+  // 0 threads means one per hardware thread
+  explicit ReserveProofGenerator(const CryptoNote::AccountKeys& _keys, size_t _threads = 0);
+
+  // The largest outputs down to the ones needed for the amount, as the wallet core picks them
+  static std::vector<CryptoNote::TransactionOutputInformation> selectOutputs(std::vector<CryptoNote::TransactionOutputInformation> _outputs,
+    uint64_t _reserve);
+
+  // False when cancelled or when the device fails, the device then holds a partial proof
+  bool generate(const std::vector<CryptoNote::TransactionOutputInformation>& _outputs, const std::string& _message, QIODevice& _device,
+    const ProgressCallback& _progress, const std::atomic<bool>& _cancel) const;
+
+private:
+  CryptoNote::AccountKeys m_keys;
+  size_t m_threads;
+  RingSigner m_signer;
+};
+
+class ReserveProofVerifier {
+public:
+  enum class Status { VALID, INVALID, CANCELLED };
+
+  struct Result {
+    Status status;
+    uint64_t outputCount;
+    uint64_t total;
+    // Outputs whose key images the chain already knows
+    uint64_t spent;
+    std::string error;
+  };
+
+  // Called on the verifying thread, never concurrently
+  using OutputLookup = std::function<bool(const Crypto::Hash& _transactionHash, uint64_t _outputInTransaction, ReserveProofOutput& _output)>;
+  using SpentCheck = std::function<bool(const Crypto::KeyImage& _keyImage)>;
+
+  explicit ReserveProofVerifier(size_t _threads = 0);
+
+  // Reads the proof twice, the device has to be seekable. A null spent check counts nothing as spent.
+  Result verify(QIODevice& _device, const CryptoNote::AccountPublicAddress& _address, const std::string& _message,
+    const OutputLookup& _lookup, const SpentCheck& _isSpent, const ReserveProofGenerator::ProgressCallback& _progress,
+    const std::atomic<bool>& _cancel) const;
+
+private:
+  size_t m_threads;
+};
+
+}
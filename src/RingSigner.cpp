@@ -0,0 +1,104 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+#include "ParallelFor.h"
+#include "RingSigner.h"
+
+namespace WalletGui {
+
+namespace {
+
+// Below these counts handing work to the pool costs more than the work itself
+const size_t MIN_KEY_IMAGES_PER_THREAD = 64;
+const size_t MIN_RING_MEMBERS_PER_THREAD = 16;
+
+}
+
+RingSigner::RingSigner(size_t _threads) : m_threads(_threads) {
+  if (m_threads == 0) {
+    m_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+}
+
+size_t RingSigner::getThreadCount() const {
+  return m_threads;
+}
+
+template <typename Func>
+void RingSigner::forEachInput(size_t _count, size_t _minPerThread, Func _func) const {
+  parallelFor(std::min(m_threads, std::max<size_t>(_count / std::max<size_t>(_minPerThread, 1), 1)), _count, _func);
+}
+
+Crypto::KeyImage RingSigner::generateKeyImage(const RingSigningInput& _input) {
+  if (_input.realIndex >= _input.ring.size()) {
+    throw std::invalid_argument("Real output index is out of the ring");
+  }
+
+  Crypto::KeyImage keyImage;
+  Crypto::generate_key_image(_input.ring[_input.realIndex], _input.ephemeralSecretKey, keyImage);
+  return keyImage;
+}
+
+std::vector<Crypto::Signature> RingSigner::signInput(const Crypto::Hash& _prefixHash, const RingSigningInput& _input, const Crypto::KeyImage& _keyImage) {
+  if (_input.realIndex >= _input.ring.size()) {
+    throw std::invalid_argument("Real output index is out of the ring");
+  }
+
+  std::vector<const Crypto::PublicKey*> keys;
+  keys.reserve(_input.ring.size());
+  for (const Crypto::PublicKey& key : _input.ring) {
+    keys.push_back(&key);
+  }
+
+  std::vector<Crypto::Signature> signatures(_input.ring.size());
+  Crypto::generate_ring_signature(_prefixHash, _keyImage, keys.data(), keys.size(), _input.ephemeralSecretKey, _input.realIndex, signatures.data());
+  return signatures;
+}
+
+std::vector<Crypto::KeyImage> RingSigner::generateKeyImages(const std::vector<RingSigningInput>& _inputs) const {
+  for (const RingSigningInput& input : _inputs) {
+    if (input.realIndex >= input.ring.size()) {
+      throw std::invalid_argument("Real output index is out of the ring");
+    }
+  }
+
+  std::vector<Crypto::KeyImage> keyImages(_inputs.size());
+  forEachInput(_inputs.size(), MIN_KEY_IMAGES_PER_THREAD, [&](size_t _index) {
+    keyImages[_index] = generateKeyImage(_inputs[_index]);
+  });
+
+  return keyImages;
+}
+
+std::vector<std::vector<Crypto::Signature>> RingSigner::sign(const Crypto::Hash& _prefixHash, const std::vector<RingSigningInput>& _inputs,
+  const std::vector<Crypto::KeyImage>& _keyImages) const {
+  if (_keyImages.size() != _inputs.size()) {
+    throw std::invalid_argument("Key image count doesn't match input count");
+  }
+
+  // Validate up front, an exception must not escape a worker thread
+  size_t ringMembers = 0;
+  for (const RingSigningInput& input : _inputs) {
+    if (input.realIndex >= input.ring.size()) {
+      throw std::invalid_argument("Real output index is out of the ring");
+    }
+
+    ringMembers += input.ring.size();
+  }
+
+  // Work grows with the ring size, so the thread count is chosen by ring members per input
+  const size_t averageRing = _inputs.empty() ? 1 : std::max<size_t>(ringMembers / _inputs.size(), 1);
+  std::vector<std::vector<Crypto::Signature>> signatures(_inputs.size());
+  forEachInput(_inputs.size(), std::max<size_t>(MIN_RING_MEMBERS_PER_THREAD / averageRing, 1), [&](size_t _index) {
+    signatures[_index] = signInput(_prefixHash, _inputs[_index], _keyImages[_index]);
+  });
+
+  return signatures;
+}
+
+}
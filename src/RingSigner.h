@@ -0,0 +1,45 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <crypto/crypto.h>
+
+namespace WalletGui {
+
+struct RingSigningInput {
+  // Output keys of the ring in the order the input references them
+  std::vector<Crypto::PublicKey> ring;
+  size_t realIndex;
+  Crypto::SecretKey ephemeralSecretKey;
+};
+
+// Key images and ring signatures of all inputs of a transaction, or of all outputs of a reserve
+// proof as rings of one. Inputs are independent, so they are spread over the global thread pool; every
+// input writes only its own slot, which keeps the result in input order whatever the thread count.
+class RingSigner {
+public:
+  // Upper bound of pool threads working on one call, 0 means one per hardware thread
+  explicit RingSigner(size_t _threads = 0);
+
+  size_t getThreadCount() const;
+
+  std::vector<Crypto::KeyImage> generateKeyImages(const std::vector<RingSigningInput>& _inputs) const;
+  std::vector<std::vector<Crypto::Signature>> sign(const Crypto::Hash& _prefixHash, const std::vector<RingSigningInput>& _inputs,
+    const std::vector<Crypto::KeyImage>& _keyImages) const;
+
+  static Crypto::KeyImage generateKeyImage(const RingSigningInput& _input);
+  static std::vector<Crypto::Signature> signInput(const Crypto::Hash& _prefixHash, const RingSigningInput& _input, const Crypto::KeyImage& _keyImage);
+
+private:
+  size_t m_threads;
+
+  template <typename Func>
+  void forEachInput(size_t _count, size_t _minPerThread, Func _func) const;
+};
+
+}
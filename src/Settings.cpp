@@ -9,6 +9,7 @@
 #include <QTime>
 #include <QJsonArray>
 #include <QJsonDocument>
+#include <QSaveFile>
 #include <QSettings>
 #include <QStandardPaths>
 #include <QTextCodec>
@@ -29,6 +30,11 @@ Q_DECL_CONSTEXPR char OPTION_RPCNODES[] = "remoteNodes";
 Q_DECL_CONSTEXPR char OPTION_DAEMON_PORT[] = "daemonPort";
 Q_DECL_CONSTEXPR char OPTION_REMOTE_NODE[] = "remoteNode";
 const char OPTION_WALLET_THEME[] = "theme";
+const char OPTION_RECENT_WALLETS[] = "recentWallets";
+const char OPTION_TRACKING[] = "tracking";
+const char OPTION_MINIMIZE_TO_TRAY[] = "minimizeToTray";
+const char OPTION_CLOSE_TO_TRAY[] = "closeToTray";
+const char OPTION_HIDE_EVERYTHING_ON_LOCKED[] = "hideEverythingOnLocked";
 
 const char OPTION_WALLET_OPTIMIZATION[] = "optimization";
 const char OPTION_WALLET_OPTIMIZATION_ENABLED[] = "enabled";
@@ -38,11 +44,16 @@ const char OPTION_WALLET_OPTIMIZATION_STOP_TIME[] = "stopTime";
 const char OPTION_WALLET_OPTIMIZATION_INTERVAL[] = "interval";
 const char OPTION_WALLET_OPTIMIZATION_THRESHOLD[] = "target";
 const char OPTION_WALLET_OPTIMIZATION_MIXIN[] = "mixin";
+const char OPTION_WALLET_OPTIMIZATION_TARGET_OUTPUT_COUNT[] = "targetOutputCount";
 const quint64 DEFAULT_OPTIMIZATION_PERIOD = 1000 * 60 * 30; // 30 minutes
 const quint64 DEFAULT_OPTIMIZATION_THRESHOLD = 10000000000000;
 const quint64 DEFAULT_OPTIMIZATION_MIXIN = 3;
 const char OPTION_SKIP_WALLET_OPTIMIZATION_TRANSACTIONS[] = "skipFusionTransactions";
 
+// Setters called in a row, as the settings dialogs do, end up in a single write
+const int SAVE_DELAY = 500;
+const int MAX_RECENT_WALLETS = 10;
+
 const QVector<NodeSetting> DEFAULT_NODES_LIST = {
   {"node.karbo.io", 32348, "/", false},
   {"node.karbo.org", 32348, "/", false},
@@ -51,15 +62,99 @@ const QVector<NodeSetting> DEFAULT_NODES_LIST = {
   {"node.krb.mypool.online", 32348, "/", false}
 };
 
+namespace {
+
+QJsonObject nodeSettingToJson(const NodeSetting& _node) {
+  QJsonObject nodeSettingObj;
+  nodeSettingObj.insert("host", QJsonValue(_node.host));
+  nodeSettingObj.insert("port", QJsonValue(_node.port));
+  nodeSettingObj.insert("path", QJsonValue(_node.path));
+  nodeSettingObj.insert("ssl", QJsonValue(_node.ssl));
+  return nodeSettingObj;
+}
+
+QVector<NodeSetting> parseNodesList(const QJsonArray& _nodesList) {
+  QVector<NodeSetting> res;
+  for (const QJsonValue nodeSettingValue : _nodesList) {
+    const QJsonObject nodeSettingObj = nodeSettingValue.toObject();
+    NodeSetting nodeSetting;
+    if (nodeSettingObj.contains("host") &&
+        nodeSettingObj.contains("port") &&
+        nodeSettingObj.contains("path") &&
+        nodeSettingObj.contains("ssl")) {
+        nodeSetting.host = nodeSettingObj.value("host").toString();
+        nodeSetting.port = nodeSettingObj.value("port").toInt();
+        nodeSetting.path = nodeSettingObj.value("path").toString();
+        nodeSetting.ssl  = nodeSettingObj.value("ssl").toBool();
+    } else {
+       // convert old format
+       QUrl remoteNodeUrl = QUrl::fromUserInput(nodeSettingValue.toString());
+       nodeSetting.host = remoteNodeUrl.host();
+       nodeSetting.port = remoteNodeUrl.port();
+       nodeSetting.path = "/";
+       nodeSetting.ssl  = false;
+    }
+    res.append(nodeSetting);
+  }
+
+  return res;
+}
+
+QString addressBookFileFor(const QString& _walletFile) {
+  QString addressBookFile = _walletFile;
+  addressBookFile.replace(addressBookFile.lastIndexOf(".wallet"), 7, ".addressbook");
+  return addressBookFile;
+}
+
+}
+
+// Writes the configuration off the GUI thread. QSaveFile replaces the file only once the new
+// contents are completely written, so a crash in between leaves the previous configuration intact.
+class SettingsWriter : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(SettingsWriter)
+
+public:
+  SettingsWriter(QObject* _parent = nullptr) : QObject(_parent) {
+  }
+
+  ~SettingsWriter() {
+  }
+
+  static void writeFile(const QString& _fileName, const QByteArray& _data) {
+    QSaveFile cfgFile(_fileName);
+    if (cfgFile.open(QIODevice::WriteOnly)) {
+      cfgFile.write(_data);
+      cfgFile.commit();
+    }
+  }
+
+  Q_SLOT void write(const QString& _fileName, const QByteArray& _data) {
+    writeFile(_fileName, _data);
+  }
+};
+
 Settings& Settings::instance() {
   static Settings inst;
   return inst;
 }
 
-Settings::Settings() : QObject(), m_cmdLineParser(nullptr) {
+Settings::Settings() : QObject(), m_writer(nullptr), m_isModified(false), m_cmdLineParser(nullptr) {
+  m_saveTimer.setSingleShot(true);
+  m_saveTimer.setInterval(SAVE_DELAY);
+  connect(&m_saveTimer, &QTimer::timeout, this, &Settings::saveTimeout);
+
+  m_writer = new SettingsWriter;
+  m_writer->moveToThread(&m_writerThread);
+  connect(this, &Settings::writeSettingsSignal, m_writer, &SettingsWriter::write, Qt::QueuedConnection);
+  connect(&m_writerThread, &QThread::finished, m_writer, &QObject::deleteLater);
+  m_writerThread.start();
 }
 
 Settings::~Settings() {
+  m_writerThread.quit();
+  m_writerThread.wait();
+  flush();
 }
 
 void Settings::setCommandLineParser(CommandLineParser* _cmdLineParser) {
@@ -68,66 +163,83 @@ void Settings::setCommandLineParser(CommandLineParser* _cmdLineParser) {
 }
 
 void Settings::load() {
-  QFile cfgFile(getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".cfg"));
+  m_fileName = getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".cfg");
+  QFile cfgFile(m_fileName);
   if (cfgFile.open(QIODevice::ReadOnly)) {
     m_settings = QJsonDocument::fromJson(cfgFile.readAll()).object();
     cfgFile.close();
-    if (!m_settings.contains("walletFile")) {
-      m_addressBookFile = getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".addressbook");
-    } else {
-      m_addressBookFile = m_settings.value("walletFile").toString();
-      m_addressBookFile.replace(m_addressBookFile.lastIndexOf(".wallet"), 7, ".addressbook");
-    }
-
-    if (!m_settings.contains(OPTION_LANGUAGE)) {
-         m_currentLang = "uk";
-    }
-
-    if (!m_settings.contains(OPTION_CONNECTION)) {
-         m_connectionMode = "auto";
-    }
-
-    if (!m_settings.contains(OPTION_DAEMON_PORT)) {
-         m_daemonPort = CryptoNote::RPC_DEFAULT_PORT;
-    }
-
-  } else {
-    m_addressBookFile = getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".addressbook");
-  }
-
-  if (m_settings.contains(OPTION_LANGUAGE)) {
-        m_currentLang = m_settings.value(OPTION_LANGUAGE).toString();
-  }
-
-  if (m_settings.contains(OPTION_CONNECTION)) {
-        m_connectionMode = m_settings.value(OPTION_CONNECTION).toString();
   }
 
   if (!m_settings.contains(OPTION_DAEMON_PORT)) {
         m_settings.insert(OPTION_DAEMON_PORT, CryptoNote::RPC_DEFAULT_PORT); // default daemon port
   }
 
-  if (!m_settings.contains("tracking")) {
-       m_settings.insert("tracking", false);
+  if (!m_settings.contains(OPTION_TRACKING)) {
+       m_settings.insert(OPTION_TRACKING, false);
   }
 
-  QVector<NodeSetting> nodesList = getRpcNodesList();
-
-  if (!m_settings.contains(OPTION_RPCNODES) || nodesList.isEmpty()) {
-    setRpcNodesList(DEFAULT_NODES_LIST);
-  } else {
-    setRpcNodesList(nodesList);
+  QVector<NodeSetting> nodesList = parseNodesList(m_settings.value(OPTION_RPCNODES).toArray());
+  QJsonArray nodesArray;
+  for (const NodeSetting& nodeSetting : (nodesList.isEmpty() ? DEFAULT_NODES_LIST : nodesList)) {
+    nodesArray.append(nodeSettingToJson(nodeSetting));
   }
 
-  if (!m_settings.contains("recentWallets")) {
+  m_settings.insert(OPTION_RPCNODES, nodesArray);
+
+  if (!m_settings.contains(OPTION_RECENT_WALLETS)) {
      QStringList recentWallets;
-     if (m_settings.contains("walletFile")) {
-        recentWallets.prepend(m_settings.value("walletFile").toString());
+     if (m_settings.contains(OPTION_WALLET_FILE)) {
+        recentWallets.prepend(m_settings.value(OPTION_WALLET_FILE).toString());
      } else {
         recentWallets.prepend(getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".wallet"));
      }
-     m_settings.insert("recentWallets", QJsonArray::fromStringList(recentWallets));
+     m_settings.insert(OPTION_RECENT_WALLETS, QJsonArray::fromStringList(recentWallets));
   }
+
+  parseSettings();
+}
+
+void Settings::parseSettings() {
+  m_values = Values();
+  m_values.walletFile = m_settings.contains(OPTION_WALLET_FILE) ? m_settings.value(OPTION_WALLET_FILE).toString() :
+    getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".wallet");
+  m_values.addressBookFile = m_settings.contains(OPTION_WALLET_FILE) ? addressBookFileFor(m_values.walletFile) :
+    getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".addressbook");
+  m_values.recentWallets = m_settings.value(OPTION_RECENT_WALLETS).toVariant().toStringList();
+  m_values.encrypted = m_settings.value(OPTION_ENCRYPTED).toBool(false);
+  m_values.tracking = m_settings.value(OPTION_TRACKING).toBool(false);
+  m_values.theme = m_settings.value(OPTION_WALLET_THEME).toString("light");
+  m_values.language = m_settings.value(OPTION_LANGUAGE).toString();
+  m_values.connection = m_settings.value(OPTION_CONNECTION).toString("auto");
+  m_values.daemonPort = m_settings.value(OPTION_DAEMON_PORT).toVariant().toInt();
+  m_values.rpcNodes = parseNodesList(m_settings.value(OPTION_RPCNODES).toArray());
+  if (m_settings.contains(OPTION_REMOTE_NODE)) {
+    const QJsonObject nodeSettingObj = m_settings.value(OPTION_REMOTE_NODE).toObject();
+    m_values.remoteNode.host = nodeSettingObj.value("host").toString();
+    m_values.remoteNode.port = nodeSettingObj.value("port").toInt();
+    m_values.remoteNode.path = nodeSettingObj.value("path").toString();
+    m_values.remoteNode.ssl = nodeSettingObj.value("ssl").toBool();
+  }
+
+  m_values.minimizeToTray = m_settings.value(OPTION_MINIMIZE_TO_TRAY).toBool(false);
+  m_values.closeToTray = m_settings.value(OPTION_CLOSE_TO_TRAY).toBool(false);
+  m_values.hideEverythingOnLocked = m_settings.value(OPTION_HIDE_EVERYTHING_ON_LOCKED).toBool(false);
+
+  const QJsonObject optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
+  m_values.optimizationEnabled = optimizationObject.value(OPTION_WALLET_OPTIMIZATION_ENABLED).toBool(false);
+  m_values.optimizationTimeSetManually = optimizationObject.value(OPTION_WALLET_OPTIMIZATION_TIME_SET_MANUALLY).toBool(false);
+  m_values.optimizationStartTime = optimizationObject.contains(OPTION_WALLET_OPTIMIZATION_START_TIME) ?
+    QTime::fromString(optimizationObject.value(OPTION_WALLET_OPTIMIZATION_START_TIME).toString(), Qt::ISODate) : QTime(0, 0);
+  m_values.optimizationStopTime = optimizationObject.contains(OPTION_WALLET_OPTIMIZATION_STOP_TIME) ?
+    QTime::fromString(optimizationObject.value(OPTION_WALLET_OPTIMIZATION_STOP_TIME).toString(), Qt::ISODate) : QTime(0, 0);
+  m_values.optimizationInterval = optimizationObject.contains(OPTION_WALLET_OPTIMIZATION_INTERVAL) ?
+    optimizationObject.value(OPTION_WALLET_OPTIMIZATION_INTERVAL).toString().toULongLong() : DEFAULT_OPTIMIZATION_PERIOD;
+  m_values.optimizationThreshold = optimizationObject.contains(OPTION_WALLET_OPTIMIZATION_THRESHOLD) ?
+    optimizationObject.value(OPTION_WALLET_OPTIMIZATION_THRESHOLD).toString().toULongLong() : DEFAULT_OPTIMIZATION_THRESHOLD;
+  m_values.optimizationMixin = optimizationObject.contains(OPTION_WALLET_OPTIMIZATION_MIXIN) ?
+    optimizationObject.value(OPTION_WALLET_OPTIMIZATION_MIXIN).toString().toULongLong() : DEFAULT_OPTIMIZATION_MIXIN;
+  m_values.optimizationTargetOutputCount = optimizationObject.value(OPTION_WALLET_OPTIMIZATION_TARGET_OUTPUT_COUNT).toString().toULongLong();
+  m_values.skipFusionTransactions = optimizationObject.value(OPTION_SKIP_WALLET_OPTIMIZATION_TRANSACTIONS).toBool(false);
 }
 
 bool Settings::isTestnet() const {
@@ -135,6 +247,11 @@ bool Settings::isTestnet() const {
   return m_cmdLineParser->hasTestnetOption();
 }
 
+bool Settings::isHeadless() const {
+  Q_ASSERT(m_cmdLineParser != nullptr);
+  return m_cmdLineParser->hasHeadlessOption();
+}
+
 bool Settings::hasAllowLocalIpOption() const {
   Q_ASSERT(m_cmdLineParser != nullptr);
   return m_cmdLineParser->hasAllowLocalIpOption();
@@ -196,8 +313,7 @@ quint32 Settings::getRollBack() const {
 }
 
 QString Settings::getWalletFile() const {
-  return m_settings.contains("walletFile") ? m_settings.value("walletFile").toString() :
-    getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".wallet");
+  return m_values.walletFile;
 }
 
 QString Settings::getWalletName() const {
@@ -206,23 +322,19 @@ QString Settings::getWalletName() const {
 }
 
 QStringList Settings::getRecentWalletsList() const {
-   QStringList recent_wallets;
-   if (m_settings.contains("recentWallets")) {
-     recent_wallets << m_settings.value("recentWallets").toVariant().toStringList();
-   }
-   return recent_wallets;
+  return m_values.recentWallets;
 }
 
 QString Settings::getAddressBookFile() const {
-  return m_addressBookFile;
+  return m_values.addressBookFile;
 }
 
 bool Settings::isEncrypted() const {
-  return m_settings.contains("encrypted") ? m_settings.value("encrypted").toBool() : false;
+  return m_values.encrypted;
 }
 
 bool Settings::isTrackingMode() const {
-  return m_settings.contains("tracking") ? m_settings.value("tracking").toBool() : false;
+  return m_values.tracking;
 }
 
 QString Settings::getVersion() const {
@@ -230,76 +342,27 @@ QString Settings::getVersion() const {
 }
 
 QString Settings::getCurrentTheme() const {
-  return m_settings.contains(OPTION_WALLET_THEME) ? m_settings.value(OPTION_WALLET_THEME).toString() : "light";
+  return m_values.theme;
 }
 
 QString Settings::getLanguage() const {
-    QString currentLang;
-    if (m_settings.contains(OPTION_LANGUAGE)) {
-        currentLang = m_settings.value(OPTION_LANGUAGE).toString();
-    }
-    return currentLang;
+  return m_values.language;
 }
 
 QString Settings::getConnection() const {
-    QString connection;
-    if (m_settings.contains(OPTION_CONNECTION)) {
-        connection = m_settings.value(OPTION_CONNECTION).toString();
-    }
-    else {
-    connection = "auto"; // default
-    }
-    return connection;
+  return m_values.connection;
 }
 
 QVector<NodeSetting> Settings::getRpcNodesList() const {
-  QVector<NodeSetting> res;
-  if (m_settings.contains(OPTION_RPCNODES)) {
-    const QJsonArray nodeSettingArray(m_settings.value(OPTION_RPCNODES).toArray());
-    for (const QJsonValue nodeSettingValue : nodeSettingArray) {
-      const QJsonObject nodeSettingObj = nodeSettingValue.toObject();
-      NodeSetting nodeSetting;
-      if (nodeSettingObj.contains("host") &&
-          nodeSettingObj.contains("port") &&
-          nodeSettingObj.contains("path") &&
-          nodeSettingObj.contains("ssl")) {
-          nodeSetting.host = nodeSettingObj.value("host").toString();
-          nodeSetting.port = nodeSettingObj.value("port").toInt();
-          nodeSetting.path = nodeSettingObj.value("path").toString();
-          nodeSetting.ssl  = nodeSettingObj.value("ssl").toBool();
-      } else {
-         // convert old format
-         QUrl remoteNodeUrl = QUrl::fromUserInput(nodeSettingValue.toString());
-         nodeSetting.host = remoteNodeUrl.host();
-         nodeSetting.port = remoteNodeUrl.port();
-         nodeSetting.path = "/";
-         nodeSetting.ssl  = false;
-      }
-      res.append(nodeSetting);
-    }
-  }
-
-  return res;
+  return m_values.rpcNodes;
 }
 
 quint16 Settings::getCurrentLocalDaemonPort() const {
-    quint16 port;
-    if (m_settings.contains(OPTION_DAEMON_PORT)) {
-        port = m_settings.value(OPTION_DAEMON_PORT).toVariant().toInt();
-    }
-    return port;
+  return m_values.daemonPort;
 }
 
 NodeSetting Settings::getCurrentRemoteNode() const {
-  NodeSetting remotenode;
-  if (m_settings.contains(OPTION_REMOTE_NODE)) {
-    const QJsonObject nodeSettingObj = m_settings.value(OPTION_REMOTE_NODE).toObject();
-    remotenode.host = nodeSettingObj.value("host").toString();
-    remotenode.port = nodeSettingObj.value("port").toInt();
-    remotenode.path = nodeSettingObj.value("path").toString();
-    remotenode.ssl = nodeSettingObj.value("ssl").toBool();
-  }
-  return remotenode;
+  return m_values.remoteNode;
 }
 
 bool Settings::isStartOnLoginEnabled() const {
@@ -341,169 +404,94 @@ bool Settings::isStartOnLoginEnabled() const {
 
 #ifdef Q_OS_WIN
 bool Settings::isMinimizeToTrayEnabled() const {
-  return m_settings.contains("minimizeToTray") ? m_settings.value("minimizeToTray").toBool() : false;
+  return m_values.minimizeToTray;
 }
 
 bool Settings::isCloseToTrayEnabled() const {
-  return m_settings.contains("closeToTray") ? m_settings.value("closeToTray").toBool() : false;
+  return m_values.closeToTray;
 }
 #endif
 
 bool Settings::isOptimizationEnabled() const {
-  if (!m_settings.contains(OPTION_WALLET_OPTIMIZATION)) {
-    return false;
-  }
-
-  QJsonObject optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
-  return optimizationObject.contains(OPTION_WALLET_OPTIMIZATION_ENABLED) ? optimizationObject.value(OPTION_WALLET_OPTIMIZATION_ENABLED).toBool() : false;
+  return m_values.optimizationEnabled;
 }
 
 bool Settings::isOptimizationTimeSetManually() const {
-  if (!m_settings.contains(OPTION_WALLET_OPTIMIZATION)) {
-    return false;
-  }
-
-  QJsonObject optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
-  if (!optimizationObject.contains(OPTION_WALLET_OPTIMIZATION_TIME_SET_MANUALLY)) {
-    return false;
-  }
-
-  return optimizationObject.value(OPTION_WALLET_OPTIMIZATION_TIME_SET_MANUALLY).toBool();
+  return m_values.optimizationTimeSetManually;
 }
 
 QTime Settings::getOptimizationStartTime() const {
-  if (!m_settings.contains(OPTION_WALLET_OPTIMIZATION)) {
-    return QTime(0, 0);
-  }
-
-  QJsonObject optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
-  if (!optimizationObject.contains(OPTION_WALLET_OPTIMIZATION_START_TIME)) {
-    return QTime(0, 0);
-  }
-
-  QString timeString = optimizationObject.value(OPTION_WALLET_OPTIMIZATION_START_TIME).toString();
-  return QTime::fromString(timeString, Qt::ISODate);
+  return m_values.optimizationStartTime;
 }
 
 QTime Settings::getOptimizationStopTime() const {
-  if (!m_settings.contains(OPTION_WALLET_OPTIMIZATION)) {
-    return QTime(0, 0);
-  }
-
-  QJsonObject optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
-  if (!optimizationObject.contains(OPTION_WALLET_OPTIMIZATION_STOP_TIME)) {
-    return QTime(0, 0);
-  }
-
-  QString timeString = optimizationObject.value(OPTION_WALLET_OPTIMIZATION_STOP_TIME).toString();
-  return QTime::fromString(timeString, Qt::ISODate);
+  return m_values.optimizationStopTime;
 }
 
 quint64 Settings::getOptimizationInterval() const {
-  if (!m_settings.contains(OPTION_WALLET_OPTIMIZATION)) {
-    return DEFAULT_OPTIMIZATION_PERIOD;
-  }
-
-  QJsonObject optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
-  if (!optimizationObject.contains(OPTION_WALLET_OPTIMIZATION_INTERVAL)) {
-    return DEFAULT_OPTIMIZATION_PERIOD;
-  }
-
-  return optimizationObject.value(OPTION_WALLET_OPTIMIZATION_INTERVAL).toString().toULongLong();
+  return m_values.optimizationInterval;
 }
 
 quint64 Settings::getOptimizationThreshold() const {
-  if (!m_settings.contains(OPTION_WALLET_OPTIMIZATION)) {
-    return DEFAULT_OPTIMIZATION_THRESHOLD;
-  }
-
-  QJsonObject optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
-  if (!optimizationObject.contains(OPTION_WALLET_OPTIMIZATION_THRESHOLD)) {
-    return DEFAULT_OPTIMIZATION_THRESHOLD;
-  }
-
-  return optimizationObject.value(OPTION_WALLET_OPTIMIZATION_THRESHOLD).toString().toULongLong();
+  return m_values.optimizationThreshold;
 }
 
 quint64 Settings::getOptimizationMixin() const {
-  if (!m_settings.contains(OPTION_WALLET_OPTIMIZATION)) {
-    return DEFAULT_OPTIMIZATION_MIXIN;
-  }
-
-  QJsonObject optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
-  if (!optimizationObject.contains(OPTION_WALLET_OPTIMIZATION_MIXIN)) {
-    return DEFAULT_OPTIMIZATION_MIXIN;
-  }
+  return m_values.optimizationMixin;
+}
 
-  return optimizationObject.value(OPTION_WALLET_OPTIMIZATION_MIXIN).toString().toULongLong();
+quint64 Settings::getOptimizationTargetOutputCount() const {
+  return m_values.optimizationTargetOutputCount;
 }
 
 bool Settings::skipFusionTransactions() const {
-  if (!m_settings.contains(OPTION_WALLET_OPTIMIZATION)) {
-    return false;
-  }
-
-  QJsonObject optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
-  return optimizationObject.contains(OPTION_SKIP_WALLET_OPTIMIZATION_TRANSACTIONS) ? optimizationObject.value(OPTION_SKIP_WALLET_OPTIMIZATION_TRANSACTIONS).toBool() : false;
+  return m_values.skipFusionTransactions;
 }
 
 bool Settings::hideEverythingOnLocked() const {
-  return m_settings.contains("hideEverythingOnLocked") ? m_settings.value("hideEverythingOnLocked").toBool() : false;
+  return m_values.hideEverythingOnLocked;
 }
 
 void Settings::setWalletFile(const QString& _file) {
-  if (_file.endsWith(".wallet") || _file.endsWith(".keys")) {
-    m_settings.insert("walletFile", _file);
-  } else if (_file.endsWith(".trackingwallet")) {
-    m_settings.insert("walletFile", _file);
-  } else {
-    m_settings.insert("walletFile", _file + ".wallet");
+  QString walletFile = _file;
+  if (!_file.endsWith(".wallet") && !_file.endsWith(".keys") && !_file.endsWith(".trackingwallet")) {
+    walletFile = _file + ".wallet";
   }
 
-  if (!m_settings.contains("recentWallets")) {
-    QStringList recentWallets;
-    if (_file.endsWith(".wallet") || _file.endsWith(".keys")) {
-        recentWallets.prepend(_file);
-    } else if (_file.endsWith(".trackingwallet")) {
-        recentWallets.prepend(_file);
-    } else {
-       recentWallets.prepend(_file + ".wallet");
-    }
-    m_settings.insert("recentWallets", QJsonArray::fromStringList(recentWallets));
-  } else {
-    QStringList recentWallets = m_settings.value("recentWallets").toVariant().toStringList();
-
-    foreach (const QString &recentFile, recentWallets) {
-      if (recentFile.contains(_file))
-        recentWallets.removeOne(recentFile);
-    }
-    if (_file.endsWith(".wallet") || _file.endsWith(".keys")) {
-        recentWallets.prepend(_file);
-    } else if (_file.endsWith(".trackingwallet")) {
-        recentWallets.prepend(_file);
-    } else {
-       recentWallets.prepend(_file + ".wallet");
-    }
-    while (recentWallets.size() > 10)
-           recentWallets.removeLast();
-    m_settings.insert("recentWallets", QJsonArray::fromStringList(recentWallets));
+  QStringList recentWallets = m_values.recentWallets;
+  foreach (const QString &recentFile, m_values.recentWallets) {
+    if (recentFile.contains(_file))
+      recentWallets.removeOne(recentFile);
   }
 
+  recentWallets.prepend(walletFile);
+  while (recentWallets.size() > MAX_RECENT_WALLETS)
+         recentWallets.removeLast();
+
+  const bool changed = walletFile != m_values.walletFile;
+  m_values.walletFile = walletFile;
+  m_values.recentWallets = recentWallets;
+  m_values.addressBookFile = addressBookFileFor(walletFile);
+  m_settings.insert(OPTION_WALLET_FILE, walletFile);
+  m_settings.insert(OPTION_RECENT_WALLETS, QJsonArray::fromStringList(recentWallets));
   saveSettings();
-  m_addressBookFile = m_settings.value("walletFile").toString();
-  m_addressBookFile.replace(m_addressBookFile.lastIndexOf(".wallet"), 7, ".addressbook");
+  if (changed) {
+    Q_EMIT walletFileChangedSignal(walletFile);
+  }
 }
 
 void Settings::setEncrypted(bool _encrypted) {
-  if (isEncrypted() != _encrypted) {
-    m_settings.insert("encrypted", _encrypted);
+  if (m_values.encrypted != _encrypted) {
+    m_values.encrypted = _encrypted;
+    m_settings.insert(OPTION_ENCRYPTED, _encrypted);
     saveSettings();
   }
 }
 
 void Settings::setTrackingMode(bool _tracking) {
-  if (isTrackingMode() != _tracking) {
-    m_settings.insert("tracking", _tracking);
+  if (m_values.tracking != _tracking) {
+    m_values.tracking = _tracking;
+    m_settings.insert(OPTION_TRACKING, _tracking);
     saveSettings();
   }
 }
@@ -512,8 +500,11 @@ void Settings::setCurrentTheme(const QString& _theme) {
 }
 
 void Settings::setLanguage(const QString& _language) {
+  if (m_values.language != _language) {
+    m_values.language = _language;
     m_settings.insert(OPTION_LANGUAGE, _language);
     saveSettings();
+  }
 }
 
 void Settings::setStartOnLoginEnabled(bool _enable) {
@@ -573,209 +564,203 @@ void Settings::setStartOnLoginEnabled(bool _enable) {
 }
 
 void Settings::setConnection(const QString& _connection) {
+  if (m_values.connection != _connection) {
+    m_values.connection = _connection;
     m_settings.insert(OPTION_CONNECTION, _connection);
     saveSettings();
+    Q_EMIT connectionSettingsChangedSignal();
+  }
 }
 
 void Settings::setCurrentLocalDaemonPort(const quint16& _daemonPort) {
+  if (m_values.daemonPort != _daemonPort) {
+    m_values.daemonPort = _daemonPort;
     m_settings.insert(OPTION_DAEMON_PORT, _daemonPort);
     saveSettings();
+    Q_EMIT connectionSettingsChangedSignal();
+  }
 }
 
 void Settings::setCurrentRemoteNode(const NodeSetting &remoteNode) {
-  if (!remoteNode.host.isEmpty()) {
-    QJsonObject nodeSettingObj;
-    nodeSettingObj.insert("host", QJsonValue(remoteNode.host));
-    nodeSettingObj.insert("port", QJsonValue(remoteNode.port));
-    nodeSettingObj.insert("path", QJsonValue(remoteNode.path));
-    nodeSettingObj.insert("ssl", QJsonValue(remoteNode.ssl));
-    m_settings.insert(OPTION_REMOTE_NODE, nodeSettingObj);
+  if (remoteNode.host.isEmpty() || m_values.remoteNode == remoteNode) {
+    return;
   }
+
+  m_values.remoteNode = remoteNode;
+  m_settings.insert(OPTION_REMOTE_NODE, nodeSettingToJson(remoteNode));
   saveSettings();
+  Q_EMIT connectionSettingsChangedSignal();
 }
 
 void Settings::setRpcNodesList(const QVector<NodeSetting> &RpcNodesList) {
-  if (!RpcNodesList.isEmpty()) {
-    QJsonArray nodesList;
-    for (const NodeSetting &nodeSetting : RpcNodesList) {
-      QJsonObject nodeSettingObj;
-      nodeSettingObj.insert("host", QJsonValue(nodeSetting.host));
-      nodeSettingObj.insert("port", QJsonValue(nodeSetting.port));
-      nodeSettingObj.insert("path", QJsonValue(nodeSetting.path));
-      nodeSettingObj.insert("ssl", QJsonValue(nodeSetting.ssl));
-      nodesList.append(nodeSettingObj);
-    }
-    m_settings.insert(OPTION_RPCNODES, nodesList);
+  if (RpcNodesList.isEmpty() || m_values.rpcNodes == RpcNodesList) {
+    return;
   }
+
+  QJsonArray nodesList;
+  for (const NodeSetting &nodeSetting : RpcNodesList) {
+    nodesList.append(nodeSettingToJson(nodeSetting));
+  }
+
+  m_values.rpcNodes = RpcNodesList;
+  m_settings.insert(OPTION_RPCNODES, nodesList);
   saveSettings();
+  Q_EMIT connectionSettingsChangedSignal();
 }
 
 #ifdef Q_OS_WIN
 void Settings::setMinimizeToTrayEnabled(bool _enable) {
-  if (isMinimizeToTrayEnabled() != _enable) {
-    m_settings.insert("minimizeToTray", _enable);
+  if (m_values.minimizeToTray != _enable) {
+    m_values.minimizeToTray = _enable;
+    m_settings.insert(OPTION_MINIMIZE_TO_TRAY, _enable);
     saveSettings();
   }
 }
 
 void Settings::setCloseToTrayEnabled(bool _enable) {
-  if (isCloseToTrayEnabled() != _enable) {
-    m_settings.insert("closeToTray", _enable);
+  if (m_values.closeToTray != _enable) {
+    m_values.closeToTray = _enable;
+    m_settings.insert(OPTION_CLOSE_TO_TRAY, _enable);
     saveSettings();
   }
 }
 #endif
 
+void Settings::insertOptimizationValue(const QString& _key, const QJsonValue& _value) {
+  QJsonObject optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
+  optimizationObject.insert(_key, _value);
+  m_settings.insert(OPTION_WALLET_OPTIMIZATION, optimizationObject);
+  saveSettings();
+}
+
 void Settings::setOptimizationEnabled(bool _enable) {
-  if (_enable == isOptimizationEnabled()) {
+  if (_enable == m_values.optimizationEnabled) {
     return;
   }
 
-  {
-    QJsonObject optimizationObject;
-    if (m_settings.contains(OPTION_WALLET_OPTIMIZATION)) {
-      optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
-    }
-
-    optimizationObject.insert(OPTION_WALLET_OPTIMIZATION_ENABLED, _enable);
-    m_settings.insert(OPTION_WALLET_OPTIMIZATION, optimizationObject);
-    saveSettings();
-  }
+  m_values.optimizationEnabled = _enable;
+  insertOptimizationValue(OPTION_WALLET_OPTIMIZATION_ENABLED, _enable);
+  Q_EMIT optimizationSettingsChangedSignal();
 }
 
 void Settings::setOptimizationTimeSetManually(bool _enable) {
-  if (_enable == isOptimizationTimeSetManually()) {
+  if (_enable == m_values.optimizationTimeSetManually) {
     return;
   }
 
-  {
-    QJsonObject optimizationObject;
-    if (m_settings.contains(OPTION_WALLET_OPTIMIZATION)) {
-      optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
-    }
-
-    optimizationObject.insert(OPTION_WALLET_OPTIMIZATION_TIME_SET_MANUALLY, _enable);
-    m_settings.insert(OPTION_WALLET_OPTIMIZATION, optimizationObject);
-    saveSettings();
-  }
+  m_values.optimizationTimeSetManually = _enable;
+  insertOptimizationValue(OPTION_WALLET_OPTIMIZATION_TIME_SET_MANUALLY, _enable);
+  Q_EMIT optimizationSettingsChangedSignal();
 }
 
 void Settings::setOptimizationStartTime(const QTime& _startTime) {
-  if (_startTime == getOptimizationStartTime()) {
+  if (_startTime == m_values.optimizationStartTime) {
     return;
   }
 
-  {
-    QJsonObject optimizationObject;
-    if (m_settings.contains(OPTION_WALLET_OPTIMIZATION)) {
-      optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
-    }
-
-    optimizationObject.insert(OPTION_WALLET_OPTIMIZATION_START_TIME, _startTime.toString(Qt::ISODate));
-    m_settings.insert(OPTION_WALLET_OPTIMIZATION, optimizationObject);
-    saveSettings();
-  }
+  m_values.optimizationStartTime = _startTime;
+  insertOptimizationValue(OPTION_WALLET_OPTIMIZATION_START_TIME, _startTime.toString(Qt::ISODate));
+  Q_EMIT optimizationSettingsChangedSignal();
 }
 
 void Settings::setOptimizationStopTime(const QTime& _stopTime) {
-  if (_stopTime == getOptimizationStopTime()) {
+  if (_stopTime == m_values.optimizationStopTime) {
     return;
   }
 
-  {
-    QJsonObject optimizationObject;
-    if (m_settings.contains(OPTION_WALLET_OPTIMIZATION)) {
-      optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
-    }
-
-    optimizationObject.insert(OPTION_WALLET_OPTIMIZATION_STOP_TIME, _stopTime.toString(Qt::ISODate));
-    m_settings.insert(OPTION_WALLET_OPTIMIZATION, optimizationObject);
-    saveSettings();
-  }
+  m_values.optimizationStopTime = _stopTime;
+  insertOptimizationValue(OPTION_WALLET_OPTIMIZATION_STOP_TIME, _stopTime.toString(Qt::ISODate));
+  Q_EMIT optimizationSettingsChangedSignal();
 }
 
 void Settings::setOptimizationInterval(quint64 _interval) {
-  if (_interval == getOptimizationInterval()) {
+  if (_interval == m_values.optimizationInterval) {
     return;
   }
 
-  {
-    QJsonObject optimizationObject;
-    if (m_settings.contains(OPTION_WALLET_OPTIMIZATION)) {
-      optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
-    }
-
-    optimizationObject.insert(OPTION_WALLET_OPTIMIZATION_INTERVAL, QString::number(_interval));
-    m_settings.insert(OPTION_WALLET_OPTIMIZATION, optimizationObject);
-    saveSettings();
-  }
+  m_values.optimizationInterval = _interval;
+  insertOptimizationValue(OPTION_WALLET_OPTIMIZATION_INTERVAL, QString::number(_interval));
+  Q_EMIT optimizationSettingsChangedSignal();
 }
 
 void Settings::setOptimizationThreshold(quint64 _threshold) {
-  if (_threshold == getOptimizationThreshold()) {
+  if (_threshold == m_values.optimizationThreshold) {
     return;
   }
 
-  {
-    QJsonObject optimizationObject;
-    if (m_settings.contains(OPTION_WALLET_OPTIMIZATION)) {
-      optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
-    }
-
-    optimizationObject.insert(OPTION_WALLET_OPTIMIZATION_THRESHOLD, QString::number(_threshold));
-    m_settings.insert(OPTION_WALLET_OPTIMIZATION, optimizationObject);
-    saveSettings();
-  }
+  m_values.optimizationThreshold = _threshold;
+  insertOptimizationValue(OPTION_WALLET_OPTIMIZATION_THRESHOLD, QString::number(_threshold));
+  Q_EMIT optimizationSettingsChangedSignal();
 }
 
 void Settings::setOptimizationMixin(quint64 _mixin) {
-  if (_mixin == getOptimizationMixin()) {
+  if (_mixin == m_values.optimizationMixin) {
     return;
   }
 
-  {
-    QJsonObject optimizationObject;
-    if (m_settings.contains(OPTION_WALLET_OPTIMIZATION)) {
-      optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
-    }
+  m_values.optimizationMixin = _mixin;
+  insertOptimizationValue(OPTION_WALLET_OPTIMIZATION_MIXIN, QString::number(_mixin));
+  Q_EMIT optimizationSettingsChangedSignal();
+}
 
-    optimizationObject.insert(OPTION_WALLET_OPTIMIZATION_MIXIN, QString::number(_mixin));
-    m_settings.insert(OPTION_WALLET_OPTIMIZATION, optimizationObject);
-    saveSettings();
+void Settings::setOptimizationTargetOutputCount(quint64 _count) {
+  if (_count == m_values.optimizationTargetOutputCount) {
+    return;
   }
+
+  m_values.optimizationTargetOutputCount = _count;
+  insertOptimizationValue(OPTION_WALLET_OPTIMIZATION_TARGET_OUTPUT_COUNT, QString::number(_count));
+  Q_EMIT optimizationSettingsChangedSignal();
 }
 
 void Settings::setSkipFusionTransactions(bool _skip) {
-  if (_skip == skipFusionTransactions()) {
+  if (_skip == m_values.skipFusionTransactions) {
     return;
   }
 
-  {
-    QJsonObject optimizationObject;
-    if (m_settings.contains(OPTION_WALLET_OPTIMIZATION)) {
-      optimizationObject = m_settings.value(OPTION_WALLET_OPTIMIZATION).toObject();
-    }
+  m_values.skipFusionTransactions = _skip;
+  insertOptimizationValue(OPTION_SKIP_WALLET_OPTIMIZATION_TRANSACTIONS, _skip);
+}
 
-    optimizationObject.insert(OPTION_SKIP_WALLET_OPTIMIZATION_TRANSACTIONS, _skip);
-    m_settings.insert(OPTION_WALLET_OPTIMIZATION, optimizationObject);
+void Settings::setHideEverythingOnLocked(bool _hide) {
+  if (m_values.hideEverythingOnLocked != _hide) {
+    m_values.hideEverythingOnLocked = _hide;
+    m_settings.insert(OPTION_HIDE_EVERYTHING_ON_LOCKED, _hide);
     saveSettings();
   }
 }
 
-void Settings::setHideEverythingOnLocked(bool _hide) {
-  if (hideEverythingOnLocked() != _hide) {
-    m_settings.insert("hideEverythingOnLocked", _hide);
-    saveSettings();
+void Settings::saveSettings() {
+  m_isModified = true;
+  m_saveTimer.start();
+}
+
+void Settings::saveTimeout() {
+  if (m_fileName.isEmpty()) {
+    return;
   }
+
+  Q_EMIT writeSettingsSignal(m_fileName, QJsonDocument(m_settings).toJson());
 }
 
-void Settings::saveSettings() const {
-  QFile cfgFile(getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".cfg"));
-  if (cfgFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-    QJsonDocument cfg_doc(m_settings);
-    cfgFile.write(cfg_doc.toJson());
-    cfgFile.close();
+void Settings::flush() {
+  m_saveTimer.stop();
+  if (!m_isModified || m_fileName.isEmpty()) {
+    return;
   }
+
+  // Queued behind the pending writes, so the full document is the last one written. Once the writer
+  // has stopped in the destructor, writes queued to it may have been dropped and the document covers them.
+  const QByteArray data = QJsonDocument(m_settings).toJson();
+  if (m_writerThread.isRunning()) {
+    QMetaObject::invokeMethod(m_writer, "write", Qt::BlockingQueuedConnection, Q_ARG(QString, m_fileName), Q_ARG(QByteArray, data));
+  } else {
+    SettingsWriter::writeFile(m_fileName, data);
+  }
+
+  m_isModified = false;
 }
 
 }
+
+#include "Settings.moc"
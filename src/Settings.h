@@ -9,6 +9,10 @@
 #include <QJsonArray>
 #include <QObject>
 #include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QTime>
+#include <QTimer>
 #include <QVector>
 #include <QDir>
 
@@ -21,7 +25,16 @@ struct NodeSetting {
   bool ssl;
 };
 
+inline bool operator==(const NodeSetting& _left, const NodeSetting& _right) {
+  return _left.host == _right.host && _left.port == _right.port && _left.path == _right.path && _left.ssl == _right.ssl;
+}
+
+inline bool operator!=(const NodeSetting& _left, const NodeSetting& _right) {
+  return !(_left == _right);
+}
+
 class CommandLineParser;
+class SettingsWriter;
 
 class Settings : public QObject {
   Q_OBJECT
@@ -36,6 +49,7 @@ public:
   bool hasAllowLocalIpOption() const;
   bool hasHideMyPortOption() const;
   bool isTestnet() const;
+  bool isHeadless() const;
   bool useLevelDB() const;
   QDir getDataDir() const;
   QString getP2pBindIp() const;
@@ -67,6 +81,7 @@ public:
   quint64 getOptimizationInterval() const;
   quint64 getOptimizationThreshold() const;
   quint64 getOptimizationMixin() const;
+  quint64 getOptimizationTargetOutputCount() const;
 
   quint32 getRollBack() const;
 
@@ -103,21 +118,64 @@ public:
   void setOptimizationInterval(quint64 _interval);
   void setOptimizationThreshold(quint64 _threshold);
   void setOptimizationMixin(quint64 _mixin);
+  void setOptimizationTargetOutputCount(quint64 _count);
   void setSkipFusionTransactions(bool _skip);
   void setHideEverythingOnLocked(bool _hide);
 
+  // Writes out pending changes before returning, after any write still queued to the background writer.
+  // The writer keeps running, later changes are saved as usual.
+  void flush();
+
 private:
+  // Values parsed once in load() and kept in step by the setters, so getters don't go through JSON
+  struct Values {
+    QString walletFile;
+    QStringList recentWallets;
+    QString addressBookFile;
+    bool encrypted = false;
+    bool tracking = false;
+    QString theme;
+    QString language;
+    QString connection;
+    quint16 daemonPort = 0;
+    QVector<NodeSetting> rpcNodes;
+    NodeSetting remoteNode {QString(), 0, QString(), false};
+    bool minimizeToTray = false;
+    bool closeToTray = false;
+    bool hideEverythingOnLocked = false;
+    bool optimizationEnabled = false;
+    bool optimizationTimeSetManually = false;
+    QTime optimizationStartTime;
+    QTime optimizationStopTime;
+    quint64 optimizationInterval = 0;
+    quint64 optimizationThreshold = 0;
+    quint64 optimizationMixin = 0;
+    quint64 optimizationTargetOutputCount = 0;
+    bool skipFusionTransactions = false;
+  };
+
   QJsonObject m_settings;
-  QString m_addressBookFile;
-  QString m_currentLang;
-  QString m_connectionMode;
-  quint16 m_daemonPort;
+  Values m_values;
+  QString m_fileName;
+  QTimer m_saveTimer;
+  QThread m_writerThread;
+  SettingsWriter* m_writer;
+  bool m_isModified;
   CommandLineParser* m_cmdLineParser;
 
   Settings();
   ~Settings();
 
-  void saveSettings() const;
+  void parseSettings();
+  void insertOptimizationValue(const QString& _key, const QJsonValue& _value);
+  void saveSettings();
+  void saveTimeout();
+
+Q_SIGNALS:
+  void optimizationSettingsChangedSignal();
+  void connectionSettingsChangedSignal();
+  void walletFileChangedSignal(const QString& _file);
+  void writeSettingsSignal(const QString& _fileName, const QByteArray& _data);
 };
 
 }
@@ -0,0 +1,78 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "StartupLogSink.h"
+
+namespace WalletGui {
+
+StartupLogSink::StartupLogSink() : QObject(), Logging::CommonLogger(Logging::INFO), m_head(0), m_tail(0),
+  m_isDrainScheduled(false), m_isEnabled(false) {
+  // The splash screen shows the bare message, without time, level and category
+  setPattern("");
+}
+
+StartupLogSink::~StartupLogSink() {
+}
+
+void StartupLogSink::setEnabled(bool _enable) {
+  m_isEnabled = _enable;
+}
+
+void StartupLogSink::operator()(const std::string& _category, Logging::Level _level, boost::posix_time::ptime _time,
+  const std::string& _body) {
+  // Costs nothing but this check once the startup is over
+  if (m_isEnabled) {
+    Logging::CommonLogger::operator()(_category, _level, _time, _body);
+  }
+}
+
+void StartupLogSink::doLogString(const std::string& _message) {
+  std::string message;
+  message.reserve(_message.size());
+  bool isColor = false;
+  for (char c : _message) {
+    if (c == Logging::ILogger::COLOR_DELIMETER) {
+      isColor = !isColor;
+    } else if (!isColor && c != '\n' && c != '\r') {
+      message.push_back(c);
+    }
+  }
+
+  if (message.empty()) {
+    return;
+  }
+
+  // A full ring means the GUI thread is busy, the status line catches up with a later message
+  const size_t head = m_head.load(std::memory_order_relaxed);
+  if (head - m_tail.load(std::memory_order_acquire) == RING_SIZE) {
+    return;
+  }
+
+  m_ring[head % RING_SIZE].swap(message);
+  m_head.store(head + 1, std::memory_order_release);
+  if (!m_isDrainScheduled.exchange(true)) {
+    QMetaObject::invokeMethod(this, "drain", Qt::QueuedConnection);
+  }
+}
+
+void StartupLogSink::drain() {
+  // Cleared first, a message pushed while draining schedules the next drain
+  m_isDrainScheduled = false;
+  const size_t head = m_head.load(std::memory_order_acquire);
+  size_t tail = m_tail.load(std::memory_order_relaxed);
+  if (tail == head) {
+    return;
+  }
+
+  std::string latest;
+  for (; tail != head; ++tail) {
+    latest.swap(m_ring[tail % RING_SIZE]);
+    m_ring[tail % RING_SIZE].clear();
+  }
+
+  m_tail.store(tail, std::memory_order_release);
+  Q_EMIT startupMessageSignal(QString::fromStdString(latest));
+}
+
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <string>
+
+#include <QObject>
+
+#include "Logging/CommonLogger.h"
+
+namespace WalletGui {
+
+// Logger of the LoggerManager that hands the log messages to the GUI thread while it is enabled, for
+// the status line of the splash screen. Messages go through a lock-free ring buffer: the
+// LoggerManager calls its loggers under its own lock, so there is a single producer at a time, and the
+// GUI thread is the only consumer. The GUI thread is woken once per batch and only the latest
+// message of the batch is reported.
+class StartupLogSink : public QObject, public Logging::CommonLogger {
+  Q_OBJECT
+  Q_DISABLE_COPY(StartupLogSink)
+
+public:
+  StartupLogSink();
+  ~StartupLogSink();
+
+  void setEnabled(bool _enable);
+  void operator()(const std::string& _category, Logging::Level _level, boost::posix_time::ptime _time,
+    const std::string& _body) override;
+
+protected:
+  void doLogString(const std::string& _message) override;
+
+private:
+  static const size_t RING_SIZE = 64;
+
+  std::array<std::string, RING_SIZE> m_ring;
+  std::atomic<size_t> m_head;
+  std::atomic<size_t> m_tail;
+  std::atomic<bool> m_isDrainScheduled;
+  std::atomic<bool> m_isEnabled;
+
+  Q_SLOT void drain();
+
+Q_SIGNALS:
+  void startupMessageSignal(const QString& _message);
+};
+
+}
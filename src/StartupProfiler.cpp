@@ -0,0 +1,165 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+
+#include "StartupProfiler.h"
+
+namespace WalletGui {
+
+StartupProfiler& StartupProfiler::instance() {
+  static StartupProfiler inst;
+  return inst;
+}
+
+StartupProfiler::StartupProfiler() : m_finishedUs(-1) {
+  m_timer.start();
+}
+
+StartupProfiler::~StartupProfiler() {
+}
+
+void StartupProfiler::setTraceFile(const QString& _fileName) {
+  QMutexLocker lock(&m_mutex);
+  m_traceFile = _fileName;
+}
+
+void StartupProfiler::addSpan(const char* _name, qint64 _startUs, qint64 _durationUs) {
+  QMutexLocker lock(&m_mutex);
+  m_events.append(Event {_name, _startUs, _durationUs, currentThreadId()});
+  // Late spans, like the time to the first block of the node, update the trace already written
+  if (m_finishedUs >= 0 && !m_traceFile.isEmpty()) {
+    writeTrace();
+  }
+}
+
+void StartupProfiler::mark(const char* _name) {
+  QMutexLocker lock(&m_mutex);
+  m_events.append(Event {_name, m_timer.nsecsElapsed() / 1000, -1, currentThreadId()});
+}
+
+qint64 StartupProfiler::elapsedUs() const {
+  return m_timer.nsecsElapsed() / 1000;
+}
+
+void StartupProfiler::finish() {
+  QMutexLocker lock(&m_mutex);
+  if (m_finishedUs >= 0) {
+    return;
+  }
+
+  m_finishedUs = m_timer.nsecsElapsed() / 1000;
+  m_events.append(Event {"startup finished", m_finishedUs, -1, currentThreadId()});
+  if (!m_traceFile.isEmpty()) {
+    writeTrace();
+  }
+}
+
+bool StartupProfiler::isFinished() const {
+  QMutexLocker lock(&m_mutex);
+  return m_finishedUs >= 0;
+}
+
+// Spans in the order they started, nested ones indented under their parent
+QString StartupProfiler::getSummary() const {
+  QMutexLocker lock(&m_mutex);
+  QVector<Event> events = m_events;
+  std::stable_sort(events.begin(), events.end(), [](const Event& _left, const Event& _right) {
+    return _left.startUs < _right.startUs || (_left.startUs == _right.startUs && _left.durationUs > _right.durationUs);
+  });
+
+  QString summary;
+  QVector<qint64> openSpans;
+  for (const Event& event : events) {
+    while (!openSpans.isEmpty() && event.startUs >= openSpans.last()) {
+      openSpans.removeLast();
+    }
+
+    const QString indent(openSpans.size() * 2, QLatin1Char(' '));
+    if (event.durationUs < 0) {
+      summary += QString("%1%2 at %3 ms\n").arg(indent).arg(event.name).arg(event.startUs / 1000.0, 0, 'f', 1);
+      continue;
+    }
+
+    summary += QString("%1%2: %3 ms\n").arg(indent).arg(event.name).arg(event.durationUs / 1000.0, 0, 'f', 1);
+    // Spans of other threads overlap the main ones without being nested in them
+    if (event.threadId == 1) {
+      openSpans.append(event.startUs + event.durationUs);
+    }
+  }
+
+  if (m_finishedUs >= 0) {
+    summary += QString("Total: %1 ms\n").arg(m_finishedUs / 1000.0, 0, 'f', 1);
+  }
+
+  return summary;
+}
+
+int StartupProfiler::currentThreadId() {
+  const quintptr thread = reinterpret_cast<quintptr>(QThread::currentThreadId());
+  auto it = m_threadIds.find(thread);
+  if (it == m_threadIds.end()) {
+    it = m_threadIds.insert(thread, m_threadIds.size() + 1);
+  }
+
+  return it.value();
+}
+
+void StartupProfiler::writeTrace() const {
+  const qint64 pid = QCoreApplication::applicationPid();
+  QJsonArray traceEvents;
+  for (auto it = m_threadIds.constBegin(); it != m_threadIds.constEnd(); ++it) {
+    QJsonObject metadata;
+    metadata.insert("name", "thread_name");
+    metadata.insert("ph", "M");
+    metadata.insert("pid", pid);
+    metadata.insert("tid", it.value());
+    metadata.insert("args", QJsonObject {{"name", it.value() == 1 ? QString("main") : QString("worker %1").arg(it.value())}});
+    traceEvents.append(metadata);
+  }
+
+  for (const Event& event : m_events) {
+    QJsonObject traceEvent;
+    traceEvent.insert("name", event.name);
+    traceEvent.insert("cat", "startup");
+    traceEvent.insert("pid", pid);
+    traceEvent.insert("tid", event.threadId);
+    traceEvent.insert("ts", static_cast<double>(event.startUs));
+    if (event.durationUs < 0) {
+      traceEvent.insert("ph", "i");
+      traceEvent.insert("s", "p");
+    } else {
+      traceEvent.insert("ph", "X");
+      traceEvent.insert("dur", static_cast<double>(event.durationUs));
+    }
+
+    traceEvents.append(traceEvent);
+  }
+
+  QJsonObject trace;
+  trace.insert("traceEvents", traceEvents);
+  trace.insert("displayTimeUnit", "ms");
+  QSaveFile traceFile(m_traceFile);
+  if (traceFile.open(QIODevice::WriteOnly)) {
+    traceFile.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+    traceFile.commit();
+  }
+}
+
+StartupSpan::StartupSpan(const char* _name) : m_name(_name), m_startUs(StartupProfiler::instance().elapsedUs()) {
+}
+
+StartupSpan::~StartupSpan() {
+  StartupProfiler::instance().addSpan(m_name, m_startUs, StartupProfiler::instance().elapsedUs() - m_startUs);
+}
+
+}
@@ -0,0 +1,67 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+namespace WalletGui {
+
+// Collects timing spans of the startup stages from any thread. The spans are cheap enough to be
+// always recorded for the summary in the information dialog, the trace file in the Chrome
+// trace-event format (chrome://tracing, Perfetto) is only written with --profile-startup.
+class StartupProfiler {
+public:
+  static StartupProfiler& instance();
+
+  void setTraceFile(const QString& _fileName);
+  // Spans added after the finish are still recorded and rewrite the trace file
+  void addSpan(const char* _name, qint64 _startUs, qint64 _durationUs);
+  void mark(const char* _name);
+  qint64 elapsedUs() const;
+
+  // Closes the startup, writes the trace file once if one was requested
+  void finish();
+  bool isFinished() const;
+  QString getSummary() const;
+
+private:
+  struct Event {
+    const char* name;
+    qint64 startUs;
+    // -1 for instant events
+    qint64 durationUs;
+    int threadId;
+  };
+
+  mutable QMutex m_mutex;
+  QElapsedTimer m_timer;
+  QVector<Event> m_events;
+  QHash<quintptr, int> m_threadIds;
+  QString m_traceFile;
+  qint64 m_finishedUs;
+
+  StartupProfiler();
+  ~StartupProfiler();
+
+  int currentThreadId();
+  void writeTrace() const;
+};
+
+// Times the enclosing scope as one startup span
+class StartupSpan {
+public:
+  explicit StartupSpan(const char* _name);
+  ~StartupSpan();
+
+private:
+  const char* m_name;
+  qint64 m_startUs;
+};
+
+}
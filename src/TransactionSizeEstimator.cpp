@@ -0,0 +1,151 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+#include <limits>
+
+#include "TransactionSizeEstimator.h"
+
+namespace WalletGui {
+
+namespace {
+
+const uint64_t TRANSACTION_VERSION = 1;
+const size_t VARIANT_TAG_SIZE = 1;
+const size_t KEY_SIZE = 32;
+const size_t SIGNATURE_SIZE = 64;
+const size_t TRANSACTION_PUBLIC_KEY_EXTRA_SIZE = 1 + KEY_SIZE;
+const size_t PAYMENT_ID_EXTRA_NONCE_SIZE = 1 + 1 + 1 + KEY_SIZE;
+
+// Global output indexes are 32 bit, so no ring offset is wider than this
+const size_t MAX_OFFSET_SIZE = 5;
+const size_t MAX_AMOUNT_SIZE = 10;
+
+// Same split as the wallet does: every decimal digit above the dust threshold becomes an output,
+// the digits below it are merged into a single dust output
+template <typename Handler>
+void decomposeAmount(uint64_t _amount, uint64_t _dustThreshold, Handler _handler) {
+  bool dustHandled = false;
+  uint64_t dust = 0;
+  uint64_t order = 1;
+  while (_amount != 0) {
+    const uint64_t chunk = (_amount % 10) * order;
+    _amount /= 10;
+    order *= 10;
+    if (dust + chunk <= _dustThreshold) {
+      dust += chunk;
+    } else {
+      if (!dustHandled && dust != 0) {
+        _handler(dust);
+        dustHandled = true;
+      }
+
+      if (chunk != 0) {
+        _handler(chunk);
+      }
+    }
+  }
+
+  if (!dustHandled && dust != 0) {
+    _handler(dust);
+  }
+}
+
+uint64_t prefixSize(size_t _inputCount, size_t _outputCount, size_t _extraSize) {
+  const size_t extraSize = TRANSACTION_PUBLIC_KEY_EXTRA_SIZE + _extraSize;
+  return TransactionSizeEstimator::varintSize(TRANSACTION_VERSION) + TransactionSizeEstimator::varintSize(0) +
+    TransactionSizeEstimator::varintSize(_inputCount) + TransactionSizeEstimator::varintSize(_outputCount) +
+    TransactionSizeEstimator::varintSize(extraSize) + extraSize;
+}
+
+}
+
+TransactionSizeEstimator::TransactionSizeEstimator(uint64_t _dustThreshold) : m_dustThreshold(_dustThreshold) {
+}
+
+size_t TransactionSizeEstimator::varintSize(uint64_t _value) {
+  size_t size = 1;
+  while (_value >= 0x80) {
+    _value >>= 7;
+    ++size;
+  }
+
+  return size;
+}
+
+size_t TransactionSizeEstimator::paymentIdExtraSize() {
+  return PAYMENT_ID_EXTRA_NONCE_SIZE;
+}
+
+size_t TransactionSizeEstimator::decomposedOutputCount(uint64_t _amount) const {
+  size_t count = 0;
+  decomposeAmount(_amount, m_dustThreshold, [&count](uint64_t) { ++count; });
+  return count;
+}
+
+std::vector<uint64_t> TransactionSizeEstimator::decompose(uint64_t _amount) const {
+  std::vector<uint64_t> amounts;
+  decomposeAmount(_amount, m_dustThreshold, [&amounts](uint64_t _chunk) { amounts.push_back(_chunk); });
+  return amounts;
+}
+
+TransactionSizeEstimate TransactionSizeEstimator::estimate(const std::vector<Input>& _inputs, const std::vector<uint64_t>& _destinations,
+  uint64_t _change, size_t _mixin, size_t _extraSize) const {
+  const size_t ringSize = _mixin + 1;
+  uint64_t size = 0;
+  uint64_t maxSize = 0;
+  for (const Input& input : _inputs) {
+    const uint64_t fixed = VARIANT_TAG_SIZE + varintSize(input.amount) + varintSize(ringSize) + KEY_SIZE + ringSize * SIGNATURE_SIZE;
+
+    // Offsets are relative, the first one is about as wide as the real index, the others as the gaps between ring members
+    const uint64_t gap = std::max<uint64_t>(input.globalOutputIndex / ringSize, 1);
+    size += fixed + varintSize(input.globalOutputIndex) + _mixin * varintSize(gap);
+    maxSize += fixed + ringSize * MAX_OFFSET_SIZE;
+  }
+
+  size_t outputCount = 0;
+  uint64_t outputsSize = 0;
+  auto addOutput = [&](uint64_t _outputAmount) {
+    ++outputCount;
+    outputsSize += varintSize(_outputAmount) + VARIANT_TAG_SIZE + KEY_SIZE;
+  };
+
+  for (uint64_t amount : _destinations) {
+    decomposeAmount(amount, m_dustThreshold, addOutput);
+  }
+
+  decomposeAmount(_change, m_dustThreshold, addOutput);
+
+  const uint64_t prefix = prefixSize(_inputs.size(), outputCount, _extraSize);
+  return TransactionSizeEstimate {prefix + size + outputsSize, prefix + maxSize + outputsSize, outputCount};
+}
+
+uint64_t TransactionSizeEstimator::estimateMaxSize(size_t _inputCount, size_t _outputCount, size_t _mixin, size_t _extraSize) {
+  const size_t ringSize = _mixin + 1;
+  const uint64_t inputSize = VARIANT_TAG_SIZE + MAX_AMOUNT_SIZE + varintSize(ringSize) + ringSize * MAX_OFFSET_SIZE + KEY_SIZE +
+    ringSize * SIGNATURE_SIZE;
+  const uint64_t outputSize = MAX_AMOUNT_SIZE + VARIANT_TAG_SIZE + KEY_SIZE;
+  return prefixSize(_inputCount, _outputCount, _extraSize) + _inputCount * inputSize + _outputCount * outputSize;
+}
+
+uint64_t TransactionSizeEstimator::roundUpFee(uint64_t _fee) {
+  uint64_t scale = 1;
+  while (_fee / scale >= 100) {
+    scale *= 10;
+  }
+
+  if (_fee > std::numeric_limits<uint64_t>::max() - scale) {
+    return _fee;
+  }
+
+  return (_fee + scale - 1) / scale * scale;
+}
+
+uint64_t TransactionSizeEstimator::requiredFee(uint64_t _size, uint64_t _feePerByte, uint64_t _minimalFee) {
+  const uint64_t sizeFee = _feePerByte != 0 && _size > std::numeric_limits<uint64_t>::max() / _feePerByte ?
+    std::numeric_limits<uint64_t>::max() : _size * _feePerByte;
+  return std::max(_minimalFee, roundUpFee(sizeFee));
+}
+
+}
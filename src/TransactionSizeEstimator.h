@@ -0,0 +1,52 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace WalletGui {
+
+struct TransactionSizeEstimate {
+  // Serialized size with ring offsets guessed from the real outputs' global indexes
+  uint64_t size;
+  // Upper bound, ring offsets taken at their widest
+  uint64_t maxSize;
+  size_t outputCount;
+};
+
+// Serialized size of a transaction computed from its parts, without building or signing it.
+// Everything but the ring member offsets is known exactly up front: those depend on the decoys
+// picked while signing, so both the likely and the largest possible size are reported.
+class TransactionSizeEstimator {
+public:
+  struct Input {
+    uint64_t amount;
+    uint32_t globalOutputIndex;
+  };
+
+  explicit TransactionSizeEstimator(uint64_t _dustThreshold);
+
+  // _extraSize counts extra bytes besides the transaction public key, see paymentIdExtraSize()
+  TransactionSizeEstimate estimate(const std::vector<Input>& _inputs, const std::vector<uint64_t>& _destinations, uint64_t _change,
+    size_t _mixin, size_t _extraSize) const;
+  size_t decomposedOutputCount(uint64_t _amount) const;
+  // Output amounts the wallet splits _amount into, in the same order
+  std::vector<uint64_t> decompose(uint64_t _amount) const;
+
+  static uint64_t estimateMaxSize(size_t _inputCount, size_t _outputCount, size_t _mixin, size_t _extraSize);
+  static size_t paymentIdExtraSize();
+  static size_t varintSize(uint64_t _value);
+
+  // Fee for the size at the given rate, never below _minimalFee, rounded up to two significant digits
+  static uint64_t requiredFee(uint64_t _size, uint64_t _feePerByte, uint64_t _minimalFee);
+  static uint64_t roundUpFee(uint64_t _fee);
+
+private:
+  uint64_t m_dustThreshold;
+};
+
+}
@@ -4,14 +4,25 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <algorithm>
+#include <functional>
+#include <random>
+
 #include <QCoreApplication>
 #include <QMessageBox>
 #include <QGridLayout>
 #include <QTextEdit>
 #include <QDateTime>
+#include <QFileInfo>
 #include <QLocale>
 #include <QVector>
 #include <QDebug>
+#include <QBuffer>
+#include <QReadLocker>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QSet>
+#include <QWriteLocker>
 
 #include "WalletAdapter.h"
 
@@ -21,12 +32,16 @@
 #include <Wallet/WalletErrors.h>
 #include <Wallet/LegacyKeysImporter.h>
 #include "CryptoNoteCore/CryptoNoteBasic.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
 #include <ITransfersContainer.h>
 #include "NodeAdapter.h"
 #include "Settings.h"
+#include "ReserveProof.h"
+#include "StartupProfiler.h"
 #include "Mnemonics/electrum-words.h"
 #include "gui/VerifyMnemonicSeedDialog.h"
 #include "CurrencyAdapter.h"
+#include "FusionTransactionBuilder.h"
 
 extern "C"
 {
@@ -42,14 +57,174 @@ const quint32 MSECS_IN_MINUTE = 60 * 1000;
 const quint32 LAST_BLOCK_INFO_UPDATING_INTERVAL = 1 * MSECS_IN_MINUTE;
 const quint32 LAST_BLOCK_INFO_WARNING_INTERVAL = 1 * MSECS_IN_HOUR;
 
+QByteArray outputKey(const CryptoNote::TransactionOutputInformation& _output) {
+  QByteArray key(reinterpret_cast<const char*>(&_output.transactionHash), sizeof(_output.transactionHash));
+  key.append(reinterpret_cast<const char*>(&_output.outputInTransaction), sizeof(_output.outputInTransaction));
+  return key;
+}
+
+// Checks a proof of this wallet as a verifier would, with the wallet's own outputs standing in for the blockchain.
+// Every proven output has to be unspent.
+bool verifyOwnReserveProof(QIODevice& _device, const CryptoNote::AccountPublicAddress& _address, const std::string& _message,
+  const std::vector<CryptoNote::TransactionOutputInformation>& _outputs,
+  const std::vector<CryptoNote::TransactionSpentOutputInformation>& _spentOutputs, const ReserveProofGenerator::ProgressCallback& _progress,
+  const std::atomic<bool>& _cancel, ReserveProofVerifier::Result& _result) {
+  QHash<QByteArray, ReserveProofOutput> outputs;
+  outputs.reserve(static_cast<int>(_outputs.size()));
+  for (const CryptoNote::TransactionOutputInformation& output : _outputs) {
+    outputs.insert(outputKey(output), ReserveProofOutput {output.transactionPublicKey, output.outputKey, output.amount});
+  }
+
+  QSet<QByteArray> spentKeyImages;
+  for (const CryptoNote::TransactionSpentOutputInformation& output : _spentOutputs) {
+    spentKeyImages.insert(QByteArray(reinterpret_cast<const char*>(&output.keyImage), sizeof(output.keyImage)));
+  }
+
+  const ReserveProofVerifier verifier;
+  _result = verifier.verify(_device, _address, _message, [&outputs](const Crypto::Hash& _transactionHash, uint64_t _outputInTransaction,
+      ReserveProofOutput& _output) {
+      CryptoNote::TransactionOutputInformation key;
+      key.transactionHash = _transactionHash;
+      key.outputInTransaction = static_cast<uint32_t>(_outputInTransaction);
+      auto it = outputs.constFind(outputKey(key));
+      if (it == outputs.constEnd()) {
+        return false;
+      }
+
+      _output = it.value();
+      return true;
+    }, [&spentKeyImages](const Crypto::KeyImage& _keyImage) {
+      return spentKeyImages.contains(QByteArray(reinterpret_cast<const char*>(&_keyImage), sizeof(_keyImage)));
+    }, _progress, _cancel);
+  if (_result.status == ReserveProofVerifier::Status::VALID && _result.spent != 0) {
+    _result.error = "The proof contains spent outputs";
+  }
+
+  return _result.status == ReserveProofVerifier::Status::VALID && _result.spent == 0;
+}
+
+// Runs a function on a pool thread
+class FunctionRunnable : public QRunnable {
+public:
+  explicit FunctionRunnable(const std::function<void()>& _func) : m_func(_func) {
+  }
+
+  void run() override {
+    m_func();
+  }
+
+private:
+  std::function<void()> m_func;
+};
+
+struct WalletAdapter::TransactionJob {
+  bool relay;
+  std::vector<CryptoNote::WalletLegacyTransfer> transfers;
+  std::list<CryptoNote::TransactionOutputInformation> selectedOuts;
+  quint64 fee;
+  QString paymentId;
+  quint64 mixin;
+  std::atomic<int> phase;
+};
+
+// Runs transaction construction, including decoy fetch and ring signing done by the wallet, off the GUI thread
+class TransactionBuilder : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(TransactionBuilder)
+
+public:
+  TransactionBuilder(QObject* _parent = nullptr) : QObject(_parent) {
+  }
+
+  ~TransactionBuilder() {
+  }
+
+  void build(quint64 _jobId) {
+    WalletAdapter& adapter = WalletAdapter::instance();
+    std::shared_ptr<WalletAdapter::TransactionJob> job;
+    {
+      QMutexLocker locker(&adapter.m_jobsMutex);
+      job = adapter.m_jobs.value(_jobId);
+    }
+
+    if (!job) {
+      return;
+    }
+
+    int expected = WalletAdapter::JOB_PHASE_QUEUED;
+    if (!job->phase.compare_exchange_strong(expected, WalletAdapter::JOB_PHASE_BUILDING)) {
+      return;
+    }
+
+    Q_EMIT adapter.transactionJobPhaseChangedSignal(_jobId, WalletAdapter::JOB_PHASE_BUILDING);
+    // Sends without selected outputs get inputs picked here, so they are reserved like the selected ones
+    const bool isWalletSelected = job->selectedOuts.empty();
+    if (job->relay) {
+      adapter.takeTransactionJob(_jobId);
+      if (isWalletSelected ? !adapter.selectAndReserveOutputs(_jobId, job->transfers, job->fee, job->mixin, job->selectedOuts) :
+          !adapter.reserveOutputs(_jobId, job->selectedOuts)) {
+        job->phase = WalletAdapter::JOB_PHASE_COMPLETED;
+        adapter.failTransactionJob(_jobId, isWalletSelected ? CryptoNote::error::WRONG_AMOUNT : CryptoNote::error::WRONG_STATE,
+          isWalletSelected ? WalletAdapter::tr("Not enough unlocked balance besides the outputs of pending transactions") :
+            WalletAdapter::tr("Some of the selected outputs are already spent by a pending transaction"));
+        Q_EMIT adapter.transactionJobPhaseChangedSignal(_jobId, WalletAdapter::JOB_PHASE_COMPLETED);
+        return;
+      }
+
+      // Announced before the wallet gets the transaction, its completion may arrive before submitTransaction returns
+      job->phase = WalletAdapter::JOB_PHASE_RELAYING;
+      Q_EMIT adapter.transactionJobPhaseChangedSignal(_jobId, WalletAdapter::JOB_PHASE_RELAYING);
+      if (!adapter.submitTransaction(_jobId, true, job->transfers, job->selectedOuts, job->fee, job->paymentId, job->mixin)) {
+        job->phase = WalletAdapter::JOB_PHASE_COMPLETED;
+        adapter.failTransactionJob(_jobId, CryptoNote::error::WRONG_STATE, adapter.walletErrorMessage(CryptoNote::error::WRONG_STATE));
+        Q_EMIT adapter.transactionJobPhaseChangedSignal(_jobId, WalletAdapter::JOB_PHASE_COMPLETED);
+      }
+
+      return;
+    }
+
+    // Raw transactions are not relayed by us, their inputs are only held while the transaction is built
+    if (isWalletSelected ? !adapter.selectAndReserveOutputs(_jobId, job->transfers, job->fee, job->mixin, job->selectedOuts) :
+        !adapter.reserveOutputs(_jobId, job->selectedOuts)) {
+      adapter.takeTransactionJob(_jobId);
+      job->phase = WalletAdapter::JOB_PHASE_COMPLETED;
+      Q_EMIT adapter.rawTransactionPreparedSignal(_jobId, QString());
+      Q_EMIT adapter.transactionJobPhaseChangedSignal(_jobId, WalletAdapter::JOB_PHASE_COMPLETED);
+      return;
+    }
+
+    QString rawTransaction = job->selectedOuts.empty() ?
+      adapter.prepareRawTransaction(job->transfers, job->fee, job->paymentId, job->mixin) :
+      adapter.prepareRawTransaction(job->transfers, job->selectedOuts, job->fee, job->paymentId, job->mixin);
+
+    adapter.releaseOutputs(_jobId);
+    adapter.takeTransactionJob(_jobId);
+
+    // Raw transactions are never relayed by us, so a cancel during building just drops the result
+    expected = WalletAdapter::JOB_PHASE_BUILDING;
+    if (!job->phase.compare_exchange_strong(expected, WalletAdapter::JOB_PHASE_COMPLETED)) {
+      return;
+    }
+
+    Q_EMIT adapter.rawTransactionPreparedSignal(_jobId, rawTransaction);
+    Q_EMIT adapter.transactionJobPhaseChangedSignal(_jobId, WalletAdapter::JOB_PHASE_COMPLETED);
+  }
+};
+
 WalletAdapter& WalletAdapter::instance() {
   static WalletAdapter inst;
   return inst;
 }
 
-WalletAdapter::WalletAdapter() : QObject(), m_wallet(nullptr), m_mutex(), m_isBackupInProgress(false),
+WalletAdapter::WalletAdapter() : QObject(), m_wallet(nullptr), m_isLoadingPrefetched(false), m_loadStartUs(-1), m_mutex(), m_isBackupInProgress(false),
   m_syncSpeed(0), m_syncPeriod(0), m_isSynchronized(false), m_newTransactionsNotificationTimer(),
-  m_lastWalletTransactionId(std::numeric_limits<quint64>::max()) {
+  m_lastWalletTransactionId(std::numeric_limits<quint64>::max()), m_transactionBuilderThread(), m_transactionBuilder(new TransactionBuilder),
+  m_lastJobId(0), m_walletLock(QReadWriteLock::Recursive), m_balances(std::make_shared<BalanceSnapshot>()),
+  m_reserveProofPool(), m_lastReserveProofId(0), m_reserveProofCancel() {
+  m_reserveProofPool.setMaxThreadCount(1);
+  m_transactionBuilder->moveToThread(&m_transactionBuilderThread);
+  connect(this, &WalletAdapter::buildTransactionSignal, m_transactionBuilder, &TransactionBuilder::build, Qt::QueuedConnection);
+  connect(&m_transactionBuilderThread, &QThread::finished, m_transactionBuilder, &QObject::deleteLater);
   connect(this, &WalletAdapter::walletInitCompletedSignal, this, &WalletAdapter::onWalletInitCompleted, Qt::QueuedConnection);
   connect(this, &WalletAdapter::walletSendTransactionCompletedSignal, this, &WalletAdapter::onWalletSendTransactionCompleted, Qt::QueuedConnection);
   connect(this, &WalletAdapter::updateBlockStatusTextSignal, this, &WalletAdapter::updateBlockStatusText, Qt::QueuedConnection);
@@ -70,9 +245,14 @@ WalletAdapter::WalletAdapter() : QObject(), m_wallet(nullptr), m_mutex(), m_isBa
 }
 
 WalletAdapter::~WalletAdapter() {
+  cancelReserveProof();
+  m_reserveProofPool.waitForDone();
+  m_transactionBuilderThread.quit();
+  m_transactionBuilderThread.wait();
 }
 
 QString WalletAdapter::getAddress() const {
+  QReadLocker locker(&m_walletLock);
   try {
     return m_wallet == nullptr ? QString() : QString::fromStdString(m_wallet->getAddress());
   } catch (std::system_error&) {
@@ -81,27 +261,37 @@ QString WalletAdapter::getAddress() const {
 }
 
 quint64 WalletAdapter::getActualBalance() const {
-  try {
-    return m_wallet == nullptr ? 0 : m_wallet->actualBalance();
-  } catch (std::system_error&) {
-  }
-  return 0;
+  return std::atomic_load(&m_balances)->actual;
 }
 
 quint64 WalletAdapter::getPendingBalance() const {
-  try {
-    return m_wallet == nullptr ? 0 : m_wallet->pendingBalance();
-  } catch (std::system_error&) {
-  }
-  return 0;
+  return std::atomic_load(&m_balances)->pending;
 }
 
 quint64 WalletAdapter::getUnmixableBalance() const {
-  try {
-    return m_wallet == nullptr ? 0 : m_wallet->unmixableBalance();
-  } catch (std::system_error&) {
+  return std::atomic_load(&m_balances)->unmixable;
+}
+
+void WalletAdapter::prefetch() {
+  const QString fileName = Settings::instance().getWalletFile();
+  if (!fileName.endsWith(".wallet") || !QFile::exists(fileName)) {
+    return;
   }
-  return 0;
+
+  m_prefetchedFile = std::async(std::launch::async, [fileName]() {
+    StartupSpan span("wallet file prefetch");
+    const QFileInfo info(fileName);
+    PrefetchedFile prefetched {fileName, info.size(), info.lastModified(), std::string()};
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly)) {
+      prefetched.content.resize(static_cast<size_t>(prefetched.size));
+      if (file.read(&prefetched.content[0], prefetched.size) != prefetched.size) {
+        prefetched.content.clear();
+      }
+    }
+
+    return prefetched;
+  });
 }
 
 void WalletAdapter::open(const QString& _password) {
@@ -109,8 +299,7 @@ void WalletAdapter::open(const QString& _password) {
   Settings::instance().setEncrypted(!_password.isEmpty());
   Q_EMIT walletStateChangedSignal(tr("Opening wallet"));
 
-  m_wallet = NodeAdapter::instance().createWallet();
-  m_wallet->addObserver(this);
+  attachWallet();
 
   if (QFile::exists(Settings::instance().getWalletFile())) {  
     if (Settings::instance().getWalletFile().endsWith(".keys")) {
@@ -120,13 +309,23 @@ void WalletAdapter::open(const QString& _password) {
     }
 
     if (Settings::instance().getWalletFile().endsWith(".wallet")) {
-      if (openFile(Settings::instance().getWalletFile(), true)) {
+      if (openPrefetched(Settings::instance().getWalletFile())) {
+        try {
+          m_loadStartUs = StartupProfiler::instance().elapsedUs();
+          m_wallet->initAndLoad(m_prefetchedStream, _password.toStdString());
+        } catch (std::system_error&) {
+          m_loadStartUs = -1;
+          closePrefetched();
+          destroyWallet();
+        }
+      } else if (openFile(Settings::instance().getWalletFile(), true)) {
         try {
+          m_loadStartUs = StartupProfiler::instance().elapsedUs();
           m_wallet->initAndLoad(m_file, _password.toStdString());
         } catch (std::system_error&) {
+          m_loadStartUs = -1;
           closeFile();
-          delete m_wallet;
-          m_wallet = nullptr;
+          destroyWallet();
         }
       }
     }
@@ -163,8 +362,7 @@ void WalletAdapter::createWallet() {
   Q_ASSERT(m_wallet == nullptr);
   Settings::instance().setEncrypted(false);
   Q_EMIT walletStateChangedSignal(tr("Creating wallet"));
-  m_wallet = NodeAdapter::instance().createWallet();
-  m_wallet->addObserver(this);
+  attachWallet();
 
   try {
     m_wallet->initAndGenerateDeterministic("");
@@ -174,51 +372,86 @@ void WalletAdapter::createWallet() {
       return;
     }
   } catch (std::system_error&) {
-    delete m_wallet;
-    m_wallet = nullptr;
+    destroyWallet();
   }
 }
 
 void WalletAdapter::createNonDeterministic() {
-  m_wallet = NodeAdapter::instance().createWallet();
-  m_wallet->addObserver(this);
+  attachWallet();
   Settings::instance().setEncrypted(false);
   try {
     m_wallet->initAndGenerateNonDeterministic("");
   } catch (std::system_error&) {
-    delete m_wallet;
-    m_wallet = nullptr;
+    destroyWallet();
   }
 }
 
 void WalletAdapter::createWithKeys(const CryptoNote::AccountKeys& _keys) {
-  m_wallet = NodeAdapter::instance().createWallet();
-  m_wallet->addObserver(this);
+  attachWallet();
   Settings::instance().setEncrypted(false);
   Q_EMIT walletStateChangedSignal(tr("Importing keys"));
   m_wallet->initWithKeys(_keys, "");
 }
 
 void WalletAdapter::createWithKeys(const CryptoNote::AccountKeys& _keys, const quint32 _sync_heigth) {
-  m_wallet = NodeAdapter::instance().createWallet();
-  m_wallet->addObserver(this);
+  attachWallet();
   Settings::instance().setEncrypted(false);
   Q_EMIT walletStateChangedSignal(tr("Importing keys"));
   m_wallet->initWithKeys(_keys, "", _sync_heigth);
 }
 
 bool WalletAdapter::isOpen() const {
+  QReadLocker locker(&m_walletLock);
   return m_wallet != nullptr;
 }
 
+void WalletAdapter::attachWallet() {
+  CryptoNote::IWalletLegacy* wallet = NodeAdapter::instance().createWallet();
+  wallet->addObserver(this);
+  QWriteLocker locker(&m_walletLock);
+  m_wallet = wallet;
+}
+
+// The wallet is deleted outside the lock, its destructor waits for wallet threads that may still be reading through us
+void WalletAdapter::destroyWallet() {
+  CryptoNote::IWalletLegacy* wallet;
+  {
+    QWriteLocker locker(&m_walletLock);
+    wallet = m_wallet;
+    m_wallet = nullptr;
+  }
+
+  delete wallet;
+  std::atomic_store(&m_balances, std::shared_ptr<const BalanceSnapshot>(std::make_shared<BalanceSnapshot>()));
+}
+
+void WalletAdapter::publishBalances() {
+  std::shared_ptr<BalanceSnapshot> balances = std::make_shared<BalanceSnapshot>();
+  {
+    QReadLocker locker(&m_walletLock);
+    if (m_wallet == nullptr) {
+      return;
+    }
+
+    try {
+      balances->actual = m_wallet->actualBalance();
+      balances->pending = m_wallet->pendingBalance();
+      balances->unmixable = m_wallet->unmixableBalance();
+    } catch (std::system_error&) {
+      return;
+    }
+  }
+
+  std::atomic_store(&m_balances, std::shared_ptr<const BalanceSnapshot>(balances));
+}
+
 bool WalletAdapter::importLegacyWallet(const QString &_password) {
   QString fileName = Settings::instance().getWalletFile();
   Settings::instance().setEncrypted(!_password.isEmpty());
   try {
     fileName.replace(fileName.lastIndexOf(".keys"), 5, ".wallet");
     if (!openFile(fileName, false)) {
-      delete m_wallet;
-      m_wallet = nullptr;
+      destroyWallet();
       return false;
     }
 
@@ -236,23 +469,23 @@ bool WalletAdapter::importLegacyWallet(const QString &_password) {
     closeFile();
   }
 
-  delete m_wallet;
-  m_wallet = nullptr;
+  destroyWallet();
   return false;
 }
 
 void WalletAdapter::close() {
   Q_CHECK_PTR(m_wallet);
+  cancelReserveProof();
   save(true, true);
   lock();
   m_wallet->removeObserver(this);
   m_isSynchronized = false;
   m_newTransactionsNotificationTimer.stop();
   m_lastWalletTransactionId = std::numeric_limits<quint64>::max();
+  clearReservations();
   Q_EMIT walletCloseCompletedSignal();
   QCoreApplication::processEvents();
-  delete m_wallet;
-  m_wallet = nullptr;
+  destroyWallet();
   unlock();
 }
 
@@ -265,6 +498,7 @@ bool WalletAdapter::save(const QString& _file, bool _details, bool _cache) {
   if (openFile(_file, false)) {
     Q_EMIT walletStateChangedSignal(tr("Saving data"));
     try {
+      QReadLocker walletLocker(&m_walletLock);
       m_wallet->save(m_file, _details, _cache);
     } catch (std::system_error&) {
       closeFile();
@@ -302,14 +536,15 @@ void WalletAdapter::reset() {
   m_isSynchronized = false;
   m_newTransactionsNotificationTimer.stop();
   m_lastWalletTransactionId = std::numeric_limits<quint64>::max();
+  clearReservations();
   Q_EMIT walletCloseCompletedSignal();
   QCoreApplication::processEvents();
-  delete m_wallet;
-  m_wallet = nullptr;
+  destroyWallet();
   unlock();
 }
 
 quint64 WalletAdapter::getTransactionCount() const {
+  QReadLocker locker(&m_walletLock);
   Q_CHECK_PTR(m_wallet);
   try {
     return m_wallet->getTransactionCount();
@@ -320,6 +555,7 @@ quint64 WalletAdapter::getTransactionCount() const {
 }
 
 quint64 WalletAdapter::getTransferCount() const {
+  QReadLocker locker(&m_walletLock);
   Q_CHECK_PTR(m_wallet);
   try {
     return m_wallet->getTransferCount();
@@ -330,7 +566,11 @@ quint64 WalletAdapter::getTransferCount() const {
 }
 
 bool WalletAdapter::getTransaction(CryptoNote::TransactionId& _id, CryptoNote::WalletLegacyTransaction& _transaction) {
-  Q_CHECK_PTR(m_wallet);
+  QReadLocker locker(&m_walletLock);
+  if (m_wallet == nullptr) {
+    return false;
+  }
+
   try {
     return m_wallet->getTransaction(_id, _transaction);
   } catch (std::system_error&) {
@@ -340,7 +580,11 @@ bool WalletAdapter::getTransaction(CryptoNote::TransactionId& _id, CryptoNote::W
 }
 
 bool WalletAdapter::getTransfer(CryptoNote::TransferId& _id, CryptoNote::WalletLegacyTransfer& _transfer) {
-  Q_CHECK_PTR(m_wallet);
+  QReadLocker locker(&m_walletLock);
+  if (m_wallet == nullptr) {
+    return false;
+  }
+
   try {
     return m_wallet->getTransfer(_id, _transfer);
   } catch (std::system_error&) {
@@ -350,6 +594,7 @@ bool WalletAdapter::getTransfer(CryptoNote::TransferId& _id, CryptoNote::WalletL
 }
 
 bool WalletAdapter::getAccountKeys(CryptoNote::AccountKeys& _keys) {
+  QReadLocker locker(&m_walletLock);
   Q_CHECK_PTR(m_wallet);
   try {
     m_wallet->getAccountKeys(_keys);
@@ -361,6 +606,7 @@ bool WalletAdapter::getAccountKeys(CryptoNote::AccountKeys& _keys) {
 }
 
 Crypto::SecretKey WalletAdapter::getTxKey(Crypto::Hash& txid) {
+  QReadLocker locker(&m_walletLock);
   Q_CHECK_PTR(m_wallet);
   try {
     return m_wallet->getTxKey(txid);
@@ -371,6 +617,7 @@ Crypto::SecretKey WalletAdapter::getTxKey(Crypto::Hash& txid) {
 }
 
 std::vector<CryptoNote::TransactionOutputInformation> WalletAdapter::getOutputs() {
+  QReadLocker locker(&m_walletLock);
   Q_CHECK_PTR(m_wallet);
   try {
     return m_wallet->getOutputs();
@@ -380,6 +627,7 @@ std::vector<CryptoNote::TransactionOutputInformation> WalletAdapter::getOutputs(
 }
 
 std::vector<CryptoNote::TransactionOutputInformation> WalletAdapter::getLockedOutputs() {
+  QReadLocker locker(&m_walletLock);
   Q_CHECK_PTR(m_wallet);
   try {
     return m_wallet->getLockedOutputs();
@@ -389,15 +637,17 @@ std::vector<CryptoNote::TransactionOutputInformation> WalletAdapter::getLockedOu
 }
 
 std::vector<CryptoNote::TransactionOutputInformation> WalletAdapter::getUnlockedOutputs() {
+  QReadLocker locker(&m_walletLock);
   Q_CHECK_PTR(m_wallet);
   try {
-    return m_wallet->getLockedOutputs();
+    return m_wallet->getUnlockedOutputs();
   } catch (std::system_error&) {
   }
   return {};
 }
 
 std::vector<CryptoNote::TransactionSpentOutputInformation> WalletAdapter::getSpentOutputs() {
+  QReadLocker locker(&m_walletLock);
   Q_CHECK_PTR(m_wallet);
   try {
     return m_wallet->getSpentOutputs();
@@ -406,39 +656,72 @@ std::vector<CryptoNote::TransactionSpentOutputInformation> WalletAdapter::getSpe
   return {};
 }
 
-void WalletAdapter::sendTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, quint64 _fee, const QString& _payment_id, quint64 _mixin) {
+std::vector<CryptoNote::TransactionOutputInformation> WalletAdapter::getSpendableOutputs() {
+  std::vector<CryptoNote::TransactionOutputInformation> outputs = getUnlockedOutputs();
+  QMutexLocker locker(&m_reservationsMutex);
+  outputs.erase(std::remove_if(outputs.begin(), outputs.end(), [this](const CryptoNote::TransactionOutputInformation& _output) {
+    return m_reservedOutputs.contains(outputKey(_output));
+  }), outputs.end());
+  return outputs;
+}
+
+bool WalletAdapter::sendTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, quint64 _fee, const QString& _payment_id, quint64 _mixin) {
   Q_CHECK_PTR(m_wallet);
-  try {
-    lock();
-    Q_EMIT walletStateChangedSignal(tr("Sending transaction"));
-    m_wallet->sendTransaction(_transfers, _fee, NodeAdapter::instance().convertPaymentId(_payment_id), _mixin, 0);
-  } catch (std::system_error&) {
-    unlock();
+  quint64 reservationId = newReservationId();
+  std::list<CryptoNote::TransactionOutputInformation> selectedOuts;
+  if (!selectAndReserveOutputs(reservationId, _transfers, _fee, _mixin, selectedOuts)) {
+    return false;
   }
+
+  return submitTransaction(reservationId, false, _transfers, selectedOuts, _fee, _payment_id, _mixin);
 }
 
 // Prerequisites: deduce fee from transfers, selected outs amount and tansfers amount + fee should match
-void WalletAdapter::sendTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, const std::list<CryptoNote::TransactionOutputInformation>& _selectedOuts, quint64 _fee, const QString& _payment_id, quint64 _mixin) {
+bool WalletAdapter::sendTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, const std::list<CryptoNote::TransactionOutputInformation>& _selectedOuts, quint64 _fee, const QString& _payment_id, quint64 _mixin) {
   Q_CHECK_PTR(m_wallet);
 
   // can validate here that transfer amount + fee = selected outs amounts
 
+  quint64 reservationId = newReservationId();
+  if (!reserveOutputs(reservationId, _selectedOuts)) {
+    return false;
+  }
+
+  return submitTransaction(reservationId, false, _transfers, _selectedOuts, _fee, _payment_id, _mixin);
+}
+
+// m_mutex only guards the call into the wallet, so saves and further sends don't wait for the relay to complete
+bool WalletAdapter::submitTransaction(quint64 _reservationId, bool _isJob, const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers,
+  const std::list<CryptoNote::TransactionOutputInformation>& _selectedOuts, quint64 _fee, const QString& _payment_id, quint64 _mixin) {
+  CryptoNote::TransactionId transactionId;
   try {
     lock();
+    QReadLocker walletLocker(&m_walletLock);
     Q_EMIT walletStateChangedSignal(tr("Sending transaction"));
-    m_wallet->sendTransaction(_transfers, _selectedOuts, _fee, NodeAdapter::instance().convertPaymentId(_payment_id), _mixin, 0);
+    transactionId = _selectedOuts.empty() ?
+      m_wallet->sendTransaction(_transfers, _fee, NodeAdapter::instance().convertPaymentId(_payment_id), _mixin, 0) :
+      m_wallet->sendTransaction(_transfers, _selectedOuts, _fee, NodeAdapter::instance().convertPaymentId(_payment_id), _mixin, 0);
+    unlock();
   } catch (std::system_error&) {
     unlock();
+    releaseOutputs(_reservationId);
+    return false;
   }
+
+  trackSentTransaction(transactionId, {_reservationId, _isJob});
+  return true;
 }
 
 QString WalletAdapter::prepareRawTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, quint64 _fee, const QString& _payment_id, quint64 _mixin) {
   Q_CHECK_PTR(m_wallet);
   try {
     lock();
+    QReadLocker walletLocker(&m_walletLock);
     Q_EMIT walletStateChangedSignal(tr("Preparing transaction"));
     CryptoNote::TransactionId transactionId;
-    return QString::fromStdString(m_wallet->prepareRawTransaction(transactionId, _transfers, _fee, NodeAdapter::instance().convertPaymentId(_payment_id), _mixin, 0));
+    QString rawTransaction = QString::fromStdString(m_wallet->prepareRawTransaction(transactionId, _transfers, _fee, NodeAdapter::instance().convertPaymentId(_payment_id), _mixin, 0));
+    unlock();
+    return rawTransaction;
   } catch (std::system_error&) {
     unlock();
   }
@@ -449,16 +732,213 @@ QString WalletAdapter::prepareRawTransaction(const std::vector<CryptoNote::Walle
   Q_CHECK_PTR(m_wallet);
   try {
     lock();
+    QReadLocker walletLocker(&m_walletLock);
     Q_EMIT walletStateChangedSignal(tr("Preparing transaction"));
     CryptoNote::TransactionId transactionId;
-    return QString::fromStdString(m_wallet->prepareRawTransaction(transactionId, _transfers, _selectedOuts, _fee, NodeAdapter::instance().convertPaymentId(_payment_id), _mixin, 0));
+    QString rawTransaction = QString::fromStdString(m_wallet->prepareRawTransaction(transactionId, _transfers, _selectedOuts, _fee, NodeAdapter::instance().convertPaymentId(_payment_id), _mixin, 0));
+    unlock();
+    return rawTransaction;
   } catch (std::system_error&) {
     unlock();
   }
   return QString();
 }
 
+quint64 WalletAdapter::sendTransactionAsync(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, const std::list<CryptoNote::TransactionOutputInformation>& _selectedOuts, quint64 _fee, const QString& _payment_id, quint64 _mixin) {
+  std::shared_ptr<TransactionJob> job(new TransactionJob {true, _transfers, _selectedOuts, _fee, _payment_id, _mixin, {JOB_PHASE_QUEUED}});
+  return enqueueTransactionJob(job);
+}
+
+quint64 WalletAdapter::prepareRawTransactionAsync(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, const std::list<CryptoNote::TransactionOutputInformation>& _selectedOuts, quint64 _fee, const QString& _payment_id, quint64 _mixin) {
+  std::shared_ptr<TransactionJob> job(new TransactionJob {false, _transfers, _selectedOuts, _fee, _payment_id, _mixin, {JOB_PHASE_QUEUED}});
+  return enqueueTransactionJob(job);
+}
+
+quint64 WalletAdapter::enqueueTransactionJob(std::shared_ptr<TransactionJob> _job) {
+  quint64 jobId;
+  {
+    QMutexLocker locker(&m_jobsMutex);
+    jobId = ++m_lastJobId;
+    m_jobs.insert(jobId, _job);
+  }
+
+  if (!m_transactionBuilderThread.isRunning()) {
+    m_transactionBuilderThread.start();
+  }
+
+  Q_EMIT transactionJobPhaseChangedSignal(jobId, JOB_PHASE_QUEUED);
+  Q_EMIT buildTransactionSignal(jobId);
+  return jobId;
+}
+
+std::shared_ptr<WalletAdapter::TransactionJob> WalletAdapter::takeTransactionJob(quint64 _jobId) {
+  QMutexLocker locker(&m_jobsMutex);
+  return m_jobs.take(_jobId);
+}
+
+bool WalletAdapter::cancelTransactionJob(quint64 _jobId) {
+  std::shared_ptr<TransactionJob> job;
+  {
+    QMutexLocker locker(&m_jobsMutex);
+    job = m_jobs.value(_jobId);
+  }
+
+  if (!job) {
+    return false;
+  }
+
+  // Sends can only be stopped before the wallet gets them, raw transactions until they are handed out
+  int expected = JOB_PHASE_QUEUED;
+  if (!job->phase.compare_exchange_strong(expected, JOB_PHASE_CANCELLED)) {
+    expected = JOB_PHASE_BUILDING;
+    if (job->relay || !job->phase.compare_exchange_strong(expected, JOB_PHASE_CANCELLED)) {
+      return false;
+    }
+  }
+
+  takeTransactionJob(_jobId);
+  Q_EMIT transactionJobPhaseChangedSignal(_jobId, JOB_PHASE_CANCELLED);
+  if (job->relay) {
+    failTransactionJob(_jobId, CryptoNote::error::OPERATION_CANCELLED, walletErrorMessage(CryptoNote::error::OPERATION_CANCELLED));
+  }
+
+  return true;
+}
+
+// Sends that end before the wallet core gets them report as the ones it completes, without a transaction
+void WalletAdapter::failTransactionJob(quint64 _jobId, int _error, const QString& _errorText) {
+  Q_EMIT transactionJobCompletedSignal(_jobId, CryptoNote::WALLET_LEGACY_INVALID_TRANSACTION_ID, _error, _errorText);
+  Q_EMIT walletSendTransactionCompletedSignal(CryptoNote::WALLET_LEGACY_INVALID_TRANSACTION_ID, _error, _errorText);
+}
+
+quint64 WalletAdapter::newReservationId() {
+  QMutexLocker locker(&m_jobsMutex);
+  return ++m_lastJobId;
+}
+
+bool WalletAdapter::reserveOutputs(quint64 _reservationId, const std::list<CryptoNote::TransactionOutputInformation>& _outputs) {
+  QList<QByteArray> keys;
+  for (const CryptoNote::TransactionOutputInformation& output : _outputs) {
+    keys.append(outputKey(output));
+  }
+
+  QMutexLocker locker(&m_reservationsMutex);
+  for (const QByteArray& key : keys) {
+    if (m_reservedOutputs.contains(key)) {
+      return false;
+    }
+  }
+
+  for (const QByteArray& key : keys) {
+    m_reservedOutputs.insert(key, _reservationId);
+  }
+
+  m_reservations[_reservationId].append(keys);
+  return true;
+}
+
+// Picks unreserved unlocked outputs in random order, as the wallet core does, and reserves them in the same step.
+// Dust can't be mixed, it's only taken without mixin.
+bool WalletAdapter::selectAndReserveOutputs(quint64 _reservationId, const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, quint64 _fee,
+  quint64 _mixin, std::list<CryptoNote::TransactionOutputInformation>& _outputs) {
+  quint64 needed = _fee;
+  for (const CryptoNote::WalletLegacyTransfer& transfer : _transfers) {
+    needed += static_cast<quint64>(transfer.amount);
+  }
+
+  std::vector<CryptoNote::TransactionOutputInformation> candidates = getUnlockedOutputs();
+  const quint64 dustThreshold = CurrencyAdapter::instance().getCurrency().defaultDustThreshold();
+  std::shuffle(candidates.begin(), candidates.end(), std::mt19937(std::random_device()()));
+
+  QMutexLocker locker(&m_reservationsMutex);
+  _outputs.clear();
+  QList<QByteArray> keys;
+  quint64 selected = 0;
+  for (const CryptoNote::TransactionOutputInformation& output : candidates) {
+    if (selected >= needed) {
+      break;
+    }
+
+    const QByteArray key = outputKey(output);
+    if ((_mixin > 0 && output.amount < dustThreshold) || m_reservedOutputs.contains(key)) {
+      continue;
+    }
+
+    _outputs.push_back(output);
+    keys.append(key);
+    selected += output.amount;
+  }
+
+  if (selected < needed) {
+    _outputs.clear();
+    return false;
+  }
+
+  for (const QByteArray& key : keys) {
+    m_reservedOutputs.insert(key, _reservationId);
+  }
+
+  m_reservations[_reservationId].append(keys);
+  return true;
+}
+
+void WalletAdapter::releaseOutputs(quint64 _reservationId) {
+  QMutexLocker locker(&m_reservationsMutex);
+  for (const QByteArray& key : m_reservations.take(_reservationId)) {
+    m_reservedOutputs.remove(key);
+  }
+}
+
+bool WalletAdapter::isOutputReserved(const CryptoNote::TransactionOutputInformation& _output) {
+  QMutexLocker locker(&m_reservationsMutex);
+  return m_reservedOutputs.contains(outputKey(_output));
+}
+
+void WalletAdapter::clearReservations() {
+  QMutexLocker locker(&m_reservationsMutex);
+  m_reservedOutputs.clear();
+  m_reservations.clear();
+  m_sentTransactions.clear();
+  m_relayedFusions.clear();
+  m_earlyCompletions.clear();
+}
+
+// The wallet reports completion from its own threads, possibly before sendTransaction returned the id,
+// whichever of the two comes second finishes the send
+void WalletAdapter::trackSentTransaction(CryptoNote::TransactionId _transactionId, const SentTransaction& _sent) {
+  int error = 0;
+  {
+    QMutexLocker locker(&m_reservationsMutex);
+    if (!m_earlyCompletions.contains(_transactionId)) {
+      m_sentTransactions.insert(_transactionId, _sent);
+      return;
+    }
+
+    error = m_earlyCompletions.take(_transactionId);
+  }
+
+  finishSentTransaction(_transactionId, _sent, error);
+}
+
+// A relayed transaction keeps its inputs reserved until transactionUpdated() sees it mined or failed
+void WalletAdapter::finishSentTransaction(CryptoNote::TransactionId _transactionId, const SentTransaction& _sent, int _error) {
+  if (_error) {
+    releaseOutputs(_sent.reservationId);
+    QMutexLocker locker(&m_reservationsMutex);
+    m_sentTransactions.remove(_transactionId);
+  } else {
+    QMutexLocker locker(&m_reservationsMutex);
+    m_sentTransactions.insert(_transactionId, {_sent.reservationId, false});
+  }
+
+  if (_sent.isJob) {
+    Q_EMIT transactionJobCompletedSignal(_sent.reservationId, _transactionId, _error, walletErrorMessage(_error));
+    Q_EMIT transactionJobPhaseChangedSignal(_sent.reservationId, JOB_PHASE_COMPLETED);
+  }
+}
+
 quint64 WalletAdapter::estimateFusion(quint64 _threshold) {
+  QReadLocker locker(&m_walletLock);
   Q_CHECK_PTR(m_wallet);
   try {
     return m_wallet->estimateFusion(_threshold);
@@ -468,31 +948,77 @@ quint64 WalletAdapter::estimateFusion(quint64 _threshold) {
 }
 
 std::list<CryptoNote::TransactionOutputInformation> WalletAdapter::getFusionTransfersToSend(quint64 _threshold, size_t _min_input_count, size_t _max_input_count) {
+  QReadLocker locker(&m_walletLock);
   Q_CHECK_PTR(m_wallet);
   try {
-    return m_wallet->selectFusionTransfersToSend(_threshold, _min_input_count, _max_input_count);
+    std::list<CryptoNote::TransactionOutputInformation> inputs = m_wallet->selectFusionTransfersToSend(_threshold, _min_input_count, _max_input_count);
+    inputs.remove_if([this](const CryptoNote::TransactionOutputInformation& _input) { return isOutputReserved(_input); });
+    return inputs;
   } catch (std::system_error&) {
   }
   return {};
 }
 
+// Fusions are built and signed here instead of in the wallet core, see FusionTransactionBuilder. The wallet
+// core records a fusion once it sees it in the pool, until then its inputs stay reserved under its hash.
 void WalletAdapter::sendFusionTransaction(const std::list<CryptoNote::TransactionOutputInformation>& _fusion_inputs, quint64 _fee, const QString& _extra, quint64 _mixin) {
   Q_CHECK_PTR(m_wallet);
-  try {
-    lock();
-    Q_EMIT walletStateChangedSignal(tr("Optimizing wallet"));
-    m_wallet->sendFusionTransaction(_fusion_inputs, _fee, _extra.toStdString(), _mixin, 0);
-  } catch (std::system_error&) {
-    unlock();
+  quint64 reservationId = newReservationId();
+  if (!reserveOutputs(reservationId, _fusion_inputs)) {
+    return;
+  }
+
+  Q_EMIT walletStateChangedSignal(tr("Optimizing wallet"));
+  const std::vector<CryptoNote::TransactionOutputInformation> inputs(_fusion_inputs.begin(), _fusion_inputs.end());
+  std::vector<uint64_t> amounts;
+  for (const CryptoNote::TransactionOutputInformation& input : inputs) {
+    amounts.push_back(input.amount);
+  }
+
+  // One random output more than the mixin, the real output may be among them. Without mixin every ring is the input alone.
+  std::vector<RandomOutsForAmount> decoys;
+  if (_mixin == 0) {
+    for (uint64_t amount : amounts) {
+      RandomOutsForAmount noDecoys;
+      noDecoys.amount = amount;
+      decoys.push_back(noDecoys);
+    }
+  }
+
+  CryptoNote::AccountKeys keys;
+  CryptoNote::Transaction transaction;
+  std::string error;
+  if (!getAccountKeys(keys) ||
+      (_mixin > 0 && NodeAdapter::instance().getRandomOuts(std::move(amounts), static_cast<uint16_t>(_mixin + 1), decoys)) ||
+      !FusionTransactionBuilder(CurrencyAdapter::instance().getCurrency(), keys).build(inputs, decoys, _mixin, _fee, _extra.toStdString(),
+        transaction, error)) {
+    releaseOutputs(reservationId);
+    return;
+  }
+
+  const Crypto::Hash hash = CryptoNote::getObjectHash(transaction);
+  const QByteArray hashKey(reinterpret_cast<const char*>(&hash), sizeof(hash));
+  {
+    QMutexLocker locker(&m_reservationsMutex);
+    m_relayedFusions.insert(hashKey, reservationId);
+  }
+
+  if (NodeAdapter::instance().relayTransaction(transaction)) {
+    QMutexLocker locker(&m_reservationsMutex);
+    m_relayedFusions.remove(hashKey);
+    locker.unlock();
+    releaseOutputs(reservationId);
   }
 }
 
 bool WalletAdapter::isFusionTransaction(const CryptoNote::WalletLegacyTransaction& walletTx) const {
+  QReadLocker locker(&m_walletLock);
   Q_CHECK_PTR(m_wallet);
   return m_wallet->isFusionTransaction(walletTx);
 }
 
 bool WalletAdapter::changePassword(const QString& _oldPassword, const QString& _newPassword) {
+  QReadLocker locker(&m_walletLock);
   Q_CHECK_PTR(m_wallet);
   try {
     if (m_wallet->changePassword(_oldPassword.toStdString(), _newPassword.toStdString()).value() == CryptoNote::error::WRONG_PASSWORD) {
@@ -502,6 +1028,7 @@ bool WalletAdapter::changePassword(const QString& _oldPassword, const QString& _
     return false;
   }
 
+  locker.unlock();
   Settings::instance().setEncrypted(!_newPassword.isEmpty());
 
   QString source = Settings::instance().getWalletFile();
@@ -526,8 +1053,17 @@ void WalletAdapter::setWalletFile(const QString& _path) {
 }
 
 void WalletAdapter::initCompleted(std::error_code _error) {
+  // Decryption and deserialization, which the prefetch can't move ahead of the node
+  const qint64 loadStartUs = m_loadStartUs.exchange(-1);
+  if (loadStartUs >= 0) {
+    StartupProfiler::instance().addSpan(m_isLoadingPrefetched ? "wallet load from prefetch" : "wallet load from file", loadStartUs,
+      StartupProfiler::instance().elapsedUs() - loadStartUs);
+  }
+
   if (m_file.is_open()) {
     closeFile();
+  } else if (m_isLoadingPrefetched) {
+    closePrefetched();
   }
 
   Q_EMIT walletInitCompletedSignal(_error.value(), QString::fromStdString(_error.message()));
@@ -536,10 +1072,11 @@ void WalletAdapter::initCompleted(std::error_code _error) {
 void WalletAdapter::onWalletInitCompleted(int _error, const QString& _errorText) {
   switch(_error) {
   case 0: {
-    Q_EMIT walletActualBalanceUpdatedSignal(m_wallet->actualBalance());
-    Q_EMIT walletPendingBalanceUpdatedSignal(m_wallet->pendingBalance());
-    Q_EMIT walletUnmixableBalanceUpdatedSignal(m_wallet->unmixableBalance());
-    Q_EMIT updateWalletAddressSignal(QString::fromStdString(m_wallet->getAddress()));
+    publishBalances();
+    Q_EMIT walletActualBalanceUpdatedSignal(getActualBalance());
+    Q_EMIT walletPendingBalanceUpdatedSignal(getPendingBalance());
+    Q_EMIT walletUnmixableBalanceUpdatedSignal(getUnmixableBalance());
+    Q_EMIT updateWalletAddressSignal(getAddress());
     Q_EMIT reloadWalletTransactionsSignal();
     Q_EMIT walletStateChangedSignal(tr("Ready"));
     QTimer::singleShot(5000, this, SLOT(updateBlockStatusText()));
@@ -552,12 +1089,10 @@ void WalletAdapter::onWalletInitCompleted(int _error, const QString& _errorText)
   case CryptoNote::error::WRONG_PASSWORD:
     Q_EMIT openWalletWithPasswordSignal(Settings::instance().isEncrypted());
     Settings::instance().setEncrypted(true);
-    delete m_wallet;
-    m_wallet = nullptr;
+    destroyWallet();
     break;
   default: {
-    delete m_wallet;
-    m_wallet = nullptr;
+    destroyWallet();
     break;
   }
   }
@@ -645,18 +1180,31 @@ void WalletAdapter::synchronizationCompleted(std::error_code _error) {
 }
 
 void WalletAdapter::actualBalanceUpdated(uint64_t _actual_balance) {
+  publishBalances();
   Q_EMIT walletActualBalanceUpdatedSignal(_actual_balance);
 }
 
 void WalletAdapter::pendingBalanceUpdated(uint64_t _pending_balance) {
+  publishBalances();
   Q_EMIT walletPendingBalanceUpdatedSignal(_pending_balance);
 }
 
 void WalletAdapter::unmixableBalanceUpdated(uint64_t _dust_balance) {
+  publishBalances();
   Q_EMIT walletUnmixableBalanceUpdatedSignal(_dust_balance);
 }
 
 void WalletAdapter::externalTransactionCreated(CryptoNote::TransactionId _transactionId) {
+  CryptoNote::WalletLegacyTransaction transaction;
+  if (getTransaction(_transactionId, transaction)) {
+    // A fusion relayed by sendFusionTransaction(), from now on its inputs are released as for any sent transaction
+    QMutexLocker locker(&m_reservationsMutex);
+    const QByteArray hashKey(reinterpret_cast<const char*>(&transaction.hash), sizeof(transaction.hash));
+    if (m_relayedFusions.contains(hashKey)) {
+      m_sentTransactions.insert(_transactionId, {m_relayedFusions.take(hashKey), false});
+    }
+  }
+
   if (!m_isSynchronized) {
     m_lastWalletTransactionId = _transactionId;
   } else {
@@ -665,7 +1213,22 @@ void WalletAdapter::externalTransactionCreated(CryptoNote::TransactionId _transa
 }
 
 void WalletAdapter::sendTransactionCompleted(CryptoNote::TransactionId _transaction_id, std::error_code _error) {
-  unlock();
+  SentTransaction sent;
+  bool isTracked;
+  {
+    QMutexLocker locker(&m_reservationsMutex);
+    isTracked = m_sentTransactions.contains(_transaction_id);
+    if (isTracked) {
+      sent = m_sentTransactions.value(_transaction_id);
+    } else {
+      m_earlyCompletions.insert(_transaction_id, _error.value());
+    }
+  }
+
+  if (isTracked) {
+    finishSentTransaction(_transaction_id, sent, _error.value());
+  }
+
   Q_EMIT walletSendTransactionCompletedSignal(_transaction_id, _error.value(), walletErrorMessage(_error.value()));
   Q_EMIT updateBlockStatusTextWithDelaySignal();
 }
@@ -725,6 +1288,23 @@ void WalletAdapter::onWalletSendTransactionCompleted(CryptoNote::TransactionId _
 }
 
 void WalletAdapter::transactionUpdated(CryptoNote::TransactionId _transactionId) {
+  SentTransaction sent;
+  bool isTracked;
+  {
+    QMutexLocker locker(&m_reservationsMutex);
+    isTracked = m_sentTransactions.contains(_transactionId);
+    sent = m_sentTransactions.value(_transactionId);
+  }
+
+  CryptoNote::WalletLegacyTransaction transaction;
+  if (isTracked && getTransaction(_transactionId, transaction) &&
+      (transaction.blockHeight != CryptoNote::WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT ||
+       (transaction.state != CryptoNote::WalletLegacyTransactionState::Active && transaction.state != CryptoNote::WalletLegacyTransactionState::Sending))) {
+    releaseOutputs(sent.reservationId);
+    QMutexLocker locker(&m_reservationsMutex);
+    m_sentTransactions.remove(_transactionId);
+  }
+
   Q_EMIT walletTransactionUpdatedSignal(_transactionId);
 }
 
@@ -759,6 +1339,38 @@ void WalletAdapter::closeFile() {
   unlock();
 }
 
+// Uses the prefetched contents once, and only if the file hasn't changed since it was read
+bool WalletAdapter::openPrefetched(const QString& _file) {
+  if (!m_prefetchedFile.valid()) {
+    return false;
+  }
+
+  PrefetchedFile prefetched;
+  {
+    // Whatever of the read the node start didn't cover
+    StartupSpan span("wallet prefetch wait");
+    prefetched = m_prefetchedFile.get();
+  }
+
+  const QFileInfo info(_file);
+  if (prefetched.fileName != _file || prefetched.content.empty() || info.size() != prefetched.size ||
+      info.lastModified() != prefetched.modified) {
+    return false;
+  }
+
+  lock();
+  m_prefetchedStream.clear();
+  m_prefetchedStream.str(prefetched.content);
+  m_isLoadingPrefetched = true;
+  return true;
+}
+
+void WalletAdapter::closePrefetched() {
+  m_prefetchedStream.str(std::string());
+  m_isLoadingPrefetched = false;
+  unlock();
+}
+
 void WalletAdapter::notifyAboutLastTransaction() {
   if (m_lastWalletTransactionId != std::numeric_limits<quint64>::max()) {
     Q_EMIT walletTransactionCreatedSignal(m_lastWalletTransactionId);
@@ -773,7 +1385,7 @@ void WalletAdapter::renameFile(const QString& _oldName, const QString& _newName)
 }
 
 void WalletAdapter::updateBlockStatusText() {
-  if (m_wallet == nullptr) {
+  if (!isOpen()) {
     return;
   }
 
@@ -844,37 +1456,113 @@ CryptoNote::AccountKeys WalletAdapter::getKeysFromMnemonicSeed(QString& _seed) c
 }
 
 QString WalletAdapter::getTxProof(Crypto::Hash& _txid, CryptoNote::AccountPublicAddress& _address, Crypto::SecretKey& _tx_key) {
+  QString proof;
+  if (!getTxProof(_txid, _address, _tx_key, proof)) {
+    QMessageBox::critical(nullptr, tr("Failed to get the transaction proof"), tr("Failed to get the transaction proof."), QMessageBox::Ok);
+    return QString();
+  }
+
+  return proof;
+}
+
+bool WalletAdapter::getTxProof(Crypto::Hash& _txid, CryptoNote::AccountPublicAddress& _address, Crypto::SecretKey& _tx_key, QString& _proof) {
+  QReadLocker locker(&m_walletLock);
   Q_CHECK_PTR(m_wallet);
   std::string sig_str;
   try {
     m_wallet->getTxProof(_txid, _address, _tx_key, sig_str);
   } catch (std::system_error&) {
-    QMessageBox::critical(nullptr, tr("Failed to get the transaction proof"), tr("Failed to get the transaction proof."), QMessageBox::Ok);
-    return QString();
+    return false;
   }
-  return QString::fromStdString(sig_str);
+
+  _proof = QString::fromStdString(sig_str);
+  return true;
 }
 
-QString WalletAdapter::getReserveProof(const quint64 &_reserve, const QString &_message) {
+quint64 WalletAdapter::generateReserveProofAsync(quint64 _reserve, const QString& _message, const QString& _file, QString& _error) {
   Q_CHECK_PTR(m_wallet);
-  std::string sig_str;
-  if(Settings::instance().isTrackingMode()) {
-    QMessageBox::critical(nullptr, tr("Failed to get the reserve proof"), tr("This is tracking wallet. The reserve proof can be generated only by a full wallet."), QMessageBox::Ok);
-    return QString();
+  if (Settings::instance().isTrackingMode()) {
+    _error = tr("This is tracking wallet. The reserve proof can be generated only by a full wallet.");
+    return 0;
   }
-  try {
-    uint64_t amount = 0;
-    if (_reserve == 0) {
-      amount = m_wallet->actualBalance();
+
+  CryptoNote::AccountKeys keys;
+  if (!getAccountKeys(keys)) {
+    _error = tr("Failed to get the reserve proof.");
+    return 0;
+  }
+
+  std::vector<CryptoNote::TransactionOutputInformation> outputs = ReserveProofGenerator::selectOutputs(getUnlockedOutputs(),
+    _reserve == 0 ? getActualBalance() : _reserve);
+  if (outputs.empty()) {
+    _error = tr("Not enough unlocked balance for the reserve proof.");
+    return 0;
+  }
+
+  // What the proof is checked against once written
+  std::vector<CryptoNote::TransactionOutputInformation> walletOutputs = getOutputs();
+  std::vector<CryptoNote::TransactionSpentOutputInformation> spentOutputs = getSpentOutputs();
+
+  cancelReserveProof();
+  const std::shared_ptr<std::atomic<bool>> cancel = std::make_shared<std::atomic<bool>>(false);
+  m_reserveProofCancel = cancel;
+  const quint64 proofId = ++m_lastReserveProofId;
+  const std::string message = _message.toStdString();
+  m_reserveProofPool.start(new FunctionRunnable([this, proofId, cancel, keys, outputs, walletOutputs, spentOutputs, message, _file]() {
+    QSaveFile file(_file);
+    if (!file.open(QIODevice::WriteOnly)) {
+      Q_EMIT reserveProofCompletedSignal(proofId, true, *cancel ? QString() : file.errorString());
+      return;
+    }
+
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    // Generation takes the first half of the progress, verification the second
+    const ReserveProofGenerator generator(keys);
+    const bool isGenerated = generator.generate(outputs, message, file, [this, proofId](uint64_t _done, uint64_t _total) {
+      Q_EMIT reserveProofProgressSignal(proofId, _done, _total * 2);
+    }, *cancel);
+
+    // An uncommitted file is discarded, a cancelled proof leaves nothing behind
+    if (*cancel) {
+      Q_EMIT reserveProofCompletedSignal(proofId, true, QString());
+      return;
+    }
+
+    if (!isGenerated || !file.commit()) {
+      Q_EMIT reserveProofCompletedSignal(proofId, true, tr("Failed to get the reserve proof."));
+      return;
+    }
+
+    QFile proof(_file);
+    ReserveProofVerifier::Result result {ReserveProofVerifier::Status::INVALID, 0, 0, 0, std::string()};
+    const bool isVerified = proof.open(QIODevice::ReadOnly) && verifyOwnReserveProof(proof, keys.address, message, walletOutputs,
+      spentOutputs, [this, proofId](uint64_t _done, uint64_t _total) {
+        Q_EMIT reserveProofProgressSignal(proofId, _total + _done, _total * 2);
+      }, *cancel, result);
+    proof.close();
+    // Checked after the last write, so the caller may remove the file right after it cancels
+    const bool isCancelled = *cancel;
+    if (!isVerified || isCancelled) {
+      proof.remove();
+    }
+
+    if (isCancelled) {
+      Q_EMIT reserveProofCompletedSignal(proofId, true, QString());
+    } else if (!isVerified) {
+      Q_EMIT reserveProofCompletedSignal(proofId, true, tr("The reserve proof failed its verification: %1").arg(QString::fromStdString(result.error)));
     } else {
-      amount = _reserve;
+      Q_EMIT reserveProofCompletedSignal(proofId, false, QString());
     }
-    sig_str = m_wallet->getReserveProof(amount, (!_message.isEmpty() ? _message.toStdString() : ""));
-  } catch (std::system_error&) {
-    QMessageBox::critical(nullptr, tr("Failed to get the reserve proof"), tr("Failed to get the reserve proof."), QMessageBox::Ok);
-    return QString();
+  }));
+
+  return proofId;
+}
+
+void WalletAdapter::cancelReserveProof() {
+  if (m_reserveProofCancel) {
+    *m_reserveProofCancel = true;
+    m_reserveProofCancel.reset();
   }
-  return QString::fromStdString(sig_str);
 }
 
 QString WalletAdapter::signMessage(const QString &data) {
@@ -884,17 +1572,20 @@ QString WalletAdapter::signMessage(const QString &data) {
     return QString();
   }
 
+  QReadLocker locker(&m_walletLock);
   std::string sig_str = m_wallet->sign_message(data.toStdString());
   return QString::fromUtf8(sig_str.data(), sig_str.size());
 }
 
 bool WalletAdapter::verifyMessage(const QString &data, const CryptoNote::AccountPublicAddress &address, const QString &signature) {
+  QReadLocker locker(&m_walletLock);
   Q_CHECK_PTR(m_wallet);
 
   return m_wallet->verify_message(data.toStdString(), address, signature.toStdString());
 }
 
 size_t WalletAdapter::getUnlockedOutputsCount() {
+  QReadLocker locker(&m_walletLock);
   Q_CHECK_PTR(m_wallet);
   try {
     return m_wallet->getUnlockedOutputsCount();
@@ -904,3 +1595,5 @@ size_t WalletAdapter::getUnlockedOutputsCount() {
 }
 
 }
+
+#include "WalletAdapter.moc"
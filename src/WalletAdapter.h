@@ -6,30 +6,51 @@
 
 #pragma once
 
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
 #include <QMutex>
 #include <QObject>
+#include <QReadWriteLock>
+#include <QThread>
+#include <QThreadPool>
 #include <QTime>
 #include <QTimer>
 #include <QPushButton>
 
 #include <list>
+#include <memory>
 #include <vector>
 #include <atomic>
 #include <fstream>
+#include <future>
+#include <sstream>
+#include <string>
 
 #include <IWalletLegacy.h>
 
 namespace WalletGui {
 
 class ITransfersContainer;
+class TransactionBuilder;
 
 class WalletAdapter : public QObject, public CryptoNote::IWalletLegacyObserver {
   Q_OBJECT
   Q_DISABLE_COPY(WalletAdapter)
 
 public:
+  enum TransactionJobPhase {
+    JOB_PHASE_QUEUED = 0, JOB_PHASE_BUILDING, JOB_PHASE_RELAYING, JOB_PHASE_COMPLETED, JOB_PHASE_CANCELLED
+  };
+
   static WalletAdapter& instance();
 
+  // Reads the wallet file in the background while the node starts, open() then loads it from memory.
+  // Only the read overlaps the node: the wallet core decrypts and deserializes the file in initAndLoad(),
+  // on a wallet that needs the node. The startup summary shows the read, what open() still waited for
+  // it and the load, so the time saved is the read minus the wait.
+  void prefetch();
   void open(const QString& _password);
   void createWallet();
   void createNonDeterministic();
@@ -51,7 +72,14 @@ public:
   bool getTransfer(CryptoNote::TransferId& _id, CryptoNote::WalletLegacyTransfer& _transfer);
   bool getAccountKeys(CryptoNote::AccountKeys& _keys);
   QString getTxProof(Crypto::Hash& _txid, CryptoNote::AccountPublicAddress& _address, Crypto::SecretKey& _tx_key);
-  QString getReserveProof(const quint64 &_reserve, const QString &_message);
+  // Without message boxes, for callers that report errors themselves
+  bool getTxProof(Crypto::Hash& _txid, CryptoNote::AccountPublicAddress& _address, Crypto::SecretKey& _tx_key, QString& _proof);
+  // Writes the proof to the file on worker threads, cancelling the one still running, and verifies it against
+  // the wallet's outputs before it is reported done. Returns the ID of the proof for the progress and
+  // completion signals, or 0 with the error when it cannot be started.
+  quint64 generateReserveProofAsync(quint64 _reserve, const QString& _message, const QString& _file, QString& _error);
+  // Returns at once, the cancelled proof removes its file and reports its completion with an error and no text
+  void cancelReserveProof();
   Crypto::SecretKey getTxKey(Crypto::Hash& txid);
   size_t getUnlockedOutputsCount();
 
@@ -59,13 +87,20 @@ public:
   std::vector<CryptoNote::TransactionOutputInformation> getLockedOutputs();
   std::vector<CryptoNote::TransactionOutputInformation> getUnlockedOutputs();
   std::vector<CryptoNote::TransactionSpentOutputInformation> getSpentOutputs();
+  // Unlocked outputs not reserved by a transaction that is being sent or waits for confirmation
+  std::vector<CryptoNote::TransactionOutputInformation> getSpendableOutputs();
 
-  void sendTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, quint64 _fee, const QString& _payment_id, quint64 _mixin);
-  void sendTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, const std::list<CryptoNote::TransactionOutputInformation>& _selectedOuts, quint64 _fee, const QString& _payment_id, quint64 _mixin);
+  bool sendTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, quint64 _fee, const QString& _payment_id, quint64 _mixin);
+  bool sendTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, const std::list<CryptoNote::TransactionOutputInformation>& _selectedOuts, quint64 _fee, const QString& _payment_id, quint64 _mixin);
 
   QString prepareRawTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, quint64 _fee, const QString& _payment_id, quint64 _mixin);
   QString prepareRawTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, const std::list<CryptoNote::TransactionOutputInformation>& _selectedOuts, quint64 _fee, const QString& _payment_id, quint64 _mixin);
 
+  // Build the transaction on the builder thread, an empty _selectedOuts lets the wallet pick inputs
+  quint64 sendTransactionAsync(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, const std::list<CryptoNote::TransactionOutputInformation>& _selectedOuts, quint64 _fee, const QString& _payment_id, quint64 _mixin);
+  quint64 prepareRawTransactionAsync(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, const std::list<CryptoNote::TransactionOutputInformation>& _selectedOuts, quint64 _fee, const QString& _payment_id, quint64 _mixin);
+  bool cancelTransactionJob(quint64 _jobId);
+
   quint64 estimateFusion(quint64 _threshold);
   std::list<CryptoNote::TransactionOutputInformation> getFusionTransfersToSend(quint64 _threshold, size_t _min_input_count, size_t _max_input_count);
   void sendFusionTransaction(const std::list<CryptoNote::TransactionOutputInformation>& _fusion_inputs, quint64 _fee, const QString& _extra, quint64 _mixin);
@@ -97,7 +132,18 @@ public:
   bool tryOpen(const QString& _password);
 
 private:
+  struct PrefetchedFile {
+    QString fileName;
+    qint64 size;
+    QDateTime modified;
+    std::string content;
+  };
+
   std::fstream m_file;
+  std::future<PrefetchedFile> m_prefetchedFile;
+  std::istringstream m_prefetchedStream;
+  std::atomic<bool> m_isLoadingPrefetched;
+  std::atomic<qint64> m_loadStartUs;
   CryptoNote::IWalletLegacy* m_wallet;
   QMutex m_mutex;
   std::atomic<bool> m_isBackupInProgress;
@@ -111,11 +157,59 @@ private:
   struct PerfType { uint32_t height; QTime time; };
   std::vector<PerfType> m_perfData;
 
+  struct TransactionJob;
+  friend class TransactionBuilder;
+  QThread m_transactionBuilderThread;
+  TransactionBuilder* m_transactionBuilder;
+  QMutex m_jobsMutex;
+  QHash<quint64, std::shared_ptr<TransactionJob>> m_jobs;
+  quint64 m_lastJobId;
+
+  // m_wallet is shared by getters, sends and saves, only attaching or destroying it is exclusive.
+  // m_mutex still serializes file access and transaction construction.
+  mutable QReadWriteLock m_walletLock;
+  // Balances re-read together after every wallet update and published as one immutable value
+  struct BalanceSnapshot { quint64 actual = 0; quint64 pending = 0; quint64 unmixable = 0; };
+  std::shared_ptr<const BalanceSnapshot> m_balances;
+
+  // Inputs of transactions that are being sent or wait for confirmation. Every send owns a reservation,
+  // jobs use their job id, so concurrent sends never pick the same output.
+  struct SentTransaction { quint64 reservationId; bool isJob; };
+  QMutex m_reservationsMutex;
+  QHash<QByteArray, quint64> m_reservedOutputs;
+  QHash<quint64, QList<QByteArray>> m_reservations;
+  QHash<CryptoNote::TransactionId, SentTransaction> m_sentTransactions;
+  QHash<CryptoNote::TransactionId, int> m_earlyCompletions;
+  // Fusions relayed by the wallet itself, by hash, until the wallet core reports them
+  QHash<QByteArray, quint64> m_relayedFusions;
+
+  // Proofs run one at a time, a cancelled one stops at the end of its current chunk before the next starts
+  QThreadPool m_reserveProofPool;
+  quint64 m_lastReserveProofId;
+  std::shared_ptr<std::atomic<bool>> m_reserveProofCancel;
+
   WalletAdapter();
   ~WalletAdapter();
 
   void onWalletInitCompleted(int _error, const QString& _error_text);
   void onWalletSendTransactionCompleted(CryptoNote::TransactionId _transaction_id, int _error, const QString& _error_text);
+  quint64 enqueueTransactionJob(std::shared_ptr<TransactionJob> _job);
+  std::shared_ptr<TransactionJob> takeTransactionJob(quint64 _jobId);
+  void attachWallet();
+  void destroyWallet();
+  void publishBalances();
+  quint64 newReservationId();
+  bool reserveOutputs(quint64 _reservationId, const std::list<CryptoNote::TransactionOutputInformation>& _outputs);
+  bool selectAndReserveOutputs(quint64 _reservationId, const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, quint64 _fee,
+    quint64 _mixin, std::list<CryptoNote::TransactionOutputInformation>& _outputs);
+  void releaseOutputs(quint64 _reservationId);
+  bool isOutputReserved(const CryptoNote::TransactionOutputInformation& _output);
+  void clearReservations();
+  bool submitTransaction(quint64 _reservationId, bool _isJob, const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers,
+    const std::list<CryptoNote::TransactionOutputInformation>& _selectedOuts, quint64 _fee, const QString& _payment_id, quint64 _mixin);
+  void trackSentTransaction(CryptoNote::TransactionId _transaction_id, const SentTransaction& _sent);
+  void finishSentTransaction(CryptoNote::TransactionId _transaction_id, const SentTransaction& _sent, int _error);
+  void failTransactionJob(quint64 _jobId, int _error, const QString& _errorText);
 
   bool importLegacyWallet(const QString &_password);
   bool save(const QString& _file, bool _details, bool _cache);
@@ -123,6 +217,8 @@ private:
   void unlock();
   bool openFile(const QString& _file, bool _read_only);
   void closeFile();
+  bool openPrefetched(const QString& _file);
+  void closePrefetched();
   void notifyAboutLastTransaction();
   QString walletErrorMessage(int _error_code);
 
@@ -143,6 +239,13 @@ Q_SIGNALS:
   void walletSendTransactionCompletedSignal(CryptoNote::TransactionId _transaction_id, int _error, const QString& _error_text);
   void walletTransactionUpdatedSignal(CryptoNote::TransactionId _transaction_id);
   void walletStateChangedSignal(const QString &_state_text);
+  void transactionJobPhaseChangedSignal(quint64 _job_id, int _phase);
+  void rawTransactionPreparedSignal(quint64 _job_id, const QString& _raw_transaction);
+  void transactionJobCompletedSignal(quint64 _job_id, CryptoNote::TransactionId _transaction_id, int _error, const QString& _error_text);
+  void reserveProofProgressSignal(quint64 _proof_id, quint64 _done, quint64 _total);
+  // An empty error text with the error set means cancelled
+  void reserveProofCompletedSignal(quint64 _proof_id, bool _error, const QString& _error_text);
+  void buildTransactionSignal(quint64 _job_id);
 
   void openWalletWithPasswordSignal(bool _error);
   void changeWalletPasswordSignal();
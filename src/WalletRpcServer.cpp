@@ -0,0 +1,741 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QStringList>
+#include <QTcpSocket>
+#include <QTemporaryFile>
+
+#include <Common/StringTools.h>
+#include <CryptoNoteConfig.h>
+#include <CryptoNoteCore/CryptoNoteBasic.h>
+
+#include "WalletRpcServer.h"
+#include "CurrencyAdapter.h"
+#include "NodeAdapter.h"
+#include "Settings.h"
+#include "TransactionSizeEstimator.h"
+#include "WalletAdapter.h"
+
+namespace WalletGui {
+
+namespace {
+
+const int MAX_HEADER_SIZE = 16 * 1024;
+const int MAX_BODY_SIZE = 16 * 1024 * 1024;
+const int DEFAULT_PAGE_SIZE = 100;
+const int MAX_PAGE_SIZE = 10000;
+const quint64 DEFAULT_MIXIN = 7;
+// The range the send frame offers
+const quint64 MIN_MIXIN = 0;
+const quint64 MAX_MIXIN = 19;
+
+const int PARSE_ERROR = -32700;
+const int INVALID_REQUEST = -32600;
+const int METHOD_NOT_FOUND = -32601;
+const int INVALID_PARAMS = -32602;
+const int WALLET_ERROR = -32000;
+
+QJsonObject resultResponse(const QJsonValue& _id, const QJsonValue& _result) {
+  return QJsonObject {{"jsonrpc", "2.0"}, {"id", _id}, {"result", _result}};
+}
+
+QJsonObject errorResponse(const QJsonValue& _id, int _code, const QString& _message) {
+  return QJsonObject {{"jsonrpc", "2.0"}, {"id", _id}, {"error", QJsonObject {{"code", _code}, {"message", _message}}}};
+}
+
+QString amountToString(qint64 _amount) {
+  return QString::number(_amount);
+}
+
+// Amounts are accepted as strings of atomic units, or as numbers while they are exact
+bool parseAmount(const QJsonValue& _value, quint64& _amount) {
+  if (_value.isString()) {
+    bool ok = false;
+    _amount = _value.toString().toULongLong(&ok);
+    return ok;
+  }
+
+  if (_value.isDouble() && _value.toDouble() >= 0 && _value.toDouble() <= 9007199254740992.0) {
+    _amount = static_cast<quint64>(_value.toDouble());
+    return static_cast<double>(_amount) == _value.toDouble();
+  }
+
+  return false;
+}
+
+// Non-negative integers up to _max, JSON has only doubles
+bool parseInteger(const QJsonValue& _value, quint64 _max, quint64& _integer) {
+  if (!_value.isDouble()) {
+    return false;
+  }
+
+  const double value = _value.toDouble();
+  if (!std::isfinite(value) || value < 0 || value > static_cast<double>(_max) || std::floor(value) != value) {
+    return false;
+  }
+
+  _integer = static_cast<quint64>(value);
+  return true;
+}
+
+// The page size, absent means the default and larger ones are cut to the maximum
+bool parseLimit(const QJsonObject& _params, int& _limit) {
+  quint64 limit = DEFAULT_PAGE_SIZE;
+  if (_params.contains("limit") && (!parseInteger(_params.value("limit"), 9007199254740992ULL, limit) || limit == 0)) {
+    return false;
+  }
+
+  _limit = static_cast<int>(std::min<quint64>(limit, MAX_PAGE_SIZE));
+  return true;
+}
+
+// Outputs have no ID, they are paged by "<transactionHash>:<outputInTransaction>" in the order of that pair
+QString outputPageKey(const CryptoNote::TransactionOutputInformation& _output) {
+  return QString::fromStdString(Common::podToHex(_output.transactionHash)) + ':' + QString::number(_output.outputInTransaction);
+}
+
+bool parseOutputPageKey(const QJsonValue& _value, Crypto::Hash& _transactionHash, quint32& _outputInTransaction) {
+  const QStringList fields = _value.toString().split(':');
+  bool ok = false;
+  if (fields.size() != 2 || !Common::podFromHex(fields[0].toStdString(), _transactionHash)) {
+    return false;
+  }
+
+  _outputInTransaction = fields[1].toUInt(&ok);
+  return ok;
+}
+
+int compareOutput(const CryptoNote::TransactionOutputInformation& _output, const Crypto::Hash& _transactionHash, quint32 _outputInTransaction) {
+  const int order = std::memcmp(&_output.transactionHash, &_transactionHash, sizeof(_transactionHash));
+  if (order != 0) {
+    return order;
+  }
+
+  return _output.outputInTransaction < _outputInTransaction ? -1 : _output.outputInTransaction > _outputInTransaction ? 1 : 0;
+}
+
+QString transactionStateName(CryptoNote::WalletLegacyTransactionState _state) {
+  switch (_state) {
+  case CryptoNote::WalletLegacyTransactionState::Active:
+    return "active";
+  case CryptoNote::WalletLegacyTransactionState::Deleted:
+    return "deleted";
+  case CryptoNote::WalletLegacyTransactionState::Sending:
+    return "sending";
+  case CryptoNote::WalletLegacyTransactionState::Cancelled:
+    return "cancelled";
+  case CryptoNote::WalletLegacyTransactionState::Failed:
+    return "failed";
+  }
+
+  return QString();
+}
+
+QJsonObject outputToJson(const CryptoNote::TransactionOutputInformation& _output) {
+  return QJsonObject {
+    {"amount", amountToString(_output.amount)},
+    {"globalOutputIndex", static_cast<double>(_output.globalOutputIndex)},
+    {"outputInTransaction", static_cast<double>(_output.outputInTransaction)},
+    {"transactionHash", QString::fromStdString(Common::podToHex(_output.transactionHash))},
+    {"transactionPublicKey", QString::fromStdString(Common::podToHex(_output.transactionPublicKey))},
+    {"outputKey", QString::fromStdString(Common::podToHex(_output.outputKey))}
+  };
+}
+
+}
+
+struct WalletRpcServer::Connection {
+  QTcpSocket* socket;
+  QByteArray buffer;
+  // Responses go out in request order, the next request waits for the current one
+  bool isBusy;
+  bool keepAlive;
+  bool isBatch;
+  QJsonArray responses;
+  QVector<bool> isNotification;
+  int pendingCalls;
+};
+
+WalletRpcServer::WalletRpcServer(QObject* _parent) : QObject(_parent), m_server() {
+  connect(&m_server, &QTcpServer::newConnection, this, &WalletRpcServer::newConnection);
+  // Emitted by the transaction builder thread
+  connect(&WalletAdapter::instance(), &WalletAdapter::transactionJobCompletedSignal, this, &WalletRpcServer::transactionJobCompleted,
+    Qt::QueuedConnection);
+  connect(&WalletAdapter::instance(), &WalletAdapter::rawTransactionPreparedSignal, this, &WalletRpcServer::rawTransactionPrepared,
+    Qt::QueuedConnection);
+  // Emitted by the reserve proof worker
+  connect(&WalletAdapter::instance(), &WalletAdapter::reserveProofCompletedSignal, this, &WalletRpcServer::reserveProofCompleted,
+    Qt::QueuedConnection);
+}
+
+WalletRpcServer::~WalletRpcServer() {
+  stop();
+}
+
+bool WalletRpcServer::start(quint16 _port) {
+  if (!m_cookie.create(Settings::instance().getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".rpc.cookie"))) {
+    return false;
+  }
+
+  return m_server.listen(QHostAddress::LocalHost, _port);
+}
+
+void WalletRpcServer::stop() {
+  if (!m_server.isListening()) {
+    return;
+  }
+
+  m_server.close();
+  for (auto it = m_connections.begin(); it != m_connections.end(); ++it) {
+    it.key()->disconnect(this);
+    it.key()->abort();
+    it.key()->deleteLater();
+  }
+
+  m_connections.clear();
+  m_pendingCalls.clear();
+  // Proofs still running are cleaned up when they complete
+  for (const QString& file : m_proofFiles) {
+    QFile::remove(file);
+  }
+
+  m_cookie.remove();
+}
+
+void WalletRpcServer::newConnection() {
+  while (QTcpSocket* socket = m_server.nextPendingConnection()) {
+    std::shared_ptr<Connection> connection(new Connection {socket, QByteArray(), false, true, false, QJsonArray(), QVector<bool>(), 0});
+    m_connections.insert(socket, connection);
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+      readSocket(socket);
+    });
+
+    connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+      m_connections.remove(socket);
+      socket->deleteLater();
+    });
+  }
+}
+
+void WalletRpcServer::readSocket(QTcpSocket* _socket) {
+  std::shared_ptr<Connection> connection = m_connections.value(_socket);
+  if (!connection) {
+    return;
+  }
+
+  connection->buffer.append(_socket->readAll());
+  if (connection->buffer.size() > MAX_HEADER_SIZE + MAX_BODY_SIZE) {
+    connection->keepAlive = false;
+    writeResponse(connection, 413, QByteArray());
+    return;
+  }
+
+  processBuffer(connection);
+}
+
+void WalletRpcServer::processBuffer(const std::shared_ptr<Connection>& _connection) {
+  if (_connection->isBusy) {
+    return;
+  }
+
+  const int headerEnd = _connection->buffer.indexOf("\r\n\r\n");
+  if (headerEnd < 0) {
+    if (_connection->buffer.size() > MAX_HEADER_SIZE) {
+      _connection->keepAlive = false;
+      writeResponse(_connection, 431, QByteArray());
+    }
+
+    return;
+  }
+
+  const QList<QByteArray> lines = _connection->buffer.left(headerEnd).split('\n');
+  const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+  QHash<QByteArray, QByteArray> headers;
+  for (int i = 1; i < lines.size(); ++i) {
+    const int colon = lines[i].indexOf(':');
+    if (colon > 0) {
+      headers.insert(lines[i].left(colon).trimmed().toLower(), lines[i].mid(colon + 1).trimmed());
+    }
+  }
+
+  bool isLengthValid = false;
+  const int contentLength = headers.value("content-length", "0").toInt(&isLengthValid);
+  if (requestLine.size() != 3 || !isLengthValid || contentLength < 0 || contentLength > MAX_BODY_SIZE) {
+    _connection->keepAlive = false;
+    writeResponse(_connection, 400, QByteArray());
+    return;
+  }
+
+  if (_connection->buffer.size() < headerEnd + 4 + contentLength) {
+    return;
+  }
+
+  const QByteArray body = _connection->buffer.mid(headerEnd + 4, contentLength);
+  _connection->buffer.remove(0, headerEnd + 4 + contentLength);
+  const QByteArray connectionHeader = headers.value("connection").toLower();
+  _connection->keepAlive = requestLine[2] == "HTTP/1.1" ? connectionHeader != "close" : connectionHeader == "keep-alive";
+  _connection->isBusy = true;
+  if (requestLine[0] != "POST") {
+    writeResponse(_connection, 405, QByteArray());
+  } else if (!isAuthorized(headers.value("authorization"))) {
+    writeResponse(_connection, 401, QByteArray());
+  } else {
+    handleBody(_connection, body);
+  }
+}
+
+bool WalletRpcServer::isAuthorized(const QByteArray& _authorization) const {
+  QByteArray token;
+  if (_authorization.startsWith("Bearer ")) {
+    token = _authorization.mid(7).trimmed();
+  } else if (_authorization.startsWith("Basic ")) {
+    const QByteArray credentials = QByteArray::fromBase64(_authorization.mid(6).trimmed());
+    token = credentials.mid(credentials.indexOf(':') + 1);
+  }
+
+  return m_cookie.isValid(token);
+}
+
+void WalletRpcServer::handleBody(const std::shared_ptr<Connection>& _connection, const QByteArray& _body) {
+  _connection->responses = QJsonArray();
+  _connection->isNotification.clear();
+  _connection->pendingCalls = 0;
+  QJsonParseError error;
+  const QJsonDocument request = QJsonDocument::fromJson(_body, &error);
+  _connection->isBatch = request.isArray() && !request.array().isEmpty();
+  if (error.error != QJsonParseError::NoError) {
+    _connection->responses.append(errorResponse(QJsonValue(), PARSE_ERROR, error.errorString()));
+    _connection->isNotification.append(false);
+  } else if (_connection->isBatch) {
+    const QJsonArray calls = request.array();
+    for (int i = 0; i < calls.size(); ++i) {
+      _connection->responses.append(QJsonObject());
+      // Entries that aren't objects aren't calls either, they are answered with an error and a null ID
+      _connection->isNotification.append(calls[i].isObject() && !calls[i].toObject().contains("id"));
+    }
+
+    for (int i = 0; i < calls.size(); ++i) {
+      const QJsonObject response = handleCall(_connection, i, calls[i]);
+      if (!response.isEmpty()) {
+        _connection->responses[i] = response;
+      }
+    }
+  } else {
+    const QJsonValue call = request.isObject() ? QJsonValue(request.object()) : QJsonValue();
+    _connection->responses.append(QJsonObject());
+    _connection->isNotification.append(call.isObject() && !call.toObject().contains("id"));
+    const QJsonObject response = handleCall(_connection, 0, call);
+    if (!response.isEmpty()) {
+      _connection->responses[0] = response;
+    }
+  }
+
+  if (_connection->pendingCalls == 0) {
+    finishResponse(_connection);
+  }
+}
+
+void WalletRpcServer::finishResponse(const std::shared_ptr<Connection>& _connection) {
+  QJsonArray responses;
+  for (int i = 0; i < _connection->responses.size(); ++i) {
+    if (!_connection->isNotification[i]) {
+      responses.append(_connection->responses[i]);
+    }
+  }
+
+  if (responses.isEmpty()) {
+    writeResponse(_connection, 204, QByteArray());
+  } else if (_connection->isBatch) {
+    writeResponse(_connection, 200, QJsonDocument(responses).toJson(QJsonDocument::Compact));
+  } else {
+    writeResponse(_connection, 200, QJsonDocument(responses.first().toObject()).toJson(QJsonDocument::Compact));
+  }
+}
+
+void WalletRpcServer::writeResponse(const std::shared_ptr<Connection>& _connection, int _status, const QByteArray& _body) {
+  static const QHash<int, QByteArray> reasons {{200, "OK"}, {204, "No Content"}, {400, "Bad Request"}, {401, "Unauthorized"},
+    {405, "Method Not Allowed"}, {413, "Payload Too Large"}, {431, "Request Header Fields Too Large"}};
+  QByteArray response = "HTTP/1.1 " + QByteArray::number(_status) + ' ' + reasons.value(_status) + "\r\n";
+  if (!_body.isEmpty()) {
+    response += "Content-Type: application/json\r\n";
+  }
+
+  if (_status == 401) {
+    response += "WWW-Authenticate: Bearer\r\n";
+  }
+
+  response += "Content-Length: " + QByteArray::number(_body.size()) + "\r\n";
+  response += _connection->keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+  response += _body;
+  _connection->socket->write(response);
+  _connection->isBusy = false;
+  if (!_connection->keepAlive) {
+    _connection->buffer.clear();
+    _connection->socket->disconnectFromHost();
+    return;
+  }
+
+  // Pipelined requests may already be buffered
+  processBuffer(_connection);
+}
+
+QJsonObject WalletRpcServer::handleCall(const std::shared_ptr<Connection>& _connection, int _slot, const QJsonValue& _call) {
+  if (!_call.isObject()) {
+    return errorResponse(QJsonValue(), INVALID_REQUEST, "Invalid request");
+  }
+
+  const QJsonObject call = _call.toObject();
+  const QJsonValue id = call.value("id");
+  if (call.value("jsonrpc").toString() != "2.0" || !call.value("method").isString()) {
+    return errorResponse(id, INVALID_REQUEST, "Invalid request");
+  }
+
+  const QJsonValue params = call.value("params");
+  if (!params.isUndefined() && !params.isNull() && !params.isObject()) {
+    return errorResponse(id, INVALID_PARAMS, "Parameters have to be passed by name");
+  }
+
+  if (!WalletAdapter::instance().isOpen()) {
+    return errorResponse(id, WALLET_ERROR, "No wallet is open");
+  }
+
+  return dispatch(call.value("method").toString(), params.toObject(), id, _connection, _slot);
+}
+
+QJsonObject WalletRpcServer::dispatch(const QString& _method, const QJsonObject& _params, const QJsonValue& _id,
+  const std::shared_ptr<Connection>& _connection, int _slot) {
+  if (_method == "getAddress") {
+    return resultResponse(_id, QJsonObject {{"address", WalletAdapter::instance().getAddress()}});
+  } else if (_method == "getBalance") {
+    return resultResponse(_id, getBalance());
+  } else if (_method == "getTransactions") {
+    return getTransactions(_params, _id);
+  } else if (_method == "getOutputs") {
+    return getOutputs(_params, _id);
+  } else if (_method == "getTransactionProof") {
+    return getTransactionProof(_params, _id);
+  } else if (_method == "getReserveProof") {
+    return getReserveProof(_params, _id, _connection, _slot);
+  } else if (_method == "signMessage") {
+    return signMessage(_params, _id);
+  } else if (_method == "verifyMessage") {
+    return verifyMessage(_params, _id);
+  } else if (_method == "sendTransaction") {
+    return startTransaction(_params, _id, true, _connection, _slot);
+  } else if (_method == "prepareRawTransaction") {
+    return startTransaction(_params, _id, false, _connection, _slot);
+  }
+
+  return errorResponse(_id, METHOD_NOT_FOUND, "Method not found");
+}
+
+QJsonObject WalletRpcServer::getBalance() {
+  return QJsonObject {
+    {"actual", amountToString(WalletAdapter::instance().getActualBalance())},
+    {"pending", amountToString(WalletAdapter::instance().getPendingBalance())},
+    {"unmixable", amountToString(WalletAdapter::instance().getUnmixableBalance())}
+  };
+}
+
+// Keyset pagination: the page starts after "sinceId", the last ID of the page is the next "sinceId"
+QJsonObject WalletRpcServer::getTransactions(const QJsonObject& _params, const QJsonValue& _id) {
+  const quint64 count = WalletAdapter::instance().getTransactionCount();
+  // A null "sinceId" is what an empty first page hands back
+  quint64 sinceId = 0;
+  const bool hasSinceId = _params.contains("sinceId") && !_params.value("sinceId").isNull();
+  if (hasSinceId && !parseInteger(_params.value("sinceId"), 9007199254740992ULL, sinceId)) {
+    return errorResponse(_id, INVALID_PARAMS, "Invalid sinceId");
+  }
+
+  int limit = 0;
+  if (!parseLimit(_params, limit)) {
+    return errorResponse(_id, INVALID_PARAMS, "Invalid limit");
+  }
+
+  const quint64 first = hasSinceId ? sinceId + 1 : 0;
+  QJsonArray transactions;
+  CryptoNote::TransactionId transactionId = first;
+  for (; transactionId < count && transactions.size() < limit; ++transactionId) {
+    CryptoNote::WalletLegacyTransaction transaction;
+    if (!WalletAdapter::instance().getTransaction(transactionId, transaction)) {
+      continue;
+    }
+
+    QJsonArray transfers;
+    for (CryptoNote::TransferId transferId = transaction.firstTransferId;
+         transferId < transaction.firstTransferId + transaction.transferCount; ++transferId) {
+      CryptoNote::WalletLegacyTransfer transfer;
+      if (WalletAdapter::instance().getTransfer(transferId, transfer)) {
+        transfers.append(QJsonObject {{"address", QString::fromStdString(transfer.address)}, {"amount", amountToString(transfer.amount)}});
+      }
+    }
+
+    const bool isConfirmed = transaction.blockHeight != CryptoNote::WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT;
+    transactions.append(QJsonObject {
+      {"id", static_cast<double>(transactionId)},
+      {"hash", QString::fromStdString(Common::podToHex(transaction.hash))},
+      {"state", transactionStateName(transaction.state)},
+      {"blockHeight", isConfirmed ? QJsonValue(static_cast<double>(transaction.blockHeight)) : QJsonValue()},
+      {"timestamp", static_cast<double>(transaction.timestamp)},
+      {"totalAmount", amountToString(transaction.totalAmount)},
+      {"fee", amountToString(transaction.fee)},
+      {"unlockTime", static_cast<double>(transaction.unlockTime)},
+      {"isCoinbase", transaction.isCoinbase},
+      {"paymentId", NodeAdapter::instance().extractPaymentId(transaction.extra)},
+      {"transfers", transfers}
+    });
+  }
+
+  return resultResponse(_id, QJsonObject {
+    {"transactions", transactions},
+    {"nextSinceId", !transactions.isEmpty() ? transactions.last().toObject().value("id") :
+      hasSinceId ? QJsonValue(static_cast<double>(sinceId)) : QJsonValue()},
+    {"hasMore", transactionId < count}
+  });
+}
+
+// Keyset pagination as for transactions: the page starts after "sinceKey", the key of the last output of the page
+// is the next "sinceKey". Outputs spent or unlocked meanwhile move between the types, the others keep their place.
+QJsonObject WalletRpcServer::getOutputs(const QJsonObject& _params, const QJsonValue& _id) {
+  const QString type = _params.contains("type") ? _params.value("type").toString() : QString("unlocked");
+  if (type != "unlocked" && type != "locked" && type != "all" && type != "spent") {
+    return errorResponse(_id, INVALID_PARAMS, "Invalid type, expected unlocked, locked, all or spent");
+  }
+
+  Crypto::Hash sinceHash;
+  quint32 sinceOutput = 0;
+  const bool hasSinceKey = _params.contains("sinceKey") && !_params.value("sinceKey").isNull();
+  if (hasSinceKey && !parseOutputPageKey(_params.value("sinceKey"), sinceHash, sinceOutput)) {
+    return errorResponse(_id, INVALID_PARAMS, "Invalid sinceKey");
+  }
+
+  int limit = 0;
+  if (!parseLimit(_params, limit)) {
+    return errorResponse(_id, INVALID_PARAMS, "Invalid limit");
+  }
+
+  QJsonArray outputs;
+  bool hasMore = false;
+  QJsonValue nextSinceKey = hasSinceKey ? _params.value("sinceKey") : QJsonValue();
+  auto page = [&](auto _list, auto _toJson) {
+    // Only the outputs after the key are ordered, and of those only as many as the page takes
+    auto begin = _list.begin();
+    if (hasSinceKey) {
+      begin = std::partition(_list.begin(), _list.end(), [&sinceHash, sinceOutput](const CryptoNote::TransactionOutputInformation& _output) {
+        return compareOutput(_output, sinceHash, sinceOutput) <= 0;
+      });
+    }
+
+    const auto isBefore = [](const CryptoNote::TransactionOutputInformation& _left, const CryptoNote::TransactionOutputInformation& _right) {
+      return compareOutput(_left, _right.transactionHash, _right.outputInTransaction) < 0;
+    };
+    const size_t count = std::min<size_t>(limit, _list.end() - begin);
+    std::partial_sort(begin, begin + count, _list.end(), isBefore);
+    for (auto it = begin; it != begin + count; ++it) {
+      outputs.append(_toJson(*it));
+    }
+
+    hasMore = begin + count != _list.end();
+    if (count != 0) {
+      nextSinceKey = outputPageKey(*(begin + count - 1));
+    }
+  };
+
+  if (type == "spent") {
+    page(WalletAdapter::instance().getSpentOutputs(), [](const CryptoNote::TransactionSpentOutputInformation& _output) {
+      QJsonObject object = outputToJson(_output);
+      object.insert("spendingTransactionHash", QString::fromStdString(Common::podToHex(_output.spendingTransactionHash)));
+      object.insert("keyImage", QString::fromStdString(Common::podToHex(_output.keyImage)));
+      return object;
+    });
+  } else {
+    page(type == "locked" ? WalletAdapter::instance().getLockedOutputs() : type == "all" ? WalletAdapter::instance().getOutputs() :
+      WalletAdapter::instance().getUnlockedOutputs(), [](const CryptoNote::TransactionOutputInformation& _output) {
+      return outputToJson(_output);
+    });
+  }
+
+  return resultResponse(_id, QJsonObject {{"outputs", outputs}, {"nextSinceKey", nextSinceKey}, {"hasMore", hasMore}});
+}
+
+QJsonObject WalletRpcServer::getTransactionProof(const QJsonObject& _params, const QJsonValue& _id) {
+  Crypto::Hash transactionHash;
+  if (!Common::podFromHex(_params.value("transactionHash").toString().toStdString(), transactionHash)) {
+    return errorResponse(_id, INVALID_PARAMS, "Invalid transaction hash");
+  }
+
+  CryptoNote::AccountPublicAddress address;
+  if (!CurrencyAdapter::instance().getCurrency().parseAccountAddressString(_params.value("address").toString().toStdString(), address)) {
+    return errorResponse(_id, INVALID_PARAMS, "Invalid address");
+  }
+
+  Crypto::SecretKey transactionKey = WalletAdapter::instance().getTxKey(transactionHash);
+  QString proof;
+  if (transactionKey == CryptoNote::NULL_SECRET_KEY ||
+      !WalletAdapter::instance().getTxProof(transactionHash, address, transactionKey, proof)) {
+    return errorResponse(_id, WALLET_ERROR, "Failed to get the transaction proof");
+  }
+
+  return resultResponse(_id, QJsonObject {{"proof", proof}});
+}
+
+QJsonObject WalletRpcServer::getReserveProof(const QJsonObject& _params, const QJsonValue& _id,
+  const std::shared_ptr<Connection>& _connection, int _slot) {
+  quint64 amount = 0;
+  if (_params.contains("amount") && !parseAmount(_params.value("amount"), amount)) {
+    return errorResponse(_id, INVALID_PARAMS, "Invalid amount");
+  }
+
+  // An owner-only file in the data directory, the worker replaces it with the proof
+  QTemporaryFile file(Settings::instance().getDataDir().absoluteFilePath("rpc-reserve-proof-XXXXXX.txt"));
+  file.setAutoRemove(false);
+  if (!file.open()) {
+    return errorResponse(_id, WALLET_ERROR, file.errorString());
+  }
+
+  const QString fileName = file.fileName();
+  file.close();
+  QString error;
+  const quint64 proofId = WalletAdapter::instance().generateReserveProofAsync(amount, _params.value("message").toString(), fileName, error);
+  if (proofId == 0) {
+    QFile::remove(fileName);
+    return errorResponse(_id, WALLET_ERROR, error);
+  }
+
+  m_pendingProofs.insert(proofId, PendingCall {_connection, _slot, _id});
+  m_proofFiles.insert(proofId, fileName);
+  ++_connection->pendingCalls;
+  return QJsonObject();
+}
+
+QJsonObject WalletRpcServer::signMessage(const QJsonObject& _params, const QJsonValue& _id) {
+  if (Settings::instance().isTrackingMode()) {
+    return errorResponse(_id, WALLET_ERROR, "A tracking wallet cannot sign messages");
+  }
+
+  return resultResponse(_id, QJsonObject {{"signature", WalletAdapter::instance().signMessage(_params.value("message").toString())}});
+}
+
+QJsonObject WalletRpcServer::verifyMessage(const QJsonObject& _params, const QJsonValue& _id) {
+  CryptoNote::AccountPublicAddress address;
+  if (!CurrencyAdapter::instance().getCurrency().parseAccountAddressString(_params.value("address").toString().toStdString(), address)) {
+    return errorResponse(_id, INVALID_PARAMS, "Invalid address");
+  }
+
+  const bool isValid = WalletAdapter::instance().verifyMessage(_params.value("message").toString(), address,
+    _params.value("signature").toString());
+  return resultResponse(_id, QJsonObject {{"isValid", isValid}});
+}
+
+QJsonObject WalletRpcServer::startTransaction(const QJsonObject& _params, const QJsonValue& _id, bool _relay,
+  const std::shared_ptr<Connection>& _connection, int _slot) {
+  std::vector<CryptoNote::WalletLegacyTransfer> transfers;
+  for (const QJsonValue& value : _params.value("transfers").toArray()) {
+    const QJsonObject transfer = value.toObject();
+    const QString address = transfer.value("address").toString();
+    quint64 amount = 0;
+    if (!CurrencyAdapter::instance().validateAddress(address) || !parseAmount(transfer.value("amount"), amount) || amount == 0) {
+      return errorResponse(_id, INVALID_PARAMS, "Invalid transfer");
+    }
+
+    transfers.push_back(CryptoNote::WalletLegacyTransfer {address.toStdString(), static_cast<int64_t>(amount)});
+  }
+
+  if (transfers.empty()) {
+    return errorResponse(_id, INVALID_PARAMS, "No transfers");
+  }
+
+  // The minimal fee as offered by the send frame
+  quint64 fee = TransactionSizeEstimator::roundUpFee(NodeAdapter::instance().getCurrentBlockMajorVersion() < CryptoNote::BLOCK_MAJOR_VERSION_4 ?
+    CurrencyAdapter::instance().getMinimumFee() : NodeAdapter::instance().getMinimalFee());
+  if (_params.contains("fee") && !parseAmount(_params.value("fee"), fee)) {
+    return errorResponse(_id, INVALID_PARAMS, "Invalid fee");
+  }
+
+  quint64 mixin = DEFAULT_MIXIN;
+  if (_params.contains("mixin") && (!parseInteger(_params.value("mixin"), MAX_MIXIN, mixin) || mixin < MIN_MIXIN)) {
+    return errorResponse(_id, INVALID_PARAMS, QString("Invalid mixin, expected an integer from %1 to %2").arg(MIN_MIXIN).arg(MAX_MIXIN));
+  }
+
+  const QString paymentId = _params.value("paymentId").toString();
+  const std::list<CryptoNote::TransactionOutputInformation> selectedOuts;
+  const quint64 jobId = _relay ? WalletAdapter::instance().sendTransactionAsync(transfers, selectedOuts, fee, paymentId, mixin) :
+    WalletAdapter::instance().prepareRawTransactionAsync(transfers, selectedOuts, fee, paymentId, mixin);
+  m_pendingCalls.insert(jobId, PendingCall {_connection, _slot, _id});
+  ++_connection->pendingCalls;
+  return QJsonObject();
+}
+
+void WalletRpcServer::transactionJobCompleted(quint64 _jobId, CryptoNote::TransactionId _transactionId, int _error,
+  const QString& _errorText) {
+  if (!m_pendingCalls.contains(_jobId)) {
+    return;
+  }
+
+  const PendingCall call = m_pendingCalls.take(_jobId);
+  CryptoNote::WalletLegacyTransaction transaction;
+  if (_error != 0 || !WalletAdapter::instance().getTransaction(_transactionId, transaction)) {
+    completeCall(call, errorResponse(call.id, WALLET_ERROR, _errorText));
+    return;
+  }
+
+  completeCall(call, resultResponse(call.id, QJsonObject {
+    {"transactionId", static_cast<double>(_transactionId)},
+    {"transactionHash", QString::fromStdString(Common::podToHex(transaction.hash))}
+  }));
+}
+
+void WalletRpcServer::rawTransactionPrepared(quint64 _jobId, const QString& _rawTransaction) {
+  if (!m_pendingCalls.contains(_jobId)) {
+    return;
+  }
+
+  const PendingCall call = m_pendingCalls.take(_jobId);
+  completeCall(call, _rawTransaction.isEmpty() ? errorResponse(call.id, WALLET_ERROR, "Failed to prepare the transaction") :
+    resultResponse(call.id, QJsonObject {{"rawTransaction", _rawTransaction}}));
+}
+
+// A proof started later, by another call or by the wallet window, cancels this one and completes it without an error text
+void WalletRpcServer::reserveProofCompleted(quint64 _proofId, bool _error, const QString& _errorText) {
+  if (!m_pendingProofs.contains(_proofId)) {
+    return;
+  }
+
+  const PendingCall call = m_pendingProofs.take(_proofId);
+  QFile file(m_proofFiles.take(_proofId));
+  QJsonObject response;
+  if (_error) {
+    response = errorResponse(call.id, WALLET_ERROR, _errorText.isEmpty() ? "The reserve proof was cancelled" : _errorText);
+  } else if (!file.open(QIODevice::ReadOnly)) {
+    response = errorResponse(call.id, WALLET_ERROR, file.errorString());
+  } else {
+    response = resultResponse(call.id, QJsonObject {{"proof", QString::fromLatin1(file.readAll())}});
+    file.close();
+  }
+
+  file.remove();
+  completeCall(call, response);
+}
+
+void WalletRpcServer::completeCall(const PendingCall& _call, const QJsonObject& _response) {
+  std::shared_ptr<Connection> connection = _call.connection.lock();
+  // The client may have gone, the transaction is sent anyway
+  if (!connection || !m_connections.contains(connection->socket)) {
+    return;
+  }
+
+  connection->responses[_call.slot] = _response;
+  if (--connection->pendingCalls == 0) {
+    finishResponse(connection);
+  }
+}
+
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <memory>
+
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QObject>
+#include <QTcpServer>
+
+#include <IWalletLegacy.h>
+
+#include "AuthCookie.h"
+
+class QTcpSocket;
+
+namespace WalletGui {
+
+// JSON-RPC 2.0 over HTTP on the loopback interface, for automation against the open wallet.
+// Requests are POSTed to any path, one call or a batch array of calls per request, and have to carry
+// the token of the cookie file in the data directory as "Authorization: Bearer <token>" (or as the
+// password of basic authentication). The file is rewritten with a new token on every start.
+//
+// Amounts are strings of atomic units both ways, JSON numbers lose precision above 2^53. Transactions
+// are paged by ID: getTransactions returns the ones after "sinceId" in ID order, which stays stable
+// while new transactions are appended. getOutputs pages the same way by "sinceKey", which is
+// "<transactionHash>:<outputInTransaction>". Sends and raw transactions are built on the transaction
+// builder thread and reserve proofs on the proof workers, all answered when done; a batch is
+// answered once all of its calls are.
+class WalletRpcServer : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(WalletRpcServer)
+
+public:
+  WalletRpcServer(QObject* _parent);
+  ~WalletRpcServer();
+
+  bool start(quint16 _port);
+  void stop();
+
+private:
+  struct Connection;
+  struct PendingCall {
+    std::weak_ptr<Connection> connection;
+    int slot;
+    QJsonValue id;
+  };
+
+  QTcpServer m_server;
+  AuthCookie m_cookie;
+  QHash<QTcpSocket*, std::shared_ptr<Connection>> m_connections;
+  QHash<quint64, PendingCall> m_pendingCalls;
+  QHash<quint64, PendingCall> m_pendingProofs;
+  QHash<quint64, QString> m_proofFiles;
+
+  void newConnection();
+  void readSocket(QTcpSocket* _socket);
+  void processBuffer(const std::shared_ptr<Connection>& _connection);
+  bool isAuthorized(const QByteArray& _authorization) const;
+  void handleBody(const std::shared_ptr<Connection>& _connection, const QByteArray& _body);
+  void finishResponse(const std::shared_ptr<Connection>& _connection);
+  void writeResponse(const std::shared_ptr<Connection>& _connection, int _status, const QByteArray& _body);
+
+  // Returns the response of the call, or an empty object when it is answered later
+  QJsonObject handleCall(const std::shared_ptr<Connection>& _connection, int _slot, const QJsonValue& _call);
+  QJsonObject dispatch(const QString& _method, const QJsonObject& _params, const QJsonValue& _id,
+    const std::shared_ptr<Connection>& _connection, int _slot);
+
+  QJsonObject getBalance();
+  QJsonObject getTransactions(const QJsonObject& _params, const QJsonValue& _id);
+  QJsonObject getOutputs(const QJsonObject& _params, const QJsonValue& _id);
+  QJsonObject getTransactionProof(const QJsonObject& _params, const QJsonValue& _id);
+  QJsonObject getReserveProof(const QJsonObject& _params, const QJsonValue& _id, const std::shared_ptr<Connection>& _connection,
+    int _slot);
+  QJsonObject signMessage(const QJsonObject& _params, const QJsonValue& _id);
+  QJsonObject verifyMessage(const QJsonObject& _params, const QJsonValue& _id);
+  QJsonObject startTransaction(const QJsonObject& _params, const QJsonValue& _id, bool _relay,
+    const std::shared_ptr<Connection>& _connection, int _slot);
+
+  void transactionJobCompleted(quint64 _jobId, CryptoNote::TransactionId _transactionId, int _error, const QString& _errorText);
+  void rawTransactionPrepared(quint64 _jobId, const QString& _rawTransaction);
+  void reserveProofCompleted(quint64 _proofId, bool _error, const QString& _errorText);
+  void completeCall(const PendingCall& _call, const QJsonObject& _response);
+};
+
+}
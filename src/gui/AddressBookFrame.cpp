@@ -11,6 +11,7 @@
 #include "AddressBookFrame.h"
 #include "MainWindow.h"
 #include "NewAddressDialog.h"
+#include "SortedAddressBookModel.h"
 #include "WalletEvents.h"
 
 #include "ui_addressbookframe.h"
@@ -19,7 +20,7 @@ namespace WalletGui {
 
 AddressBookFrame::AddressBookFrame(QWidget* _parent) : QFrame(_parent), m_ui(new Ui::AddressBookFrame) {
   m_ui->setupUi(this);
-  m_ui->m_addressBookView->setModel(&AddressBookModel::instance());
+  m_ui->m_addressBookView->setModel(&SortedAddressBookModel::instance());
   m_ui->m_addressBookView->header()->setStretchLastSection(false);
   m_ui->m_addressBookView->header()->setSectionResizeMode(1, QHeaderView::Stretch);
   m_ui->m_addressBookView->setSortingEnabled(true);
@@ -27,6 +28,7 @@ AddressBookFrame::AddressBookFrame(QWidget* _parent) : QFrame(_parent), m_ui(new
   m_ui->m_addressBookView->setRootIsDecorated(false);
 
   connect(m_ui->m_addressBookView->selectionModel(), &QItemSelectionModel::currentChanged, this, &AddressBookFrame::currentAddressChanged);
+  connect(m_ui->m_searchFor, &QLineEdit::textChanged, &SortedAddressBookModel::instance(), &SortedAddressBookModel::setSearchFor);
 
   m_ui->m_addressBookView->setContextMenuPolicy(Qt::CustomContextMenu);
   connect(m_ui->m_addressBookView, SIGNAL(customContextMenuRequested(const QPoint &)), this, SLOT(onCustomContextMenu(const QPoint &)));
@@ -150,7 +152,7 @@ void AddressBookFrame::copyLabelClicked() {
 }
 
 void AddressBookFrame::deleteClicked() {
-  int row = m_ui->m_addressBookView->currentIndex().row();
+  int row = SortedAddressBookModel::instance().mapToSource(m_ui->m_addressBookView->currentIndex()).row();
   AddressBookModel::instance().removeAddress(row);
   m_ui->m_copyPaymentIdButton->setEnabled(false);
   currentAddressChanged(m_ui->m_addressBookView->currentIndex());
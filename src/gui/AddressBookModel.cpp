@@ -2,13 +2,13 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
-#include <QFile>
-#include <QJsonDocument>
-#include <QJsonObject>
+#include <QCoreApplication>
 
 #include "WalletAdapter.h"
 #include "AddressBookModel.h"
+#include "MainWindow.h"
 #include "Settings.h"
+#include "WalletEvents.h"
 
 namespace WalletGui {
 
@@ -34,7 +34,7 @@ QVariant AddressBookModel::data(const QModelIndex& _index, int _role) const {
     return QVariant();
   }
 
-  QJsonObject address = m_addressBook.at(_index.row()).toObject();
+  const AddressBookEntry& address = m_addressBook.at(_index.row());
 
   switch (_role) {
   case Qt::DisplayRole:
@@ -50,11 +50,11 @@ QVariant AddressBookModel::data(const QModelIndex& _index, int _role) const {
     }
 
   case ROLE_LABEL:
-    return address.value("label");
+    return address.label;
   case ROLE_ADDRESS:
-    return address.value("address");
+    return address.address;
   case ROLE_PAYMENTID:
-    return address.value("paymentid");
+    return address.paymentId;
   default:
     return QVariant();
   }
@@ -100,71 +100,74 @@ int AddressBookModel::rowCount(const QModelIndex& _parent) const {
 }
 
 void AddressBookModel::addAddress(const QString& _label, const QString& _address, const QString& _paymentid) {
+  if (!checkWritable()) {
+    return;
+  }
+
   beginInsertRows(QModelIndex(), m_addressBook.size(), m_addressBook.size());
-  QJsonObject newAddress;
-  newAddress.insert("label", _label);
-  newAddress.insert("address", _address);
-  newAddress.insert("paymentid", _paymentid);
-  m_addressBook.append(newAddress);
+  m_addressBook.append(_label, _address, _paymentid);
   endInsertRows();
-  saveAddressBook();
 }
 
 void AddressBookModel::removeAddress(quint32 _row) {
-  if (_row > m_addressBook.size() - 1) {
+  if (_row >= static_cast<quint32>(m_addressBook.size()) || !checkWritable()) {
     return;
   }
 
-  beginRemoveRows(QModelIndex(), _row, _row);
-  m_addressBook.removeAt(_row);
+  // The store moves its last contact into the freed row, so the last row is what goes away
+  const int lastRow = m_addressBook.size() - 1;
+  beginRemoveRows(QModelIndex(), lastRow, lastRow);
+  m_addressBook.remove(_row);
   endRemoveRows();
-  saveAddressBook();
+  if (static_cast<int>(_row) != lastRow) {
+    Q_EMIT dataChanged(index(_row, COLUMN_LABEL), index(_row, COLUMN_PAYMENTID));
+  }
 }
 
 void AddressBookModel::reset() {
   beginResetModel();
-  while (!m_addressBook.empty()) {
-    m_addressBook.removeFirst();
-  }
-
+  m_addressBook.close();
   endResetModel();
 }
 
-void AddressBookModel::saveAddressBook() {
-  QFile addressBookFile(Settings::instance().getAddressBookFile());
-  if (addressBookFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-    QByteArray file_content = QJsonDocument(m_addressBook).toJson(QJsonDocument::Compact);
-    addressBookFile.write(file_content);
-    addressBookFile.close();
-  }
-}
-
 void AddressBookModel::walletInitCompleted(int _error, const QString& _error_text) {
   if (!_error) {
-    QFile addressBookFile(Settings::instance().getAddressBookFile());
-    if (addressBookFile.open(QIODevice::ReadOnly)) {
-      QByteArray file_content = addressBookFile.readAll();
-      QJsonDocument doc = QJsonDocument::fromJson(file_content);
-      if (!doc.isNull()) {
-        m_addressBook = doc.array();
-      }
-
-      addressBookFile.close();
-      if (!m_addressBook.isEmpty()) {
-        beginInsertRows(QModelIndex(), 0, m_addressBook.size() - 1);
-        endInsertRows();
-      }
+    const QString addressBookFile = Settings::instance().getAddressBookFile();
+    beginResetModel();
+    const bool opened = m_addressBook.open(addressBookFile);
+    endResetModel();
+    if (!opened) {
+      QCoreApplication::postEvent(&MainWindow::instance(), new ShowMessageEvent(
+        tr("Could not open the address book %1, contacts can't be changed").arg(addressBookFile), QtCriticalMsg));
     }
   }
 }
 
+bool AddressBookModel::checkWritable() {
+  if (m_addressBook.isOpen()) {
+    return true;
+  }
+
+  QCoreApplication::postEvent(&MainWindow::instance(), new ShowMessageEvent(tr("The address book could not be opened, contacts can't be changed"),
+    QtCriticalMsg));
+  return false;
+}
+
 const QModelIndex AddressBookModel::indexFromContact(const QString& searchstring, const int& column){
-    QModelIndex index = match(AddressBookModel::index(0,column,QModelIndex()),
-            Qt::DisplayRole, searchstring, 1,
-            Qt::MatchFlags(Qt::MatchExactly|Qt::MatchRecursive))
-            .value(0);
+  int row = -1;
+  switch (column) {
+  case COLUMN_LABEL:
+    row = m_addressBook.findByLabel(searchstring);
+    break;
+  case COLUMN_ADDRESS:
+    row = m_addressBook.findByAddress(searchstring);
+    break;
+  default:
+    return match(AddressBookModel::index(0, column, QModelIndex()), Qt::DisplayRole, searchstring, 1,
+      Qt::MatchFlags(Qt::MatchExactly | Qt::MatchRecursive)).value(0);
+  }
 
-    return index;
+  return row < 0 ? QModelIndex() : index(row, column);
 }
 
 }
@@ -5,7 +5,8 @@
 #pragma once
 
 #include <QAbstractItemModel>
-#include <QJsonArray>
+
+#include "AddressBookStore.h"
 
 namespace WalletGui {
   
@@ -33,14 +34,15 @@ public:
   const QModelIndex indexFromContact(const QString& searchstring, const int& column);
 
 private:
-  QJsonArray m_addressBook;
+  AddressBookStore m_addressBook;
 
   AddressBookModel();
   ~AddressBookModel();
 
   void reset();
-  void saveAddressBook();
   void walletInitCompleted(int _error, const QString& _error_text);
+  // Reports and refuses changes while the address book failed to open
+  bool checkWritable();
 };
 
 }
@@ -0,0 +1,242 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QFileDialog>
+#include <QMessageBox>
+
+#include <Common/StringTools.h>
+#include <CryptoNoteConfig.h>
+
+#include "BatchPayoutDialog.h"
+#include "CurrencyAdapter.h"
+#include "MempoolFeeModel.h"
+#include "NodeAdapter.h"
+#include "PasswordDialog.h"
+#include "Settings.h"
+#include "WalletAdapter.h"
+
+#include "ui_batchpayoutdialog.h"
+
+namespace WalletGui {
+
+namespace {
+
+const quint32 PAYOUT_TARGET_BLOCKS = 3;
+// After this long without all answers the dialog can be closed again, the rows still being sent stay as they are
+const int SEND_TIMEOUT_MS = 5 * 60 * 1000;
+
+}
+
+BatchPayoutDialog::BatchPayoutDialog(QWidget* _parent) : QDialog(_parent), m_ui(new Ui::BatchPayoutDialog), m_model(new BatchPayoutModel(this)),
+  m_currentBatch(0), m_isSending(false) {
+  m_ui->setupUi(this);
+  m_ui->m_payoutsView->setModel(m_model);
+  m_ui->m_payoutsView->header()->setSectionResizeMode(BatchPayoutModel::COLUMN_ADDRESS, QHeaderView::Stretch);
+  m_ui->m_payoutsView->header()->setSectionResizeMode(BatchPayoutModel::COLUMN_AMOUNT, QHeaderView::ResizeToContents);
+  m_ui->m_payoutsView->header()->setSectionResizeMode(BatchPayoutModel::COLUMN_BATCH, QHeaderView::ResizeToContents);
+  m_ui->m_payoutsView->header()->setStretchLastSection(false);
+  m_ui->m_payoutsView->setUniformRowHeights(true);
+
+  connect(&WalletAdapter::instance(), &WalletAdapter::transactionJobCompletedSignal, this, &BatchPayoutDialog::sendTransactionCompleted,
+    Qt::QueuedConnection);
+  m_sendTimer.setSingleShot(true);
+  m_sendTimer.setInterval(SEND_TIMEOUT_MS);
+  connect(&m_sendTimer, &QTimer::timeout, this, &BatchPayoutDialog::sendTimedOut);
+  updateSummary();
+}
+
+BatchPayoutDialog::~BatchPayoutDialog() {
+}
+
+void BatchPayoutDialog::reject() {
+  if (m_isSending && m_sendTimer.isActive()) {
+    return;
+  }
+
+  QDialog::reject();
+}
+
+void BatchPayoutDialog::importClicked() {
+  QString fileName = QFileDialog::getOpenFileName(this, tr("Import payouts"), QDir::homePath(), tr("Payouts (*.csv *.txt *.json)"));
+  if (fileName.isEmpty()) {
+    return;
+  }
+
+  QString errorText;
+  if (!m_model->importFile(fileName, errorText)) {
+    QMessageBox::critical(this, tr("Import failed"), errorText, QMessageBox::Ok);
+    return;
+  }
+
+  m_model->validate();
+  repack();
+}
+
+void BatchPayoutDialog::clearClicked() {
+  m_model->clear();
+  m_batches.clear();
+  updateSummary();
+}
+
+void BatchPayoutDialog::mixinValueChanged(int _value) {
+  Q_UNUSED(_value);
+  repack();
+}
+
+void BatchPayoutDialog::repack() {
+  if (m_isSending || m_model->rowCount() == 0) {
+    return;
+  }
+
+  quint64 nodeFee = 0;
+  if (Settings::instance().getConnection().compare("remote") == 0 && !NodeAdapter::instance().getNodeFeeAddress().isEmpty()) {
+    nodeFee = std::min<quint64>(NodeAdapter::instance().getNodeFeeAmount(), CryptoNote::parameters::COIN);
+    if (nodeFee == 0) {
+      nodeFee = NodeAdapter::instance().getMinimalFee();
+    }
+  }
+
+  m_batches = m_model->pack(m_ui->m_mixinSpin->value(), MempoolFeeModel::instance().estimateFeePerByte(PAYOUT_TARGET_BLOCKS),
+    NodeAdapter::instance().getMinimalFee(), nodeFee,
+    CurrencyAdapter::instance().getMaxTransactionSize(NodeAdapter::instance().getCurrentBlockMajorVersion()));
+  m_currentBatch = 0;
+  updateSummary();
+}
+
+void BatchPayoutDialog::updateSummary() {
+  quint64 totalFee = 0;
+  quint64 totalAmount = 0;
+  int packedRows = 0;
+  for (const PayoutBatch& batch : m_batches) {
+    totalFee += batch.fee;
+    totalAmount += batch.amount;
+    packedRows += batch.rows.size();
+  }
+
+  m_ui->m_summaryLabel->setText(tr("%1 of %2 payouts in %3 transactions, amount %4 %5, fee %6 %5")
+    .arg(packedRows)
+    .arg(m_model->rowCount())
+    .arg(m_batches.size())
+    .arg(CurrencyAdapter::instance().formatAmount(totalAmount))
+    .arg(CurrencyAdapter::instance().getCurrencyTicker().toUpper())
+    .arg(CurrencyAdapter::instance().formatAmount(totalFee)));
+  m_ui->m_sendButton->setEnabled(!m_isSending && m_currentBatch < m_batches.size());
+}
+
+void BatchPayoutDialog::setSending(bool _sending) {
+  m_isSending = _sending;
+  m_ui->m_importButton->setEnabled(!_sending);
+  m_ui->m_clearButton->setEnabled(!_sending);
+  m_ui->m_mixinSpin->setEnabled(!_sending);
+  m_ui->m_closeButton->setEnabled(!_sending);
+  if (_sending) {
+    m_sendTimer.start();
+  } else {
+    m_sendTimer.stop();
+  }
+
+  updateSummary();
+}
+
+void BatchPayoutDialog::sendTimedOut() {
+  m_ui->m_closeButton->setEnabled(true);
+  QMessageBox::warning(this, tr("Send payouts"), tr("%1 transactions are still being sent. You can close the window, "
+    "check the transaction list before sending these payouts again.").arg(m_pendingJobs.size()), QMessageBox::Ok);
+}
+
+void BatchPayoutDialog::sendClicked() {
+  if (m_batches.isEmpty()) {
+    return;
+  }
+
+  quint64 total = 0;
+  for (int i = m_currentBatch; i < m_batches.size(); ++i) {
+    total += m_batches[i].amount + m_batches[i].fee;
+  }
+
+  if (QMessageBox::question(this, tr("Send payouts"), tr("Send %1 transactions for a total of %2 %3, fees included?")
+      .arg(m_batches.size() - m_currentBatch)
+      .arg(CurrencyAdapter::instance().formatAmount(total))
+      .arg(CurrencyAdapter::instance().getCurrencyTicker().toUpper()), QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes) {
+    return;
+  }
+
+  // The same password gate as the send frame
+  if (Settings::instance().isEncrypted()) {
+    PasswordDialog passwordDialog(false, this);
+    if (passwordDialog.exec() != QDialog::Accepted) {
+      return;
+    }
+
+    if (!WalletAdapter::instance().tryOpen(passwordDialog.getPassword())) {
+      QMessageBox::critical(this, tr("Incorrect password"), tr("Wrong password."), QMessageBox::Ok);
+      return;
+    }
+  } else if (!WalletAdapter::instance().tryOpen("")) {
+    return;
+  }
+
+  // Batches were packed from disjoint inputs, so the wallet builds and relays them side by side
+  setSending(true);
+  for (; m_currentBatch < m_batches.size(); ++m_currentBatch) {
+    sendBatch(m_currentBatch);
+  }
+}
+
+void BatchPayoutDialog::sendBatch(int _batch) {
+  const PayoutBatch& batch = m_batches[_batch];
+  std::vector<CryptoNote::WalletLegacyTransfer> transfers;
+  transfers.reserve(batch.rows.size() + 2);
+  for (int row : batch.rows) {
+    const QModelIndex index = m_model->index(row, 0);
+    CryptoNote::WalletLegacyTransfer transfer;
+    transfer.address = index.data(BatchPayoutModel::ROLE_ADDRESS).toString().toStdString();
+    transfer.amount = index.data(BatchPayoutModel::ROLE_AMOUNT).value<quint64>();
+    transfers.push_back(transfer);
+  }
+
+  if (batch.nodeFee > 0) {
+    CryptoNote::WalletLegacyTransfer transfer;
+    transfer.address = NodeAdapter::instance().getNodeFeeAddress().toStdString();
+    transfer.amount = batch.nodeFee;
+    transfers.push_back(transfer);
+  }
+
+  // Inputs are chosen up front, so the change goes back explicitly and the selected amount is spent in full
+  if (batch.change > 0) {
+    CryptoNote::WalletLegacyTransfer transfer;
+    transfer.address = WalletAdapter::instance().getAddress().toStdString();
+    transfer.amount = batch.change;
+    transfers.push_back(transfer);
+  }
+
+  m_model->setRowsStatus(batch.rows, BatchPayoutModel::STATUS_SENDING);
+  m_pendingJobs.insert(WalletAdapter::instance().sendTransactionAsync(transfers, batch.inputs, batch.fee, batch.paymentId, m_ui->m_mixinSpin->value()),
+    _batch);
+}
+
+void BatchPayoutDialog::sendTransactionCompleted(quint64 _jobId, CryptoNote::TransactionId _id, int _error, const QString& _errorText) {
+  if (!m_pendingJobs.contains(_jobId)) {
+    return;
+  }
+
+  const PayoutBatch& batch = m_batches[m_pendingJobs.take(_jobId)];
+  if (_error) {
+    m_model->setRowsStatus(batch.rows, BatchPayoutModel::STATUS_FAILED, _errorText);
+  } else {
+    CryptoNote::WalletLegacyTransaction transaction;
+    QString transactionHash;
+    if (WalletAdapter::instance().getTransaction(_id, transaction)) {
+      transactionHash = QString::fromStdString(Common::podToHex(transaction.hash));
+    }
+
+    m_model->setRowsStatus(batch.rows, BatchPayoutModel::STATUS_SENT, QString(), transactionHash);
+  }
+
+  if (m_pendingJobs.isEmpty()) {
+    setSending(false);
+  }
+}
+
+}
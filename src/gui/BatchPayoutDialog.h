@@ -0,0 +1,51 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QDialog>
+#include <QHash>
+#include <QTimer>
+
+#include "BatchPayoutModel.h"
+
+namespace Ui {
+class BatchPayoutDialog;
+}
+
+namespace WalletGui {
+
+class BatchPayoutDialog : public QDialog {
+  Q_OBJECT
+  Q_DISABLE_COPY(BatchPayoutDialog)
+
+public:
+  BatchPayoutDialog(QWidget* _parent);
+  ~BatchPayoutDialog();
+
+  void reject() Q_DECL_OVERRIDE;
+
+private:
+  QScopedPointer<Ui::BatchPayoutDialog> m_ui;
+  BatchPayoutModel* m_model;
+  QVector<PayoutBatch> m_batches;
+  int m_currentBatch;
+  QHash<quint64, int> m_pendingJobs;
+  bool m_isSending;
+  QTimer m_sendTimer;
+
+  void repack();
+  void updateSummary();
+  void setSending(bool _sending);
+  void sendBatch(int _batch);
+  void sendTimedOut();
+  void sendTransactionCompleted(quint64 _jobId, CryptoNote::TransactionId _id, int _error, const QString& _errorText);
+
+  Q_SLOT void importClicked();
+  Q_SLOT void clearClicked();
+  Q_SLOT void sendClicked();
+  Q_SLOT void mixinValueChanged(int _value);
+};
+
+}
@@ -0,0 +1,438 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QRegExp>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include "BatchPayoutModel.h"
+#include "CurrencyAdapter.h"
+#include "TransactionSizeEstimator.h"
+#include "WalletAdapter.h"
+
+namespace WalletGui {
+
+namespace {
+
+const int VALIDATION_CHUNK_SIZE = 256;
+
+}
+
+class PayoutValidationTask : public QRunnable {
+public:
+  PayoutValidationTask(BatchPayoutModel::PayoutRow* _begin, BatchPayoutModel::PayoutRow* _end) : m_begin(_begin), m_end(_end) {
+  }
+
+  void run() Q_DECL_OVERRIDE {
+    const QRegExp paymentIdMatcher("^[0-9A-F]{64}$", Qt::CaseInsensitive);
+    for (BatchPayoutModel::PayoutRow* row = m_begin; row != m_end; ++row) {
+      row->amount = CurrencyAdapter::instance().parseAmount(row->amountText);
+      if (!CurrencyAdapter::instance().validateAddress(row->address)) {
+        row->status = BatchPayoutModel::STATUS_INVALID;
+        row->error = BatchPayoutModel::tr("Invalid address");
+      } else if (row->amount == 0) {
+        row->status = BatchPayoutModel::STATUS_INVALID;
+        row->error = BatchPayoutModel::tr("Invalid amount");
+      } else if (!row->paymentId.isEmpty() && !paymentIdMatcher.exactMatch(row->paymentId)) {
+        row->status = BatchPayoutModel::STATUS_INVALID;
+        row->error = BatchPayoutModel::tr("Invalid payment ID");
+      } else {
+        row->status = BatchPayoutModel::STATUS_VALID;
+        row->error.clear();
+      }
+    }
+  }
+
+private:
+  BatchPayoutModel::PayoutRow* m_begin;
+  BatchPayoutModel::PayoutRow* m_end;
+};
+
+BatchPayoutModel::BatchPayoutModel(QObject* _parent) : QAbstractItemModel(_parent) {
+}
+
+BatchPayoutModel::~BatchPayoutModel() {
+}
+
+QModelIndex BatchPayoutModel::index(int _row, int _column, const QModelIndex& _parent) const {
+  if (_parent.isValid()) {
+    return QModelIndex();
+  }
+
+  return createIndex(_row, _column, _row);
+}
+
+QModelIndex BatchPayoutModel::parent(const QModelIndex& _index) const {
+  return QModelIndex();
+}
+
+int BatchPayoutModel::columnCount(const QModelIndex& _parent) const {
+  return COLUMN_STATUS + 1;
+}
+
+int BatchPayoutModel::rowCount(const QModelIndex& _parent) const {
+  return m_rows.size();
+}
+
+QVariant BatchPayoutModel::data(const QModelIndex& _index, int _role) const {
+  if (!_index.isValid()) {
+    return QVariant();
+  }
+
+  const PayoutRow& row = m_rows[_index.row()];
+  switch (_role) {
+  case Qt::DisplayRole:
+    switch (_index.column()) {
+    case COLUMN_ADDRESS:
+      return row.address;
+    case COLUMN_AMOUNT:
+      return row.amount > 0 ? CurrencyAdapter::instance().formatAmount(row.amount) : row.amountText;
+    case COLUMN_PAYMENT_ID:
+      return row.paymentId;
+    case COLUMN_BATCH:
+      return row.batch > 0 ? QVariant(row.batch) : QVariant();
+    case COLUMN_STATUS:
+      return row.error.isEmpty() ? statusText(row.status) : QString("%1: %2").arg(statusText(row.status)).arg(row.error);
+    default:
+      return QVariant();
+    }
+
+  case Qt::ToolTipRole:
+    if (_index.column() == COLUMN_STATUS && !row.transactionHash.isEmpty()) {
+      return row.transactionHash;
+    }
+
+    return QVariant();
+
+  case ROLE_ADDRESS:
+    return row.address;
+  case ROLE_AMOUNT:
+    return static_cast<quint64>(row.amount);
+  case ROLE_PAYMENT_ID:
+    return row.paymentId;
+  case ROLE_BATCH:
+    return row.batch;
+  case ROLE_STATUS:
+    return static_cast<int>(row.status);
+  case ROLE_ERROR:
+    return row.error;
+  case ROLE_TRANSACTION_HASH:
+    return row.transactionHash;
+  default:
+    return QVariant();
+  }
+
+  return QVariant();
+}
+
+Qt::ItemFlags BatchPayoutModel::flags(const QModelIndex& _index) const {
+  return (Qt::ItemIsEnabled | Qt::ItemNeverHasChildren | Qt::ItemIsSelectable);
+}
+
+QVariant BatchPayoutModel::headerData(int _section, Qt::Orientation _orientation, int _role) const {
+  if (_orientation != Qt::Horizontal || _role != Qt::DisplayRole) {
+    return QVariant();
+  }
+
+  switch (_section) {
+  case COLUMN_ADDRESS:
+    return tr("Address");
+  case COLUMN_AMOUNT:
+    return tr("Amount");
+  case COLUMN_PAYMENT_ID:
+    return tr("Payment ID");
+  case COLUMN_BATCH:
+    return tr("Transaction");
+  case COLUMN_STATUS:
+    return tr("Status");
+  }
+
+  return QVariant();
+}
+
+QString BatchPayoutModel::statusText(Status _status) {
+  switch (_status) {
+  case STATUS_NEW:
+    return tr("New");
+  case STATUS_INVALID:
+    return tr("Invalid");
+  case STATUS_VALID:
+    return tr("Valid");
+  case STATUS_PACKED:
+    return tr("Ready");
+  case STATUS_SENDING:
+    return tr("Sending");
+  case STATUS_SENT:
+    return tr("Sent");
+  case STATUS_FAILED:
+    return tr("Failed");
+  }
+
+  return QString();
+}
+
+void BatchPayoutModel::clear() {
+  beginResetModel();
+  m_rows.clear();
+  endResetModel();
+}
+
+bool BatchPayoutModel::importFile(const QString& _fileName, QString& _errorText) {
+  QFile file(_fileName);
+  if (!file.open(QIODevice::ReadOnly)) {
+    _errorText = tr("Cannot open file %1").arg(_fileName);
+    return false;
+  }
+
+  const QByteArray content = file.readAll();
+  file.close();
+
+  QVector<PayoutRow> rows;
+  const bool isJson = QFileInfo(_fileName).suffix().compare("json", Qt::CaseInsensitive) == 0 || content.trimmed().startsWith('[');
+  if (!(isJson ? parseJson(content, rows, _errorText) : parseCsv(content, rows, _errorText))) {
+    return false;
+  }
+
+  appendRows(rows);
+  return true;
+}
+
+bool BatchPayoutModel::parseCsv(const QByteArray& _content, QVector<PayoutRow>& _rows, QString& _errorText) const {
+  // Empty lines are kept in the split so the line numbers of errors match the file
+  const QStringList lines = QString::fromUtf8(_content).split(QRegExp("\r\n|\r|\n"));
+  const QRegExp separator("[,;\t]");
+  int lineNumber = 0;
+  bool isFirstRow = true;
+  for (const QString& line : lines) {
+    ++lineNumber;
+    const QString trimmedLine = line.trimmed();
+    if (trimmedLine.isEmpty() || trimmedLine.startsWith('#')) {
+      continue;
+    }
+
+    const QStringList fields = trimmedLine.split(separator);
+    if (isFirstRow) {
+      isFirstRow = false;
+      if (fields.first().trimmed().compare("address", Qt::CaseInsensitive) == 0) {
+        continue;
+      }
+    }
+
+    if (fields.size() < 2) {
+      _errorText = tr("Line %1: expected address, amount and optional payment ID").arg(lineNumber);
+      return false;
+    }
+
+    _rows.append(PayoutRow {fields[0].trimmed(), fields[1].trimmed(), 0, fields.size() > 2 ? fields[2].trimmed() : QString(), 0, STATUS_NEW, QString(), QString()});
+  }
+
+  return true;
+}
+
+bool BatchPayoutModel::parseJson(const QByteArray& _content, QVector<PayoutRow>& _rows, QString& _errorText) const {
+  QJsonParseError parseError;
+  const QJsonDocument document = QJsonDocument::fromJson(_content, &parseError);
+  if (parseError.error != QJsonParseError::NoError || !document.isArray()) {
+    _errorText = tr("Expected a JSON array of payouts: %1").arg(parseError.errorString());
+    return false;
+  }
+
+  const QJsonArray payouts = document.array();
+  for (int i = 0; i < payouts.size(); ++i) {
+    const QJsonObject payout = payouts[i].toObject();
+    // JSON numbers are doubles, amounts have to be strings to be exact
+    const QJsonValue amount = payout.value("amount");
+    if (!amount.isString()) {
+      _errorText = tr("Payout %1: the amount must be a string").arg(i + 1);
+      return false;
+    }
+
+    QString paymentId = payout.value("paymentId").toString();
+    if (paymentId.isEmpty()) {
+      paymentId = payout.value("payment_id").toString();
+    }
+
+    _rows.append(PayoutRow {payout.value("address").toString().trimmed(), amount.toString(),
+      0, paymentId.trimmed(), 0, STATUS_NEW, QString(), QString()});
+  }
+
+  return true;
+}
+
+void BatchPayoutModel::appendRows(const QVector<PayoutRow>& _rows) {
+  if (_rows.isEmpty()) {
+    return;
+  }
+
+  beginInsertRows(QModelIndex(), m_rows.size(), m_rows.size() + _rows.size() - 1);
+  m_rows += _rows;
+  endInsertRows();
+}
+
+int BatchPayoutModel::validate() {
+  if (m_rows.isEmpty()) {
+    return 0;
+  }
+
+  // Rows are split into disjoint chunks, so the tasks never touch the same row
+  QThreadPool pool;
+  PayoutRow* rows = m_rows.data();
+  for (int begin = 0; begin < m_rows.size(); begin += VALIDATION_CHUNK_SIZE) {
+    const int end = std::min(begin + VALIDATION_CHUNK_SIZE, m_rows.size());
+    pool.start(new PayoutValidationTask(rows + begin, rows + end));
+  }
+
+  pool.waitForDone();
+  Q_EMIT dataChanged(index(0, 0), index(m_rows.size() - 1, COLUMN_STATUS));
+  return getValidCount();
+}
+
+QVector<PayoutBatch> BatchPayoutModel::pack(quint64 _mixin, quint64 _feePerByte, quint64 _minimalFee, quint64 _nodeFee, quint64 _maxTransactionSize) {
+  // One payment ID per transaction, so recipients are grouped by it first
+  QMap<QString, QVector<int>> groups;
+  for (int i = 0; i < m_rows.size(); ++i) {
+    PayoutRow& row = m_rows[i];
+    // Only validated rows not sent yet, rows being sent or already paid are never packed again
+    if (row.status != STATUS_VALID && row.status != STATUS_PACKED && row.status != STATUS_FAILED) {
+      continue;
+    }
+
+    row.status = STATUS_VALID;
+    row.batch = 0;
+    row.error.clear();
+    groups[row.paymentId.toUpper()].append(i);
+  }
+
+  // Largest outputs first keeps the number of inputs, and so the size, of every transaction minimal
+  std::vector<CryptoNote::TransactionOutputInformation> pool = WalletAdapter::instance().getSpendableOutputs();
+  std::sort(pool.begin(), pool.end(), [](const CryptoNote::TransactionOutputInformation& _left, const CryptoNote::TransactionOutputInformation& _right) {
+    return _left.amount > _right.amount;
+  });
+
+  const TransactionSizeEstimator estimator(CurrencyAdapter::instance().getCurrency().defaultDustThreshold());
+  size_t poolPosition = 0;
+  QVector<PayoutBatch> batches;
+  for (auto group = groups.begin(); group != groups.end(); ++group) {
+    QVector<int> pending = group.value();
+    std::sort(pending.begin(), pending.end(), [this](int _left, int _right) { return m_rows[_left].amount > m_rows[_right].amount; });
+    const size_t extraSize = group.key().isEmpty() ? 0 : TransactionSizeEstimator::paymentIdExtraSize();
+
+    while (!pending.isEmpty()) {
+      PayoutBatch batch {{}, group.key(), _nodeFee, 0, _nodeFee, 0, 0, {}};
+      quint64 outputsCount = estimator.decomposedOutputCount(_nodeFee);
+      size_t inputsCount = 0;
+      quint64 selectedAmount = 0;
+
+      // Checks whether the batch still fits after adding _amount, extending the input selection if needed
+      auto fits = [&](quint64 _amount, quint64 _outputs, size_t& _inputs, quint64& _selected, quint64& _fee, quint64& _size) {
+        _inputs = inputsCount;
+        _selected = selectedAmount;
+        _fee = _minimalFee;
+        for (int iteration = 0; iteration < 4; ++iteration) {
+          while (_selected < _amount + _fee && poolPosition + _inputs < pool.size()) {
+            _selected += pool[poolPosition + _inputs].amount;
+            ++_inputs;
+          }
+
+          if (_selected < _amount + _fee) {
+            return false;
+          }
+
+          _size = TransactionSizeEstimator::estimateMaxSize(_inputs, _outputs + estimator.decomposedOutputCount(_selected - _amount - _fee), _mixin, extraSize);
+          const quint64 requiredFee = TransactionSizeEstimator::requiredFee(_size, _feePerByte, _minimalFee);
+          if (requiredFee <= _fee) {
+            break;
+          }
+
+          _fee = requiredFee;
+        }
+
+        return _size <= _maxTransactionSize;
+      };
+
+      QVector<int> skipped;
+      QString lastError;
+      for (int rowIndex : pending) {
+        const PayoutRow& row = m_rows[rowIndex];
+        size_t inputs;
+        quint64 selected;
+        quint64 fee;
+        quint64 size;
+        if (!fits(batch.amount + row.amount, outputsCount + estimator.decomposedOutputCount(row.amount), inputs, selected, fee, size)) {
+          lastError = selected < batch.amount + row.amount + fee ? tr("Insufficient unlocked balance") : tr("Does not fit into a transaction");
+          skipped.append(rowIndex);
+          continue;
+        }
+
+        batch.rows.append(rowIndex);
+        batch.amount += row.amount;
+        batch.fee = fee;
+        batch.estimatedSize = size;
+        outputsCount += estimator.decomposedOutputCount(row.amount);
+        inputsCount = inputs;
+        selectedAmount = selected;
+      }
+
+      if (batch.rows.isEmpty()) {
+        for (int rowIndex : skipped) {
+          m_rows[rowIndex].status = STATUS_FAILED;
+          m_rows[rowIndex].error = lastError;
+        }
+
+        break;
+      }
+
+      batch.change = selectedAmount - batch.amount - batch.fee;
+      batch.inputs.assign(pool.begin() + poolPosition, pool.begin() + poolPosition + inputsCount);
+      poolPosition += inputsCount;
+      batches.append(batch);
+      for (int rowIndex : batch.rows) {
+        m_rows[rowIndex].status = STATUS_PACKED;
+        m_rows[rowIndex].batch = batches.size();
+      }
+
+      pending = skipped;
+    }
+  }
+
+  if (!m_rows.isEmpty()) {
+    Q_EMIT dataChanged(index(0, 0), index(m_rows.size() - 1, COLUMN_STATUS));
+  }
+
+  return batches;
+}
+
+quint64 BatchPayoutModel::getValidAmount() const {
+  quint64 amount = 0;
+  for (const PayoutRow& row : m_rows) {
+    if (row.status != STATUS_INVALID && row.status != STATUS_NEW) {
+      amount += row.amount;
+    }
+  }
+
+  return amount;
+}
+
+int BatchPayoutModel::getValidCount() const {
+  return std::count_if(m_rows.begin(), m_rows.end(), [](const PayoutRow& _row) { return _row.status != STATUS_INVALID && _row.status != STATUS_NEW; });
+}
+
+void BatchPayoutModel::setRowsStatus(const QVector<int>& _rows, Status _status, const QString& _error, const QString& _transactionHash) {
+  for (int rowIndex : _rows) {
+    m_rows[rowIndex].status = _status;
+    m_rows[rowIndex].error = _error;
+    m_rows[rowIndex].transactionHash = _transactionHash;
+    Q_EMIT dataChanged(index(rowIndex, 0), index(rowIndex, COLUMN_STATUS));
+  }
+}
+
+}
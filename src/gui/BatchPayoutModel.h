@@ -0,0 +1,86 @@
+// Copyright (c) 2016-2021 The Karbo developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <list>
+
+#include <QAbstractItemModel>
+#include <QVector>
+
+#include <IWalletLegacy.h>
+
+namespace WalletGui {
+
+struct PayoutBatch {
+  QVector<int> rows;
+  QString paymentId;
+  quint64 amount;
+  quint64 fee;
+  quint64 nodeFee;
+  quint64 change;
+  quint64 estimatedSize;
+  std::list<CryptoNote::TransactionOutputInformation> inputs;
+};
+
+class BatchPayoutModel : public QAbstractItemModel {
+  Q_OBJECT
+  Q_DISABLE_COPY(BatchPayoutModel)
+
+public:
+  enum Columns {
+    COLUMN_ADDRESS = 0, COLUMN_AMOUNT, COLUMN_PAYMENT_ID, COLUMN_BATCH, COLUMN_STATUS
+  };
+
+  enum Roles {
+    ROLE_ADDRESS = Qt::UserRole, ROLE_AMOUNT, ROLE_PAYMENT_ID, ROLE_BATCH, ROLE_STATUS, ROLE_ERROR, ROLE_TRANSACTION_HASH
+  };
+
+  enum Status {
+    STATUS_NEW = 0, STATUS_INVALID, STATUS_VALID, STATUS_PACKED, STATUS_SENDING, STATUS_SENT, STATUS_FAILED
+  };
+
+  BatchPayoutModel(QObject* _parent);
+  ~BatchPayoutModel();
+
+  int columnCount(const QModelIndex& _parent = QModelIndex()) const Q_DECL_OVERRIDE;
+  QVariant data(const QModelIndex& _index, int _role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+  Qt::ItemFlags flags(const QModelIndex& _index) const Q_DECL_OVERRIDE;
+  QVariant headerData(int _section, Qt::Orientation _orientation, int _role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+  QModelIndex index(int _row, int _column, const QModelIndex& _parent = QModelIndex()) const Q_DECL_OVERRIDE;
+  QModelIndex parent(const QModelIndex& _index) const Q_DECL_OVERRIDE;
+  int rowCount(const QModelIndex& _parent = QModelIndex()) const Q_DECL_OVERRIDE;
+
+  bool importFile(const QString& _fileName, QString& _errorText);
+  void clear();
+  int validate();
+  QVector<PayoutBatch> pack(quint64 _mixin, quint64 _feePerByte, quint64 _minimalFee, quint64 _nodeFee, quint64 _maxTransactionSize);
+
+  quint64 getValidAmount() const;
+  int getValidCount() const;
+  void setRowsStatus(const QVector<int>& _rows, Status _status, const QString& _error = QString(), const QString& _transactionHash = QString());
+
+private:
+  struct PayoutRow {
+    QString address;
+    QString amountText;
+    quint64 amount;
+    QString paymentId;
+    int batch;
+    Status status;
+    QString error;
+    QString transactionHash;
+  };
+
+  friend class PayoutValidationTask;
+
+  QVector<PayoutRow> m_rows;
+
+  void appendRows(const QVector<PayoutRow>& _rows);
+  bool parseCsv(const QByteArray& _content, QVector<PayoutRow>& _rows, QString& _errorText) const;
+  bool parseJson(const QByteArray& _content, QVector<PayoutRow>& _rows, QString& _errorText) const;
+  static QString statusText(Status _status);
+};
+
+}
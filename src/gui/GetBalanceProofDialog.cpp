@@ -6,28 +6,60 @@
 #include "ui_getbalanceproofdialog.h"
 
 #include <QClipboard>
+#include <QCoreApplication>
 #include <QFileDialog>
 #include <QBuffer>
+#include <QMessageBox>
+#include <QTemporaryFile>
 #include <QTextStream>
 
 #include "Common/Base58.h"
 #include "Common/StringTools.h"
 #include "CurrencyAdapter.h"
+#include "Settings.h"
 #include "WalletAdapter.h"
 #include "MainWindow.h"
 
 namespace WalletGui {
 
-GetBalanceProofDialog::GetBalanceProofDialog(QWidget* _parent) : QDialog(_parent), m_ui(new Ui::GetBalanceProofDialog) {
+namespace {
+
+// Typing in the message restarts the proof once per pause, not per key
+const int GENERATE_DELAY_MS = 400;
+// Larger proofs are only saved, not shown
+const qint64 MAX_SHOWN_PROOF_SIZE = 1024 * 1024;
+
+}
+
+GetBalanceProofDialog::GetBalanceProofDialog(QWidget* _parent) : QDialog(_parent), m_proofId(0), m_ui(new Ui::GetBalanceProofDialog) {
   m_ui->setupUi(this);
+  // An unpredictable owner-only name in the data directory, not in the temporary directory shared with other users
+  QTemporaryFile proofFile(Settings::instance().getDataDir().absoluteFilePath("reserve-proof-XXXXXX.txt"));
+  proofFile.setAutoRemove(false);
+  if (proofFile.open()) {
+    m_proofFile = proofFile.fileName();
+  }
+
+  m_generateTimer.setSingleShot(true);
+  m_generateTimer.setInterval(GENERATE_DELAY_MS);
+  connect(&m_generateTimer, &QTimer::timeout, this, &GetBalanceProofDialog::startProof);
   connect(&WalletAdapter::instance(), &WalletAdapter::walletActualBalanceUpdatedSignal, this, &GetBalanceProofDialog::walletBalanceUpdated, Qt::QueuedConnection);
+  connect(&WalletAdapter::instance(), &WalletAdapter::reserveProofProgressSignal, this, &GetBalanceProofDialog::proofProgress, Qt::QueuedConnection);
+  connect(&WalletAdapter::instance(), &WalletAdapter::reserveProofCompletedSignal, this, &GetBalanceProofDialog::proofCompleted, Qt::QueuedConnection);
   m_ui->m_amountSpin->setSuffix(" " + CurrencyAdapter::instance().getCurrencyTicker().toUpper());
   m_amount = WalletAdapter::instance().getActualBalance();
   m_ui->m_amountSpin->setValue(CurrencyAdapter::instance().formatAmount(m_amount).toDouble());
-  genProof();
+  setGenerating(false);
+  startProof();
 }
 
 GetBalanceProofDialog::~GetBalanceProofDialog() {
+  if (m_proofId != 0) {
+    WalletAdapter::instance().cancelReserveProof();
+  }
+
+  // A proof still running removes the file itself once it sees the cancel
+  QFile::remove(m_proofFile);
 }
 
 void GetBalanceProofDialog::walletBalanceUpdated() {
@@ -38,19 +70,90 @@ void GetBalanceProofDialog::walletBalanceUpdated() {
 }
 
 void GetBalanceProofDialog::genProof() {
+  m_generateTimer.start();
+}
+
+void GetBalanceProofDialog::startProof() {
   m_message = m_ui->m_messageEdit->toPlainText().toUtf8().constData();
   m_amount = static_cast<quint64>(CurrencyAdapter::instance().parseAmount(m_ui->m_amountSpin->cleanText()));
   quint64 balance = WalletAdapter::instance().getActualBalance();
   if (balance != 0 && (m_amount > balance || m_amount == 0)) {
       m_amount = balance;
+      m_ui->m_amountSpin->blockSignals(true);
       m_ui->m_amountSpin->setValue(CurrencyAdapter::instance().formatAmount(m_amount).toDouble());
+      m_ui->m_amountSpin->blockSignals(false);
   }
-  if (m_amount > 0) {
-    m_proof = WalletAdapter::instance().getReserveProof(m_amount, m_message);
+
+  // The previous proof no longer matches the amount or the message
+  WalletAdapter::instance().cancelReserveProof();
+  m_proofId = 0;
+  QFile::remove(m_proofFile);
+  m_proof.clear();
+  m_ui->m_signatureEdit->setText("");
+  if (m_amount == 0) {
+    setGenerating(false);
+    m_ui->m_amountSpin->setValue(0);
+    return;
+  }
+
+  QString error;
+  m_proofId = WalletAdapter::instance().generateReserveProofAsync(m_amount, m_message, m_proofFile, error);
+  if (m_proofId == 0) {
+    setGenerating(false);
+    QMessageBox::critical(this, tr("Failed to get the reserve proof"), error, QMessageBox::Ok);
+    return;
+  }
+
+  m_ui->m_proofProgressBar->setValue(0);
+  setGenerating(true);
+}
+
+void GetBalanceProofDialog::setGenerating(bool _generating) {
+  m_ui->m_proofProgressBar->setVisible(_generating);
+  m_ui->m_cancelProofButton->setVisible(_generating);
+  m_ui->m_saveProofButton->setEnabled(!_generating && QFile::exists(m_proofFile));
+  m_ui->m_copyProofButton->setEnabled(!_generating && !m_proof.isEmpty());
+}
+
+void GetBalanceProofDialog::proofProgress(quint64 _proofId, quint64 _done, quint64 _total) {
+  if (_proofId == m_proofId && _total != 0) {
+    m_ui->m_proofProgressBar->setValue(static_cast<int>(_done * 100 / _total));
+  }
+}
+
+void GetBalanceProofDialog::proofCompleted(quint64 _proofId, bool _error, const QString& _errorText) {
+  if (_proofId != m_proofId) {
+    return;
+  }
+
+  m_proofId = 0;
+  if (_error) {
+    setGenerating(false);
+    if (!_errorText.isEmpty()) {
+      QMessageBox::critical(this, tr("Failed to get the reserve proof"), _errorText, QMessageBox::Ok);
+    }
+
+    return;
+  }
+
+  QFile file(m_proofFile);
+  if (file.size() <= MAX_SHOWN_PROOF_SIZE && file.open(QIODevice::ReadOnly)) {
+    m_proof = QString::fromLatin1(file.readAll());
     m_ui->m_signatureEdit->setText(m_proof);
   } else {
-    m_ui->m_amountSpin->setValue(0);
-    m_ui->m_signatureEdit->setText("");
+    m_ui->m_signatureEdit->setText(tr("The proof takes %1 MB, save it to a file.").arg(file.size() / (1024.0 * 1024.0), 0, 'f', 1));
+  }
+
+  setGenerating(false);
+}
+
+// The proof stops at the end of its current chunk and reports it, proofCompleted() then resets the dialog
+void GetBalanceProofDialog::cancelProof() {
+  m_generateTimer.stop();
+  if (m_proofId != 0) {
+    WalletAdapter::instance().cancelReserveProof();
+  } else {
+    setGenerating(false);
   }
 }
 
@@ -59,15 +162,23 @@ void GetBalanceProofDialog::copyProof() {
 }
 
 void GetBalanceProofDialog::saveProof() {
- QString file = QFileDialog::getSaveFileName(&MainWindow::instance(), tr("Save as"), QDir::homePath(), "TXT (*.txt)");
-   if (!file.isEmpty()) {
-     QFile f(file);
-      if (f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-        QTextStream outputStream(&f);
-        outputStream << m_proof;
-        f.close();
-      }
-   }
+  QString file = QFileDialog::getSaveFileName(&MainWindow::instance(), tr("Save as"), QDir::homePath(), "TXT (*.txt)");
+  if (file.isEmpty()) {
+    return;
+  }
+
+  // QFile::copy doesn't overwrite, the dialog already asked about replacing the file
+  if (QFile::exists(file) && !QFile::remove(file)) {
+    QMessageBox::critical(this, tr("Failed to save the reserve proof"), tr("Could not replace %1").arg(QDir::toNativeSeparators(file)),
+      QMessageBox::Ok);
+    return;
+  }
+
+  QFile proof(m_proofFile);
+  if (!proof.copy(file)) {
+    QMessageBox::critical(this, tr("Failed to save the reserve proof"),
+      tr("Could not save the proof to %1: %2").arg(QDir::toNativeSeparators(file)).arg(proof.errorString()), QMessageBox::Ok);
+  }
 }
 
 }
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <QDialog>
+#include <QTimer>
 
 namespace Ui {
 class GetBalanceProofDialog;
@@ -22,8 +23,17 @@ private:
     quint64 m_amount;
     QString m_message;
     QString m_proof;
+    QString m_proofFile;
+    quint64 m_proofId;
+    QTimer m_generateTimer;
+
+    void startProof();
+    void setGenerating(bool _generating);
+    void proofProgress(quint64 _proofId, quint64 _done, quint64 _total);
+    void proofCompleted(quint64 _proofId, bool _error, const QString& _errorText);
 
     Q_SLOT void genProof();
+    Q_SLOT void cancelProof();
     Q_SLOT void copyProof();
     Q_SLOT void saveProof();
 
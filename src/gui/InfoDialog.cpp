@@ -14,6 +14,7 @@
 #include "CryptoNoteWrapper.h"
 #include "CurrencyAdapter.h"
 #include "ConnectionsModel.h"
+#include "StartupProfiler.h"
 
 #include "ui_infodialog.h"
 
@@ -43,6 +44,7 @@ InfoDialog::InfoDialog(QWidget* _parent) : QDialog(_parent), m_ui(new Ui::InfoDi
   m_contextMenu->addAction(QString(tr("Copy &Id")), this, SLOT(copyIdClicked()));
 
   ConnectionsModel::instance().refreshConnections();
+  m_ui->m_startupProfile->setPlainText(StartupProfiler::instance().getSummary());
 }
 
 InfoDialog::~InfoDialog() {
@@ -91,6 +93,12 @@ void InfoDialog::timerEvent(QTimerEvent* _event) {
     quint64 coinsInCirculation = NodeAdapter::instance().getAlreadyGeneratedCoins();
     m_ui->m_alreadyGeneratedCoins->setText(QString(tr("%1 %2")).arg(CurrencyAdapter::instance().formatAmount(coinsInCirculation)).arg(CurrencyAdapter::instance().getCurrencyTicker()));
 
+    // The wallet load and the first block of the node may end after the dialog was opened
+    const QString startupProfile = StartupProfiler::instance().getSummary();
+    if (startupProfile != m_ui->m_startupProfile->toPlainText()) {
+      m_ui->m_startupProfile->setPlainText(startupProfile);
+    }
+
     return;
   }
 
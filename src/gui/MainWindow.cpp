@@ -25,8 +25,10 @@
 #include <Common/Base58.h>
 #include <Common/StringTools.h>
 #include <Common/Util.h>
+#include <Wallet/WalletErrors.h>
 #include "AboutDialog.h"
 #include "AnimatedLabel.h"
+#include "BatchPayoutDialog.h"
 #include "AddressBookModel.h"
 #include "ChangePasswordDialog.h"
 #include "ConnectionSettings.h"
@@ -85,7 +87,7 @@ MainWindow::MainWindow() : QMainWindow(),
   m_ui->setupUi(this);
   m_connectionStateIconLabel = new QPushButton();
   m_connectionStateIconLabel->setFlat(true); // Make the button look like a label, but clickable
-  m_connectionStateIconLabel->setStyleSheet(".QPushButton { background-color: rgba(255, 255, 255, 0); border: none;}");
+  m_connectionStateIconLabel->setObjectName("m_connectionStateButton");
   m_connectionStateIconLabel->setMaximumSize(16, 16);
   m_encryptionStateIconLabel = new QLabel(this);
   m_trackingModeIconLabel = new QLabel(this);
@@ -123,11 +125,24 @@ void MainWindow::connectToSignals() {
   connect(&WalletAdapter::instance(), &WalletAdapter::walletTransactionCreatedSignal, this, [this]() {
       QApplication::alert(this);
   });
+  // Sends complete on the wallet's threads, including the ones that fail before a transaction exists
   connect(&WalletAdapter::instance(), &WalletAdapter::walletSendTransactionCompletedSignal, this, [this](CryptoNote::TransactionId _transactionId, int _error, const QString& _errorString) {
+    Q_UNUSED(_transactionId);
     if (_error == 0) {
       m_ui->m_transactionsAction->setChecked(true);
     }
-  });
+
+    // The send progress is in the window, tell about the outcome when the wallet sits in the tray
+    if (m_trayIcon == nullptr || isVisible() || _error == CryptoNote::error::WalletErrorCodes::OPERATION_CANCELLED) {
+      return;
+    }
+
+    if (_error == 0) {
+      m_trayIcon->showMessage(tr("Transaction sent"), tr("The transaction was relayed to the network."), QSystemTrayIcon::Information);
+    } else {
+      m_trayIcon->showMessage(tr("Transaction failed"), _errorString, QSystemTrayIcon::Warning);
+    }
+  }, Qt::QueuedConnection);
   connect(&NodeAdapter::instance(), &NodeAdapter::peerCountUpdatedSignal, this, &MainWindow::peerCountUpdated, Qt::QueuedConnection);
   connect(m_ui->m_exitAction, &QAction::triggered, qApp, &QApplication::quit);
   connect(m_ui->m_sendFrame, &SendFrame::uriOpenSignal, this, &MainWindow::onUriOpenSignal, Qt::QueuedConnection);
@@ -243,7 +258,7 @@ void MainWindow::initUi() {
   m_ui->m_closeToTrayAction->deleteLater();
 #endif
 
-  OptimizationManager* optimizationManager = new OptimizationManager(this);
+  optimizationManager = new OptimizationManager(this);
   createTrayIconMenu();
 }
 
@@ -632,6 +647,7 @@ void MainWindow::isTrackingMode() {
   m_ui->m_overviewAction->trigger();
   m_ui->m_sendAction->setEnabled(false);
   m_ui->m_openUriAction->setEnabled(false);
+  m_ui->m_batchPayoutAction->setEnabled(false);
   m_ui->m_showMnemonicSeedAction->setEnabled(false);
   m_ui->m_optimizationAction->setEnabled(false);
   m_ui->m_proofBalanceAction->setEnabled(false);
@@ -782,7 +798,7 @@ void MainWindow::openConnectionSettings() {
 }
 
 void MainWindow::openOptimizationSettings() {
-  OptimizationSettingsDialog dlg(&MainWindow::instance());
+  OptimizationSettingsDialog dlg(optimizationManager, &MainWindow::instance());
   dlg.exec();
 }
 
@@ -795,6 +811,11 @@ void MainWindow::getBalanceProof() {
   dlg.exec();
 }
 
+void MainWindow::openBatchPayouts() {
+  BatchPayoutDialog dlg(&MainWindow::instance());
+  dlg.exec();
+}
+
 void MainWindow::showStatusInfo() {
   InfoDialog dlg(this);
   dlg.exec();
@@ -1153,6 +1174,7 @@ void MainWindow::walletOpened(bool _error, const QString& _error_text) {
     m_ui->m_showPrivateKey->setEnabled(true);
     m_ui->m_resetAction->setEnabled(true);
     m_ui->m_openUriAction->setEnabled(true);
+    m_ui->m_batchPayoutAction->setEnabled(true);
     m_ui->m_optimizationAction->setEnabled(true);
     m_ui->m_signMessageAction->setEnabled(true);
     m_ui->m_verifySignedMessageAction->setEnabled(true);
@@ -1193,6 +1215,7 @@ void MainWindow::walletClosed() {
   m_ui->m_changePasswordAction->setEnabled(false);
   m_ui->m_closeWalletAction->setEnabled(false);
   m_ui->m_openUriAction->setEnabled(false);
+  m_ui->m_batchPayoutAction->setEnabled(false);
   m_ui->m_exportTrackingKeyAction->setEnabled(false);
   m_ui->m_showPrivateKey->setEnabled(false);
   m_ui->m_resetAction->setEnabled(false);
@@ -142,6 +142,7 @@ private:
   Q_SLOT void showMnemonicSeed();
   Q_SLOT void restoreFromMnemonicSeed();
   Q_SLOT void getBalanceProof();
+  Q_SLOT void openBatchPayouts();
   Q_SLOT void lockWalletWithPassword();
 
   bool isObscured(QWidget *w);
@@ -2,11 +2,15 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <algorithm>
+
 #include <QtMath>
 
 #include "ui_optimizationsettingsdialog.h"
 #include "OptimizationSettings.h"
 #include "CurrencyAdapter.h"
+#include "FusionPlanner.h"
+#include "OptimizationManager.h"
 #include "WalletAdapter.h"
 #include "MainWindow.h"
 #include "Settings.h"
@@ -23,17 +27,20 @@ const int MIN_THRESHOLD_ORDER_VALUE = 0;
 const int MAX_THRESHOLD_ORDER_VALUE = 4;
 const int MIN_MIXIN_VALUE = 0;
 const int MAX_MIXIN_VALUE = 5;
+const int MAX_TARGET_OUTPUT_COUNT = 100000;
 const quint64 MINUTE_MSECS = 1000 * 60;
 const quint64 HOUR_MSECS = MINUTE_MSECS * 60;
 
 }
 
-OptimizationSettingsDialog::OptimizationSettingsDialog(QWidget* _parent) : QDialog(_parent),
-    m_ui(new Ui::OptimizationSettingsDialog) {
+OptimizationSettingsDialog::OptimizationSettingsDialog(OptimizationManager* _optimizationManager, QWidget* _parent) : QDialog(_parent),
+    m_ui(new Ui::OptimizationSettingsDialog), m_optimizationManager(_optimizationManager), m_previewId(0) {
     m_ui->setupUi(this);
     m_ui->m_thresholdSlider->setRange(MIN_THRESHOLD_ORDER_VALUE, MAX_THRESHOLD_ORDER_VALUE);
     m_ui->m_mixinSpin->setRange(MIN_MIXIN_VALUE, MAX_MIXIN_VALUE);
     m_ui->m_mixinSlider->setRange(MIN_MIXIN_VALUE, MAX_MIXIN_VALUE);
+    m_ui->m_targetOutputCountSpin->setRange(0, MAX_TARGET_OUTPUT_COUNT);
+    connect(m_optimizationManager, &OptimizationManager::fusionPreviewReadySignal, this, &OptimizationSettingsDialog::fusionPreviewReady);
     initOptimizationPeriods();
     m_currencyMultiplier = CurrencyAdapter::instance().parseAmount("1");
     initThresholdCombo();
@@ -57,6 +64,8 @@ void OptimizationSettingsDialog::load() {
   quint64 coinCount = Settings::instance().getOptimizationThreshold() / m_currencyMultiplier;
   m_ui->m_thresholdSlider->setValue(std::log10(coinCount));
   m_ui->m_mixinSlider->setValue(Settings::instance().getOptimizationMixin());
+  m_ui->m_targetOutputCountSpin->setValue(static_cast<int>(std::min<quint64>(Settings::instance().getOptimizationTargetOutputCount(),
+    MAX_TARGET_OUTPUT_COUNT)));
   updateEstimateValue();
 }
 
@@ -68,6 +77,7 @@ void OptimizationSettingsDialog::save() {
   Settings::instance().setOptimizationInterval(m_ui->m_periodCombo->currentData().value<quint64>());
   Settings::instance().setOptimizationThreshold(qPow(10, m_ui->m_thresholdSlider->value()) * m_currencyMultiplier);
   Settings::instance().setOptimizationMixin(m_ui->m_mixinSlider->value());
+  Settings::instance().setOptimizationTargetOutputCount(m_ui->m_targetOutputCountSpin->value());
 
   accept();
 }
@@ -94,22 +104,48 @@ void OptimizationSettingsDialog::initThresholdCombo() {
   }
 }
 
+// The estimate and the plan come from the optimization worker, only the answer to the last request is shown
 void OptimizationSettingsDialog::updateEstimateValue() {
-  quintptr estimate = 0;
-  if (WalletAdapter::instance().isOpen()) {
-    estimate = WalletAdapter::instance().estimateFusion(qPow(10, m_ui->m_thresholdSlider->value()) * m_currencyMultiplier);
-    if (estimate == 0) {
-      m_ui->m_nonOptimizedOutputsLabel->hide();
-      m_ui->m_nonOptimizedOutputsTextLabel->setText(tr("Wallet is currently optimized for this target"));
-    } else {
-      m_ui->m_nonOptimizedOutputsLabel->show();
-      m_ui->m_nonOptimizedOutputsLabel->setText(QString::number(estimate));
-      m_ui->m_nonOptimizedOutputsTextLabel->setText(tr(" outputs below selected target"));
-    }
-  } else {
+  m_ui->m_fusionPlanLabel->clear();
+  if (!WalletAdapter::instance().isOpen()) {
+    m_previewId = 0;
     m_ui->m_nonOptimizedOutputsLabel->hide();
     m_ui->m_nonOptimizedOutputsTextLabel->setText(tr("Wallet is closed"));
+    return;
+  }
+
+  m_ui->m_nonOptimizedOutputsLabel->hide();
+  m_ui->m_nonOptimizedOutputsTextLabel->setText(tr("Estimating..."));
+  m_previewId = m_optimizationManager->previewFusion(qPow(10, m_ui->m_thresholdSlider->value()) * m_currencyMultiplier,
+    m_ui->m_mixinSlider->value(), m_ui->m_targetOutputCountSpin->value());
+}
+
+// Dry run of the whole consolidation, nothing is sent
+void OptimizationSettingsDialog::fusionPreviewReady(quint64 _previewId, quint64 _estimate, const FusionPlan& _plan) {
+  if (_previewId != m_previewId) {
+    return;
+  }
+
+  if (_estimate == 0) {
+    m_ui->m_nonOptimizedOutputsLabel->hide();
+    m_ui->m_nonOptimizedOutputsTextLabel->setText(tr("Wallet is currently optimized for this target"));
+    return;
   }
+
+  m_ui->m_nonOptimizedOutputsLabel->show();
+  m_ui->m_nonOptimizedOutputsLabel->setText(QString::number(_estimate));
+  m_ui->m_nonOptimizedOutputsTextLabel->setText(tr(" outputs below selected target"));
+  if (_plan.transactions.empty()) {
+    m_ui->m_fusionPlanLabel->setText(tr("Not enough unlocked outputs for a fusion transaction with this target and mixin"));
+    return;
+  }
+
+  m_ui->m_fusionPlanLabel->setText(tr("Optimization needs %n transaction(s) in %1 round(s) with a fee of %2 %3, reducing unlocked outputs from %4 to %5", "", _plan.transactions.size())
+    .arg(_plan.roundCount)
+    .arg(CurrencyAdapter::instance().formatAmount(_plan.totalFee))
+    .arg(CurrencyAdapter::instance().getCurrencyTicker().toUpper())
+    .arg(_plan.initialOutputCount)
+    .arg(_plan.finalOutputCount));
 }
 
 void OptimizationSettingsDialog::thresholdChanged(int _value) {
@@ -132,6 +168,13 @@ void OptimizationSettingsDialog::mixinChanged(int _mixin) {
   if (m_ui->m_mixinSpin->value() != _mixin) {
     m_ui->m_mixinSpin->setValue(_mixin);
   }
+
+  updateEstimateValue();
+}
+
+void OptimizationSettingsDialog::targetOutputCountChanged(int _count) {
+  Q_UNUSED(_count);
+  updateEstimateValue();
 }
 
 }
@@ -6,20 +6,22 @@
 
 #include <QDialog>
 
+#include "FusionPlanner.h"
+
 namespace Ui {
 class OptimizationSettingsDialog;
 }
 
 namespace WalletGui {
 
-//class NodeModel;
+class OptimizationManager;
 
 class OptimizationSettingsDialog : public QDialog {
   Q_OBJECT
   Q_DISABLE_COPY(OptimizationSettingsDialog)
 
 public:
-  OptimizationSettingsDialog(QWidget* _parent);
+  OptimizationSettingsDialog(OptimizationManager* _optimizationManager, QWidget* _parent);
   ~OptimizationSettingsDialog();
 
   void load();
@@ -27,14 +29,18 @@ public:
 private:
   QScopedPointer<Ui::OptimizationSettingsDialog> m_ui;
 
+  OptimizationManager* m_optimizationManager;
   quint64 m_currencyMultiplier;
+  quint64 m_previewId;
 
   void initOptimizationPeriods();
   void initThresholdCombo();
   void updateEstimateValue();
+  void fusionPreviewReady(quint64 _previewId, quint64 _estimate, const FusionPlan& _plan);
 
   Q_SLOT void thresholdChanged(int _value);
   Q_SLOT void mixinChanged(int _mixin);
+  Q_SLOT void targetOutputCountChanged(int _count);
   Q_SLOT void save();
 
 };
@@ -7,6 +7,7 @@
 #include <QApplication>
 #include <QFileDialog>
 #include <QStandardPaths>
+#include <QStyle>
 #include "RestoreFromMnemonicSeedDialog.h"
 #include "ui_restorefrommnemonicseeddialog.h"
 
@@ -55,13 +56,20 @@ void RestoreFromMnemonicSeedDialog::onTextChanged() {
   if(wordCount != 25) {
     m_ui->m_okButton->setEnabled(false);
     m_ui->m_errorLabel->setText(QString::number(wordCount));
-    m_ui->m_errorLabel->setStyleSheet("QLabel { color : red; }");
+    setErrorState("invalid");
   }
   if(wordCount == 25) {
     m_ui->m_okButton->setEnabled(true);
     m_ui->m_errorLabel->setText("OK");
-    m_ui->m_errorLabel->setStyleSheet("QLabel { color : green; }");
+    setErrorState("valid");
   }
 }
 
+// Colored by the "state" rules of the theme
+void RestoreFromMnemonicSeedDialog::setErrorState(const char* _state) {
+  m_ui->m_errorLabel->setProperty("state", _state);
+  m_ui->m_errorLabel->style()->unpolish(m_ui->m_errorLabel);
+  m_ui->m_errorLabel->style()->polish(m_ui->m_errorLabel);
+}
+
 }
@@ -32,6 +32,8 @@ private:
 
   Q_SLOT void selectPathClicked();
   Q_SLOT void onTextChanged();
+
+  void setErrorState(const char* _state);
 };
 
 }
@@ -4,17 +4,24 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <algorithm>
+#include <atomic>
+
 #include <QRegExpValidator>
 #include <QInputDialog>
 #include <QMessageBox>
+#include <QStyle>
 #include <QUrlQuery>
 #include <QTime>
 #include <QUrl>
 
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+#include <Wallet/WalletErrors.h>
 #include "AddressBookModel.h"
 #include "CurrencyAdapter.h"
+#include "DecoyPrefetcher.h"
 #include "MainWindow.h"
+#include "MempoolFeeModel.h"
 #include "NodeAdapter.h"
 #include "SendFrame.h"
 #include "TransferFrame.h"
@@ -31,9 +38,123 @@
 
 namespace WalletGui {
 
+namespace {
+
+// Confirmation targets in blocks for the Low, Normal, High and Highest priority
+const quint32 PRIORITY_TARGET_BLOCKS[] = {6, 3, 2, 1};
+
+// Form edits come in bursts while typing, only the last one is estimated
+const int SIZE_ESTIMATE_DELAY_MSECS = 100;
+
+}
+
+// Picks the inputs and estimates the size off the GUI thread, the wallet adapter is safe to read from here
+class SizeEstimateWorker : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(SizeEstimateWorker)
+
+public:
+  SizeEstimateWorker(QObject* _parent = nullptr) : QObject(_parent), lastEstimateId(0), isOutputsStale(true),
+    m_dustThreshold(CurrencyAdapter::instance().getCurrency().defaultDustThreshold()), m_estimator(m_dustThreshold) {
+  }
+
+  ~SizeEstimateWorker() {
+  }
+
+  std::atomic<quint64> lastEstimateId;
+  // Set on balance updates, the outputs are fetched again by the next estimate only
+  std::atomic<bool> isOutputsStale;
+
+  // The wallet picks its inputs in random order. Taking them smallest first as it may at worst gives
+  // the most inputs the send can end up with, so the size and the fee are upper bounds.
+  void estimate(quint64 _estimateId, const SizeEstimateRequest& _request) {
+    if (_estimateId != lastEstimateId) {
+      return;
+    }
+
+    if (isOutputsStale.exchange(false)) {
+      fetchOutputs();
+    }
+
+    quint64 total = 0;
+    for (uint64_t amount : _request.destinations) {
+      total += amount;
+    }
+
+    std::vector<TransactionSizeEstimator::Input> inputs = _request.selectedInputs;
+    quint64 selected = 0;
+    for (const TransactionSizeEstimator::Input& input : inputs) {
+      selected += input.amount;
+    }
+
+    // The fee changes the inputs and the change, and those the size, so settle it in a few rounds
+    const bool pickInputs = inputs.empty();
+    size_t next = 0;
+    quint64 fee = _request.minimalFee;
+    TransactionSizeEstimate estimate {0, 0, 0};
+    for (int iteration = 0; iteration < 4; ++iteration) {
+      for (; pickInputs && selected < total + fee && next < m_outputs.size(); ++next) {
+        // Same as the wallet, dust can't be mixed
+        if (_request.mixin > 0 && m_outputs[next].amount < m_dustThreshold) {
+          continue;
+        }
+
+        inputs.push_back(m_outputs[next]);
+        selected += m_outputs[next].amount;
+      }
+
+      estimate = m_estimator.estimate(inputs, _request.destinations, selected > total + fee ? selected - total - fee : 0, _request.mixin,
+        _request.extraSize);
+      const quint64 requiredFee = TransactionSizeEstimator::requiredFee(estimate.maxSize, _request.feePerByte, _request.minimalFee);
+      if (requiredFee <= fee) {
+        break;
+      }
+
+      fee = requiredFee;
+    }
+
+    Q_EMIT sizeEstimatedSignal(_estimateId, fee, estimate);
+  }
+
+Q_SIGNALS:
+  void sizeEstimatedSignal(quint64 _estimateId, quint64 _requiredFee, const TransactionSizeEstimate& _estimate);
+
+private:
+  uint64_t m_dustThreshold;
+  TransactionSizeEstimator m_estimator;
+  // Spendable outputs, smallest first
+  std::vector<TransactionSizeEstimator::Input> m_outputs;
+
+  void fetchOutputs() {
+    m_outputs.clear();
+    if (!WalletAdapter::instance().isOpen()) {
+      return;
+    }
+
+    for (const CryptoNote::TransactionOutputInformation& output : WalletAdapter::instance().getSpendableOutputs()) {
+      m_outputs.push_back(TransactionSizeEstimator::Input {output.amount, output.globalOutputIndex});
+    }
+
+    std::sort(m_outputs.begin(), m_outputs.end(), [](const TransactionSizeEstimator::Input& _left, const TransactionSizeEstimator::Input& _right) {
+      return _left.amount < _right.amount;
+    });
+  }
+};
+
 SendFrame::SendFrame(QWidget* _parent) : QFrame(_parent), m_ui(new Ui::SendFrame), m_glassFrame(new SendGlassFrame(nullptr)),
-    m_nodeFee(0), m_flatRateNodeFee(0), m_selectedOutputsAmount(0)
+    m_nodeFee(0), m_flatRateNodeFee(0), m_selectedOutputsAmount(0), m_sendProgressDialog(nullptr), m_currentJobId(0),
+    m_estimateThread(), m_estimateWorker(new SizeEstimateWorker), m_estimateTimer(), m_sizeEstimate {0, 0, 0}
 {
+  qRegisterMetaType<SizeEstimateRequest>("SizeEstimateRequest");
+  qRegisterMetaType<TransactionSizeEstimate>("TransactionSizeEstimate");
+  m_estimateTimer.setSingleShot(true);
+  m_estimateWorker->moveToThread(&m_estimateThread);
+  connect(this, &SendFrame::estimateSizeSignal, m_estimateWorker, &SizeEstimateWorker::estimate, Qt::QueuedConnection);
+  connect(m_estimateWorker, &SizeEstimateWorker::sizeEstimatedSignal, this, &SendFrame::sizeEstimated, Qt::QueuedConnection);
+  connect(&m_estimateThread, &QThread::finished, m_estimateWorker, &QObject::deleteLater);
+  connect(&m_estimateTimer, &QTimer::timeout, this, &SendFrame::estimateSize);
+  m_estimateThread.start();
+
   m_ui->setupUi(this);
   m_glassFrame->setObjectName("m_sendGlassFrame");
   clearAllClicked();
@@ -43,15 +164,22 @@ SendFrame::SendFrame(QWidget* _parent) : QFrame(_parent), m_ui(new Ui::SendFrame
   priorityValueChanged(m_ui->m_prioritySlider->value());
   amountValueChanged();
 
-  connect(&WalletAdapter::instance(), &WalletAdapter::walletSendTransactionCompletedSignal, this, &SendFrame::sendTransactionCompleted,
+  connect(&WalletAdapter::instance(), &WalletAdapter::transactionJobCompletedSignal, this, &SendFrame::sendTransactionCompleted,
     Qt::QueuedConnection);
   connect(&WalletAdapter::instance(), &WalletAdapter::walletActualBalanceUpdatedSignal, this, &SendFrame::walletActualBalanceUpdated,
     Qt::QueuedConnection);
+  connect(&WalletAdapter::instance(), &WalletAdapter::transactionJobPhaseChangedSignal, this, &SendFrame::transactionJobPhaseChanged,
+    Qt::QueuedConnection);
+  connect(&WalletAdapter::instance(), &WalletAdapter::rawTransactionPreparedSignal, this, &SendFrame::rawTransactionPrepared,
+    Qt::QueuedConnection);
   connect(&WalletAdapter::instance(), &WalletAdapter::walletCloseCompletedSignal, this, &SendFrame::reset);
   connect(&WalletAdapter::instance(), &WalletAdapter::walletSynchronizationCompletedSignal, this, &SendFrame::walletSynchronized,
     Qt::QueuedConnection);
   connect(&WalletAdapter::instance(), &WalletAdapter::walletSynchronizationProgressUpdatedSignal,
     this, &SendFrame::walletSynchronizationInProgress, Qt::QueuedConnection);
+  connect(&MempoolFeeModel::instance(), &MempoolFeeModel::feeEstimatesUpdatedSignal, this, &SendFrame::feeEstimatesUpdated,
+    Qt::QueuedConnection);
+  connect(m_ui->m_paymentIdEdit, &QLineEdit::textChanged, this, &SendFrame::scheduleSizeEstimate);
 
   m_ui->m_feeSpin->setSuffix(" " + CurrencyAdapter::instance().getCurrencyTicker().toUpper());
   m_ui->m_donateSpin->setSuffix(" " + CurrencyAdapter::instance().getCurrencyTicker().toUpper());
@@ -63,17 +191,15 @@ SendFrame::SendFrame(QWidget* _parent) : QFrame(_parent), m_ui(new Ui::SendFrame
   QLabel *label2 = new QLabel(tr("Normal"), this);
   QLabel *label3 = new QLabel(tr("High"), this);
   QLabel *label4 = new QLabel(tr("Highest"), this);
-  label1->setStyleSheet(".QLabel { margin: 0; padding: 0;}");
-  label2->setStyleSheet(".QLabel { margin: 0; padding: 0;}");
-  label3->setStyleSheet(".QLabel { margin: 0; padding: 0;}");
-  label4->setStyleSheet(".QLabel { margin: 0; padding: 0;}");
+  label1->setObjectName("m_priorityLevelLabel");
+  label2->setObjectName("m_priorityLevelLabel");
+  label3->setObjectName("m_priorityLevelLabel");
+  label4->setObjectName("m_priorityLevelLabel");
   m_ui->m_priorityGridLayout->addWidget(m_ui->m_prioritySlider, 0, 0, 1, 4);
   m_ui->m_priorityGridLayout->addWidget(label1, 1, 0, 1, 1, Qt::AlignHCenter);
   m_ui->m_priorityGridLayout->addWidget(label2, 1, 1, 1, 1, Qt::AlignHCenter);
   m_ui->m_priorityGridLayout->addWidget(label3, 1, 2, 1, 1, Qt::AlignHCenter);
   m_ui->m_priorityGridLayout->addWidget(label4, 1, 3, 1, 1, Qt::AlignHCenter);
-  m_ui->m_prioritySlider->setStyleSheet(".QSlider { margin: 0 10px; padding: 0;}");
-  m_ui->m_mixinSlider->setStyleSheet(".QSlider { margin: 0 10px; padding: 0;}");
 
   QRegExp hexMatcher("^[0-9A-F]{64}$", Qt::CaseInsensitive);
   QValidator *validator = new QRegExpValidator(hexMatcher, this);
@@ -94,6 +220,8 @@ SendFrame::SendFrame(QWidget* _parent) : QFrame(_parent), m_ui(new Ui::SendFrame
 SendFrame::~SendFrame() {
   m_transfers.clear();
   m_glassFrame->deleteLater();
+  m_estimateThread.quit();
+  m_estimateThread.wait();
 }
 
 void SendFrame::walletSynchronized(int _error, const QString& _error_text) {
@@ -147,16 +275,14 @@ void SendFrame::addRecipientClicked() {
 }
 
 double SendFrame::getMinimalFee() {
-  double fee(0);
+  quint64 fee = 0;
   if (NodeAdapter::instance().getCurrentBlockMajorVersion() < CryptoNote::BLOCK_MAJOR_VERSION_4) {
-    fee = CurrencyAdapter::instance().formatAmount(CurrencyAdapter::instance().getMinimumFee()).toDouble();
+    fee = CurrencyAdapter::instance().getMinimumFee();
   } else {
-    fee = CurrencyAdapter::instance().formatAmount(NodeAdapter::instance().getMinimalFee()).toDouble();
+    fee = NodeAdapter::instance().getMinimalFee();
   }
-  int digits = 2; // round up fee to 2 digits after leading zeroes
-  double scale = pow(10., floor(log10(fabs(fee))) + (1 - digits));
-  double roundedFee = ceil(fee / scale) * scale;
-  return roundedFee;
+
+  return CurrencyAdapter::instance().formatAmount(TransactionSizeEstimator::roundUpFee(fee)).toDouble();
 }
 
 void SendFrame::clearAllClicked() {
@@ -180,6 +306,8 @@ void SendFrame::clearAllClicked() {
 void SendFrame::reset() {
   m_selectedOutputs.clear();
   m_selectedOutputsAmount = 0;
+  m_isSendPending = false;
+  m_estimateWorker->isOutputsStale = true;
   m_ui->m_mixinSlider->setEnabled(true);
   m_ui->m_sendAllButton->setEnabled(true);
   amountValueChanged();
@@ -215,6 +343,13 @@ void SendFrame::amountValueChanged() {
   if(!m_nodeFeeAddress.isEmpty()) {
     m_ui->m_remote_label->setText(QString(tr("Node fee: %1 %2")).arg(CurrencyAdapter::instance().formatAmount(m_nodeFee).remove(QRegExp("0+$"))).arg(CurrencyAdapter::instance().getCurrencyTicker().toUpper()));
   }
+
+  // More recipients mean more outputs, so the fee follows the size unless it is set by hand or fixed by selected outputs
+  if (m_selectedOutputsAmount == 0) {
+    feeEstimatesUpdated();
+  }
+
+  scheduleSizeEstimate();
 }
 
 void SendFrame::insertPaymentID(QString _paymentid) {
@@ -329,8 +464,14 @@ void SendFrame::sendOutputs(QList<CryptoNote::TransactionOutputInformation> _sel
 }
 
 void SendFrame::sendClicked() {
+  // The fee follows the size, so the form is sent once its estimate as it is now lands
   amountValueChanged();
+  m_isSendPending = true;
+  m_estimateTimer.stop();
+  estimateSize();
+}
 
+void SendFrame::send() {
   quint64 actualBalance = WalletAdapter::instance().getActualBalance();
   if (actualBalance <= NodeAdapter::instance().getMinimalFee()) {
     QCoreApplication::postEvent(
@@ -395,7 +536,6 @@ void SendFrame::sendClicked() {
   }
 
   // Miners fee
-  priorityValueChanged(m_ui->m_prioritySlider->value());
   quint64 fee = getFee();
 
   if (fee < NodeAdapter::instance().getMinimalFee()) {
@@ -438,42 +578,220 @@ void SendFrame::sendClicked() {
   }
   if (dlg.exec() == QDialog::Accepted) {
     if (WalletAdapter::instance().isOpen()) {
+      std::list<CryptoNote::TransactionOutputInformation> selectedOutputs;
+      if (m_selectedOutputsAmount > 0) {
+        selectedOutputs = m_selectedOutputs.toStdList();
+      }
+
       if (!m_ui->dontRelayCheckBox->isChecked()) {
-        if (m_selectedOutputsAmount > 0) {
-          WalletAdapter::instance().sendTransaction(walletTransfers, m_selectedOutputs.toStdList(), fee, m_ui->m_paymentIdEdit->text(), m_ui->m_mixinSlider->value());
-        } else {
-          WalletAdapter::instance().sendTransaction(walletTransfers, fee, m_ui->m_paymentIdEdit->text(), m_ui->m_mixinSlider->value());
-        }
+        showSendProgress(WalletAdapter::instance().sendTransactionAsync(walletTransfers, selectedOutputs, fee, m_ui->m_paymentIdEdit->text(), m_ui->m_mixinSlider->value()));
       } else {
-        QString rawTx;
-
-        if (m_selectedOutputsAmount > 0) {
-          rawTx = WalletAdapter::instance().prepareRawTransaction(walletTransfers, m_selectedOutputs.toStdList(), fee, m_ui->m_paymentIdEdit->text(), m_ui->m_mixinSlider->value());
-        } else {
-          rawTx = WalletAdapter::instance().prepareRawTransaction(walletTransfers, fee, m_ui->m_paymentIdEdit->text(), m_ui->m_mixinSlider->value());
-        }
-
-        if (!rawTx.isEmpty()) {
-          ExportRawTransactionDialog dlg(&MainWindow::instance());
-          dlg.setTransaction(rawTx);
-          dlg.exec();
-        }
+        showSendProgress(WalletAdapter::instance().prepareRawTransactionAsync(walletTransfers, selectedOutputs, fee, m_ui->m_paymentIdEdit->text(), m_ui->m_mixinSlider->value()));
       }
     }
   }
 }
 
+void SendFrame::showSendProgress(quint64 _jobId) {
+  m_currentJobId = _jobId;
+  if (m_sendProgressDialog == nullptr) {
+    m_sendProgressDialog = new QProgressDialog(&MainWindow::instance());
+    m_sendProgressDialog->setWindowTitle(tr("Sending transaction"));
+    m_sendProgressDialog->setWindowModality(Qt::WindowModal);
+    m_sendProgressDialog->setRange(0, 0);
+    m_sendProgressDialog->setMinimumDuration(0);
+    m_sendProgressDialog->setAutoClose(false);
+    m_sendProgressDialog->setAutoReset(false);
+    connect(m_sendProgressDialog, &QProgressDialog::canceled, this, &SendFrame::cancelSendClicked);
+  }
+
+  m_sendProgressDialog->setLabelText(tr("Waiting for the wallet..."));
+  m_sendProgressDialog->setCancelButtonText(tr("Cancel"));
+  m_sendProgressDialog->show();
+}
+
+void SendFrame::hideSendProgress() {
+  m_currentJobId = 0;
+  if (m_sendProgressDialog != nullptr) {
+    m_sendProgressDialog->hide();
+  }
+}
+
+void SendFrame::cancelSendClicked() {
+  if (m_currentJobId == 0) {
+    return;
+  }
+
+  // The canceled signal hides the dialog, bring it back if the wallet has already taken the transaction
+  if (!WalletAdapter::instance().cancelTransactionJob(m_currentJobId)) {
+    m_sendProgressDialog->show();
+  }
+}
+
+void SendFrame::transactionJobPhaseChanged(quint64 _jobId, int _phase) {
+  if (_jobId != m_currentJobId || m_sendProgressDialog == nullptr) {
+    return;
+  }
+
+  switch (_phase) {
+  case WalletAdapter::JOB_PHASE_QUEUED:
+    m_sendProgressDialog->setLabelText(tr("Waiting for the wallet..."));
+    break;
+  case WalletAdapter::JOB_PHASE_BUILDING:
+    m_sendProgressDialog->setLabelText(tr("Selecting mixins and signing the transaction..."));
+    break;
+  case WalletAdapter::JOB_PHASE_RELAYING:
+    m_sendProgressDialog->setLabelText(tr("Relaying the transaction to the network..."));
+    m_sendProgressDialog->setCancelButton(nullptr);
+    break;
+  case WalletAdapter::JOB_PHASE_COMPLETED:
+  case WalletAdapter::JOB_PHASE_CANCELLED:
+    hideSendProgress();
+    break;
+  default:
+    break;
+  }
+}
+
+void SendFrame::rawTransactionPrepared(quint64 _jobId, const QString& _rawTransaction) {
+  if (_jobId != m_currentJobId) {
+    return;
+  }
+
+  hideSendProgress();
+  if (!_rawTransaction.isEmpty()) {
+    ExportRawTransactionDialog dlg(&MainWindow::instance());
+    dlg.setTransaction(_rawTransaction);
+    dlg.exec();
+  }
+}
+
 void SendFrame::mixinValueChanged(int _value) {
   m_ui->m_mixinLabel->setText(QString::number(_value));
+  DecoyPrefetcher::instance().setMixin(_value);
+  feeEstimatesUpdated();
+  scheduleSizeEstimate();
+}
+
+void SendFrame::feeEstimatesUpdated() {
+  if (!m_ui->m_manualFeeCheckBox->isChecked()) {
+    priorityValueChanged(m_ui->m_prioritySlider->value());
+  }
+}
+
+quint64 SendFrame::getFeePerByte(int _priority) {
+  if (!MempoolFeeModel::instance().hasData()) {
+    return 0;
+  }
+
+  return MempoolFeeModel::instance().estimateFeePerByte(PRIORITY_TARGET_BLOCKS[qBound(0, _priority - 1, 3)]);
+}
+
+// Inputs are settled for the priority on the slider, other priorities are charged for the same size
+quint64 SendFrame::getPriorityFee(int _priority) {
+  const quint64 minimalFee = CurrencyAdapter::instance().parseAmount(QString::number(getMinimalFee()));
+  if (!MempoolFeeModel::instance().hasData()) {
+    return minimalFee * _priority;
+  }
+
+  return TransactionSizeEstimator::requiredFee(m_sizeEstimate.maxSize, getFeePerByte(_priority), minimalFee);
+}
+
+void SendFrame::scheduleSizeEstimate() {
+  m_estimateTimer.start(SIZE_ESTIMATE_DELAY_MSECS);
+}
+
+void SendFrame::estimateSize() {
+  SizeEstimateRequest request;
+  auto addDestination = [&request](quint64 _amount) {
+    if (_amount > 0) {
+      request.destinations.push_back(_amount);
+    }
+  };
+
+  Q_FOREACH (TransferFrame* transfer, m_transfers) {
+    addDestination(CurrencyAdapter::instance().parseAmount(transfer->getAmountString()));
+  }
+
+  if (m_ui->donateCheckBox->isChecked()) {
+    addDestination(CurrencyAdapter::instance().parseAmount(m_ui->m_donateSpin->cleanText()));
+  }
+
+  if (!m_nodeFeeAddress.isEmpty()) {
+    addDestination(m_nodeFee);
+  }
+
+  if (m_selectedOutputsAmount > 0) {
+    for (const CryptoNote::TransactionOutputInformation& output : m_selectedOutputs) {
+      request.selectedInputs.push_back(TransactionSizeEstimator::Input {output.amount, output.globalOutputIndex});
+    }
+  }
+
+  request.mixin = m_ui->m_mixinSlider->value();
+  request.extraSize = m_ui->m_paymentIdEdit->text().isEmpty() ? 0 : TransactionSizeEstimator::paymentIdExtraSize();
+  request.feePerByte = getFeePerByte(m_ui->m_prioritySlider->value());
+  request.minimalFee = CurrencyAdapter::instance().parseAmount(QString::number(getMinimalFee()));
+  m_estimateWorker->lastEstimateId = ++m_lastEstimateId;
+  Q_EMIT estimateSizeSignal(m_lastEstimateId, request);
+}
+
+void SendFrame::sizeEstimated(quint64 _estimateId, quint64 _requiredFee, const TransactionSizeEstimate& _estimate) {
+  if (_estimateId != m_lastEstimateId) {
+    return;
+  }
+
+  m_sizeEstimate = _estimate;
+  m_requiredFee = _requiredFee;
+  if (!m_ui->m_manualFeeCheckBox->isChecked()) {
+    m_ui->m_feeSpin->setValue(CurrencyAdapter::instance().formatAmount(getPriorityFee(m_ui->m_prioritySlider->value())).toDouble());
+  }
+
+  updateSizeEstimateLabel();
+  if (m_isSendPending) {
+    m_isSendPending = false;
+    send();
+  }
+}
+
+void SendFrame::updateSizeEstimateLabel() {
+  if (m_sizeEstimate.maxSize == 0) {
+    m_ui->m_sizeEstimateLabel->clear();
+    return;
+  }
+
+  const quint64 maxTransactionSize = CurrencyAdapter::instance().getMaxTransactionSize(NodeAdapter::instance().getCurrentBlockMajorVersion());
+  bool warning = false;
+  QString text = tr("Size: up to %1 bytes, %n output(s)", "", m_sizeEstimate.outputCount).arg(m_sizeEstimate.maxSize);
+  if (m_sizeEstimate.maxSize > maxTransactionSize) {
+    text = tr("May be too large: up to %1 of %2 bytes, consider sending less or to fewer recipients").arg(m_sizeEstimate.maxSize).arg(maxTransactionSize);
+    warning = true;
+  } else if (m_ui->m_manualFeeCheckBox->isChecked() && getFee() < m_requiredFee) {
+    text = tr("Size: up to %1 bytes, fee below %2 %3").arg(m_sizeEstimate.maxSize).arg(CurrencyAdapter::instance().formatAmount(m_requiredFee).remove(QRegExp("0+$")))
+      .arg(CurrencyAdapter::instance().getCurrencyTicker().toUpper());
+    warning = true;
+  }
+
+  m_ui->m_sizeEstimateLabel->setText(text);
+  if (m_ui->m_sizeEstimateLabel->property("warning").toBool() != warning) {
+    m_ui->m_sizeEstimateLabel->setProperty("warning", warning);
+    m_ui->m_sizeEstimateLabel->style()->unpolish(m_ui->m_sizeEstimateLabel);
+    m_ui->m_sizeEstimateLabel->style()->polish(m_ui->m_sizeEstimateLabel);
+  }
 }
 
 void SendFrame::priorityValueChanged(int _value) {
-  double send_fee = getMinimalFee() * _value;
+  double send_fee = CurrencyAdapter::instance().formatAmount(getPriorityFee(_value)).toDouble();
   m_ui->m_feeSpin->setValue(send_fee);
+  if (MempoolFeeModel::instance().hasData()) {
+    const int index = qBound(0, _value - 1, 3);
+    m_ui->m_prioritySlider->setToolTip(tr("Confirmation expected within %n block(s)", "", PRIORITY_TARGET_BLOCKS[index]));
+  }
 
   if (m_selectedOutputsAmount > 0) {
     recalculateAmountsSendOutputs();
   }
+
+  scheduleSizeEstimate();
 }
 
 void SendFrame::feeValueChanged(double _value) {
@@ -481,6 +799,8 @@ void SendFrame::feeValueChanged(double _value) {
   if (m_selectedOutputsAmount > 0) {
     recalculateAmountsSendOutputs();
   }
+
+  updateSizeEstimateLabel();
 }
 
 void SendFrame::donateValueChanged(double _value) {
@@ -506,11 +826,21 @@ quint64 SendFrame::getFee() {
      return CurrencyAdapter::instance().parseAmount(m_ui->m_feeSpin->cleanText());
   }
 
-  return CurrencyAdapter::instance().parseAmount(QString::number(getMinimalFee() * m_ui->m_prioritySlider->value()));
+  return getPriorityFee(m_ui->m_prioritySlider->value());
 }
 
-void SendFrame::sendTransactionCompleted(CryptoNote::TransactionId _id, bool _error, const QString& _errorText) {
+void SendFrame::sendTransactionCompleted(quint64 _jobId, CryptoNote::TransactionId _id, int _error, const QString& _errorText) {
   Q_UNUSED(_id);
+  // Other sends may complete meanwhile, only our own job decides the form's fate
+  if (_jobId != m_currentJobId) {
+    return;
+  }
+
+  hideSendProgress();
+  if (_error == CryptoNote::error::WalletErrorCodes::OPERATION_CANCELLED) {
+    return;
+  }
+
   if (_error) {
     QCoreApplication::postEvent(
       &MainWindow::instance(),
@@ -521,7 +851,13 @@ void SendFrame::sendTransactionCompleted(CryptoNote::TransactionId _id, bool _er
 }
 
 void SendFrame::walletActualBalanceUpdated(quint64 _balance) {
+  Q_UNUSED(_balance);
   m_unmixableBalance = WalletAdapter::instance().getUnmixableBalance();
+  m_estimateWorker->isOutputsStale = true;
+  // An empty form has nothing to estimate, the next edit picks the new outputs up
+  if (m_totalAmount > 0) {
+    scheduleSizeEstimate();
+  }
 }
 
 bool SendFrame::isValidPaymentId(const QByteArray& _paymentIdString) {
@@ -562,6 +898,8 @@ void SendFrame::donateToggled(bool _donate) {
   if (m_selectedOutputsAmount > 0) {
     recalculateAmountsSendOutputs();
   }
+
+  scheduleSizeEstimate();
 }
 
 bool SendFrame::confirmZeroMixin() {
@@ -624,3 +962,5 @@ void SendFrame::calculateNodeFee() {
 }
 
 }
+
+#include "SendFrame.moc"
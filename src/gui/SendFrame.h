@@ -7,10 +7,14 @@
 #pragma once
 
 #include <QFrame>
+#include <QProgressDialog>
+#include <QThread>
+#include <QTimer>
 
 #include <IWallet.h>
 #include <IWalletLegacy.h>
 #include "SendGlassFrame.h"
+#include "TransactionSizeEstimator.h"
 
 namespace Ui {
   class SendFrame;
@@ -19,6 +23,18 @@ namespace Ui {
 namespace WalletGui {
 
 class TransferFrame;
+class SizeEstimateWorker;
+
+// The transaction described by the send form, estimated off the GUI thread
+struct SizeEstimateRequest {
+  std::vector<uint64_t> destinations;
+  // Outputs picked by the user, the wallet's spendable outputs are used when there are none
+  std::vector<TransactionSizeEstimator::Input> selectedInputs;
+  size_t mixin;
+  size_t extraSize;
+  quint64 feePerByte;
+  quint64 minimalFee;
+};
 
 class SendFrame : public QFrame {
   Q_OBJECT
@@ -44,8 +60,22 @@ private:
   quint64 m_unmixableBalance = 0;
   quint64 m_selectedOutputsAmount = 0;
   QList<CryptoNote::TransactionOutputInformation> m_selectedOutputs;
-
-  void sendTransactionCompleted(CryptoNote::TransactionId _id, bool _error, const QString& _error_text);
+  QProgressDialog* m_sendProgressDialog;
+  quint64 m_currentJobId;
+  QThread m_estimateThread;
+  SizeEstimateWorker* m_estimateWorker;
+  QTimer m_estimateTimer;
+  quint64 m_lastEstimateId = 0;
+  quint64 m_completedEstimateId = 0;
+  TransactionSizeEstimate m_sizeEstimate;
+  quint64 m_requiredFee = 0;
+  bool m_isSendPending = false;
+
+  void sendTransactionCompleted(quint64 _jobId, CryptoNote::TransactionId _id, int _error, const QString& _error_text);
+  void transactionJobPhaseChanged(quint64 _jobId, int _phase);
+  void rawTransactionPrepared(quint64 _jobId, const QString& _rawTransaction);
+  void showSendProgress(quint64 _jobId);
+  void hideSendProgress();
   void walletActualBalanceUpdated(quint64 _balance);
   void walletSynchronized(int _error, const QString& _error_text);
   void walletSynchronizationInProgress(quint64 _current, quint64 _total);
@@ -54,6 +84,13 @@ private:
   void onNodeFeeAddressFound(const QString& _address, const quint64 _feeAmount);
   double getMinimalFee();
   quint64 getFee();
+  quint64 getPriorityFee(int _priority);
+  quint64 getFeePerByte(int _priority);
+  void scheduleSizeEstimate();
+  void estimateSize();
+  void sizeEstimated(quint64 _estimateId, quint64 _requiredFee, const TransactionSizeEstimate& _estimate);
+  void updateSizeEstimateLabel();
+  void send();
   void calculateNodeFee();
   void recalculateAmountsSendOutputs();
   void reset();
@@ -63,10 +100,12 @@ private:
   Q_SLOT void clearAllClicked();
   Q_SLOT void mixinValueChanged(int _value);
   Q_SLOT void priorityValueChanged(int _value);
+  Q_SLOT void feeEstimatesUpdated();
   Q_SLOT void feeValueChanged(double _value);
   Q_SLOT void donateValueChanged(double _value);
   Q_SLOT void amountValueChanged();
   Q_SLOT void sendClicked();
+  Q_SLOT void cancelSendClicked();
   Q_SLOT void sendAllClicked();
   Q_SLOT void openUriClicked();
   Q_SLOT void generatePaymentIdClicked();
@@ -77,6 +116,7 @@ private:
 
 Q_SIGNALS:
   void uriOpenSignal();
+  void estimateSizeSignal(quint64 _estimateId, const SizeEstimateRequest& _request);
 
 };
 
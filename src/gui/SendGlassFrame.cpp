@@ -26,40 +26,6 @@ namespace WalletGui {
 
 namespace {
 
-const char SEND_GLASS_FRAME_STYLE_SHEET_TEMPLATE[] =
-  "WalletGui--SendGlassFrame {"
-    "border: none;"
-    "background-color: #ea505F69"
-  "}";
-
-const char SEND_FRAME_STYLE_SHEET[] =
-  "WalletGui--SendFrame {"
-    "background-color: #ffffff;"
-    "border: none;"
-  "}"
-
-  "WalletGui--SendFrame #m_sendScrollarea {"
-    "background-color: %backgroundColorGray%;"
-    "border: none;"
-    "border-bottom: 1px solid %borderColor%;"
-  "}"
-
-  "WalletGui--SendFrame #m_sendScrollarea QScrollBar:vertical {"
-    "margin-top: 0px;"
-    "border-top: none;"
-  "}"
-
-  "WalletGui--SendFrame #scrollAreaWidgetContents {"
-    "background-color: #ffffff;"
-    "border: none;"
-  "}"
-
-  "WalletGui--SendFrame #m_sendFeeFrame {"
-    "border: none;"
-    "border-top: 1px solid %borderColor%;"
-    "border-bottom: 1px solid %borderColor%;"
-  "}";
-
 const quint32 MAX_QUINT32 = std::numeric_limits<quint32>::max();
 
 }
@@ -67,7 +33,6 @@ const quint32 MAX_QUINT32 = std::numeric_limits<quint32>::max();
 SendGlassFrame::SendGlassFrame(QWidget* _parent) : GlassFrame(_parent), m_currentHeight(MAX_QUINT32), m_totalHeight(MAX_QUINT32),
   m_pixmapBuffer(QSize(340, 340) * QApplication::primaryScreen()->devicePixelRatio()),
   m_lastThemeName(Settings::instance().getCurrentTheme()) {
-  setStyleSheet(SEND_GLASS_FRAME_STYLE_SHEET_TEMPLATE);
 }
 
 SendGlassFrame::~SendGlassFrame() {
@@ -7,6 +7,7 @@
 
 #include <QClipboard>
 #include <QFileDialog>
+#include <QStyle>
 #include <QTextStream>
 #include <QTabWidget>
 
@@ -67,15 +68,22 @@ void SignMessageDialog::verifyMessage() {
   if(CurrencyAdapter::instance().getCurrency().parseAccountAddressString(addr_str, acc)) {
     if (WalletAdapter::instance().verifyMessage(message, acc, signature)) {
       m_ui->m_verificationResult->setText(tr("Signature is valid"));
-      m_ui->m_verificationResult->setStyleSheet("QLabel { color : green; }");
+      setResultState("valid");
     } else {
       m_ui->m_verificationResult->setText(tr("Signature is invalid!"));
-      m_ui->m_verificationResult->setStyleSheet("QLabel { color : red; }");
+      setResultState("invalid");
     }
   } else {
     m_ui->m_verificationResult->setText(tr("Address is invalid!"));
-    m_ui->m_verificationResult->setStyleSheet("QLabel { color : red; }");
+    setResultState("invalid");
   }
 }
 
+// The theme colors the result by its "state" property, Qt only applies a changed property on a new polish
+void SignMessageDialog::setResultState(const char* _state) {
+  m_ui->m_verificationResult->setProperty("state", _state);
+  m_ui->m_verificationResult->style()->unpolish(m_ui->m_verificationResult);
+  m_ui->m_verificationResult->style()->polish(m_ui->m_verificationResult);
+}
+
 }
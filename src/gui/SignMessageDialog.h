@@ -28,6 +28,8 @@ private:
     Q_SLOT void verifyMessage();
     Q_SLOT void changeTitle(int _variant);
 
+    void setResultState(const char* _state);
+
     QScopedPointer<Ui::SignMessageDialog> m_ui;
 };
 
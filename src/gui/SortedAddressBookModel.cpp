@@ -15,8 +15,17 @@ SortedAddressBookModel& SortedAddressBookModel::instance() {
   return inst;
 }
 
-SortedAddressBookModel::SortedAddressBookModel() : QSortFilterProxyModel() {
-  setSourceModel(&AddressBookModel::instance());
+SortedAddressBookModel::SortedAddressBookModel() : QSortFilterProxyModel(), m_isIndexStale(false) {
+  // The index has to follow the address book before the proxy filters the changed rows
+  AddressBookModel& addressBook = AddressBookModel::instance();
+  connect(&addressBook, &QAbstractItemModel::rowsInserted, this, &SortedAddressBookModel::indexRows);
+  connect(&addressBook, &QAbstractItemModel::rowsAboutToBeRemoved, this, &SortedAddressBookModel::unindexRows);
+  connect(&addressBook, &QAbstractItemModel::rowsRemoved, this, &SortedAddressBookModel::rowsRemoved);
+  connect(&addressBook, &QAbstractItemModel::dataChanged, this, &SortedAddressBookModel::reindexRows);
+  connect(&addressBook, &QAbstractItemModel::modelReset, this, &SortedAddressBookModel::rebuildIndex);
+  rebuildIndex();
+
+  setSourceModel(&addressBook);
   setDynamicSortFilter(true);
   sort(AddressBookModel::COLUMN_LABEL, Qt::DescendingOrder);
 }
@@ -25,20 +34,71 @@ SortedAddressBookModel::~SortedAddressBookModel() {
 }
 
 bool SortedAddressBookModel::filterAcceptsRow(int _row, const QModelIndex &_parent) const {
-  QModelIndex index0 = sourceModel()->index(_row, 0, _parent);
-  QModelIndex index1 = sourceModel()->index(_row, 1, _parent);
-  QModelIndex index2 = sourceModel()->index(_row, 2, _parent);
+  return m_searchIndex.matches(_row);
+}
 
-  return (sourceModel()->data(index0).toString().contains(searchstring)
-       || sourceModel()->data(index1).toString().contains(searchstring)
-       || sourceModel()->data(index2).toString().contains(searchstring));
+// While searching, the best matches come first whatever the sort order
+bool SortedAddressBookModel::lessThan(const QModelIndex& _left, const QModelIndex& _right) const {
+  if (!m_searchIndex.isQueryEmpty()) {
+    const int leftScore = m_searchIndex.getScore(_left.row());
+    const int rightScore = m_searchIndex.getScore(_right.row());
+    if (leftScore != rightScore) {
+      return sortOrder() == Qt::AscendingOrder ? leftScore > rightScore : leftScore < rightScore;
+    }
+  }
 
-  return true;
- }
+  return QSortFilterProxyModel::lessThan(_left, _right);
+}
 
 void SortedAddressBookModel::setSearchFor(const QString &searchstring) {
-    this->searchstring = searchstring;
-    invalidateFilter();
+  m_searchIndex.setQuery(searchstring);
+  invalidate();
+}
+
+void SortedAddressBookModel::rebuildIndex() {
+  m_isIndexStale = false;
+  m_searchIndex.clear();
+  indexRows(QModelIndex(), 0, AddressBookModel::instance().rowCount() - 1);
+}
+
+void SortedAddressBookModel::indexRows(const QModelIndex& _parent, int _first, int _last) {
+  const AddressBookModel& addressBook = AddressBookModel::instance();
+  if (_first != m_searchIndex.size()) {
+    rebuildIndex();
+    return;
+  }
+
+  for (int row = _first; row <= _last; ++row) {
+    QModelIndex index = addressBook.index(row, 0);
+    m_searchIndex.append(index.data(AddressBookModel::ROLE_LABEL).toString(), index.data(AddressBookModel::ROLE_ADDRESS).toString(),
+      index.data(AddressBookModel::ROLE_PAYMENTID).toString());
+  }
+}
+
+void SortedAddressBookModel::unindexRows(const QModelIndex& _parent, int _first, int _last) {
+  // The address book only drops its last rows, see AddressBookModel::removeAddress, anything else is reindexed once removed
+  if (_last != m_searchIndex.size() - 1) {
+    m_isIndexStale = true;
+    return;
+  }
+
+  for (int row = _last; row >= _first; --row) {
+    m_searchIndex.removeLast();
+  }
+}
+
+void SortedAddressBookModel::rowsRemoved(const QModelIndex& _parent, int _first, int _last) {
+  if (m_isIndexStale) {
+    rebuildIndex();
+  }
+}
+
+void SortedAddressBookModel::reindexRows(const QModelIndex& _topLeft, const QModelIndex& _bottomRight) {
+  for (int row = _topLeft.row(); row <= _bottomRight.row(); ++row) {
+    QModelIndex index = AddressBookModel::instance().index(row, 0);
+    m_searchIndex.update(row, index.data(AddressBookModel::ROLE_LABEL).toString(), index.data(AddressBookModel::ROLE_ADDRESS).toString(),
+      index.data(AddressBookModel::ROLE_PAYMENTID).toString());
+  }
 }
 
 }
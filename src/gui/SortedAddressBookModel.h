@@ -8,6 +8,8 @@
 #include <QDateTime>
 #include <QSortFilterProxyModel>
 
+#include "AddressBookSearchIndex.h"
+
 namespace WalletGui {
 
 class SortedAddressBookModel : public QSortFilterProxyModel {
@@ -20,12 +22,20 @@ public:
 
 protected:
   bool filterAcceptsRow(int _row, const QModelIndex &_parent) const Q_DECL_OVERRIDE;
+  bool lessThan(const QModelIndex& _left, const QModelIndex& _right) const Q_DECL_OVERRIDE;
 
 private:
+  AddressBookSearchIndex m_searchIndex;
+  bool m_isIndexStale;
+
   SortedAddressBookModel();
   ~SortedAddressBookModel();
 
-  QString searchstring;
+  void rebuildIndex();
+  void indexRows(const QModelIndex& _parent, int _first, int _last);
+  void unindexRows(const QModelIndex& _parent, int _first, int _last);
+  void rowsRemoved(const QModelIndex& _parent, int _first, int _last);
+  void reindexRows(const QModelIndex& _topLeft, const QModelIndex& _bottomRight);
 };
 
 }
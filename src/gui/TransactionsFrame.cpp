@@ -197,7 +197,7 @@ QWidget *TransactionsFrame::createDateRangeWidget()
 {
     dateRangeWidget = new QFrame();
     dateRangeWidget->setFrameStyle(QFrame::Panel | QFrame::Plain);
-    dateRangeWidget->setStyleSheet("QFrame { border: 0; max-width: 240px; }");
+    dateRangeWidget->setObjectName("m_dateRangeFrame");
     dateRangeWidget->setContentsMargins(1,1,1,1);
     QHBoxLayout *layout = new QHBoxLayout(dateRangeWidget);
     layout->setContentsMargins(0,0,0,0);
@@ -2,6 +2,8 @@
 // Copyright (c) 2016-2020 The Karbowanec developers
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#include <cstdio>
+
 #include <QApplication>
 #include <QCommandLineParser>
 #include <QLocale>
@@ -9,7 +11,6 @@
 #include <QLockFile>
 #include <QMessageBox>
 #include <QProcess>
-#include <QRegularExpression>
 #include <QSplashScreen>
 #include <QStyleFactory>
 #include <QSettings>
@@ -18,33 +19,136 @@
 #include "CommandLineParser.h"
 #include "CurrencyAdapter.h"
 #include "LoggerAdapter.h"
+#include "DecoyPrefetcher.h"
+#include "HeadlessService.h"
+#include "MempoolFeeModel.h"
 #include "NodeAdapter.h"
 #include "Settings.h"
 #include "SignalHandler.h"
+#include "StartupProfiler.h"
 #include "WalletAdapter.h"
+#include "WalletRpcServer.h"
 #include "gui/MainWindow.h"
 #include "Update.h"
 #include "PaymentServer.h"
 #include "TranslatorManager.h"
-#include "LogFileWatcher.h"
 
 #define DEBUG 1
 
 using namespace WalletGui;
 
-const QRegularExpression LOG_SPLASH_REG_EXP("\\] ");
-
 QSplashScreen* splash(nullptr);
 
-inline void newLogString(const QString& _string) {
-  QRegularExpressionMatch match = LOG_SPLASH_REG_EXP.match(_string);
-  if (match.hasMatch()) {
-    QString message = _string.mid(match.capturedEnd());
-    splash->showMessage(message, Qt::AlignLeft | Qt::AlignBottom, Qt::white);
+inline void showSplashMessage(const QString& _message) {
+  if (splash != nullptr) {
+    splash->showMessage(_message, Qt::AlignLeft | Qt::AlignBottom, Qt::white);
+  }
+}
+
+// Node and wallet on a QCoreApplication, without a display and without any widget
+int runHeadless(int argc, char* argv[]) {
+  QCoreApplication app(argc, argv);
+  app.setApplicationName(CurrencyAdapter::instance().getCurrencyName() + "wallet");
+  app.setApplicationVersion(Settings::instance().getVersion());
+
+  CommandLineParser cmdLineParser(nullptr);
+  Settings::instance().setCommandLineParser(&cmdLineParser);
+  if (!cmdLineParser.process(app.arguments())) {
+    fprintf(stderr, "%s\n", qPrintable(cmdLineParser.getErrorText()));
+    return 1;
+  }
+
+  {
+    StartupSpan span("settings");
+    Settings::instance().load();
+  }
+
+  if (cmdLineParser.hasProfileStartupOption()) {
+    StartupProfiler::instance().setTraceFile(Settings::instance().getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".startup.json"));
+  }
+
+  {
+    StartupSpan span("logger");
+    LoggerAdapter::instance().init();
+  }
+
+  QString dataDirPath = Settings::instance().getDataDir().absolutePath();
+  if (!QDir().exists(dataDirPath)) {
+    QDir().mkpath(dataDirPath);
+  }
+
+  QLockFile lockFile(Settings::instance().getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".lock"));
+  if (!lockFile.tryLock()) {
+    fprintf(stderr, "%s\n", qPrintable(QObject::tr("%1 wallet already running or cannot create lock file %2. Check your permissions.")
+      .arg(CurrencyAdapter::instance().getCurrencyDisplayName()).arg(lockFile.fileName())));
+    return 1;
+  }
+
+  WalletAdapter::instance().prefetch();
+  SignalHandler::instance().init();
+  QObject::connect(&SignalHandler::instance(), &SignalHandler::quitSignal, &app, &QCoreApplication::quit);
+
+  qRegisterMetaType<CryptoNote::TransactionId>("CryptoNote::TransactionId");
+  qRegisterMetaType<QList<CryptoNote::TransactionOutputInformation>>("QList<CryptoNote::TransactionOutputInformation>");
+  qRegisterMetaType<quintptr>("quintptr");
+  {
+    StartupSpan span("node");
+    if (!NodeAdapter::instance().init()) {
+      return 1;
+    }
+  }
+
+  MempoolFeeModel::instance().start();
+  DecoyPrefetcher::instance().start();
+
+  HeadlessService service(&app);
+  QObject::connect(&service, &HeadlessService::failedSignal, &app, []() {
+    QCoreApplication::exit(1);
+  }, Qt::QueuedConnection);
+
+  QObject::connect(&WalletAdapter::instance(), &WalletAdapter::walletInitCompletedSignal, []() {
+    StartupProfiler::instance().finish();
+  });
+
+  // Payment processors subscribe to the wallet events over the same local server as with the window. Nothing
+  // takes payment requests here, ready from the start they are dropped instead of kept.
+  PaymentServer* paymentServer = new PaymentServer(&app);
+  paymentServer->uiReady();
+
+  WalletRpcServer rpcServer(&app);
+  QObject::connect(&app, &QCoreApplication::aboutToQuit, [&service, &rpcServer]() {
+    rpcServer.stop();
+    service.stop();
+    DecoyPrefetcher::instance().stop();
+    MempoolFeeModel::instance().stop();
+    NodeAdapter::instance().deinit();
+    Settings::instance().flush();
+    StartupProfiler::instance().finish();
+  });
+
+  {
+    StartupSpan span("wallet open");
+    if (!service.start(cmdLineParser.getPasswordFile())) {
+      DecoyPrefetcher::instance().stop();
+      MempoolFeeModel::instance().stop();
+      NodeAdapter::instance().deinit();
+      return 1;
+    }
   }
+
+  if (cmdLineParser.getWalletRpcPort() != 0 && !rpcServer.start(cmdLineParser.getWalletRpcPort())) {
+    fprintf(stderr, "%s\n", qPrintable(QObject::tr("Failed to start the wallet RPC server on port %1").arg(cmdLineParser.getWalletRpcPort())));
+  }
+
+  return app.exec();
 }
 
 int main(int argc, char* argv[]) {
+  StartupProfiler::instance();
+
+  if (CommandLineParser::isHeadlessRequested(argc, argv)) {
+    return runHeadless(argc, argv);
+  }
 
   QApplication app(argc, argv);
   app.setApplicationName(CurrencyAdapter::instance().getCurrencyName() + "wallet");
@@ -58,29 +162,31 @@ int main(int argc, char* argv[]) {
   CommandLineParser cmdLineParser(nullptr);
   Settings::instance().setCommandLineParser(&cmdLineParser);
   bool cmdLineParseResult = cmdLineParser.process(app.arguments());
-  Settings::instance().load();
+  {
+    StartupSpan span("settings");
+    Settings::instance().load();
+  }
+
+  if (cmdLineParser.hasProfileStartupOption()) {
+    StartupProfiler::instance().setTraceFile(Settings::instance().getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".startup.json"));
+  }
 
   //Translator must be created before the application's widgets.
-  TranslatorManager* tmanager = TranslatorManager::instance();
-  Q_UNUSED(tmanager)
+  {
+    StartupSpan span("translator");
+    TranslatorManager* tmanager = TranslatorManager::instance();
+    Q_UNUSED(tmanager)
+  }
 
   setlocale(LC_ALL, "");
 
-  QFile File1(":/qdarkstyle/style.qss");
-  File1.open(QFile::ReadOnly);
-  QString StyleSheet1 = QLatin1String(File1.readAll());
-
-  QFile File2(":/skin/dark.qss");
-  File2.open(QFile::ReadOnly);
-  QString StyleSheet2 = QLatin1String(File2.readAll());
-
-  // fix font sizes for MacOS
-  const char MAC_FIX_STYLE_SHEET[] = "QWidget{font-size:12px}";
-#ifdef Q_OS_MAC
-  qApp->setStyleSheet(MAC_FIX_STYLE_SHEET + StyleSheet1 + StyleSheet2);
-#else
-  qApp->setStyleSheet(StyleSheet1 + StyleSheet2);
-#endif
+  {
+    StartupSpan span("stylesheets");
+    // Compiled at build time with the palette resolved and comments stripped, see theme.cmake
+    QFile styleSheet(":/theme/dark.qss");
+    styleSheet.open(QFile::ReadOnly);
+    qApp->setStyleSheet(QLatin1String(styleSheet.readAll()));
+  }
 
   if (PaymentServer::ipcSendCommandLine())
   exit(0);
@@ -119,7 +225,10 @@ int main(int argc, char* argv[]) {
   exec.waitForFinished();
 #endif
 
-  LoggerAdapter::instance().init();
+  {
+    StartupSpan span("logger");
+    LoggerAdapter::instance().init();
+  }
 
   QString dataDirPath = Settings::instance().getDataDir().absolutePath();
 
@@ -128,64 +237,105 @@ int main(int argc, char* argv[]) {
   }
 
   QLockFile lockFile(Settings::instance().getDataDir().absoluteFilePath(QApplication::applicationName() + ".lock"));
-  if (!lockFile.tryLock()) {
+  bool isLocked;
+  {
+    StartupSpan span("lock file");
+    isLocked = lockFile.tryLock();
+  }
+
+  if (!isLocked) {
     QMessageBox::warning(nullptr, QObject::tr("Fail"), QObject::tr("%1 wallet already running or cannot create lock file %2. Check your permissions.").arg(CurrencyAdapter::instance().getCurrencyDisplayName()).arg(Settings::instance().getDataDir().absoluteFilePath(QApplication::applicationName() + ".lock")));
     return 0;
   }
 
+  // The wallet file is read from disk while the node starts
+  WalletAdapter::instance().prefetch();
+
   SignalHandler::instance().init();
   QObject::connect(&SignalHandler::instance(), &SignalHandler::quitSignal, &app, &QApplication::quit);
 
-  if (splash == nullptr) {
-    splash = new QSplashScreen(QPixmap(":images/splash"), Qt::X11BypassWindowManagerHint);
-  }
+  {
+    StartupSpan span("splash");
+    if (splash == nullptr) {
+      splash = new QSplashScreen(QPixmap(":images/splash"), Qt::X11BypassWindowManagerHint);
+    }
 
-  if (!splash->isVisible()) {
-    splash->show();
+    if (!splash->isVisible()) {
+      splash->show();
+    }
   }
 
   splash->showMessage(QObject::tr("Loading blockchain..."), Qt::AlignLeft | Qt::AlignBottom, Qt::white);
 
-  LogFileWatcher* logWatcher(nullptr);
-  if (logWatcher == nullptr) {
-    logWatcher = new LogFileWatcher(Settings::instance().getDataDir().absoluteFilePath(QCoreApplication::applicationName() + ".log"), &app);
-    QObject::connect(logWatcher, &LogFileWatcher::newLogStringSignal, &app, &newLogString);
-  }
+  // Log messages reach the splash screen straight from the logger while the node starts
+  StartupLogSink& startupLogSink = LoggerAdapter::instance().getStartupLogSink();
+  QObject::connect(&startupLogSink, &StartupLogSink::startupMessageSignal, &app, &showSplashMessage);
+  startupLogSink.setEnabled(true);
 
   app.processEvents();
   qRegisterMetaType<CryptoNote::TransactionId>("CryptoNote::TransactionId");
   qRegisterMetaType<QList<CryptoNote::TransactionOutputInformation>>("QList<CryptoNote::TransactionOutputInformation>");
   qRegisterMetaType<quintptr>("quintptr");
-  if (!NodeAdapter::instance().init()) {
-    return 0;
+  {
+    StartupSpan span("node");
+    if (!NodeAdapter::instance().init()) {
+      return 0;
+    }
   }
 
-  splash->finish(&MainWindow::instance());
+  MempoolFeeModel::instance().start();
+  DecoyPrefetcher::instance().start();
 
-  if (logWatcher != nullptr) {
-    logWatcher->deleteLater();
-    logWatcher = nullptr;
+  {
+    StartupSpan span("main window");
+    splash->finish(&MainWindow::instance());
   }
 
+  startupLogSink.setEnabled(false);
+  QObject::disconnect(&startupLogSink, &StartupLogSink::startupMessageSignal, &app, &showSplashMessage);
+
   splash->deleteLater();
   splash = nullptr;
 
   Updater *d = new Updater();
   d->checkForUpdate();
 
-  MainWindow::instance().show();
-  WalletAdapter::instance().open("");
+  // The wallet loads on its own thread, the startup ends when it is ready
+  QObject::connect(&WalletAdapter::instance(), &WalletAdapter::walletInitCompletedSignal, []() {
+    StartupProfiler::instance().finish();
+  });
+
+  {
+    StartupSpan span("show main window");
+    MainWindow::instance().show();
+  }
+
+  {
+    StartupSpan span("wallet open");
+    WalletAdapter::instance().open("");
+  }
 
   QTimer::singleShot(1000, paymentServer, SLOT(uiReady()));
   QObject::connect(paymentServer, &PaymentServer::receivedURI, &MainWindow::instance(), &MainWindow::handlePaymentRequest, Qt::QueuedConnection);
 
-  QObject::connect(QApplication::instance(), &QApplication::aboutToQuit, []() {
+  WalletRpcServer rpcServer(&app);
+  if (cmdLineParser.getWalletRpcPort() != 0 && !rpcServer.start(cmdLineParser.getWalletRpcPort())) {
+    QMessageBox::warning(nullptr, QObject::tr("Wallet RPC"),
+      QObject::tr("Failed to start the wallet RPC server on port %1").arg(cmdLineParser.getWalletRpcPort()));
+  }
+
+  QObject::connect(QApplication::instance(), &QApplication::aboutToQuit, [&rpcServer]() {
+    rpcServer.stop();
     MainWindow::instance().quit();
     if (WalletAdapter::instance().isOpen()) {
       WalletAdapter::instance().close();
     }
 
+    DecoyPrefetcher::instance().stop();
+    MempoolFeeModel::instance().stop();
     NodeAdapter::instance().deinit();
+    Settings::instance().flush();
+    StartupProfiler::instance().finish();
   });
 
   return app.exec();
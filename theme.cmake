@@ -0,0 +1,66 @@
+# Compiles a theme style sheet: concatenates the sources, substitutes the %name% colors of the
+# palette and strips comments and redundant whitespace. The result is embedded as :/theme/dark.qss.
+#
+# cmake -DTHEME_PALETTE=<file> -DTHEME_SOURCES=<file,file,...> -DTHEME_OUTPUT=<file> -P theme.cmake
+
+file(STRINGS "${THEME_PALETTE}" palette_lines)
+foreach(line IN LISTS palette_lines)
+  if(line MATCHES "^[ \t]*([A-Za-z][A-Za-z0-9]*)[ \t]*=[ \t]*([^ \t]+)[ \t]*$")
+    set(theme_color_${CMAKE_MATCH_1} "${CMAKE_MATCH_2}")
+  endif()
+endforeach()
+
+string(REPLACE "," ";" theme_sources "${THEME_SOURCES}")
+set(sheet "")
+foreach(source IN LISTS theme_sources)
+  file(READ "${source}" content)
+  string(APPEND sheet "${content}\n")
+endforeach()
+
+# Comments, searched for instead of matched with a regular expression which backtracks on long ones
+set(stripped "")
+string(FIND "${sheet}" "/*" comment_start)
+while(NOT comment_start EQUAL -1)
+  string(SUBSTRING "${sheet}" 0 ${comment_start} before)
+  string(APPEND stripped "${before}")
+  math(EXPR comment_start "${comment_start} + 2")
+  string(SUBSTRING "${sheet}" ${comment_start} -1 sheet)
+  string(FIND "${sheet}" "*/" comment_end)
+  if(comment_end EQUAL -1)
+    set(sheet "")
+    set(comment_start -1)
+  else()
+    math(EXPR comment_end "${comment_end} + 2")
+    string(SUBSTRING "${sheet}" ${comment_end} -1 sheet)
+    string(FIND "${sheet}" "/*" comment_start)
+  endif()
+endwhile()
+
+string(APPEND stripped "${sheet}")
+set(sheet "${stripped}")
+
+string(REGEX REPLACE "[ \t\r\n]+" " " sheet "${sheet}")
+string(REGEX REPLACE " ?([{};,]) ?" "\\1" sheet "${sheet}")
+string(REPLACE ": " ":" sheet "${sheet}")
+string(STRIP "${sheet}" sheet)
+
+string(REGEX MATCHALL "%[A-Za-z][A-Za-z0-9]*%" placeholders "${sheet}")
+list(REMOVE_DUPLICATES placeholders)
+foreach(placeholder IN LISTS placeholders)
+  string(REPLACE "%" "" name "${placeholder}")
+  if(NOT DEFINED theme_color_${name})
+    message(FATAL_ERROR "Color ${placeholder} is not defined in ${THEME_PALETTE}")
+  endif()
+
+  string(REPLACE "${placeholder}" "${theme_color_${name}}" sheet "${sheet}")
+endforeach()
+
+# Left untouched when unchanged, so the resources aren't rebuilt for nothing
+set(previous "")
+if(EXISTS "${THEME_OUTPUT}")
+  file(READ "${THEME_OUTPUT}" previous)
+endif()
+
+if(NOT previous STREQUAL sheet)
+  file(WRITE "${THEME_OUTPUT}" "${sheet}")
+endif()